@@ -0,0 +1,528 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Configuration tool for RNBD driver and RTRS library.
+ *
+ * Copyright (c) 2019 1&1 IONOS SE. All rights reserved.
+ * Authors: Danil Kipnis <danil.kipnis@cloud.ionos.com>
+ *          Lutz Pogrell <lutz.pogrell@cloud.ionos.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "analyze.h"
+
+#include "table.h"
+#include "misc.h"
+#include "rnbd-sysfs.h"
+
+#define NSEC_PER_SEC	1000000000ull
+#define NSEC_PER_MSEC	1000000ull
+
+#define ANALYZE_WINDOW_MS	1000	/* if no interval is given */
+#define ANALYZE_SAMPLES		10	/* of inflights and latency */
+#define ANALYZE_LOW_SHARE	50	/* % of the fair share */
+#define ANALYZE_LAT_SPREAD	150	/* % of the lowest latency */
+#define ANALYZE_INFL_SKEW	100	/* 1/100 requests */
+
+extern bool trm;
+
+enum an_flags {
+	AN_DOWN		= 1 << 0,	/* not connected */
+	AN_LOW_SHARE	= 1 << 1,	/* less than ANALYZE_LOW_SHARE */
+	AN_SAME_PORT	= 1 << 2,	/* HCA port used by another path */
+};
+
+static const char * const an_flag_names[] = {
+	"down",
+	"low-share",
+	"same-port",
+};
+
+/*
+ * A path of a session with its counters at the start of the window and
+ * the figures derived from the samples taken in it
+ */
+struct an_path {
+	const char	*pathname;
+	const char	*hca;
+	int		port;
+	const char	*state;
+	int		fd;
+	int		lat_fd;
+
+	uint64_t	rx;		/* bytes at the start of the window */
+	uint64_t	tx;
+	uint64_t	rx_delta;	/* in the window */
+	uint64_t	tx_delta;
+	uint64_t	bytes;		/* read and written in the window */
+	uint64_t	rx_rate;	/* per second */
+	uint64_t	tx_rate;
+	uint64_t	share;		/* 1/100 % of the session bytes */
+	uint64_t	infl_sum;
+	uint64_t	lat_sum;
+	uint64_t	inflights;	/* average, 1/100 requests */
+	uint64_t	latency;	/* average, ns */
+	unsigned int	flags;
+};
+
+struct an_sess {
+	struct rnbd_sess *s;
+	struct an_path	*paths;
+	int		path_cnt;
+	int		conn_cnt;	/* connected paths */
+	uint64_t	bytes;
+	uint64_t	fair;		/* 1/100 % of the bytes per path */
+	uint64_t	infl_skew;	/* 1/100 requests, highest - lowest */
+	uint64_t	lat_spread;	/* highest latency, % of the lowest */
+	bool		low_share;
+	const char	*advice;
+	const char	*reason;
+};
+
+static int state_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+			enum color *clr, void *v, bool humanize)
+{
+	const char *state = *(const char **)v;
+
+	*clr = strcmp(state, "connected") ? CRED : CGRN;
+
+	return snprintf(str, len, "%s", state);
+}
+
+static int share_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+			enum color *clr, void *v, bool humanize)
+{
+	*clr = CNRM;
+
+	return snprintf(str, len, humanize ? "%.1f%%" : "%.1f",
+			*(uint64_t *)v / 100.0);
+}
+
+static int infl_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+		       enum color *clr, void *v, bool humanize)
+{
+	*clr = CNRM;
+
+	return snprintf(str, len, "%.2f", *(uint64_t *)v / 100.0);
+}
+
+static int flags_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+			enum color *clr, void *v, bool humanize)
+{
+	unsigned int flags = *(unsigned int *)v;
+	int i, n = 0;
+
+	*clr = flags ? CRED : CNRM;
+	str[0] = '\0';
+
+	for (i = 0; i < ARRSIZE(an_flag_names); i++)
+		if (flags & (1 << i))
+			n += snprintf(str + n, len - n, "%s%s", n ? "," : "",
+				      an_flag_names[i]);
+
+	return n;
+}
+
+#define _CLM_A(s_name, m_name, m_header, m_type, tostr, align, c_clr, \
+	       m_descr) \
+	_CLM(an_path, s_name, m_name, m_header, m_type, tostr, align, \
+	     CNRM, c_clr, m_descr, sizeof(m_header) - 1, 0, 0)
+
+static struct table_column clm_an_pathname =
+	_CLM_A("pathname", pathname, "Path", FLD_STR, path_to_norm, 'l',
+	       CNRM, "Name of the path");
+
+static struct table_column clm_an_hca =
+	_CLM_A("hca_name", hca, "HCA", FLD_STR, NULL, 'l', CNRM,
+	       "HCA of the path");
+
+static struct table_column clm_an_port =
+	_CLM_A("hca_port", port, "Port", FLD_VAL, NULL, 'r', CNRM,
+	       "HCA port of the path");
+
+static struct table_column clm_an_state =
+	_CLM_A("state", state, "State", FLD_STR, state_to_str, 'l', CNRM,
+	       "State of the path");
+
+static struct table_column clm_an_rx =
+	_CLM_A("rx", rx_rate, "RX/s", FLD_LLU, byte_to_str, 'r', CNRM,
+	       "Bytes read per second in the window");
+
+static struct table_column clm_an_tx =
+	_CLM_A("tx", tx_rate, "TX/s", FLD_LLU, byte_to_str, 'r', CNRM,
+	       "Bytes written per second in the window");
+
+static struct table_column clm_an_share =
+	_CLM_A("share", share, "Share", FLD_LLU, share_to_str, 'r', CNRM,
+	       "Share of the traffic of the session in %");
+
+static struct table_column clm_an_inflights =
+	_CLM_A("inflights", inflights, "Inflights", FLD_LLU, infl_to_str,
+	       'r', CNRM, "Average requests in flight");
+
+static struct table_column clm_an_latency =
+	_CLM_A("latency", latency, "Latency", FLD_LLU, ns_to_str, 'r', CNRM,
+	       "Average latency of the path");
+
+static struct table_column clm_an_flags =
+	_CLM_A("flags", flags, "Flags", FLD_STR, flags_to_str, 'l', CNRM,
+	       "Findings: down, low-share or same-port");
+
+static struct table_column *clms_an_paths[] = {
+	&clm_an_pathname,
+	&clm_an_hca,
+	&clm_an_port,
+	&clm_an_state,
+	&clm_an_rx,
+	&clm_an_tx,
+	&clm_an_share,
+	&clm_an_inflights,
+	&clm_an_latency,
+	&clm_an_flags,
+	NULL
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t ns)
+{
+	struct timespec ts = {
+		.tv_sec = ns / NSEC_PER_SEC,
+		.tv_nsec = ns % NSEC_PER_SEC,
+	};
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+			       NULL) == EINTR)
+		;
+}
+
+static bool connected(const struct an_path *p)
+{
+	return !strcmp(p->state, "connected");
+}
+
+/*
+ * The first sample only keeps the byte counters, the following ones add
+ * up inflights and latency and count the bytes since the first one. A
+ * counter which can't be read anymore counts as 0.
+ */
+static void sample(struct an_sess *as, int cnt, bool first)
+{
+	struct rnbd_rdma_stat st;
+	unsigned long lat;
+	struct an_path *p;
+	int i, j;
+
+	for (i = 0; i < cnt; i++) {
+		for (j = 0; j < as[i].path_cnt; j++) {
+			p = &as[i].paths[j];
+
+			lat = 0;
+			if (p->fd < 0 || rnbd_sysfs_read_rdma_stat(p->fd, &st))
+				memset(&st, 0, sizeof(st));
+			if (p->lat_fd >= 0)
+				rnbd_sysfs_read_latency(p->lat_fd, &lat);
+
+			if (first) {
+				p->rx = st.rx_bytes;
+				p->tx = st.tx_bytes;
+				continue;
+			}
+
+			/* the counters start over when they are reset */
+			p->rx_delta = st.rx_bytes >= p->rx ?
+				      st.rx_bytes - p->rx : 0;
+			p->tx_delta = st.tx_bytes >= p->tx ?
+				      st.tx_bytes - p->tx : 0;
+			p->infl_sum += st.inflights;
+			p->lat_sum += lat;
+		}
+	}
+}
+
+static const char *advise(struct an_sess *a, const char **reason)
+{
+	if (a->conn_cnt < 2) {
+		*reason = "less than two paths connected";
+		return NULL;
+	}
+	if (!a->bytes) {
+		*reason = "no traffic in the window";
+		return NULL;
+	}
+	if (a->lat_spread >= ANALYZE_LAT_SPREAD) {
+		*reason = "latency differs between the paths";
+		return "min-latency";
+	}
+	if (a->low_share) {
+		*reason = "paths carry less than their fair share";
+		return "min-inflight";
+	}
+	if (a->infl_skew >= ANALYZE_INFL_SKEW) {
+		*reason = "inflights differ between the paths";
+		return "min-inflight";
+	}
+	*reason = "paths are balanced";
+
+	return NULL;
+}
+
+/*
+ * Derive share, averages and findings of the paths of @a from the
+ * samples taken over @ns and choose a multipath policy
+ */
+static void evaluate(struct an_sess *a, uint64_t ns)
+{
+	uint64_t infl_min = UINT64_MAX, infl_max = 0;
+	uint64_t lat_min = UINT64_MAX, lat_max = 0;
+	struct an_path *p, *q;
+	const char *policy;
+	int i, j;
+
+	for (i = 0; i < a->path_cnt; i++) {
+		p = &a->paths[i];
+
+		p->bytes = p->rx_delta + p->tx_delta;
+		p->rx_rate = ns ? (double)p->rx_delta * NSEC_PER_SEC / ns : 0;
+		p->tx_rate = ns ? (double)p->tx_delta * NSEC_PER_SEC / ns : 0;
+		p->inflights = p->infl_sum * 100 / ANALYZE_SAMPLES;
+		p->latency = p->lat_sum / ANALYZE_SAMPLES;
+		a->bytes += p->bytes;
+
+		if (!connected(p)) {
+			p->flags |= AN_DOWN;
+			continue;
+		}
+		a->conn_cnt++;
+
+		if (p->inflights < infl_min)
+			infl_min = p->inflights;
+		if (p->inflights > infl_max)
+			infl_max = p->inflights;
+		if (p->latency && p->latency < lat_min)
+			lat_min = p->latency;
+		if (p->latency > lat_max)
+			lat_max = p->latency;
+
+		for (j = 0; j < i; j++) {
+			q = &a->paths[j];
+			if (p->hca[0] && p->port == q->port &&
+			    !strcmp(p->hca, q->hca) && connected(q)) {
+				p->flags |= AN_SAME_PORT;
+				q->flags |= AN_SAME_PORT;
+			}
+		}
+	}
+
+	if (a->conn_cnt)
+		a->fair = 10000 / a->conn_cnt;
+	if (infl_max > infl_min)
+		a->infl_skew = infl_max - infl_min;
+	if (lat_max && lat_min != UINT64_MAX)
+		a->lat_spread = lat_max * 100 / lat_min;
+
+	for (i = 0; a->bytes && i < a->path_cnt; i++) {
+		p = &a->paths[i];
+
+		p->share = p->bytes * 10000 / a->bytes;
+		if (connected(p) &&
+		    p->share * 100 < a->fair * ANALYZE_LOW_SHARE) {
+			p->flags |= AN_LOW_SHARE;
+			a->low_share = true;
+		}
+	}
+
+	policy = advise(a, &a->reason);
+	if (policy && a->s->mp && !strcmp(policy, a->s->mp))
+		a->reason = "recommended policy already set";
+	else
+		a->advice = policy;
+}
+
+static void print_term(struct an_sess *as, int cnt, struct table_fld *flds,
+		       uint64_t ns, const struct rnbd_ctx *ctx)
+{
+	int i, j, cs_cnt = table_clm_cnt(clms_an_paths);
+	struct an_sess *a;
+
+	for (i = 0; i < cnt; i++) {
+		a = &as[i];
+
+		if (i)
+			printf("\n");
+		clr_print(trm, CBLD, "%s", a->s->sessname);
+		printf(": %d/%d paths connected, fair share %.1f%%, ",
+		       a->conn_cnt, a->path_cnt, a->fair / 100.0);
+		printf("window %.3fs\n", (double)ns / NSEC_PER_SEC);
+
+		for (j = 0; j < a->path_cnt; j++)
+			table_row_stringify(&a->paths[j], flds + j * cs_cnt,
+					    clms_an_paths, ctx, true, 0);
+		if (!ctx->noheaders_set)
+			table_header_print_term("", clms_an_paths, trm);
+		for (j = 0; j < a->path_cnt; j++)
+			table_flds_print_term("", flds + j * cs_cnt,
+					      clms_an_paths, trm, 0);
+
+		printf("Policy: %s, ", a->s->mp ? a->s->mp : "");
+		if (a->advice)
+			clr_print(trm, CBLD, "recommended: %s", a->advice);
+		else
+			printf("no change");
+		printf(" (%s)\n", a->reason);
+	}
+}
+
+static void print_json(struct an_sess *as, int cnt, struct table_fld *flds,
+		       uint64_t ns, const struct rnbd_ctx *ctx)
+{
+	struct an_sess *a;
+	int i, j;
+
+	printf("[");
+	for (i = 0; i < cnt; i++) {
+		a = &as[i];
+
+		printf("%s\n\t{\"sessname\": \"%s\", \"window\": %.3f, ",
+		       i ? "," : "", a->s->sessname,
+		       (double)ns / NSEC_PER_SEC);
+		printf("\"fair_share\": %.1f, \"policy\": \"%s\", ",
+		       a->fair / 100.0, a->s->mp ? a->s->mp : "");
+		if (a->advice)
+			printf("\"advice\": \"%s\", ", a->advice);
+		else
+			printf("\"advice\": null, ");
+		printf("\"reason\": \"%s\", \"paths\": [", a->reason);
+
+		for (j = 0; j < a->path_cnt; j++) {
+			table_row_stringify(&a->paths[j], flds, clms_an_paths,
+					    ctx, false, 0);
+			if (j)
+				printf(", ");
+			table_flds_print_json_line(flds, clms_an_paths);
+		}
+		printf("]}");
+	}
+	printf("\n]\n");
+}
+
+static void analyze_free(struct an_sess *as, int cnt)
+{
+	struct an_path *p;
+	int i, j;
+
+	for (i = 0; i < cnt; i++) {
+		for (j = 0; j < as[i].path_cnt; j++) {
+			p = &as[i].paths[j];
+			if (p->fd >= 0)
+				close(p->fd);
+			if (p->lat_fd >= 0)
+				close(p->lat_fd);
+		}
+		free(as[i].paths);
+	}
+	free(as);
+}
+
+static int analyze_init(struct an_sess *as, struct rnbd_sess **sess,
+			int cnt)
+{
+	struct rnbd_path *rp;
+	struct an_path *p;
+	int i, j;
+
+	for (i = 0; i < cnt; i++) {
+		as[i].s = sess[i];
+		as[i].paths = calloc(sess[i]->path_cnt + 1,
+				     sizeof(*as[i].paths));
+		if (!as[i].paths)
+			return -ENOMEM;
+		as[i].path_cnt = sess[i]->path_cnt;
+
+		for (j = 0; j < sess[i]->path_cnt; j++) {
+			rp = sess[i]->paths[j];
+			p = &as[i].paths[j];
+
+			p->pathname = rp->pathname;
+			p->hca = rp->hca_name;
+			p->port = rp->hca_port;
+			p->state = rp->state;
+			p->fd = rnbd_sysfs_open_path_stat(RNBD_CLIENT,
+							  sess[i]->sessname,
+							  rp->pathname);
+			p->lat_fd = rnbd_sysfs_open_path_latency(
+						sess[i]->sessname,
+						rp->pathname);
+		}
+	}
+
+	return 0;
+}
+
+int analyze_run(struct rnbd_sess **sess, const char **advice,
+		const struct rnbd_ctx *ctx)
+{
+	struct table_fld *flds;
+	struct an_sess *as;
+	uint64_t start, window, ns;
+	int i, cnt, max = 1, err;
+
+	for (cnt = 0; sess[cnt]; cnt++)
+		if (sess[cnt]->path_cnt > max)
+			max = sess[cnt]->path_cnt;
+
+	as = calloc(cnt + 1, sizeof(*as));
+	flds = calloc(max * table_clm_cnt(clms_an_paths) + 1, sizeof(*flds));
+	if (!as || !flds) {
+		free(as);
+		free(flds);
+		ERR(trm, "Failed to allocate memory\n");
+		return -ENOMEM;
+	}
+
+	err = analyze_init(as, sess, cnt);
+	if (err) {
+		ERR(trm, "Failed to allocate memory\n");
+		goto out;
+	}
+
+	window = (ctx->interval_set ? ctx->interval_ms : ANALYZE_WINDOW_MS) *
+		 NSEC_PER_MSEC;
+
+	start = now_ns();
+	sample(as, cnt, true);
+	for (i = 1; i <= ANALYZE_SAMPLES; i++) {
+		sleep_until(start + window * i / ANALYZE_SAMPLES);
+		sample(as, cnt, false);
+	}
+	ns = now_ns() - start;
+
+	for (i = 0; i < cnt; i++) {
+		evaluate(&as[i], ns);
+		advice[i] = as[i].advice;
+	}
+
+	if (ctx->fmt == FMT_JSON)
+		print_json(as, cnt, flds, ns, ctx);
+	else
+		print_term(as, cnt, flds, ns, ctx);
+	fflush(stdout);
+
+out:
+	analyze_free(as, cnt);
+	free(flds);
+
+	return err;
+}
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Configuration tool for RNBD driver and RTRS library.
+ *
+ * Copyright (c) 2019 1&1 IONOS SE. All rights reserved.
+ * Authors: Danil Kipnis <danil.kipnis@cloud.ionos.com>
+ *          Lutz Pogrell <lutz.pogrell@cloud.ionos.com>
+ */
+
+#ifndef __H_ANALYZE
+#define __H_ANALYZE
+
+struct rnbd_sess;
+struct rnbd_ctx;
+
+/*
+ * Sample the paths of the NULL terminated client sessions @sess over
+ * ctx->interval_ms and print the traffic share, the average inflights
+ * and latency of every path together with the paths carrying less than
+ * their fair share or sharing an HCA port. @advice[i] is set to the
+ * multipath policy recommended for @sess[i], NULL if the current one is
+ * fine. Returns -errno.
+ */
+int analyze_run(struct rnbd_sess **sess, const char **advice,
+		const struct rnbd_ctx *ctx);
+
+#endif /* __H_ANALYZE */
@@ -0,0 +1,424 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Microbenchmarks for rnbd: sysfs scan, stringify and list output.
+ *
+ * Usage: rnbd-bench <sysfs tree>...
+ *
+ * Every tree is a sysfs root as generated by rnbd-sysfs-gen.sh, the
+ * phases are run against the snapshot read from it. For every phase a
+ * tab separated line is written to stdout:
+ *
+ *   tree paths phase iters ns_per_path allocs_per_path
+ *   bytes_per_path syscalls_per_path dir_reads_per_path
+ *
+ * where paths is the number of client and server paths of the tree,
+ * allocs and bytes are counted from malloc(), calloc() and realloc()
+ * and syscalls are counted by tracing a single run of the phase in a
+ * child process (-1 if ptrace is not available). The dir_reads are the
+ * getdents64 calls among them, the directory traversal of the scan
+ * (-1 if the kernel can't tell the system calls). The "snapshot" phase
+ * only reports the memory held by the snapshot in bytes_per_path.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "table.h"
+#include "misc.h"
+#include "list.h"
+
+#include "rnbd-sysfs.h"
+#include "rnbd-clms.h"
+
+#define BENCH_MIN_NS	(300 * 1000 * 1000ull)
+#define BENCH_MIN_ITERS	3
+
+bool trm;
+
+/*
+ * Allocation counters, malloc() and friends of the libc are interposed
+ */
+static uint64_t allocs, alloc_bytes;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+	__atomic_add_fetch(&allocs, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&alloc_bytes, size, __ATOMIC_RELAXED);
+
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	__atomic_add_fetch(&allocs, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&alloc_bytes, nmemb * size, __ATOMIC_RELAXED);
+
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	__atomic_add_fetch(&allocs, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&alloc_bytes, size, __ATOMIC_RELAXED);
+
+	return __libc_realloc(ptr, size);
+}
+
+static struct rnbd_sess_dev **sds_clt, **sds_srv;
+static struct rnbd_sess **sess_clt, **sess_srv;
+static struct rnbd_path **paths_clt, **paths_srv;
+static int sds_clt_cnt, sds_srv_cnt, sess_clt_cnt, sess_srv_cnt,
+	   paths_clt_cnt, paths_srv_cnt;
+
+static struct rnbd_ctx ctx = {
+	.fmt = FMT_TERM,
+	.prec = 3,
+	.jobs = 1,
+};
+
+static int snapshot_read(void)
+{
+	return rnbd_sysfs_read_all(&sds_clt, &sds_srv, &sess_clt, &sess_srv,
+				   &paths_clt, &paths_srv,
+				   &sds_clt_cnt, &sds_srv_cnt,
+				   &sess_clt_cnt, &sess_srv_cnt,
+				   &paths_clt_cnt, &paths_srv_cnt,
+				   ctx.jobs, RNBD_ATTR_ALL);
+}
+
+static void snapshot_free(void)
+{
+	rnbd_sysfs_free_all(sds_clt, sds_srv, sess_clt, sess_srv,
+			     paths_clt, paths_srv);
+}
+
+static void bench_scan(void)
+{
+	if (!snapshot_read())
+		snapshot_free();
+}
+
+static void stringify(struct rnbd_path **paths, struct table_column **cs)
+{
+	struct table_fld flds[CLM_MAX_CNT];
+	int i;
+
+	for (i = 0; paths[i]; i++)
+		table_row_stringify(paths[i], flds, cs, &ctx, true, 0);
+}
+
+static void bench_stringify(void)
+{
+	stringify(paths_clt, all_clms_paths_clt);
+	stringify(paths_srv, all_clms_paths_srv);
+}
+
+static void bench_term(void)
+{
+	struct table_query q;
+
+	table_query_init(&q, "sessname", NULL, 0, all_clms_paths, false,
+			 NULL);
+	list_paths_term(paths_clt, paths_clt_cnt - 1, all_clms_paths_clt, 0,
+			&q, &ctx);
+	list_paths_term(paths_srv, paths_srv_cnt - 1, all_clms_paths_srv, 0,
+			&q, &ctx);
+	fflush(stdout);
+}
+
+/* the busy connected paths, busiest first */
+static void query(struct rnbd_path **paths, int cnt)
+{
+	const char *where[] = { "state=connected", "and", "rx_bytes>0" };
+	struct rnbd_path **res;
+	struct table_query q;
+
+	res = malloc(cnt * sizeof(*res));
+	if (!res)
+		return;
+	memcpy(res, paths, cnt * sizeof(*res));
+
+	table_query_init(&q, "-rx_bytes", where, ARRSIZE(where),
+			 all_clms_paths, false, NULL);
+	cnt = table_rows_filter((void **)res, cnt, &q, &ctx);
+	table_rows_sort((void **)res, cnt, &q, &ctx);
+	free(res);
+}
+
+static void bench_query(void)
+{
+	query(paths_clt, paths_clt_cnt - 1);
+	query(paths_srv, paths_srv_cnt - 1);
+}
+
+/* the 20 busiest paths */
+static void limit(struct rnbd_path **paths, int cnt)
+{
+	struct rnbd_path **res;
+	struct table_query q;
+
+	res = malloc(cnt * sizeof(*res));
+	if (!res)
+		return;
+	memcpy(res, paths, cnt * sizeof(*res));
+
+	table_query_init(&q, "-rx_bytes", NULL, 0, all_clms_paths, false,
+			 NULL);
+	table_rows_top((void **)res, cnt, &q, 20, &ctx);
+	free(res);
+}
+
+static void bench_limit(void)
+{
+	limit(paths_clt, paths_clt_cnt - 1);
+	limit(paths_srv, paths_srv_cnt - 1);
+}
+
+static void bench_group(void)
+{
+	struct table_column *key;
+	struct table_groups g = {};
+
+	key = table_find_column("hca_name", all_clms_paths_clt);
+	table_groups_add(&g, (void **)paths_clt, paths_clt_cnt - 1, key,
+			 all_clms_paths_clt, "outgoing", &ctx);
+	key = table_find_column("hca_name", all_clms_paths_srv);
+	table_groups_add(&g, (void **)paths_srv, paths_srv_cnt - 1, key,
+			 all_clms_paths_srv, "incoming", &ctx);
+	table_groups_free(&g);
+}
+
+static void bench_csv(void)
+{
+	list_paths_csv(paths_clt, all_clms_paths_clt, &ctx);
+	list_paths_csv(paths_srv, all_clms_paths_srv, &ctx);
+	fflush(stdout);
+}
+
+static void bench_json(void)
+{
+	list_paths_json(paths_clt, all_clms_paths_clt, &ctx);
+	list_paths_json(paths_srv, all_clms_paths_srv, &ctx);
+	fflush(stdout);
+}
+
+static void bench_xml(void)
+{
+	list_paths_xml(paths_clt, all_clms_paths_clt, &ctx);
+	list_paths_xml(paths_srv, all_clms_paths_srv, &ctx);
+	fflush(stdout);
+}
+
+static void bench_nop(void)
+{
+}
+
+static const struct bench_phase {
+	const char	*name;
+	void		(*fn)(void);
+} phases[] = {
+	{ "scan",	bench_scan },
+	{ "stringify",	bench_stringify },
+	{ "term",	bench_term },
+	{ "csv",	bench_csv },
+	{ "json",	bench_json },
+	{ "xml",	bench_xml },
+	{ "query",	bench_query },
+	{ "limit",	bench_limit },
+	{ "group",	bench_group },
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* whether the system call the child @pid stopped at reads a directory */
+static int syscall_is_dir_read(pid_t pid)
+{
+#ifdef PTRACE_GET_SYSCALL_INFO
+	struct __ptrace_syscall_info info;
+
+	if (ptrace(PTRACE_GET_SYSCALL_INFO, pid, sizeof(info), &info) <= 0 ||
+	    info.op != PTRACE_SYSCALL_INFO_ENTRY)
+		return -1;
+
+	return info.entry.nr == SYS_getdents64;
+#else
+	return -1;
+#endif
+}
+
+/*
+ * Number of system calls of a single run of @fn, traced in a child.
+ * The directory reads among them are counted in @dirs.
+ */
+static long count_syscalls(void (*fn)(void), long *dirs)
+{
+	bool entry = false;
+	long cnt = 0;
+	pid_t pid;
+	int st, dir;
+
+	*dirs = -1;
+
+	fflush(NULL);
+	pid = fork();
+	if (pid < 0)
+		return -1;
+
+	if (!pid) {
+		if (ptrace(PTRACE_TRACEME, 0, NULL, NULL))
+			_exit(1);
+		raise(SIGSTOP);
+		fn();
+		_exit(0);
+	}
+
+	if (waitpid(pid, &st, 0) < 0 || !WIFSTOPPED(st)) {
+		kill(pid, SIGKILL);
+		waitpid(pid, &st, 0);
+		return -1;
+	}
+	ptrace(PTRACE_SETOPTIONS, pid, NULL,
+	       PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+	*dirs = 0;
+
+	for (;;) {
+		if (ptrace(PTRACE_SYSCALL, pid, NULL, NULL))
+			break;
+		if (waitpid(pid, &st, 0) < 0 || !WIFSTOPPED(st))
+			break;
+		if (WSTOPSIG(st) != (SIGTRAP | 0x80))
+			continue;
+		entry = !entry;
+		if (!entry)
+			continue;
+		cnt++;
+		dir = syscall_is_dir_read(pid);
+		if (dir < 0)
+			*dirs = -1;
+		else if (*dirs >= 0)
+			*dirs += dir;
+	}
+	waitpid(pid, &st, 0);
+
+	return cnt;
+}
+
+static void bench_phase(FILE *out, const char *tree, int paths,
+			const struct bench_phase *ph, long base_syscalls)
+{
+	uint64_t start, ns, a, b;
+	long syscalls, dirs;
+	int iters = 0;
+
+	a = allocs;
+	b = alloc_bytes;
+	start = now_ns();
+	do {
+		ph->fn();
+		iters++;
+		ns = now_ns() - start;
+	} while (ns < BENCH_MIN_NS || iters < BENCH_MIN_ITERS);
+	a = allocs - a;
+	b = alloc_bytes - b;
+
+	syscalls = count_syscalls(ph->fn, &dirs);
+	if (syscalls >= 0 && base_syscalls >= 0)
+		syscalls -= base_syscalls;
+
+	fprintf(out, "%s\t%d\t%s\t%d\t%.1f\t%.3f\t%.1f\t%.3f\t%.3f\n",
+		tree, paths, ph->name, iters,
+		(double)ns / iters / paths,
+		(double)a / iters / paths,
+		(double)b / iters / paths,
+		syscalls < 0 ? -1.0 : (double)syscalls / paths,
+		dirs < 0 ? -1.0 : (double)dirs / paths);
+}
+
+static int bench_tree(FILE *out, const char *tree, long base_syscalls)
+{
+	struct rnbd_sysfs_mem mem;
+	int i, paths, ret;
+
+	setenv("RNBD_SYSFS_ROOT", tree, 1);
+
+	ret = snapshot_read();
+	if (ret) {
+		fprintf(stderr, "%s: failed to read sysfs: %s\n", tree,
+			strerror(-ret));
+		return ret;
+	}
+	paths = paths_clt_cnt - 1 + paths_srv_cnt - 1;
+	if (!paths) {
+		fprintf(stderr, "%s: no paths found\n", tree);
+		snapshot_free();
+		return -ENOENT;
+	}
+
+	rnbd_sysfs_mem_stats(&mem);
+	fprintf(out, "%s\t%d\t%s\t%d\t%.1f\t%.3f\t%.1f\t%.3f\t%.3f\n",
+		tree, paths, "snapshot", 1, 0.0, 0.0,
+		(double)(mem.arena + mem.index) / paths, 0.0, 0.0);
+
+	/* the scan reads a snapshot of its own */
+	for (i = 1; i < ARRSIZE(phases); i++)
+		bench_phase(out, tree, paths, &phases[i], base_syscalls);
+	snapshot_free();
+
+	bench_phase(out, tree, paths, &phases[0], base_syscalls);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	long base_syscalls, dirs;
+	int i, ret = 0;
+	FILE *out;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <sysfs tree>...\n", argv[0]);
+		return 1;
+	}
+
+	/* the output of the phases goes to /dev/null */
+	out = fdopen(dup(STDOUT_FILENO), "w");
+	if (!out || !freopen("/dev/null", "w", stdout)) {
+		perror("stdout");
+		return 1;
+	}
+	setvbuf(out, NULL, _IOLBF, 0);
+
+	base_syscalls = count_syscalls(bench_nop, &dirs);
+
+	fprintf(out, "tree\tpaths\tphase\titers\tns_per_path\t"
+		"allocs_per_path\tbytes_per_path\tsyscalls_per_path\t"
+		"dir_reads_per_path\n");
+	for (i = 1; i < argc; i++)
+		if (bench_tree(out, argv[i], base_syscalls))
+			ret = 1;
+
+	fclose(out);
+
+	return ret;
+}
@@ -25,57 +25,48 @@ int list_devices_term(struct rnbd_sess_dev **sds,
 		      const struct rnbd_ctx *ctx)
 {
 	struct rnbd_dev d_total = {
-		.rx_sect = 0,
-		.tx_sect = 0
+		.devname = "",
+		.devpath = "",
+		.state = ""
 	};
 	struct rnbd_sess_dev total = {
 		.dev = &d_total,
-		.mapping_path = ""
+		.mapping_path = "",
+		.access_mode = ""
 	};
-	struct table_fld *flds;
-	int i, cs_cnt, dev_num;
+	struct table_fld flds[CLM_MAX_CNT];
 	bool nototals_set = ctx->nototals_set;
-
-	cs_cnt = table_clm_cnt(cs);
-
-	for (dev_num = 0; sds[dev_num]; dev_num++)
-		;
+	int i;
 
 	if (!table_has_num(cs))
 		nototals_set = true;
 
-	flds = calloc((dev_num + 1) * cs_cnt, sizeof(*flds));
-	if (!flds) {
-		ERR(trm, "not enough memory\n");
-		return -ENOMEM;
-	}
-
 	for (i = 0; sds[i]; i++) {
-		table_row_stringify(sds[i], flds + i * cs_cnt, cs, ctx, true, 0);
-		total.dev->rx_sect += sds[i]->dev->rx_sect;
-		total.dev->tx_sect += sds[i]->dev->tx_sect;
+		unsigned long *sum = (unsigned long *)&d_total.stat;
+		unsigned long *st = (unsigned long *)&sds[i]->dev->stat;
+		int k;
+
+		table_row_widths(sds[i], cs, ctx, true, 0);
+		for (k = 0; k < sizeof(d_total.stat) / sizeof(*sum); k++)
+			sum[k] += st[k];
 	}
 
 	if (!nototals_set)
-		table_row_stringify(&total, flds + i * cs_cnt,
-				    cs, ctx, true, 0);
+		table_row_widths(&total, cs, ctx, true, 0);
 
 	if (!ctx->noheaders_set)
 		table_header_print_term("", cs, trm);
 
-	for (i = 0; i < dev_num; i++)
-		table_flds_print_term("", flds + i * cs_cnt,
-				      cs, trm, 0);
+	for (i = 0; sds[i]; i++)
+		table_row_print(sds[i], FMT_TERM, "", cs, trm, ctx, true, 0);
 
 	if (!nototals_set) {
 		table_row_print_line("", cs, trm, 0);
-		table_flds_del_not_num(flds + i * cs_cnt, cs);
-		table_flds_print_term("", flds + i * cs_cnt,
-				      cs, trm, 0);
+		table_row_stringify(&total, flds, cs, ctx, true, 0);
+		table_flds_del_not_num(flds, cs);
+		table_flds_print_term("", flds, cs, trm, 0);
 	}
 
-	free(flds);
-
 	return 0;
 }
 
@@ -92,7 +83,9 @@ void list_devices_csv(struct rnbd_sess_dev **sds,
 		table_header_print_csv(cs);
 
 	for (i = 0; sds[i]; i++)
-		table_row_print(sds[i], FMT_CSV, "", cs, false, ctx, false, 0);
+		table_row_out(sds[i], FMT_CSV, "", cs, ctx);
+
+	table_out_flush();
 }
 
 void list_devices_json(struct rnbd_sess_dev **sds,
@@ -104,15 +97,16 @@ void list_devices_json(struct rnbd_sess_dev **sds,
 	if (!sds[0])
 		return;
 
-	printf("[\n");
+	table_out_printf("[\n");
 
 	for (i = 0; sds[i]; i++) {
 		if (i)
-			printf(",\n");
-		table_row_print(sds[i], FMT_JSON, "\t\t", cs, false, ctx, false, 0);
+			table_out_printf(",\n");
+		table_row_out(sds[i], FMT_JSON, "\t\t", cs, ctx);
 	}
 
-	printf("\n\t]");
+	table_out_printf("\n\t]");
+	table_out_flush();
 }
 
 void list_devices_xml(struct rnbd_sess_dev **sds,
@@ -122,24 +116,37 @@ void list_devices_xml(struct rnbd_sess_dev **sds,
 	int i;
 
 	for (i = 0; sds[i]; i++) {
-		printf("\t<device>\n");
-		table_row_print(sds[i], FMT_XML, "\t\t", cs, false, ctx, false, 0);
-		printf("\t</device>\n");
+		table_out_printf("\t<device>\n");
+		table_row_out(sds[i], FMT_XML, "\t\t", cs, ctx);
+		table_out_printf("\t</device>\n");
 	}
+
+	table_out_flush();
 }
 
-static int compar_sess_sessname(const void *p1, const void *p2)
+void list_devices_prom(struct rnbd_sess_dev **clt,
+		       struct table_column **cs_clt,
+		       struct rnbd_sess_dev **srv,
+		       struct table_column **cs_srv,
+		       const struct rnbd_ctx *ctx)
 {
-	const struct rnbd_sess *const *sess1 = p1, *const *sess2 = p2;
+	void **rows[] = { (void **)clt, (void **)srv };
+	struct table_column **cs[] = { cs_clt, cs_srv };
 
-	return strcmp((*sess1)->sessname, (*sess2)->sessname);
+	table_rows_print_prom("rnbd_device", rows, cs, ARRSIZE(rows), ctx);
 }
 
 int list_sessions_term(struct rnbd_sess **sessions,
 		       struct table_column **cs,
+		       const struct table_query *paths_q,
 		       const struct rnbd_ctx *ctx)
 {
 	struct rnbd_sess total = {
+		.sessname = "",
+		.mp = "",
+		.mp_short = "",
+		.hostname = "",
+		.path_uu = "",
 		.act_path_cnt = 0,
 		.path_cnt = 0,
 		.rx_bytes = 0,
@@ -147,70 +154,44 @@ int list_sessions_term(struct rnbd_sess **sessions,
 		.inflights = 0,
 		.reconnects = 0
 	};
-	int i, cs_cnt, sess_num;
-	struct table_fld *flds;
-	struct rnbd_sess **sorted_sessions;
-
-	cs_cnt = table_clm_cnt(cs);
-	for (sess_num = 0; sessions[sess_num]; sess_num++)
-		;
+	struct table_fld flds[CLM_MAX_CNT];
+	int i, err = 0;
 
-	sorted_sessions = calloc(sess_num + 1, sizeof(*sessions));
-	if (!sorted_sessions) {
-		ERR(trm, "not enough memory\n");
-		return -ENOMEM;
-	}
-	memcpy(sorted_sessions, sessions, sizeof(*sessions) * sess_num);
-	qsort(sorted_sessions, sess_num, sizeof(*sorted_sessions), compar_sess_sessname);
-
-	flds = calloc((sess_num + 1) * cs_cnt, sizeof(*flds));
-	if (!flds) {
-		free(sorted_sessions);
-		ERR(trm, "not enough memory\n");
-		return -ENOMEM;
-	}
-
-	for (i = 0; sorted_sessions[i]; i++) {
-		table_row_stringify(sorted_sessions[i], flds + i * cs_cnt, cs,
-				    ctx, true, 0);
-
-		total.act_path_cnt += sorted_sessions[i]->act_path_cnt;
-		total.path_cnt += sorted_sessions[i]->path_cnt;
-		total.rx_bytes += sorted_sessions[i]->rx_bytes;
-		total.tx_bytes += sorted_sessions[i]->tx_bytes;
-		total.inflights += sorted_sessions[i]->inflights;
-		total.reconnects += sorted_sessions[i]->reconnects;
+	for (i = 0; sessions[i]; i++) {
+		table_row_widths(sessions[i], cs, ctx, true, 0);
+
+		total.act_path_cnt += sessions[i]->act_path_cnt;
+		total.path_cnt += sessions[i]->path_cnt;
+		total.rx_bytes += sessions[i]->rx_bytes;
+		total.tx_bytes += sessions[i]->tx_bytes;
+		total.inflights += sessions[i]->inflights;
+		total.reconnects += sessions[i]->reconnects;
 	}
 
-	if (!ctx->nototals_set) {
-		table_row_stringify(&total, flds + sess_num * cs_cnt,
-				    cs, ctx, true, 0);
-	}
+	if (!ctx->nototals_set)
+		table_row_widths(&total, cs, ctx, true, 0);
 
 	if (!ctx->noheaders_set)
 		table_header_print_term("", cs, trm);
 
-	for (i = 0; sorted_sessions[i]; i++) {
-		table_flds_print_term("", flds + i * cs_cnt,
-				      cs, trm, 0);
+	for (i = 0; sessions[i] && !err; i++) {
+		table_row_print(sessions[i], FMT_TERM, "", cs, trm,
+				ctx, true, 0);
 		if (!ctx->notree_set)
-			list_paths_term(sorted_sessions[i]->paths,
-					sorted_sessions[i]->path_cnt,
-					clms_paths_shortdesc, 1, ctx,
-					compar_paths_hca_src);
+			err = list_paths_term(sessions[i]->paths,
+					      sessions[i]->path_cnt,
+					      clms_paths_shortdesc, 1,
+					      paths_q, ctx);
 	}
 
 	if (!ctx->nototals_set && table_has_num(cs)) {
 		table_row_print_line("", cs, trm, 0);
-		table_flds_del_not_num(flds + sess_num * cs_cnt, cs);
-		table_flds_print_term("", flds + sess_num * cs_cnt,
-				      cs, trm, 0);
+		table_row_stringify(&total, flds, cs, ctx, true, 0);
+		table_flds_del_not_num(flds, cs);
+		table_flds_print_term("", flds, cs, trm, 0);
 	}
 
-	free(sorted_sessions);
-	free(flds);
-
-	return 0;
+	return err;
 }
 
 void list_sessions_csv(struct rnbd_sess **sessions,
@@ -223,7 +204,9 @@ void list_sessions_csv(struct rnbd_sess **sessions,
 		table_header_print_csv(cs);
 
 	for (i = 0; sessions[i]; i++)
-		table_row_print(sessions[i], FMT_CSV, "", cs, false, ctx, false, 0);
+		table_row_out(sessions[i], FMT_CSV, "", cs, ctx);
+
+	table_out_flush();
 }
 
 void list_sessions_json(struct rnbd_sess **sessions,
@@ -232,16 +215,16 @@ void list_sessions_json(struct rnbd_sess **sessions,
 {
 	int i;
 
-	printf("[\n");
+	table_out_printf("[\n");
 
 	for (i = 0; sessions[i]; i++) {
 		if (i)
-			printf(",\n");
-		table_row_print(sessions[i], FMT_JSON, "\t\t", cs,
-				false, ctx, false, 0);
+			table_out_printf(",\n");
+		table_row_out(sessions[i], FMT_JSON, "\t\t", cs, ctx);
 	}
 
-	printf("\n\t]");
+	table_out_printf("\n\t]");
+	table_out_flush();
 }
 
 void list_sessions_xml(struct rnbd_sess **sessions,
@@ -251,31 +234,30 @@ void list_sessions_xml(struct rnbd_sess **sessions,
 	int i;
 
 	for (i = 0; sessions[i]; i++) {
-		printf("\t<session>\n");
-		table_row_print(sessions[i], FMT_XML, "\t\t", cs,
-				false, ctx, false, 0);
-		printf("\t</session>\n");
+		table_out_printf("\t<session>\n");
+		table_row_out(sessions[i], FMT_XML, "\t\t", cs, ctx);
+		table_out_printf("\t</session>\n");
 	}
-}
-
-int compar_paths_hca_src(const void *p1, const void *p2)
-{
-	const struct rnbd_path *const *path1 = p1, *const *path2 = p2;
 
-	return strcmp((*path1)->hca_name, (*path2)->hca_name) ?
-		: strcmp((*path1)->src_addr, (*path2)->src_addr);
+	table_out_flush();
 }
 
-int compar_paths_sessname(const void *p1, const void *p2)
+void list_sessions_prom(struct rnbd_sess **clt,
+			struct table_column **cs_clt,
+			struct rnbd_sess **srv,
+			struct table_column **cs_srv,
+			const struct rnbd_ctx *ctx)
 {
-	const struct rnbd_path *const *path1 = p1, *const *path2 = p2;
+	void **rows[] = { (void **)clt, (void **)srv };
+	struct table_column **cs[] = { cs_clt, cs_srv };
 
-	return strcmp((*path1)->sess->sessname, (*path2)->sess->sessname);
+	table_rows_print_prom("rnbd_session", rows, cs, ARRSIZE(rows), ctx);
 }
 
 static struct rnbd_path **alloc_sorted_paths(struct rnbd_path **paths,
 					     int path_cnt,
-					     int (*comp)(const void *p1, const void *p2))
+					     const struct table_query *q,
+					     const struct rnbd_ctx *ctx)
 {
 	struct rnbd_path **sorted_paths;
 
@@ -284,9 +266,9 @@ static struct rnbd_path **alloc_sorted_paths(struct rnbd_path **paths,
 		return NULL;
 	memcpy(sorted_paths, paths, sizeof(*paths) * path_cnt);
 
-	if (comp) {
-		/* sort the list according to the first column */
-		qsort(sorted_paths, path_cnt, sizeof(*paths), comp);
+	if (q && table_rows_sort((void **)sorted_paths, path_cnt, q, ctx)) {
+		free(sorted_paths);
+		return NULL;
 	}
 	return sorted_paths;
 }
@@ -298,20 +280,23 @@ static void free_sorted_paths(struct rnbd_path **sorted_paths)
 
 int list_paths_term(struct rnbd_path **paths, int path_cnt,
 		    struct table_column **cs, int tree,
-		    const struct rnbd_ctx *ctx,
-		    int (*comp)(const void *p1, const void *p2))
+		    const struct table_query *q,
+		    const struct rnbd_ctx *ctx)
 {
 	struct rnbd_path total = {
+		.pathname = "",
+		.src_addr = "",
+		.dst_addr = "",
+		.hca_name = "",
+		.state = "",
 		.rx_bytes = 0,
 		.tx_bytes = 0,
 		.inflights = 0,
 		.reconnects = 0
 	};
-	int i, cs_cnt, fld_cnt = 0;
-	struct table_fld *flds;
+	struct table_fld flds[CLM_MAX_CNT];
 	struct rnbd_path **sorted_paths;
-
-	cs_cnt = table_clm_cnt(cs);
+	int i;
 
 	for (i = 0; i < path_cnt; i++) {
 		if (!paths[i]) {
@@ -319,15 +304,9 @@ int list_paths_term(struct rnbd_path **paths, int path_cnt,
 			return -EFAULT;
 		}
 	}
-	flds = calloc((path_cnt + 1) * cs_cnt, sizeof(*flds));
-	if (!flds) {
-		ERR(trm, "not enough memory\n");
-		return -ENOMEM;
-	}
 
-	sorted_paths = alloc_sorted_paths(paths, path_cnt, comp);
+	sorted_paths = alloc_sorted_paths(paths, path_cnt, q, ctx);
 	if (!sorted_paths) {
-		free(flds);
 		ERR(trm, "not enough memory\n");
 		return -EFAULT;
 	}
@@ -335,42 +314,39 @@ int list_paths_term(struct rnbd_path **paths, int path_cnt,
 	for (i = 0; i < path_cnt; i++) {
 		if (!sorted_paths[i]) {
 			free_sorted_paths(sorted_paths);
-			free(flds);
 			ERR(trm, "inconsistent internal data path_cnt <-> paths\n");
 			return -EFAULT;
 		}
-		table_row_stringify(sorted_paths[i], flds + fld_cnt, cs, ctx, true, 0);
-
-		fld_cnt += cs_cnt;
+		table_row_widths(sorted_paths[i], cs, ctx, true, 0);
 
+		total.rx_cnt += sorted_paths[i]->rx_cnt;
 		total.rx_bytes += sorted_paths[i]->rx_bytes;
+		total.tx_cnt += sorted_paths[i]->tx_cnt;
 		total.tx_bytes += sorted_paths[i]->tx_bytes;
 		total.inflights += sorted_paths[i]->inflights;
 		total.reconnects += sorted_paths[i]->reconnects;
+		total.migr.total += sorted_paths[i]->migr.total;
 	}
 
 	if (!ctx->nototals_set)
-		table_row_stringify(&total, flds + fld_cnt, cs, ctx, true, 0);
+		table_row_widths(&total, cs, ctx, true, 0);
 
 	if (!ctx->noheaders_set && !tree)
 		table_header_print_term("", cs, trm);
 
-	fld_cnt = 0;
-	for (i = 0; i < path_cnt; i++) {
-		table_flds_print_term(
-			!tree ? "" : i < path_cnt - 1 ?
-			"├─ " : "└─ ", flds + fld_cnt, cs, trm, 0);
-		fld_cnt += cs_cnt;
-	}
+	for (i = 0; i < path_cnt; i++)
+		table_row_print(sorted_paths[i], FMT_TERM,
+				!tree ? "" : i < path_cnt - 1 ?
+				"├─ " : "└─ ", cs, trm, ctx, true, 0);
 
 	if (!ctx->nototals_set && table_has_num(cs) && !tree) {
 		table_row_print_line("", cs, trm, 0);
-		table_flds_del_not_num(flds + fld_cnt, cs);
-		table_flds_print_term("", flds + fld_cnt, cs, trm, 0);
+		table_row_stringify(&total, flds, cs, ctx, true, 0);
+		table_flds_del_not_num(flds, cs);
+		table_flds_print_term("", flds, cs, trm, 0);
 	}
 
 	free_sorted_paths(sorted_paths);
-	free(flds);
 
 	return 0;
 }
@@ -385,8 +361,9 @@ void list_paths_csv(struct rnbd_path **paths,
 		table_header_print_csv(cs);
 
 	for (i = 0; paths[i]; i++)
-		table_row_print(paths[i], FMT_CSV, "", cs,
-				false, ctx, false, 0);
+		table_row_out(paths[i], FMT_CSV, "", cs, ctx);
+
+	table_out_flush();
 }
 
 void list_paths_json(struct rnbd_path **paths,
@@ -395,16 +372,16 @@ void list_paths_json(struct rnbd_path **paths,
 {
 	int i;
 
-	printf("\n\t[\n");
+	table_out_printf("[\n");
 
 	for (i = 0; paths[i]; i++) {
 		if (i)
-			printf(",\n");
-		table_row_print(paths[i], FMT_JSON, "\t\t", cs,
-				false, ctx, false, 0);
+			table_out_printf(",\n");
+		table_row_out(paths[i], FMT_JSON, "\t\t", cs, ctx);
 	}
 
-	printf("\n\t]");
+	table_out_printf("\n\t]");
+	table_out_flush();
 }
 
 void list_paths_xml(struct rnbd_path **paths,
@@ -414,10 +391,307 @@ void list_paths_xml(struct rnbd_path **paths,
 	int i;
 
 	for (i = 0; paths[i]; i++) {
-		printf("\t<path>\n");
-		table_row_print(paths[i], FMT_XML, "\t\t", cs,
-				false, ctx, false, 0);
-		printf("\t</path>\n");
+		table_out_printf("\t<path>\n");
+		table_row_out(paths[i], FMT_XML, "\t\t", cs, ctx);
+		table_out_printf("\t</path>\n");
+	}
+
+	table_out_flush();
+}
+
+void list_paths_prom(struct rnbd_path **clt,
+		     struct table_column **cs_clt,
+		     struct rnbd_path **srv,
+		     struct table_column **cs_srv,
+		     const struct rnbd_ctx *ctx)
+{
+	void **rows[] = { (void **)clt, (void **)srv };
+	struct table_column **cs[] = { cs_clt, cs_srv };
+
+	table_rows_print_prom("rnbd_path", rows, cs, ARRSIZE(rows), ctx);
+}
+
+
+int list_hcas_term(struct rnbd_hca_port **ports,
+		   struct table_column **cs,
+		   const struct rnbd_ctx *ctx)
+{
+	struct rnbd_hca_port total = {
+		.hca_name = "",
+		.gid = "",
+		.link_state = "",
+		.rate = ""
+	};
+	struct table_fld flds[CLM_MAX_CNT];
+	int i;
+
+	for (i = 0; ports[i]; i++) {
+		table_row_widths(ports[i], cs, ctx, true, 0);
+
+		total.path_cnt += ports[i]->path_cnt;
+		total.act_path_cnt += ports[i]->act_path_cnt;
+		total.rx_bytes += ports[i]->rx_bytes;
+		total.tx_bytes += ports[i]->tx_bytes;
+		total.inflights += ports[i]->inflights;
+		total.reconnects += ports[i]->reconnects;
+	}
+
+	if (!ctx->nototals_set)
+		table_row_widths(&total, cs, ctx, true, 0);
+
+	if (!ctx->noheaders_set)
+		table_header_print_term("", cs, trm);
+
+	for (i = 0; ports[i]; i++)
+		table_row_print(ports[i], FMT_TERM, "", cs, trm, ctx, true, 0);
+
+	if (!ctx->nototals_set && table_has_num(cs)) {
+		table_row_print_line("", cs, trm, 0);
+		table_row_stringify(&total, flds, cs, ctx, true, 0);
+		table_flds_del_not_num(flds, cs);
+		table_flds_print_term("", flds, cs, trm, 0);
 	}
+
+	return 0;
+}
+
+void list_hcas_csv(struct rnbd_hca_port **ports,
+		   struct table_column **cs,
+		   const struct rnbd_ctx *ctx)
+{
+	int i;
+
+	if (!ctx->noheaders_set)
+		table_header_print_csv(cs);
+
+	for (i = 0; ports[i]; i++)
+		table_row_out(ports[i], FMT_CSV, "", cs, ctx);
+
+	table_out_flush();
 }
 
+void list_hcas_json(struct rnbd_hca_port **ports,
+		    struct table_column **cs,
+		    const struct rnbd_ctx *ctx)
+{
+	int i;
+
+	table_out_printf("[\n");
+
+	for (i = 0; ports[i]; i++) {
+		if (i)
+			table_out_printf(",\n");
+		table_row_out(ports[i], FMT_JSON, "\t\t", cs, ctx);
+	}
+
+	table_out_printf("\n\t]");
+	table_out_flush();
+}
+
+void list_hcas_xml(struct rnbd_hca_port **ports,
+		   struct table_column **cs,
+		   const struct rnbd_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; ports[i]; i++) {
+		table_out_printf("\t<port>\n");
+		table_row_out(ports[i], FMT_XML, "\t\t", cs, ctx);
+		table_out_printf("\t</port>\n");
+	}
+
+	table_out_flush();
+}
+
+void list_hcas_prom(struct rnbd_hca_port **ports,
+		    struct table_column **cs,
+		    const struct rnbd_ctx *ctx)
+{
+	void **rows[] = { (void **)ports };
+	struct table_column **css[] = { cs };
+
+	table_rows_print_prom("rnbd_hca_port", rows, css, ARRSIZE(rows), ctx);
+}
+
+int list_hosts_term(struct rnbd_host **hosts,
+		    struct table_column **cs,
+		    const struct rnbd_ctx *ctx)
+{
+	struct rnbd_host total = {
+		.hostname = "",
+		.side = hosts[0] ? hosts[0]->side : RNBD_CLIENT
+	};
+	struct table_fld flds[CLM_MAX_CNT];
+	int i;
+
+	for (i = 0; hosts[i]; i++) {
+		table_row_widths(hosts[i], cs, ctx, true, 0);
+
+		total.sess_cnt += hosts[i]->sess_cnt;
+		total.dev_cnt += hosts[i]->dev_cnt;
+		total.path_cnt += hosts[i]->path_cnt;
+		total.act_path_cnt += hosts[i]->act_path_cnt;
+		total.rx_bytes += hosts[i]->rx_bytes;
+		total.tx_bytes += hosts[i]->tx_bytes;
+		total.inflights += hosts[i]->inflights;
+		total.reconnects += hosts[i]->reconnects;
+	}
+
+	if (!ctx->nototals_set)
+		table_row_widths(&total, cs, ctx, true, 0);
+
+	if (!ctx->noheaders_set)
+		table_header_print_term("", cs, trm);
+
+	for (i = 0; hosts[i]; i++)
+		table_row_print(hosts[i], FMT_TERM, "", cs, trm, ctx, true, 0);
+
+	if (!ctx->nototals_set && table_has_num(cs)) {
+		table_row_print_line("", cs, trm, 0);
+		table_row_stringify(&total, flds, cs, ctx, true, 0);
+		table_flds_del_not_num(flds, cs);
+		table_flds_print_term("", flds, cs, trm, 0);
+	}
+
+	return 0;
+}
+
+void list_hosts_csv(struct rnbd_host **hosts,
+		    struct table_column **cs,
+		    const struct rnbd_ctx *ctx)
+{
+	int i;
+
+	if (!ctx->noheaders_set)
+		table_header_print_csv(cs);
+
+	for (i = 0; hosts[i]; i++)
+		table_row_out(hosts[i], FMT_CSV, "", cs, ctx);
+
+	table_out_flush();
+}
+
+void list_hosts_json(struct rnbd_host **hosts,
+		     struct table_column **cs,
+		     const struct rnbd_ctx *ctx)
+{
+	int i;
+
+	table_out_printf("[\n");
+
+	for (i = 0; hosts[i]; i++) {
+		if (i)
+			table_out_printf(",\n");
+		table_row_out(hosts[i], FMT_JSON, "\t\t", cs, ctx);
+	}
+
+	table_out_printf("\n\t]");
+	table_out_flush();
+}
+
+void list_hosts_xml(struct rnbd_host **hosts,
+		    struct table_column **cs,
+		    const struct rnbd_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; hosts[i]; i++) {
+		table_out_printf("\t<host>\n");
+		table_row_out(hosts[i], FMT_XML, "\t\t", cs, ctx);
+		table_out_printf("\t</host>\n");
+	}
+
+	table_out_flush();
+}
+
+void list_hosts_prom(struct rnbd_host **clt, struct rnbd_host **srv,
+		     struct table_column **cs,
+		     const struct rnbd_ctx *ctx)
+{
+	void **rows[] = { (void **)clt, (void **)srv };
+	struct table_column **css[] = { cs, cs };
+
+	table_rows_print_prom("rnbd_host", rows, css, ARRSIZE(rows), ctx);
+}
+
+int list_groups_term(struct table_groups *g, const struct rnbd_ctx *ctx)
+{
+	struct table_fld flds[CLM_MAX_CNT];
+	struct table_group total;
+	int i;
+
+	for (i = 0; i < g->cnt; i++)
+		table_row_widths(g->groups[i], g->cs, ctx, true, 0);
+
+	if (!ctx->nototals_set) {
+		table_groups_total(g, &total);
+		table_row_widths(&total, g->cs, ctx, true, 0);
+	}
+
+	if (!ctx->noheaders_set)
+		table_header_print_term("", g->cs, trm);
+
+	for (i = 0; i < g->cnt; i++)
+		table_row_print(g->groups[i], FMT_TERM, "", g->cs, trm, ctx,
+				true, 0);
+
+	if (!ctx->nototals_set) {
+		table_row_print_line("", g->cs, trm, 0);
+		table_row_stringify(&total, flds, g->cs, ctx, true, 0);
+		table_flds_del_not_num(flds, g->cs);
+		table_flds_print_term("", flds, g->cs, trm, 0);
+	}
+
+	return 0;
+}
+
+void list_groups_csv(struct table_groups *g, const struct rnbd_ctx *ctx)
+{
+	int i;
+
+	if (!ctx->noheaders_set)
+		table_header_print_csv(g->cs);
+
+	for (i = 0; i < g->cnt; i++)
+		table_row_out(g->groups[i], FMT_CSV, "", g->cs, ctx);
+
+	table_out_flush();
+}
+
+void list_groups_json(struct table_groups *g, const struct rnbd_ctx *ctx)
+{
+	int i;
+
+	table_out_printf("[\n");
+
+	for (i = 0; i < g->cnt; i++) {
+		if (i)
+			table_out_printf(",\n");
+		table_row_out(g->groups[i], FMT_JSON, "\t\t", g->cs, ctx);
+	}
+
+	table_out_printf("\n\t]");
+	table_out_flush();
+}
+
+void list_groups_xml(struct table_groups *g, const struct rnbd_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < g->cnt; i++) {
+		table_out_printf("\t<group>\n");
+		table_row_out(g->groups[i], FMT_XML, "\t\t", g->cs, ctx);
+		table_out_printf("\t</group>\n");
+	}
+
+	table_out_flush();
+}
+
+void list_groups_prom(const char *prefix, struct table_groups *g,
+		      const struct rnbd_ctx *ctx)
+{
+	void **rows[] = { (void **)g->groups };
+	struct table_column **css[] = { g->cs };
+
+	table_rows_print_prom(prefix, rows, css, ARRSIZE(rows), ctx);
+}
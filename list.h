@@ -11,7 +11,11 @@
 struct rnbd_sess_dev;
 struct rnbd_path;
 struct rnbd_sess;
+struct rnbd_hca_port;
+struct rnbd_host;
 struct table_column;
+struct table_query;
+struct table_groups;
 struct rnbd_ctx;
 
 int list_devices_term(struct rnbd_sess_dev **sds,
@@ -30,8 +34,19 @@ void list_devices_xml(struct rnbd_sess_dev **sds,
 		      struct table_column **cs,
 		      const struct rnbd_ctx *ctx);
 
+/*
+ * The metrics of the imported (@clt) and exported (@srv) devices in the
+ * Prometheus text format, either array may be NULL.
+ */
+void list_devices_prom(struct rnbd_sess_dev **clt,
+		       struct table_column **cs_clt,
+		       struct rnbd_sess_dev **srv,
+		       struct table_column **cs_srv,
+		       const struct rnbd_ctx *ctx);
+
 int list_sessions_term(struct rnbd_sess **sessions,
 		       struct table_column **cs,
+		       const struct table_query *paths_q,
 		       const struct rnbd_ctx *ctx);
 
 void list_sessions_csv(struct rnbd_sess **sessions,
@@ -46,10 +61,16 @@ void list_sessions_xml(struct rnbd_sess **sessions,
 		       struct table_column **cs,
 		       const struct rnbd_ctx *ctx);
 
+void list_sessions_prom(struct rnbd_sess **clt,
+			struct table_column **cs_clt,
+			struct rnbd_sess **srv,
+			struct table_column **cs_srv,
+			const struct rnbd_ctx *ctx);
+
 int list_paths_term(struct rnbd_path **paths, int path_cnt,
 		    struct table_column **cs, int tree,
-		    const struct rnbd_ctx *ctx,
-		    int (*comp)(const void *p1, const void *p2));
+		    const struct table_query *q,
+		    const struct rnbd_ctx *ctx);
 
 void list_paths_csv(struct rnbd_path **paths,
 		    struct table_column **cs,
@@ -63,6 +84,60 @@ void list_paths_xml(struct rnbd_path **paths,
 		    struct table_column **cs,
 		    const struct rnbd_ctx *ctx);
 
-/* add more path comparation */
-int compar_paths_hca_src(const void *p1, const void *p2);
-int compar_paths_sessname(const void *p1, const void *p2);
+void list_paths_prom(struct rnbd_path **clt,
+		     struct table_column **cs_clt,
+		     struct rnbd_path **srv,
+		     struct table_column **cs_srv,
+		     const struct rnbd_ctx *ctx);
+
+int list_hcas_term(struct rnbd_hca_port **ports,
+		   struct table_column **cs,
+		   const struct rnbd_ctx *ctx);
+
+void list_hcas_csv(struct rnbd_hca_port **ports,
+		   struct table_column **cs,
+		   const struct rnbd_ctx *ctx);
+
+void list_hcas_json(struct rnbd_hca_port **ports,
+		    struct table_column **cs,
+		    const struct rnbd_ctx *ctx);
+
+void list_hcas_xml(struct rnbd_hca_port **ports,
+		   struct table_column **cs,
+		   const struct rnbd_ctx *ctx);
+
+void list_hcas_prom(struct rnbd_hca_port **ports,
+		    struct table_column **cs,
+		    const struct rnbd_ctx *ctx);
+
+int list_hosts_term(struct rnbd_host **hosts,
+		    struct table_column **cs,
+		    const struct rnbd_ctx *ctx);
+
+void list_hosts_csv(struct rnbd_host **hosts,
+		    struct table_column **cs,
+		    const struct rnbd_ctx *ctx);
+
+void list_hosts_json(struct rnbd_host **hosts,
+		     struct table_column **cs,
+		     const struct rnbd_ctx *ctx);
+
+void list_hosts_xml(struct rnbd_host **hosts,
+		    struct table_column **cs,
+		    const struct rnbd_ctx *ctx);
+
+void list_hosts_prom(struct rnbd_host **clt, struct rnbd_host **srv,
+		     struct table_column **cs,
+		     const struct rnbd_ctx *ctx);
+
+int list_groups_term(struct table_groups *g, const struct rnbd_ctx *ctx);
+
+void list_groups_csv(struct table_groups *g, const struct rnbd_ctx *ctx);
+
+void list_groups_json(struct table_groups *g, const struct rnbd_ctx *ctx);
+
+void list_groups_xml(struct table_groups *g, const struct rnbd_ctx *ctx);
+
+/* the groups of both sides, told apart by their direction */
+void list_groups_prom(const char *prefix, struct table_groups *g,
+		      const struct rnbd_ctx *ctx);
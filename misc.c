@@ -149,6 +149,18 @@ int byte_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 	return i_to_byte_unit(str, len, ctx, *(uint64_t *)v, humanize);
 }
 
+int sect_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+		enum color *clr, void *v, bool humanize)
+{
+	*clr = CNRM;
+
+	if (humanize)
+		return i_to_byte_unit(str, len, ctx, *(uint64_t *)v << 9,
+				      humanize);
+	else
+		return snprintf(str, len, "%" PRIu64, *(uint64_t *)v);
+}
+
 int sd_devname_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 		      enum color *clr, void *v, bool humanize)
 {
@@ -180,9 +192,9 @@ int sd_rx_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 	*clr = CNRM;
 
 	if (humanize)
-		return i_to_byte_unit(str, len, ctx, sd->dev->rx_sect << 9, humanize);
+		return i_to_byte_unit(str, len, ctx, sd->dev->stat.rd_sect << 9, humanize);
 	else
-		return snprintf(str, len, "%" PRIu64, sd->dev->rx_sect);
+		return snprintf(str, len, "%" PRIu64, sd->dev->stat.rd_sect);
 }
 
 int sd_tx_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
@@ -194,11 +206,59 @@ int sd_tx_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 	*clr = CNRM;
 
 	if (humanize)
-		return i_to_byte_unit(str, len, ctx, sd->dev->tx_sect << 9, humanize);
+		return i_to_byte_unit(str, len, ctx, sd->dev->stat.wr_sect << 9, humanize);
+	else
+		return snprintf(str, len, "%" PRIu64, sd->dev->stat.wr_sect);
+}
+
+int sd_dc_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+		 enum color *clr, void *v, bool humanize)
+{
+	struct rnbd_sess_dev *sd = container_of(v, struct rnbd_sess_dev,
+						 sess);
+
+	*clr = CNRM;
+
+	if (humanize)
+		return i_to_byte_unit(str, len, ctx, sd->dev->stat.dc_sect << 9, humanize);
 	else
-		return snprintf(str, len, "%" PRIu64, sd->dev->tx_sect);
+		return snprintf(str, len, "%" PRIu64, sd->dev->stat.dc_sect);
+}
+
+static int sd_stat_to_str(char *str, size_t len, enum color *clr, void *v,
+			  size_t off)
+{
+	struct rnbd_sess_dev *sd = container_of(v, struct rnbd_sess_dev,
+						 sess);
+
+	*clr = CNRM;
+
+	return snprintf(str, len, "%lu",
+			*(unsigned long *)((char *)&sd->dev->stat + off));
 }
 
+#define SD_STAT_FN(name) \
+SD_STAT_TO_STR(name) \
+{ \
+	return sd_stat_to_str(str, len, clr, v, \
+			      offsetof(struct rnbd_blk_stat, name)); \
+}
+
+SD_STAT_FN(rd_ios)
+SD_STAT_FN(rd_merges)
+SD_STAT_FN(rd_ticks)
+SD_STAT_FN(wr_ios)
+SD_STAT_FN(wr_merges)
+SD_STAT_FN(wr_ticks)
+SD_STAT_FN(in_flight)
+SD_STAT_FN(io_ticks)
+SD_STAT_FN(time_in_queue)
+SD_STAT_FN(dc_ios)
+SD_STAT_FN(dc_merges)
+SD_STAT_FN(dc_ticks)
+SD_STAT_FN(fl_ios)
+SD_STAT_FN(fl_ticks)
+
 int dev_sessname_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 			enum color *clr, void *v, bool humanize)
 {
@@ -225,6 +285,21 @@ int rnbd_path_state_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 	return snprintf(str, len, "%s", p->state);
 }
 
+int hca_link_state_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+			  enum color *clr, void *v, bool humanize)
+{
+	const char *state = *(const char **)v;
+
+	if (!state[0])
+		*clr = CNRM;
+	else if (!strcmp(state, "ACTIVE"))
+		*clr = CGRN;
+	else
+		*clr = CRED;
+
+	return snprintf(str, len, "%s", state);
+}
+
 static bool is_gid(const char *arg)
 {
 	if (strncmp("gid:", arg, 4) == 0)
@@ -233,7 +308,7 @@ static bool is_gid(const char *arg)
 		return false;
 }
 
-int rnbd_addr_to_norm(char *str, size_t len, char *v)
+int rnbd_addr_to_norm(char *str, size_t len, const char *v)
 {
 	char addr[16];
 	int cnt, af;
@@ -256,12 +331,13 @@ out:
 	return snprintf(str, len, "%s", v);
 }
 
-int rnbd_pathname_to_norm(char *str, size_t len, char *v)
+int rnbd_pathname_to_norm(char *str, size_t len, const char *v)
 {
-	char *s, *at;
+	char s[NAME_MAX + 1], *at;
 	int cnt;
 
-	s = strdup(v);
+	if (snprintf(s, sizeof(s), "%s", v) >= sizeof(s))
+		return snprintf(str, len, "%s", v);
 
 	at = strchr(s, '@');
 	if (!at)
@@ -272,31 +348,33 @@ int rnbd_pathname_to_norm(char *str, size_t len, char *v)
 	cnt += snprintf(str + cnt, len - cnt, "%s", "@");
 	cnt += rnbd_addr_to_norm(str + cnt, len - cnt, at + 1);
 
-	free(s);
-
 	return cnt;
 }
 
 int addr_to_norm(char *str, size_t len, const struct rnbd_ctx *ctx,
 		 enum color *clr, void *v, bool humanize)
 {
+	const char *addr = *(const char **)v;
+
 	*clr = CNRM;
 
 	if (!humanize)
-		return snprintf(str, len, "%s", (char *) v);
+		return snprintf(str, len, "%s", addr);
 
-	return rnbd_addr_to_norm(str, len, v);
+	return rnbd_addr_to_norm(str, len, addr);
 }
 
 int path_to_norm(char *str, size_t len, const struct rnbd_ctx *ctx,
 		 enum color *clr, void *v, bool humanize)
 {
+	const char *pathname = *(const char **)v;
+
 	*clr = CNRM;
 
 	if (!humanize)
-		return snprintf(str, len, "%s", (char *) v);
+		return snprintf(str, len, "%s", pathname);
 
-	return rnbd_pathname_to_norm(str, len, v);
+	return rnbd_pathname_to_norm(str, len, pathname);
 }
 
 int path_to_sessname(char *str, size_t len, const struct rnbd_ctx *ctx,
@@ -413,9 +491,11 @@ int act_path_cnt_to_state(char *str, size_t len, const struct rnbd_ctx *ctx,
 int sessname_to_srvname(char *str, size_t len, const struct rnbd_ctx *ctx,
 			enum color *clr, void *v, bool humanize)
 {
+	const char *at = strchr(*(const char **)v, '@');
+
 	*clr = CNRM;
 
-	return snprintf(str, len, "%s", strchrnul(v, '@') + 1);
+	return snprintf(str, len, "%s", at ? at + 1 : "");
 }
 
 int sess_side_to_direction(char *str, size_t len, const struct rnbd_ctx *ctx,
@@ -430,6 +510,18 @@ int sess_side_to_direction(char *str, size_t len, const struct rnbd_ctx *ctx,
 		return snprintf(str, len, "incoming");
 }
 
+int host_side_to_direction(char *str, size_t len, const struct rnbd_ctx *ctx,
+			   enum color *clr, void *v, bool humanize)
+{
+	struct rnbd_host *h = container_of(v, struct rnbd_host, side);
+
+	*clr = CNRM;
+	if (h->side == RNBD_CLIENT)
+		return snprintf(str, len, "outgoing");
+	else
+		return snprintf(str, len, "incoming");
+}
+
 
 int path_sess_to_direction(char *str, size_t len, const struct rnbd_ctx *ctx,
 			   enum color *clr, void *v, bool humanize)
@@ -452,6 +544,64 @@ int path_sess_to_direction(char *str, size_t len, const struct rnbd_ctx *ctx,
 	}
 }
 
+/*
+ * Average size of the requests of a path, the column is on the count
+ */
+int path_rx_avg_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+		       enum color *clr, void *v, bool humanize)
+{
+	struct rnbd_path *p = container_of(v, struct rnbd_path, rx_cnt);
+
+	*clr = CNRM;
+
+	return i_to_byte_unit(str, len, ctx,
+			      p->rx_cnt ? p->rx_bytes / p->rx_cnt : 0,
+			      humanize);
+}
+
+int path_tx_avg_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+		       enum color *clr, void *v, bool humanize)
+{
+	struct rnbd_path *p = container_of(v, struct rnbd_path, tx_cnt);
+
+	*clr = CNRM;
+
+	return i_to_byte_unit(str, len, ctx,
+			      p->tx_cnt ? p->tx_bytes / p->tx_cnt : 0,
+			      humanize);
+}
+
+int ns_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+	      enum color *clr, void *v, bool humanize)
+{
+	uint64_t ns = *(uint64_t *)v;
+
+	*clr = CNRM;
+
+	if (!humanize)
+		return snprintf(str, len, "%" PRIu64, ns);
+	if (ns < 1000)
+		return snprintf(str, len, "%" PRIu64 "ns", ns);
+	if (ns < 1000000)
+		return snprintf(str, len, "%.1fus", ns / 1000.0);
+
+	return snprintf(str, len, "%.1fms", ns / 1000000.0);
+}
+
+int path_latency_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+			enum color *clr, void *v, bool humanize)
+{
+	struct rnbd_path *p = container_of(v, struct rnbd_path, cur_latency);
+
+	*clr = CNRM;
+
+	/* the latencies of several paths don't add up to a total */
+	if (!p->sess)
+		return 0;
+
+	return ns_to_str(str, len, ctx, clr, v, humanize);
+}
+
 static bool is_ip(const char *arg)
 {
 	if (strncmp("ip:", arg, 3) == 0)
@@ -590,6 +740,23 @@ int sessname_from_host(const char *from_name, char *out_buf, size_t buf_len)
 	return 0; /* not res, will be > 0 when snprintf succeeds */
 }
 
+/*
+ * The state of a port reads "4: ACTIVE", keep the name only
+ */
+static void read_port_state(const char *dir, struct port_desc *pd)
+{
+	char line[sizeof(pd->state)], *name;
+
+	if (read_sysfs_line(dir, "state", line, sizeof(line)))
+		return;
+
+	name = strchr(line, ':');
+	name = name ? name + 1 : line;
+	while (isspace(*name))
+		name++;
+	snprintf(pd->state, sizeof(pd->state), "%s", name);
+}
+
 int read_port_descs(struct port_desc *port_descs, int max_ports)
 {
 	int cnt = 0;
@@ -601,7 +768,7 @@ int read_port_descs(struct port_desc *port_descs, int max_ports)
 	DIR *hca_dirp;
 	DIR *port_dirp;
 
-	hca_dirp = opendir(HCA_DIR);
+	hca_dirp = opendir_sysfs(HCA_DIR);
 	if (!hca_dirp)
 		return 0;
 
@@ -615,9 +782,11 @@ int read_port_descs(struct port_desc *port_descs, int max_ports)
 		snprintf(hca_subdir, sizeof(hca_subdir),
 			 HCA_DIR "%s/ports/", hca_entry->d_name);
 
-		port_dirp = opendir(hca_subdir);
-		if (!hca_dirp)
+		port_dirp = opendir_sysfs(hca_subdir);
+		if (!port_dirp) {
+			closedir(hca_dirp);
 			return -errno; /* TODO continue? */
+		}
 
 		for (port_entry = readdir(port_dirp);
 		     port_entry;
@@ -637,7 +806,16 @@ int read_port_descs(struct port_desc *port_descs, int max_ports)
 			snprintf(sysfs_path, sizeof(sysfs_path),
 				 HCA_DIR "%s/ports/%s/gids/",
 				 hca_entry->d_name, port_entry->d_name);
-			scanf_sysfs(sysfs_path, "0", "%s", port_descs[cnt].gid);
+			read_sysfs_token(sysfs_path, "0", port_descs[cnt].gid,
+					 sizeof(port_descs[cnt].gid));
+
+			snprintf(sysfs_path, sizeof(sysfs_path),
+				 HCA_DIR "%s/ports/%s/",
+				 hca_entry->d_name, port_entry->d_name);
+			read_port_state(sysfs_path, &port_descs[cnt]);
+			read_sysfs_line(sysfs_path, "rate",
+					port_descs[cnt].rate,
+					sizeof(port_descs[cnt].rate));
 
 			cnt++;
 		}
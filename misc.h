@@ -51,6 +51,8 @@ struct port_desc {
 	char hca[NAME_MAX];
 	char port[NAME_MAX];
 	char gid[NAME_MAX];
+	char state[32];		/* link state, i.e. ACTIVE */
+	char rate[64];		/* i.e. 100 Gb/sec (4X EDR) */
 };
 
 struct rnbd_ctx {
@@ -90,6 +92,9 @@ struct rnbd_ctx {
 	struct table_column *clms_paths_clt[CLM_MAX_CNT];
 	struct table_column *clms_paths_srv[CLM_MAX_CNT];
 
+	struct table_column *clms_hcas[CLM_MAX_CNT];
+	struct table_column *clms_hosts[CLM_MAX_CNT];
+
 	bool notree_set;
 	bool noterm_set;
 	bool help_set;
@@ -98,6 +103,8 @@ struct rnbd_ctx {
 	bool simulate_set;
 	bool complete_set;
 
+	int jobs;
+
 	int unit_id;
 	bool unit_set;
 	char unit[5];
@@ -120,6 +127,32 @@ struct rnbd_ctx {
 	const char *from;
 	bool from_set;
 
+	unsigned int interval_ms;
+	bool interval_set;
+
+	int count;
+	bool count_set;
+
+	const char *sort;	/* lists: comma separated, '-' descending */
+	bool sort_set;
+
+	const char *const *where;	/* the tokens after "where" */
+	int where_cnt;
+
+	int limit;		/* lists and top: rows per table */
+	bool limit_set;
+
+	const char *group;	/* lists: the field to aggregate by */
+	bool group_set;
+
+	const char *listen;
+	bool listen_set;
+
+	unsigned int ttl_ms;
+	bool ttl_set;
+
+	bool apply_set;
+
 };
 
 int get_unit_index(const char *unit, int *index);
@@ -145,6 +178,10 @@ int i_to_byte_unit(char *str, size_t len, const struct rnbd_ctx *ctx,
 int byte_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 		enum color *clr, void *v, bool humanize);
 
+/* a number of 512 byte sectors, shown in bytes when humanized */
+int sect_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+		enum color *clr, void *v, bool humanize);
+
 int sd_state_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 		    enum color *clr, void *v, bool humanize);
 
@@ -160,12 +197,39 @@ int sd_rx_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 int sd_tx_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 		 enum color *clr, void *v, bool humanize);
 
+int sd_dc_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+		 enum color *clr, void *v, bool humanize);
+
+/* the other fields of <blockdev>/stat, as plain numbers */
+#define SD_STAT_TO_STR(name) \
+int sd_ ## name ## _to_str(char *str, size_t len, \
+			   const struct rnbd_ctx *ctx, \
+			   enum color *clr, void *v, bool humanize)
+
+SD_STAT_TO_STR(rd_ios);
+SD_STAT_TO_STR(rd_merges);
+SD_STAT_TO_STR(rd_ticks);
+SD_STAT_TO_STR(wr_ios);
+SD_STAT_TO_STR(wr_merges);
+SD_STAT_TO_STR(wr_ticks);
+SD_STAT_TO_STR(in_flight);
+SD_STAT_TO_STR(io_ticks);
+SD_STAT_TO_STR(time_in_queue);
+SD_STAT_TO_STR(dc_ios);
+SD_STAT_TO_STR(dc_merges);
+SD_STAT_TO_STR(dc_ticks);
+SD_STAT_TO_STR(fl_ios);
+SD_STAT_TO_STR(fl_ticks);
+
 int dev_sessname_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 			enum color *clr, void *v, bool humanize);
 
 int rnbd_path_state_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 			    enum color *clr, void *v, bool humanize);
 
+int hca_link_state_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+			  enum color *clr, void *v, bool humanize);
+
 int path_to_sessname(char *str, size_t len, const struct rnbd_ctx *ctx,
 		     enum color *clr, void *v, bool humanize);
 
@@ -184,12 +248,27 @@ int act_path_cnt_to_state(char *str, size_t len, const struct rnbd_ctx *ctx,
 int sess_side_to_direction(char *str, size_t len, const struct rnbd_ctx *ctx,
 			   enum color *clr, void *v, bool humanize);
 
+int host_side_to_direction(char *str, size_t len, const struct rnbd_ctx *ctx,
+			   enum color *clr, void *v, bool humanize);
+
 int path_sess_to_direction(char *str, size_t len, const struct rnbd_ctx *ctx,
 			   enum color *clr, void *v, bool humanize);
 
 int path_to_shortdesc(char *str, size_t len, const struct rnbd_ctx *ctx,
 		      enum color *clr, void *v, bool humanize);
 
+int path_rx_avg_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+		       enum color *clr, void *v, bool humanize);
+
+int path_tx_avg_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+		       enum color *clr, void *v, bool humanize);
+
+int ns_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+	      enum color *clr, void *v, bool humanize);
+
+int path_latency_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+			enum color *clr, void *v, bool humanize);
+
 int sessname_to_srvname(char *str, size_t len, const struct rnbd_ctx *ctx,
 		        enum color *clr, void *v, bool humanize);
 
@@ -229,6 +308,8 @@ enum rnbd_token {
 	TOK_DEVICES,
 	TOK_SESSIONS,
 	TOK_PATHS,
+	TOK_HCAS,
+	TOK_HOSTS,
 
 	/* commands */
 	TOK_DUMP,
@@ -245,6 +326,10 @@ enum rnbd_token {
 	TOK_ADD,
 	TOK_DELETE,
 	TOK_READD,
+	TOK_TOP,
+	TOK_WATCH,
+	TOK_SERVE,
+	TOK_ANALYZE,
 
 	/* access permissions */
 	TOK_RO,
@@ -253,10 +338,28 @@ enum rnbd_token {
 
 	TOK_FROM,
 
+	/* top */
+	TOK_INTERVAL,
+	TOK_COUNT,
+	TOK_SORT,
+
+	/* list */
+	TOK_WHERE,
+	TOK_LIMIT,
+	TOK_GROUP,
+
+	/* serve */
+	TOK_LISTEN,
+	TOK_TTL,
+
+	/* analyze */
+	TOK_APPLY,
+
 	/* output format */
 	TOK_XML,
 	TOK_CSV,
 	TOK_JSON,
+	TOK_PROM,
 	TOK_TERM,
 
 	/* i/o mode */
@@ -10,56 +10,148 @@
 #include "table.h"
 #include "misc.h"
 
-#define CLM_SD(m_name, m_header, m_type, tostr, align, h_clr, c_clr, m_descr) \
+/*
+ * The last argument of the column macros are the sysfs attributes
+ * (enum rnbd_attr) the column needs to be read. Not every file including
+ * this header uses all of the column arrays.
+ */
+#define CLM_SD(m_name, m_header, m_type, tostr, align, h_clr, c_clr, m_descr, \
+	       deps) \
 	CLM(rnbd_sess_dev, m_name, m_header, m_type, tostr, align, h_clr,\
-	    c_clr, m_descr, sizeof(m_header) - 1, 0)
+	    c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
 
 #define _CLM_SD(s_name, m_name, m_header, m_type, tostr, align, h_clr, c_clr, \
-		m_descr) \
+		m_descr, deps) \
 	_CLM(rnbd_sess_dev, s_name, m_name, m_header, m_type, tostr, \
-	    align, h_clr, c_clr, m_descr, sizeof(m_header) - 1, 0)
+	    align, h_clr, c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
+
+#define _CLM_SD_CNT(s_name, m_name, m_header, m_type, tostr, align, h_clr, \
+		    c_clr, m_descr, deps) \
+	_CLM_CNT(rnbd_sess_dev, s_name, m_name, m_header, m_type, tostr, \
+		 align, h_clr, c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
 
 CLM_SD(mapping_path, "Mapping Path", FLD_STR, NULL, 'l', CNRM, CBLD,
-	"Mapping name of the remote device");
+	"Mapping name of the remote device", 0);
 
 CLM_SD(access_mode, "Access Mode", FLD_STR, NULL, 'l', CNRM,
-	CNRM, "RW mode of the device: ro, rw or migration");
+	CNRM, "RW mode of the device: ro, rw or migration",
+	RNBD_ATTR_SD_ACCESS_MODE);
 
 static struct table_column clm_rnbd_dev_devname =
 	_CLM_SD("devname", sess, "Device", FLD_STR, sd_devname_to_str, 'l',
-		CNRM, CNRM, "Device name under /dev/. I.e. rnbd0");
+		CNRM, CNRM, "Device name under /dev/. I.e. rnbd0", 0);
 
 static struct table_column clm_rnbd_dev_devpath =
 	_CLM_SD("devpath", sess, "Device path", FLD_STR, sd_devpath_to_str, 'l',
-		CNRM, CNRM, "Device path under /dev/. I.e. /dev/rnbd0");
+		CNRM, CNRM, "Device path under /dev/. I.e. /dev/rnbd0", 0);
 
 static struct table_column clm_rnbd_dev_rx_sect =
-	_CLM_SD("rx_sect", sess, "RX", FLD_LLU, sd_rx_to_str, 'r', CNRM, CNRM,
-	"Amount of data read from the device");
+	_CLM_SD_CNT("rx_sect", sess, "RX", FLD_LLU, sd_rx_to_str, 'r', CNRM,
+		    CNRM, "Amount of data read from the device",
+		    RNBD_ATTR_DEV_STAT);
 
 static struct table_column clm_rnbd_dev_tx_sect =
-	_CLM_SD("tx_sect", sess, "TX", FLD_LLU, sd_tx_to_str, 'r', CNRM, CNRM,
-	"Amount of data written to the device");
+	_CLM_SD_CNT("tx_sect", sess, "TX", FLD_LLU, sd_tx_to_str, 'r', CNRM,
+		    CNRM, "Amount of data written to the device",
+		    RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_rd_ios =
+	_CLM_SD_CNT("rd_ios", sess, "RD IOs", FLD_LLU, sd_rd_ios_to_str,
+		'r', CNRM, CNRM,
+		"Reads completed", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_rd_merges =
+	_CLM_SD_CNT("rd_merges", sess, "RD merges", FLD_LLU,
+		    sd_rd_merges_to_str,
+		'r', CNRM, CNRM,
+		"Reads merged", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_rd_ticks =
+	_CLM_SD_CNT("rd_ticks", sess, "RD ms", FLD_LLU, sd_rd_ticks_to_str,
+		'r', CNRM, CNRM,
+		"Milliseconds spent reading", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_wr_ios =
+	_CLM_SD_CNT("wr_ios", sess, "WR IOs", FLD_LLU, sd_wr_ios_to_str,
+		'r', CNRM, CNRM,
+		"Writes completed", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_wr_merges =
+	_CLM_SD_CNT("wr_merges", sess, "WR merges", FLD_LLU,
+		    sd_wr_merges_to_str,
+		'r', CNRM, CNRM,
+		"Writes merged", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_wr_ticks =
+	_CLM_SD_CNT("wr_ticks", sess, "WR ms", FLD_LLU, sd_wr_ticks_to_str,
+		'r', CNRM, CNRM,
+		"Milliseconds spent writing", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_in_flight =
+	_CLM_SD("in_flight", sess, "In flight", FLD_LLU, sd_in_flight_to_str,
+		'r', CNRM, CNRM,
+		"Requests in flight in the block layer", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_io_ticks =
+	_CLM_SD_CNT("io_ticks", sess, "IO ms", FLD_LLU, sd_io_ticks_to_str,
+		'r', CNRM, CNRM,
+		"Milliseconds the device was busy", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_time_in_queue =
+	_CLM_SD_CNT("time_in_queue", sess, "Queue ms", FLD_LLU,
+		sd_time_in_queue_to_str, 'r', CNRM, CNRM,
+		"Milliseconds requests waited in total", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_dc_ios =
+	_CLM_SD_CNT("dc_ios", sess, "DC IOs", FLD_LLU, sd_dc_ios_to_str,
+		'r', CNRM, CNRM,
+		"Discards completed", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_dc_merges =
+	_CLM_SD_CNT("dc_merges", sess, "DC merges", FLD_LLU,
+		    sd_dc_merges_to_str,
+		'r', CNRM, CNRM,
+		"Discards merged", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_dc_sect =
+	_CLM_SD_CNT("dc_sect", sess, "DC", FLD_LLU, sd_dc_to_str, 'r', CNRM,
+		    CNRM, "Amount of data discarded", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_dc_ticks =
+	_CLM_SD_CNT("dc_ticks", sess, "DC ms", FLD_LLU, sd_dc_ticks_to_str,
+		'r', CNRM, CNRM,
+		"Milliseconds spent discarding", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_fl_ios =
+	_CLM_SD_CNT("fl_ios", sess, "FL IOs", FLD_LLU, sd_fl_ios_to_str,
+		'r', CNRM, CNRM,
+		"Flushes completed", RNBD_ATTR_DEV_STAT);
+
+static struct table_column clm_rnbd_dev_fl_ticks =
+	_CLM_SD_CNT("fl_ticks", sess, "FL ms", FLD_LLU, sd_fl_ticks_to_str,
+		'r', CNRM, CNRM,
+		"Milliseconds spent flushing", RNBD_ATTR_DEV_STAT);
 
 static struct table_column clm_rnbd_dev_state =
 	_CLM_SD("state", sess, "State", FLD_STR, sd_state_to_str, 'l', CNRM,
-		CNRM, "State of the RNBD device. (client only)");
+		CNRM, "State of the RNBD device. (client only)",
+		RNBD_ATTR_DEV_STATE);
 
 static struct table_column clm_rnbd_sess_dev_sessname =
 	_CLM_SD("sessname", sess, "Session", FLD_STR, dev_sessname_to_str, 'l',
-		CNRM, CNRM, "Name of the RTRS session of the device");
+		CNRM, CNRM, "Name of the RTRS session of the device", 0);
 
 static struct table_column clm_rnbd_sess_dev_direction =
 	_CLM_SD("direction", sess, "Direction", FLD_STR,
 		sd_sess_to_direction, 'l', CNRM, CNRM,
-		"Direction of data transfer: imported or exported");
+		"Direction of data transfer: imported or exported", 0);
 
 static struct table_column clm_rnbd_sess_dev_hostname =
 	_CLM_SD("hostname", sess, "Hostname", FLD_STR,
 		sd_sess_to_hostname, 'l', CNRM, CNRM,
-		"Hostname of the remote peer");
+		"Hostname of the remote peer", RNBD_ATTR_SESS_HOSTNAME);
 
-static struct table_column *all_clms_devices[] = {
+static struct table_column *all_clms_devices[] __attribute__ ((unused)) = {
 	&clm_rnbd_sess_dev_sessname,
 	&clm_rnbd_sess_dev_mapping_path,
 	&clm_rnbd_dev_devname,
@@ -68,12 +160,27 @@ static struct table_column *all_clms_devices[] = {
 	&clm_rnbd_sess_dev_access_mode,
 	&clm_rnbd_dev_rx_sect,
 	&clm_rnbd_dev_tx_sect,
+	&clm_rnbd_dev_rd_ios,
+	&clm_rnbd_dev_rd_merges,
+	&clm_rnbd_dev_rd_ticks,
+	&clm_rnbd_dev_wr_ios,
+	&clm_rnbd_dev_wr_merges,
+	&clm_rnbd_dev_wr_ticks,
+	&clm_rnbd_dev_in_flight,
+	&clm_rnbd_dev_io_ticks,
+	&clm_rnbd_dev_time_in_queue,
+	&clm_rnbd_dev_dc_ios,
+	&clm_rnbd_dev_dc_merges,
+	&clm_rnbd_dev_dc_sect,
+	&clm_rnbd_dev_dc_ticks,
+	&clm_rnbd_dev_fl_ios,
+	&clm_rnbd_dev_fl_ticks,
 	&clm_rnbd_sess_dev_direction,
 	&clm_rnbd_sess_dev_hostname,
 	NULL
 };
 
-static struct table_column *all_clms_devices_clt[] = {
+static struct table_column *all_clms_devices_clt[] __attribute__ ((unused)) = {
 	&clm_rnbd_sess_dev_sessname,
 	&clm_rnbd_sess_dev_mapping_path,
 	&clm_rnbd_dev_devname,
@@ -82,12 +189,27 @@ static struct table_column *all_clms_devices_clt[] = {
 	&clm_rnbd_sess_dev_access_mode,
 	&clm_rnbd_dev_rx_sect,
 	&clm_rnbd_dev_tx_sect,
+	&clm_rnbd_dev_rd_ios,
+	&clm_rnbd_dev_rd_merges,
+	&clm_rnbd_dev_rd_ticks,
+	&clm_rnbd_dev_wr_ios,
+	&clm_rnbd_dev_wr_merges,
+	&clm_rnbd_dev_wr_ticks,
+	&clm_rnbd_dev_in_flight,
+	&clm_rnbd_dev_io_ticks,
+	&clm_rnbd_dev_time_in_queue,
+	&clm_rnbd_dev_dc_ios,
+	&clm_rnbd_dev_dc_merges,
+	&clm_rnbd_dev_dc_sect,
+	&clm_rnbd_dev_dc_ticks,
+	&clm_rnbd_dev_fl_ios,
+	&clm_rnbd_dev_fl_ticks,
 	&clm_rnbd_sess_dev_direction,
 	&clm_rnbd_sess_dev_hostname,
 	NULL
 };
 
-static struct table_column *all_clms_devices_srv[] = {
+static struct table_column *all_clms_devices_srv[] __attribute__ ((unused)) = {
 	&clm_rnbd_sess_dev_sessname,
 	&clm_rnbd_sess_dev_mapping_path,
 	&clm_rnbd_dev_devname,
@@ -95,12 +217,27 @@ static struct table_column *all_clms_devices_srv[] = {
 	&clm_rnbd_sess_dev_access_mode,
 	&clm_rnbd_dev_rx_sect,
 	&clm_rnbd_dev_tx_sect,
+	&clm_rnbd_dev_rd_ios,
+	&clm_rnbd_dev_rd_merges,
+	&clm_rnbd_dev_rd_ticks,
+	&clm_rnbd_dev_wr_ios,
+	&clm_rnbd_dev_wr_merges,
+	&clm_rnbd_dev_wr_ticks,
+	&clm_rnbd_dev_in_flight,
+	&clm_rnbd_dev_io_ticks,
+	&clm_rnbd_dev_time_in_queue,
+	&clm_rnbd_dev_dc_ios,
+	&clm_rnbd_dev_dc_merges,
+	&clm_rnbd_dev_dc_sect,
+	&clm_rnbd_dev_dc_ticks,
+	&clm_rnbd_dev_fl_ios,
+	&clm_rnbd_dev_fl_ticks,
 	&clm_rnbd_sess_dev_direction,
 	&clm_rnbd_sess_dev_hostname,
 	NULL
 };
 
-static struct table_column *def_clms_devices_clt[] = {
+static struct table_column *def_clms_devices_clt[] __attribute__ ((unused)) = {
 	&clm_rnbd_sess_dev_sessname,
 	&clm_rnbd_sess_dev_mapping_path,
 	&clm_rnbd_dev_devname,
@@ -109,7 +246,7 @@ static struct table_column *def_clms_devices_clt[] = {
 	NULL
 };
 
-static struct table_column *def_clms_devices_srv[] = {
+static struct table_column *def_clms_devices_srv[] __attribute__ ((unused)) = {
 	&clm_rnbd_sess_dev_sessname,
 	&clm_rnbd_sess_dev_mapping_path,
 	&clm_rnbd_dev_devname,
@@ -117,51 +254,60 @@ static struct table_column *def_clms_devices_srv[] = {
 	NULL
 };
 
-#define CLM_S(m_name, m_header, m_type, tostr, align, h_clr, c_clr, m_descr) \
+#define CLM_S(m_name, m_header, m_type, tostr, align, h_clr, c_clr, m_descr, \
+	      deps) \
 	CLM(rnbd_sess, m_name, m_header, m_type, tostr, align, h_clr, c_clr, \
-	    m_descr, sizeof(m_header) - 1, 0)
+	    m_descr, sizeof(m_header) - 1, 0, deps)
 
 #define _CLM_S(s_name, m_name, m_header, m_type, tostr, align, h_clr, c_clr, \
-	       m_descr) \
+	       m_descr, deps) \
 	_CLM(rnbd_sess, s_name, m_name, m_header, m_type, tostr, align, \
-	     h_clr, c_clr, m_descr, sizeof(m_header) - 1, 0)
+	     h_clr, c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
+
+#define CLM_S_CNT(m_name, m_header, m_type, tostr, align, h_clr, c_clr, \
+		  m_descr, deps) \
+	CLM_CNT(rnbd_sess, m_name, m_header, m_type, tostr, align, h_clr, \
+		c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
 
 CLM_S(sessname, "Session name", FLD_STR, NULL, 'l', CNRM, CBLD,
-	"Name of the session");
+	"Name of the session", 0);
 CLM_S(hostname, "Hostname", FLD_STR, NULL, 'l', CNRM, CBLD,
-	"Hostname of the counterpart");
+	"Hostname of the counterpart", RNBD_ATTR_SESS_HOSTNAME);
 CLM_S(mp_short, "MP", FLD_STR, NULL, 'l', CNRM, CNRM,
-	"Multipath policy (short)");
+	"Multipath policy (short)", RNBD_ATTR_SESS_MPATH_POLICY);
 CLM_S(mp, "MP Policy", FLD_STR, NULL, 'l', CNRM, CNRM,
-	"Multipath policy");
+	"Multipath policy", RNBD_ATTR_SESS_MPATH_POLICY);
 CLM_S(path_cnt, "Path cnt", FLD_INT, NULL, 'r', CNRM, CNRM,
-	"Number of paths");
+	"Number of paths", 0);
 CLM_S(act_path_cnt, "Act path cnt", FLD_INT, NULL, 'r', CNRM, CNRM,
-	"Number of active paths");
-CLM_S(rx_bytes, "RX", FLD_LLU, byte_to_str, 'r', CNRM, CNRM,
-	"Bytes received");
-CLM_S(tx_bytes, "TX", FLD_LLU, byte_to_str, 'r', CNRM, CNRM, "Bytes send");
-CLM_S(inflights, "Inflights", FLD_INT, NULL, 'r', CNRM, CNRM, "Inflights");
-CLM_S(reconnects, "Reconnects", FLD_INT, NULL, 'r', CNRM, CNRM, "Reconnects");
+	"Number of active paths", RNBD_ATTR_PATH_STATE);
+CLM_S_CNT(rx_bytes, "RX", FLD_LLU, byte_to_str, 'r', CNRM, CNRM,
+	"Bytes received", RNBD_ATTR_PATH_STATS_RDMA);
+CLM_S_CNT(tx_bytes, "TX", FLD_LLU, byte_to_str, 'r', CNRM, CNRM,
+	"Bytes send", RNBD_ATTR_PATH_STATS_RDMA);
+CLM_S(inflights, "Inflights", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Inflights", RNBD_ATTR_PATH_STATS_RDMA);
+CLM_S_CNT(reconnects, "Reconnects", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Reconnects", RNBD_ATTR_PATH_RECONNECTS);
 CLM_S(path_uu, "PS", FLD_STR, NULL, 'l', CNRM, CNRM,
-	"Up (U) or down (_) state of every path");
+	"Up (U) or down (_) state of every path", RNBD_ATTR_PATH_STATE);
 
 static struct table_column clm_rnbd_sess_state =
 	_CLM_S("state", act_path_cnt, "State", FLD_STR,
 		act_path_cnt_to_state, 'l', CNRM, CNRM,
-		"State of the session.");
+		"State of the session.", RNBD_ATTR_PATH_STATE);
 
 static struct table_column clm_rnbd_sess_srvname =
 	_CLM_S("srvname", sessname, "Server Name", FLD_STR,
 		sessname_to_srvname, 'l', CNRM, CNRM,
-		"Server name");
+		"Server name", 0);
 
 static struct table_column clm_rnbd_sess_side =
 	_CLM_S("direction", side, "Direction", FLD_STR,
 		sess_side_to_direction, 'l', CNRM, CNRM,
-		"Direction of the session: incoming or outgoing");
+		"Direction of the session: incoming or outgoing", 0);
 
-static struct table_column *all_clms_sessions[] = {
+static struct table_column *all_clms_sessions[] __attribute__ ((unused)) = {
 	&clm_rnbd_sess_sessname,
 	&clm_rnbd_sess_path_cnt,
 	&clm_rnbd_sess_act_path_cnt,
@@ -179,7 +325,7 @@ static struct table_column *all_clms_sessions[] = {
 	NULL
 };
 
-static struct table_column *all_clms_sessions_clt[] = {
+static struct table_column *all_clms_sessions_clt[] __attribute__ ((unused)) = {
 	&clm_rnbd_sess_sessname,
 	&clm_rnbd_sess_path_cnt,
 	&clm_rnbd_sess_act_path_cnt,
@@ -197,7 +343,7 @@ static struct table_column *all_clms_sessions_clt[] = {
 	NULL
 };
 
-static struct table_column *all_clms_sessions_srv[] = {
+static struct table_column *all_clms_sessions_srv[] __attribute__ ((unused)) = {
 	&clm_rnbd_sess_sessname,
 	&clm_rnbd_sess_path_cnt,
 	&clm_rnbd_sess_rx_bytes,
@@ -208,7 +354,7 @@ static struct table_column *all_clms_sessions_srv[] = {
 	NULL
 };
 
-static struct table_column *def_clms_sessions_clt[] = {
+static struct table_column *def_clms_sessions_clt[] __attribute__ ((unused)) = {
 	&clm_rnbd_sess_sessname,
 	&clm_rnbd_sess_state,
 	&clm_rnbd_sess_path_uu,
@@ -219,7 +365,7 @@ static struct table_column *def_clms_sessions_clt[] = {
 	NULL
 };
 
-static struct table_column *def_clms_sessions_srv[] = {
+static struct table_column *def_clms_sessions_srv[] __attribute__ ((unused)) = {
 	&clm_rnbd_sess_sessname,
 	&clm_rnbd_sess_path_cnt,
 	&clm_rnbd_sess_tx_bytes,
@@ -228,48 +374,110 @@ static struct table_column *def_clms_sessions_srv[] = {
 	NULL
 };
 
-#define CLM_P(m_name, m_header, m_type, tostr, align, h_clr, c_clr, m_descr) \
+#define CLM_P(m_name, m_header, m_type, tostr, align, h_clr, c_clr, m_descr, \
+	      deps) \
 	CLM(rnbd_path, m_name, m_header, m_type, tostr, align, h_clr, c_clr, \
-	    m_descr, sizeof(m_header) - 1, 0)
+	    m_descr, sizeof(m_header) - 1, 0, deps)
+
+#define CLM_P_CNT(m_name, m_header, m_type, tostr, align, h_clr, c_clr, \
+		  m_descr, deps) \
+	CLM_CNT(rnbd_path, m_name, m_header, m_type, tostr, align, h_clr, \
+		c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
 
 CLM_P(state, "State", FLD_STR, rnbd_path_state_to_str, 'l', CNRM, CBLD,
-	"Name of the path");
+	"Name of the path", RNBD_ATTR_PATH_STATE);
 CLM_P(pathname, "Path name", FLD_STR, path_to_norm, 'l', CNRM, CNRM,
-	"Path name");
+	"Path name", 0);
 CLM_P(src_addr, "Client Addr", FLD_STR, addr_to_norm, 'l', CNRM, CNRM,
-	"Client address of the path");
+	"Client address of the path", RNBD_ATTR_PATH_SRC_ADDR);
 CLM_P(dst_addr, "Server Addr", FLD_STR, addr_to_norm, 'l', CNRM, CNRM,
-	"Server address of the path");
-CLM_P(hca_name, "HCA", FLD_STR, NULL, 'l', CNRM, CNRM, "HCA name");
-CLM_P(hca_port, "Port", FLD_VAL, NULL, 'r', CNRM, CNRM, "HCA port");
-CLM_P(rx_bytes, "RX", FLD_LLU, byte_to_str, 'r', CNRM, CNRM, "Bytes received");
-CLM_P(tx_bytes, "TX", FLD_LLU, byte_to_str, 'r', CNRM, CNRM, "Bytes send");
-CLM_P(inflights, "Inflights", FLD_INT, NULL, 'r', CNRM, CNRM, "Inflights");
-CLM_P(reconnects, "Reconnects", FLD_INT, NULL, 'r', CNRM, CNRM, "Reconnects");
+	"Server address of the path", RNBD_ATTR_PATH_DST_ADDR);
+CLM_P(hca_name, "HCA", FLD_STR, NULL, 'l', CNRM, CNRM,
+	"HCA name", RNBD_ATTR_PATH_HCA_NAME);
+CLM_P(hca_port, "Port", FLD_VAL, NULL, 'r', CNRM, CNRM,
+	"HCA port", RNBD_ATTR_PATH_HCA_PORT);
+CLM_P_CNT(rx_bytes, "RX", FLD_LLU, byte_to_str, 'r', CNRM, CNRM,
+	"Bytes received", RNBD_ATTR_PATH_STATS_RDMA);
+CLM_P_CNT(tx_bytes, "TX", FLD_LLU, byte_to_str, 'r', CNRM, CNRM,
+	"Bytes send", RNBD_ATTR_PATH_STATS_RDMA);
+CLM_P(inflights, "Inflights", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Inflights", RNBD_ATTR_PATH_STATS_RDMA);
+CLM_P_CNT(reconnects, "Reconnects", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Reconnects", RNBD_ATTR_PATH_RECONNECTS);
 
 #define _CLM_P(s_name, m_name, m_header, m_type, tostr, align, h_clr, c_clr, \
-	       m_descr) \
+	       m_descr, deps) \
 	_CLM(rnbd_path, s_name, m_name, m_header, m_type, tostr, align, \
-	     h_clr, c_clr, m_descr, sizeof(m_header) - 1, 0)
+	     h_clr, c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
+
+#define _CLM_P_CNT(s_name, m_name, m_header, m_type, tostr, align, h_clr, \
+		   c_clr, m_descr, deps) \
+	_CLM_CNT(rnbd_path, s_name, m_name, m_header, m_type, tostr, align, \
+		 h_clr, c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
+
+#define _CLM_P_MEAN(s_name, m_name, m_header, m_type, tostr, align, h_clr, \
+		    c_clr, m_descr, deps) \
+	_CLM_MEAN(rnbd_path, s_name, m_name, m_header, m_type, tostr, align, \
+		  h_clr, c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
+
+#define _CLM_P_RATIO(s_name, m_name, dividend, m_header, m_type, tostr, \
+		     align, h_clr, c_clr, m_descr, deps) \
+	_CLM_RATIO(rnbd_path, s_name, m_name, dividend, m_header, m_type, \
+		   tostr, align, h_clr, c_clr, m_descr, sizeof(m_header) - 1, \
+		   0, deps)
 
 static struct table_column clm_rnbd_path_sessname =
 	_CLM_P("sessname", sess, "Sessname", FLD_STR, path_to_sessname, 'l',
-	       CNRM, CNRM, "Name of the session.");
+	       CNRM, CNRM, "Name of the session.", 0);
 
 static struct table_column clm_rnbd_path_hostname =
 	_CLM_P("hostname", sess, "Hostname", FLD_STR, path_to_hostname, 'l',
-	       CNRM, CNRM, "Hostname of the remote peer");
+	       CNRM, CNRM, "Hostname of the remote peer",
+	       RNBD_ATTR_SESS_HOSTNAME);
 
 static struct table_column clm_rnbd_path_shortdesc =
 	_CLM_P("shortdesc", sess, "Short", FLD_STR,
-	       path_to_shortdesc, 'l', CNRM, CNRM, "Short description");
+	       path_to_shortdesc, 'l', CNRM, CNRM, "Short description",
+	       RNBD_ATTR_PATH_HCA_NAME | RNBD_ATTR_PATH_HCA_PORT |
+	       RNBD_ATTR_PATH_STATE);
+
+static struct table_column clm_rnbd_path_rx_cnt =
+	_CLM_P_CNT("rx_cnt", rx_cnt, "RX reqs", FLD_LLU, NULL, 'r', CNRM, CNRM,
+	       "Read requests", RNBD_ATTR_PATH_STATS_RDMA);
+
+static struct table_column clm_rnbd_path_tx_cnt =
+	_CLM_P_CNT("tx_cnt", tx_cnt, "TX reqs", FLD_LLU, NULL, 'r', CNRM, CNRM,
+	       "Write requests", RNBD_ATTR_PATH_STATS_RDMA);
+
+static struct table_column clm_rnbd_path_rx_avg =
+	_CLM_P_RATIO("rx_avg", rx_cnt, rx_bytes, "RX avg", FLD_LLU,
+		     path_rx_avg_to_str, 'r', CNRM, CNRM,
+		     "Average size of a read request",
+		     RNBD_ATTR_PATH_STATS_RDMA);
+
+static struct table_column clm_rnbd_path_tx_avg =
+	_CLM_P_RATIO("tx_avg", tx_cnt, tx_bytes, "TX avg", FLD_LLU,
+		     path_tx_avg_to_str, 'r', CNRM, CNRM,
+		     "Average size of a write request",
+		     RNBD_ATTR_PATH_STATS_RDMA);
+
+static struct table_column clm_rnbd_path_cpu_migr =
+	_CLM_P_CNT("cpu_migr", migr.total, "CPU migr", FLD_LLU, NULL, 'r', CNRM,
+	       CNRM, "Requests completed on another CPU (client only)",
+	       RNBD_ATTR_PATH_CPU_MIGR);
+
+static struct table_column clm_rnbd_path_cur_latency =
+	_CLM_P_MEAN("cur_latency", cur_latency, "Latency", FLD_LLU,
+		    path_latency_to_str, 'r', CNRM, CNRM,
+		    "Current latency of the path (client only)",
+		    RNBD_ATTR_PATH_LATENCY);
 
 static struct table_column clm_rnbd_path_direction =
 	_CLM_P("direction", sess, "Direction", FLD_STR,
 	       path_sess_to_direction, 'l', CNRM, CNRM,
-	       "Direction of the path: incoming or outgoing");
+	       "Direction of the path: incoming or outgoing", 0);
 
-static struct table_column *all_clms_paths[] = {
+static struct table_column *all_clms_paths[] __attribute__ ((unused)) = {
 	&clm_rnbd_path_sessname,
 	&clm_rnbd_path_pathname,
 	&clm_rnbd_path_src_addr,
@@ -280,13 +488,19 @@ static struct table_column *all_clms_paths[] = {
 	&clm_rnbd_path_rx_bytes,
 	&clm_rnbd_path_tx_bytes,
 	&clm_rnbd_path_inflights,
+	&clm_rnbd_path_rx_cnt,
+	&clm_rnbd_path_tx_cnt,
+	&clm_rnbd_path_rx_avg,
+	&clm_rnbd_path_tx_avg,
+	&clm_rnbd_path_cpu_migr,
+	&clm_rnbd_path_cur_latency,
 	&clm_rnbd_path_reconnects,
 	&clm_rnbd_path_direction,
 	&clm_rnbd_path_hostname,
 	NULL
 };
 
-static struct table_column *all_clms_paths_clt[] = {
+static struct table_column *all_clms_paths_clt[] __attribute__ ((unused)) = {
 	&clm_rnbd_path_sessname,
 	&clm_rnbd_path_pathname,
 	&clm_rnbd_path_src_addr,
@@ -297,13 +511,19 @@ static struct table_column *all_clms_paths_clt[] = {
 	&clm_rnbd_path_rx_bytes,
 	&clm_rnbd_path_tx_bytes,
 	&clm_rnbd_path_inflights,
+	&clm_rnbd_path_rx_cnt,
+	&clm_rnbd_path_tx_cnt,
+	&clm_rnbd_path_rx_avg,
+	&clm_rnbd_path_tx_avg,
+	&clm_rnbd_path_cpu_migr,
+	&clm_rnbd_path_cur_latency,
 	&clm_rnbd_path_reconnects,
 	&clm_rnbd_path_direction,
 	&clm_rnbd_path_hostname,
 	NULL
 };
 
-static struct table_column *all_clms_paths_srv[] = {
+static struct table_column *all_clms_paths_srv[] __attribute__ ((unused)) = {
 	&clm_rnbd_path_sessname,
 	&clm_rnbd_path_pathname,
 	&clm_rnbd_path_src_addr,
@@ -313,12 +533,16 @@ static struct table_column *all_clms_paths_srv[] = {
 	&clm_rnbd_path_rx_bytes,
 	&clm_rnbd_path_tx_bytes,
 	&clm_rnbd_path_inflights,
+	&clm_rnbd_path_rx_cnt,
+	&clm_rnbd_path_tx_cnt,
+	&clm_rnbd_path_rx_avg,
+	&clm_rnbd_path_tx_avg,
 	&clm_rnbd_path_direction,
 	&clm_rnbd_path_hostname,
 	NULL
 };
 
-static struct table_column *def_clms_paths_clt[] = {
+static struct table_column *def_clms_paths_clt[] __attribute__ ((unused)) = {
 	&clm_rnbd_path_sessname,
 	&clm_rnbd_path_hca_name,
 	&clm_rnbd_path_hca_port,
@@ -329,7 +553,7 @@ static struct table_column *def_clms_paths_clt[] = {
 	NULL
 };
 
-static struct table_column *def_clms_paths_srv[] = {
+static struct table_column *def_clms_paths_srv[] __attribute__ ((unused)) = {
 	&clm_rnbd_path_sessname,
 	&clm_rnbd_path_hca_name,
 	&clm_rnbd_path_hca_port,
@@ -339,7 +563,7 @@ static struct table_column *def_clms_paths_srv[] = {
 	NULL
 };
 
-static struct table_column *clms_paths_sess_clt[] = {
+static struct table_column *clms_paths_sess_clt[] __attribute__ ((unused)) = {
 	&clm_rnbd_path_hca_name,
 	&clm_rnbd_path_hca_port,
 	&clm_rnbd_path_dst_addr,
@@ -347,7 +571,7 @@ static struct table_column *clms_paths_sess_clt[] = {
 	NULL
 };
 
-static struct table_column *clms_paths_sess_srv[] = {
+static struct table_column *clms_paths_sess_srv[] __attribute__ ((unused)) = {
 	&clm_rnbd_path_hca_name,
 	&clm_rnbd_path_hca_port,
 	&clm_rnbd_path_src_addr,
@@ -358,3 +582,129 @@ struct table_column *clms_paths_shortdesc[] = {
 	&clm_rnbd_path_shortdesc,
 	NULL
 };
+
+#define CLM_H(m_name, m_header, m_type, tostr, align, h_clr, c_clr, m_descr, \
+	      deps) \
+	CLM(rnbd_hca_port, m_name, m_header, m_type, tostr, align, h_clr, \
+	    c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
+
+#define CLM_H_CNT(m_name, m_header, m_type, tostr, align, h_clr, c_clr, \
+		  m_descr, deps) \
+	CLM_CNT(rnbd_hca_port, m_name, m_header, m_type, tostr, align, h_clr, \
+		c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
+
+CLM_H(hca_name, "HCA", FLD_STR, NULL, 'l', CNRM, CBLD,
+	"HCA name", RNBD_ATTR_PATH_HCA_NAME);
+CLM_H(port, "Port", FLD_VAL, NULL, 'r', CNRM, CNRM,
+	"HCA port", RNBD_ATTR_PATH_HCA_PORT);
+CLM_H(gid, "GID", FLD_STR, NULL, 'l', CNRM, CNRM,
+	"First GID of the port", 0);
+CLM_H(link_state, "Link", FLD_STR, hca_link_state_to_str, 'l', CNRM, CNRM,
+	"Link state of the port", 0);
+CLM_H(rate, "Rate", FLD_STR, NULL, 'l', CNRM, CNRM,
+	"Link rate of the port", 0);
+CLM_H(path_cnt, "Path cnt", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Number of paths using the port", 0);
+CLM_H(act_path_cnt, "Act path cnt", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Number of connected paths using the port", RNBD_ATTR_PATH_STATE);
+CLM_H_CNT(rx_bytes, "RX", FLD_LLU, byte_to_str, 'r', CNRM, CNRM,
+	"Bytes received over the port", RNBD_ATTR_PATH_STATS_RDMA);
+CLM_H_CNT(tx_bytes, "TX", FLD_LLU, byte_to_str, 'r', CNRM, CNRM,
+	"Bytes send over the port", RNBD_ATTR_PATH_STATS_RDMA);
+CLM_H(inflights, "Inflights", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Inflights", RNBD_ATTR_PATH_STATS_RDMA);
+CLM_H_CNT(reconnects, "Reconnects", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Reconnects of the paths", RNBD_ATTR_PATH_RECONNECTS);
+
+static struct table_column *all_clms_hcas[] __attribute__ ((unused)) = {
+	&clm_rnbd_hca_port_hca_name,
+	&clm_rnbd_hca_port_port,
+	&clm_rnbd_hca_port_gid,
+	&clm_rnbd_hca_port_link_state,
+	&clm_rnbd_hca_port_rate,
+	&clm_rnbd_hca_port_path_cnt,
+	&clm_rnbd_hca_port_act_path_cnt,
+	&clm_rnbd_hca_port_rx_bytes,
+	&clm_rnbd_hca_port_tx_bytes,
+	&clm_rnbd_hca_port_inflights,
+	&clm_rnbd_hca_port_reconnects,
+	NULL
+};
+
+static struct table_column *def_clms_hcas[] __attribute__ ((unused)) = {
+	&clm_rnbd_hca_port_hca_name,
+	&clm_rnbd_hca_port_port,
+	&clm_rnbd_hca_port_link_state,
+	&clm_rnbd_hca_port_rate,
+	&clm_rnbd_hca_port_path_cnt,
+	&clm_rnbd_hca_port_act_path_cnt,
+	&clm_rnbd_hca_port_tx_bytes,
+	&clm_rnbd_hca_port_rx_bytes,
+	&clm_rnbd_hca_port_inflights,
+	NULL
+};
+
+#define CLM_HO(m_name, m_header, m_type, tostr, align, h_clr, c_clr, m_descr, \
+	       deps) \
+	CLM(rnbd_host, m_name, m_header, m_type, tostr, align, h_clr, \
+	    c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
+
+#define _CLM_HO(s_name, m_name, m_header, m_type, tostr, align, h_clr, \
+		c_clr, m_descr, deps) \
+	_CLM(rnbd_host, s_name, m_name, m_header, m_type, tostr, align, \
+	     h_clr, c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
+
+#define CLM_HO_CNT(m_name, m_header, m_type, tostr, align, h_clr, c_clr, \
+		   m_descr, deps) \
+	CLM_CNT(rnbd_host, m_name, m_header, m_type, tostr, align, h_clr, \
+		c_clr, m_descr, sizeof(m_header) - 1, 0, deps)
+
+CLM_HO(hostname, "Hostname", FLD_STR, NULL, 'l', CNRM, CBLD,
+	"Hostname of the counterpart", RNBD_ATTR_SESS_HOSTNAME);
+CLM_HO(sess_cnt, "Sess cnt", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Number of sessions to the host", 0);
+CLM_HO(dev_cnt, "Dev cnt", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Number of devices imported from or exported to the host", 0);
+CLM_HO(path_cnt, "Path cnt", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Number of paths to the host", 0);
+CLM_HO(act_path_cnt, "Act path cnt", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Number of active paths to the host", RNBD_ATTR_PATH_STATE);
+CLM_HO_CNT(rx_bytes, "RX", FLD_LLU, byte_to_str, 'r', CNRM, CNRM,
+	"Bytes received from the host", RNBD_ATTR_PATH_STATS_RDMA);
+CLM_HO_CNT(tx_bytes, "TX", FLD_LLU, byte_to_str, 'r', CNRM, CNRM,
+	"Bytes send to the host", RNBD_ATTR_PATH_STATS_RDMA);
+CLM_HO(inflights, "Inflights", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Inflights", RNBD_ATTR_PATH_STATS_RDMA);
+CLM_HO_CNT(reconnects, "Reconnects", FLD_INT, NULL, 'r', CNRM, CNRM,
+	"Reconnects of the paths", RNBD_ATTR_PATH_RECONNECTS);
+
+static struct table_column clm_rnbd_host_side =
+	_CLM_HO("direction", side, "Direction", FLD_STR,
+		host_side_to_direction, 'l', CNRM, CNRM,
+		"Direction of the sessions: incoming or outgoing", 0);
+
+static struct table_column *all_clms_hosts[] __attribute__ ((unused)) = {
+	&clm_rnbd_host_hostname,
+	&clm_rnbd_host_sess_cnt,
+	&clm_rnbd_host_dev_cnt,
+	&clm_rnbd_host_path_cnt,
+	&clm_rnbd_host_act_path_cnt,
+	&clm_rnbd_host_rx_bytes,
+	&clm_rnbd_host_tx_bytes,
+	&clm_rnbd_host_inflights,
+	&clm_rnbd_host_reconnects,
+	&clm_rnbd_host_side,
+	NULL
+};
+
+static struct table_column *def_clms_hosts[] __attribute__ ((unused)) = {
+	&clm_rnbd_host_hostname,
+	&clm_rnbd_host_sess_cnt,
+	&clm_rnbd_host_dev_cnt,
+	&clm_rnbd_host_path_cnt,
+	&clm_rnbd_host_act_path_cnt,
+	&clm_rnbd_host_tx_bytes,
+	&clm_rnbd_host_rx_bytes,
+	&clm_rnbd_host_inflights,
+	NULL
+};
@@ -0,0 +1,167 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# Generate a synthetic sysfs tree of the rnbd and rtrs kernel modules,
+# to run rnbd without RDMA hardware:
+#
+#   ./rnbd-sysfs-gen.sh /tmp/rnbd-sysfs 100 2 10
+#   RNBD_SYSFS_ROOT=/tmp/rnbd-sysfs rnbd client sessions list
+#
+# The client side gets <sessions> sessions with <paths> paths each and
+# <devices> devices mapped over each session. The server side mirrors
+# it: <sessions> sessions with <paths> paths, each exporting <devices>
+# devices. The content of the files only depends on the arguments.
+# Writes of rnbd (map, resize, ...) just end up in the files.
+
+set -e
+
+usage() {
+	echo "Usage: $0 <dir> <sessions> <paths> <devices>" >&2
+	exit 1
+}
+
+[ $# -eq 4 ] || usage
+root=$1; S=$2; P=$3; D=$4
+for n in "$S" "$P" "$D"; do
+	[[ $n =~ ^[0-9]+$ ]] || usage
+done
+
+# only ever remove a tree generated by us
+if [ -e "$root/.rnbd-sysfs-gen" ]; then
+	rm -rf "$root/sys"
+elif [ -n "$(ls -A "$root" 2>/dev/null)" ]; then
+	echo "$root exists and is not a generated tree" >&2
+	exit 1
+fi
+mkdir -p "$root"
+: > "$root/.rnbd-sysfs-gen"
+
+sys=$root/sys
+c=$sys/class
+blk=$sys/devices/virtual/block
+
+mkdir -p "$c/rnbd-client/ctl/devices" "$c/rtrs-client/ctl" \
+	 "$c/rnbd-server/ctl/devices" "$c/rtrs-server" \
+	 "$c/block" "$sys/block" "$blk"
+: > "$c/rnbd-client/ctl/map_device"
+
+for hca in 0 1; do
+	port=$c/infiniband/mlx5_$hca/ports/1
+	mkdir -p "$port/gids"
+	printf "fe80:0000:0000:0000:0002:c903:0010:%04x\n" $((hca + 1)) \
+		> "$port/gids/0"
+	echo "4: ACTIVE" > "$port/state"
+	echo "100 Gb/sec (4X EDR)" > "$port/rate"
+done
+
+# block device $1 with index $2
+block_dev() {
+	local d=$blk/$1 i=$2
+
+	echo "$((i + 1)) 0 $((i * 16)) 5 $((i + 2)) 0 $((i * 8 + 1)) 7" \
+	     "0 10 12 0 0 0 0 0 0" > "$d/stat"
+	ln -s "../devices/virtual/block/$1" "$sys/block/$1"
+	ln -s "../../devices/virtual/block/$1" "$c/block/$1"
+}
+
+# client side
+for ((s = 0; s < S; s++)); do
+	sess=clt$s@srv$s
+	sd=$c/rtrs-client/$sess
+	dirs=("$sd/paths")
+	for ((p = 0; p < P; p++)); do
+		dirs+=("$sd/paths/ip:10.0.$p.1@ip:10.1.$((s / 256)).$((s % 256))/stats")
+	done
+	for ((d = 0; d < D; d++)); do
+		dirs+=("$blk/rnbd$((s * D + d))/rnbd")
+	done
+	mkdir -p "${dirs[@]}"
+
+	echo "min-inflight (MI: 1)" > "$sd/mpath_policy"
+	echo "srv$s" > "$sd/srv_hostname"
+	: > "$sd/add_path"
+
+	for ((p = 0; p < P; p++)); do
+		src=ip:10.0.$p.1
+		dst=ip:10.1.$((s / 256)).$((s % 256))
+		pd=$sd/paths/$src@$dst
+		echo "$src" > "$pd/src_addr"
+		echo "$dst" > "$pd/dst_addr"
+		echo "mlx5_$((p % 2))" > "$pd/hca_name"
+		echo 1 > "$pd/hca_port"
+		if (((s + p) % 7 == 3)); then
+			echo reconnecting > "$pd/state"
+		else
+			echo connected > "$pd/state"
+		fi
+		echo "$((s * 10 + p)) $((s * 4096 + p * 512)) $((p + 1))" \
+		     "$((s * 8192 + p)) $((p % 3)) 0" > "$pd/stats/rdma"
+		echo "$((p % 4)) 0" > "$pd/stats/reconnects"
+		echo "$((p * 3)) 0 $((s % 5)) 0 " > "$pd/stats/cpu_migration_from"
+		echo "0 $((p * 3)) 0 $((s % 5)) " > "$pd/stats/cpu_migration_to"
+		echo "$((20000 + s * 100 + p)) ns" > "$pd/cur_latency"
+		: > "$pd/reconnect"
+		: > "$pd/disconnect"
+		: > "$pd/remove_path"
+	done
+
+	for ((d = 0; d < D; d++)); do
+		dev=rnbd$((s * D + d))
+		rd=$blk/$dev/rnbd
+		block_dev $dev $((s * D + d))
+		ln -s "../../../../devices/virtual/block/$dev" \
+		      "$c/rnbd-client/ctl/devices/$dev"
+		echo "$sess" > "$rd/session"
+		echo "vol-$s-$d" > "$rd/mapping_path"
+		echo rw > "$rd/access_mode"
+		if ((d % 5 == 4)); then
+			echo closed > "$rd/state"
+		else
+			echo open > "$rd/state"
+		fi
+		: > "$rd/unmap_device"
+		: > "$rd/remap_device"
+		: > "$rd/resize"
+	done
+done
+
+# server side
+for ((s = 0; s < S; s++)); do
+	sess=host$s@srv
+	sd=$c/rtrs-server/$sess
+	dirs=("$sd/paths")
+	for ((p = 0; p < P; p++)); do
+		dirs+=("$sd/paths/ip:10.2.$((s / 256)).$((s % 256))@ip:10.3.0.$p/stats")
+	done
+	for ((d = 0; d < D; d++)); do
+		dirs+=("$blk/ram$((s * D + d))"
+		       "$c/rnbd-server/ctl/devices/ram$((s * D + d))/sessions/$sess")
+	done
+	mkdir -p "${dirs[@]}"
+
+	echo "host$s" > "$sd/clt_hostname"
+
+	for ((p = 0; p < P; p++)); do
+		src=ip:10.2.$((s / 256)).$((s % 256))
+		dst=ip:10.3.0.$p
+		pd=$sd/paths/$src@$dst
+		echo "$src" > "$pd/src_addr"
+		echo "$dst" > "$pd/dst_addr"
+		echo "mlx5_$((p % 2))" > "$pd/hca_name"
+		echo 1 > "$pd/hca_port"
+		echo "$((s + p)) $((s * 1000 + p)) 1 $((s * 2000 + p)) 1 0" \
+			> "$pd/stats/rdma"
+		: > "$pd/disconnect"
+	done
+
+	for ((d = 0; d < D; d++)); do
+		dev=ram$((s * D + d))
+		dd=$c/rnbd-server/ctl/devices/$dev
+		block_dev $dev $((s * D + d + 1))
+		ln -s "../../../../../devices/virtual/block/$dev" \
+		      "$dd/block_dev"
+		echo "/dev/$dev" > "$dd/sessions/$sess/mapping_path"
+		echo rw > "$dd/sessions/$sess/access_mode"
+		: > "$dd/sessions/$sess/force_close"
+	done
+done
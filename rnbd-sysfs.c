@@ -17,9 +17,23 @@
 #include <dirent.h>	/* for opendir() */
 #include <unistd.h>	/* for write() */
 #include <stdarg.h>
+#include <stdint.h>
+#include <ctype.h>
 #include <libgen.h>	/* for basename */
 #include <inttypes.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include <sys/mman.h>	/* for mmap() */
+#include <sys/syscall.h>	/* for syscall() */
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(IO_URING_OP_SUPPORTED)
+#define HAVE_IO_URING
+#endif
+#endif
+#endif
 
 #include "rnbd-sysfs.h"
 #include "table.h"
@@ -37,8 +51,6 @@
 #define COMPAT_PATH_SESS_SRV  "/sys/class/ibtrs-server/"
 #define COMPAT_PATH_DEV_NAME  "ibnbd"
 
-struct rnbd_dev *devs[4096]; /* FIXME: this has to be a list */
-
 
 static struct rnbd_sysfs_info _sysfs_info =
 {
@@ -66,613 +78,2513 @@ get_sysfs_info(const struct rnbd_ctx *ctx)
 	return use_sysfs_info;
 }
 
-int printf_sysfs(const char *dir, const char *entry,
-		 const struct rnbd_ctx *ctx, const char *format, ...)
+static int openat_dir(int dirfd, const char *name)
 {
-	char path[PATH_MAX];
-	char cmd[4096];
-	va_list args;
-	FILE *f;
-	int ret;
-
-	snprintf(path, sizeof(path), "%s/%s", dir, entry);
-
-	va_start(args, format);
-	ret = vsnprintf(cmd, sizeof(cmd), format, args);
-	va_end(args);
-
-	if (ctx->debug_set || ctx->simulate_set) {
+	return openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
 
-		printf("echo '%s' > %s\n", cmd, path);
-		if (ctx->simulate_set)
-			return 0;
-	}
-	f = fopen(path, "w");
-	if (!f)
-		return -errno;
+static DIR *opendir_at(int dirfd, const char *name)
+{
+	DIR *dir;
+	int fd;
 
-	ret = fputs(cmd, f);
+	fd = openat_dir(dirfd, name);
+	if (fd < 0)
+		return NULL;
 
-	if (ret >= 0) {
-		if (fflush(f))
-			ret = -errno;
-		else
-			ret = 0;
-	}
-	/* if something failed flush should have reported, */
-	/* don't need to check return value of close. */
-	fclose(f);
+	dir = fdopendir(fd);
+	if (!dir)
+		close(fd);
 
-	return ret;
+	return dir;
 }
 
-int scanf_sysfs(const char *dir, const char *entry, const char *format, ...)
+static void close_dir(int fd)
 {
-	char path[PATH_MAX];
-	va_list args;
-	FILE *f;
-	int ret;
+	if (fd >= 0)
+		close(fd);
+}
 
-	snprintf(path, sizeof(path), "%s/%s", dir, entry);
+/*
+ * All the sysfs entries are accessed relative to the root directory,
+ * which is "/" unless overridden by the RNBD_SYSFS_ROOT environment
+ * variable. This allows to run against a synthetic sysfs tree, see
+ * rnbd-sysfs-gen.sh.
+ */
+static int sysfs_root_fd = -1;
 
-	f = fopen(path, "r");
-	if (!f)
-		return -1;
+static int sysfs_root(void)
+{
+	const char *root;
 
-	va_start(args, format);
-	ret = vfscanf(f, format, args);
-	va_end(args);
+	if (sysfs_root_fd >= 0)
+		return sysfs_root_fd;
 
-	fclose(f);
+	root = getenv("RNBD_SYSFS_ROOT");
+	if (!root || !*root)
+		root = "/";
 
-	return ret;
+	sysfs_root_fd = openat_dir(AT_FDCWD, root);
+
+	return sysfs_root_fd;
 }
 
-static void rnbd_sysfs_free(struct rnbd_sess_dev **sds,
-			     struct rnbd_sess **sess,
-			     struct rnbd_path **paths)
+/*
+ * Path of a sysfs entry relative to the sysfs root
+ */
+static const char *sysfs_rel(const char *path)
 {
-	int i;
+	while (*path == '/')
+		path++;
 
-	for (i = 0; sds[i]; i++)
-		free(sds[i]);
-	free(sds);
+	return path;
+}
 
-	for (i = 0; sess[i]; i++) {
-		free(sess[i]->paths);
-		free(sess[i]);
-	}
-	free(sess);
+/*
+ * Parsers for the content of the sysfs attributes
+ */
+#define SYSFS_ATTR_LEN	256	/* longest attribute value read */
+#define SYSFS_PAGE_LEN	4096	/* per CPU values, at most a page */
 
-	for (i = 0; paths[i]; i++)
-		free(paths[i]);
-	free(paths);
+static char *skip_space(char *s)
+{
+	while (isspace(*s))
+		s++;
+
+	return s;
 }
 
-void rnbd_sysfs_free_all(struct rnbd_sess_dev **sds_clt,
-			  struct rnbd_sess_dev **sds_srv,
-			  struct rnbd_sess **sess_clt,
-			  struct rnbd_sess **sess_srv,
-			  struct rnbd_path **paths_clt,
-			  struct rnbd_path **paths_srv)
+/*
+ * Next token of @s separated by white space, terminated in place
+ */
+static char *parse_token(char **s)
 {
-	int i;
+	char *tok = skip_space(*s), *end = tok;
 
-	rnbd_sysfs_free(sds_clt, sess_clt, paths_clt);
-	rnbd_sysfs_free(sds_srv, sess_srv, paths_srv);
+	while (*end && !isspace(*end))
+		end++;
+	if (*end)
+		*end++ = '\0';
+	*s = end;
 
-	for (i = 0; devs[i]; i++)
-		free(devs[i]);
+	return *tok ? tok : NULL;
 }
 
-static int dir_cnt(const char *dir)
+static bool parse_digits(char **s, unsigned long *v)
 {
-	struct dirent *entry;
-	int cnt = 0;
-	DIR *dirp;
-
-	dirp = opendir(dir);
-	if (!dirp)
-		return 0;
+	unsigned long n = 0;
+	char *p = *s;
 
-	for (entry = readdir(dirp); entry; entry = readdir(dirp))
-		if (entry->d_name[0] != '.')
-			cnt++;
+	if (!isdigit(*p))
+		return false;
+	while (isdigit(*p))
+		n = n * 10 + (*p++ - '0');
 
-	closedir(dirp);
+	*s = p;
+	*v = n;
 
-	return cnt;
+	return true;
 }
 
-static int rnbd_sysfs_path_cnt(const char *sdir)
+static bool parse_ulong(char **s, unsigned long *v)
 {
-	struct dirent *sess;
-	char pdir[PATH_MAX];
-	int cnt = 0;
-	DIR *sp;
+	*s = skip_space(*s);
 
-	sp = opendir(sdir);
-	if (!sp)
-		return 0;
+	return parse_digits(s, v);
+}
 
-	for (sess = readdir(sp); sess; sess = readdir(sp)) {
-		if (sess->d_name[0] == '.')
-			continue;
+static bool parse_int(char **s, int *v)
+{
+	char *p = skip_space(*s);
+	unsigned long n;
+	bool neg;
 
-		sprintf(pdir, "%s/%s/paths/", sdir, sess->d_name);
-		cnt += dir_cnt(pdir);
-	}
-	closedir(sp);
+	neg = *p == '-';
+	if (neg || *p == '+')
+		p++;
+	if (!parse_digits(&p, &n))
+		return false;
 
-	return cnt;
+	*s = p;
+	*v = neg ? -(int)n : (int)n;
+
+	return true;
 }
 
-static int rnbd_sysfs_sds_srv_cnt(void)
+/*
+ * Parse the fields of <blockdev>/stat into @st, returns how many of
+ * them were there.
+ */
+static int parse_blk_stat(char **s, struct rnbd_blk_stat *st)
 {
-	struct dirent *sd;
-	char dir[PATH_MAX];
-	int cnt = 0;
-	DIR *d;
+	unsigned long *v = (unsigned long *)st;
+	int i;
 
-	sprintf(dir, "%s/devices/", use_sysfs_info->path_dev_srv);
-	d = opendir(dir);
-	if (!d)
-		return 0;
+	for (i = 0; i < sizeof(*st) / sizeof(*v); i++)
+		if (!parse_ulong(s, &v[i]))
+			break;
 
-	for (sd = readdir(d); sd; sd = readdir(d)) {
-		if (sd->d_name[0] == '.')
-			continue;
+	return i;
+}
 
-		sprintf(dir, "%s/devices/%s/sessions/", use_sysfs_info->path_dev_srv, sd->d_name);
-		cnt += dir_cnt(dir);
-	}
-	closedir(d);
+/*
+ * Sum of the per CPU counters of stats/cpu_migration_from or of the
+ * "from:" line of the older stats/cpu_migration table.
+ */
+static bool parse_cpu_migr_total(char *s, unsigned long *total)
+{
+	char *from = strstr(s, "from:");
+	unsigned long v;
 
-	return cnt;
+	if (from)
+		s = from + strlen("from:");
+
+	*total = 0;
+	while (parse_ulong(&s, &v))
+		*total += v;
+
+	return !*skip_space(s) || from;
 }
 
-static int rnbd_sysfs_alloc(struct rnbd_sess_dev ***sds,
-			     struct rnbd_sess ***sess,
-			     struct rnbd_path ***paths,
-			     int sds_cnt, int *sess_cnt, int *path_cnt,
-			     const char *sess_path)
+/*
+ * The sysfs helpers below take absolute paths, like "/sys/class/...",
+ * which are resolved relative to the sysfs root.
+ */
+int printf_sysfs(const char *dir, const char *entry,
+		 const struct rnbd_ctx *ctx, const char *format, ...)
 {
-	*sess_cnt = dir_cnt(sess_path);
-	if (*sess_cnt < 0)
-		return *sess_cnt;
+	char path[PATH_MAX];
+	char cmd[4096];
+	va_list args;
+	ssize_t len;
+	int fd, ret;
 
-	*path_cnt = rnbd_sysfs_path_cnt(sess_path);
-	if (*path_cnt < 0)
-		return *path_cnt;
+	snprintf(path, sizeof(path), "%s/%s", dir, entry);
 
-	*sess_cnt += 1;
-	*path_cnt += 1;
+	va_start(args, format);
+	len = vsnprintf(cmd, sizeof(cmd), format, args);
+	va_end(args);
 
-	*sds = calloc(sds_cnt, sizeof(*sds));
-	if (!*sds)
-		return -ENOMEM;
+	if (len >= sizeof(cmd))
+		return -E2BIG;
 
-	*sess = calloc(*sess_cnt, sizeof(*sess));
-	if (!*sess) {
-		free(*sds);
-		return -ENOMEM;
-	}
+	if (ctx->debug_set || ctx->simulate_set) {
 
-	*paths = calloc(*path_cnt, sizeof(*paths));
-	if (!*paths) {
-		free(*sds);
-		free(*sess);
-		return -ENOMEM;
+		printf("echo '%s' > %s\n", cmd, path);
+		if (ctx->simulate_set)
+			return 0;
 	}
+	fd = openat(sysfs_root(), sysfs_rel(path),
+		    O_WRONLY | O_TRUNC | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
 
-	return 0;
+	/* sysfs takes the whole value in a single write */
+	ret = write(fd, cmd, len);
+	if (ret < 0)
+		ret = -errno;
+	else if (ret != len)
+		ret = -EIO;
+	else
+		ret = 0;
+
+	/* if something failed write should have reported, */
+	/* don't need to check return value of close. */
+	close(fd);
+
+	return ret;
 }
 
-int rnbd_sysfs_alloc_all(struct rnbd_sess_dev ***sds_clt,
-			  struct rnbd_sess_dev ***sds_srv,
-			  struct rnbd_sess ***sess_clt,
-			  struct rnbd_sess ***sess_srv,
-			  struct rnbd_path ***paths_clt,
-			  struct rnbd_path ***paths_srv,
-			  int *sds_clt_cnt, int *sds_srv_cnt,
-			  int *sess_clt_cnt, int *sess_srv_cnt,
-			  int *paths_clt_cnt, int *paths_srv_cnt)
+/*
+ * Read the attribute @entry relative to @dirfd into @buf with a single
+ * read(), the content is NUL terminated. Returns its length or -errno.
+ */
+static int read_attr(int dirfd, const char *entry, char *buf, size_t size)
 {
-	char path[PATH_MAX];
-	int ret = 0;
+	ssize_t len;
+	int fd;
+
+	fd = openat(dirfd, entry, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	len = read(fd, buf, size - 1);
+	if (len < 0)
+		len = -errno;
+	else
+		buf[len] = '\0';
+	close(fd);
+
+	return len;
+}
 
-	devs[0] = NULL;
+/*
+ * Read the first token of the sysfs attribute @dir/@entry into @buf
+ */
+int read_sysfs_token(const char *dir, const char *entry,
+		     char *buf, size_t size)
+{
+	char path[PATH_MAX], val[SYSFS_ATTR_LEN], *s = val, *tok;
+	int ret;
 
+	snprintf(path, sizeof(path), "%s/%s", dir, entry);
 
-	sprintf(path, "%s/devices/", use_sysfs_info->path_dev_clt);
-	*sds_clt_cnt = dir_cnt(path);
-	if (*sds_clt_cnt < 0)
-		return *sds_clt_cnt;
+	ret = read_attr(sysfs_root(), sysfs_rel(path), val, sizeof(val));
+	if (ret < 0)
+		return ret;
 
+	tok = parse_token(&s);
+	if (!tok || strlen(tok) >= size)
+		return -EINVAL;
+	strcpy(buf, tok);
 
-	*sds_srv_cnt = rnbd_sysfs_sds_srv_cnt();
-	if (*sds_srv_cnt < 0)
-		return *sds_srv_cnt;
+	return 0;
+}
 
+/*
+ * Read the first line of the sysfs attribute @dir/@entry into @buf,
+ * without the surrounding white space
+ */
+int read_sysfs_line(const char *dir, const char *entry,
+		    char *buf, size_t size)
+{
+	char path[PATH_MAX], val[SYSFS_ATTR_LEN], *s, *end;
+	int ret;
 
-	*sds_clt_cnt += 1;
-	*sds_srv_cnt += 1;
+	snprintf(path, sizeof(path), "%s/%s", dir, entry);
 
-	ret = rnbd_sysfs_alloc(sds_clt, sess_clt, paths_clt,
-				*sds_clt_cnt, sess_clt_cnt, paths_clt_cnt,
-				use_sysfs_info->path_sess_clt);
-	if (ret)
+	ret = read_attr(sysfs_root(), sysfs_rel(path), val, sizeof(val));
+	if (ret < 0)
 		return ret;
 
-	ret = rnbd_sysfs_alloc(sds_srv, sess_srv, paths_srv,
-				*sds_srv_cnt, sess_srv_cnt, paths_srv_cnt,
-				use_sysfs_info->path_sess_srv);
-	if (ret)
-		rnbd_sysfs_free(*sds_clt, *sess_clt, *paths_clt);
+	s = skip_space(val);
+	end = s + strcspn(s, "\n");
+	while (end > s && isspace(end[-1]))
+		end--;
+	*end = '\0';
+	if (end - s >= size)
+		return -EINVAL;
+	strcpy(buf, s);
 
-	return ret;
+	return 0;
 }
 
-static struct rnbd_dev *find_or_add_dev(const char *syspath,
-					 struct rnbd_dev **devs,
-					 enum rnbdmode side)
+DIR *opendir_sysfs(const char *path)
 {
-	char *devname, *r, path[2*PATH_MAX], rpath[PATH_MAX];
-	int i;
+	return opendir_at(sysfs_root(), sysfs_rel(path));
+}
 
-	strcpy(path, syspath);
-	r = realpath(path, rpath);
-	if (!r)
-		return NULL;
+static const char *str_intern(const char *s);
 
-	devname = basename(rpath);
+/*
+ * Batched attribute reads
+ *
+ * The attributes of a scan level are not read one by one but collected
+ * in a batch together with the kind of their content and the pointers
+ * to store the values to. When the batch is flushed all the files are opened,
+ * read and closed at once: with io_uring each of the three steps is a
+ * single submission for the whole batch, without io_uring (old kernel,
+ * disabled by sysctl or seccomp) the files are read synchronously.
+ */
+#define SYSFS_BATCH_MAX	256
 
-	for (i = 0; devs[i]; i++)
-		if (!strcmp(devname, devs[i]->devname))
-			return devs[i];
+/*
+ * Content of the attributes and the arguments they are parsed into
+ */
+enum sysfs_parse {
+	SYSFS_TOKEN,	/* single token: const char ** (interned) */
+	SYSFS_INT,	/* int * */
+	SYSFS_MPATH,	/* mpath_policy: const char **policy, **short */
+	SYSFS_ULONG,	/* unsigned long * */
+	SYSFS_RDMA,	/* stats/rdma: unsigned long [4], int *infl */
+	SYSFS_CPU_FROM,	/* stats/cpu_migration_from: struct rnbd_cpu_migr * */
+	SYSFS_CPU_TO,	/* stats/cpu_migration_to: struct rnbd_cpu_migr * */
+	SYSFS_CPU_MIGR,	/* older stats/cpu_migration: struct rnbd_cpu_migr * */
+	SYSFS_BLK_STAT,	/* block stat: struct rnbd_blk_stat * */
+};
 
-	devs[i] = calloc(1, sizeof(**devs));
-	if (!devs[i])
-		return NULL;
+struct sysfs_attr {
+	int			dirfd;
+	int			fd;
+	int			len;
+	char			entry[32];
+	enum sysfs_parse	parse;
+	void			*args[3];
+	char			*buf;		/* small or a bigger one */
+	int			size;
+	char			small[SYSFS_ATTR_LEN];
+};
 
-	devs[i + 1] = NULL;
+struct sysfs_uring {
+	int			fd;
+	unsigned int		*sq_tail, *sq_mask, *sq_array;
+	unsigned int		*cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe	*sqes;
+	struct io_uring_cqe	*cqes;
+	void			*sq_ptr, *cq_ptr;
+	size_t			sq_len, cq_len, sqes_len;
+};
 
-	strcpy(devs[i]->devname, devname);
-	sprintf(devs[i]->devpath, "/dev/%s", devname);
-	scanf_sysfs(rpath, "stat", "%*d %*d %ld %*d %*d %*d %ld", &devs[i]->rx_sect,
-		    &devs[i]->tx_sect);
+struct sysfs_batch {
+	struct sysfs_uring	ring;
+	int			cnt;
+	struct sysfs_attr	attrs[SYSFS_BATCH_MAX];
+	int			fds_cnt;
+	int			fds[SYSFS_BATCH_MAX];	/* closed on flush */
+};
 
-	if (side == RNBD_CLIENT) {
-		snprintf(path, sizeof(path), "%s/%s/", rpath, use_sysfs_info->path_dev_name);
-		scanf_sysfs(path, "state", "%s", devs[i]->state);
-	}
+#ifdef HAVE_IO_URING
 
-	return devs[i];
+static void sysfs_uring_exit(struct sysfs_uring *r)
+{
+	if (r->fd < 0)
+		return;
+
+	if (r->sqes)
+		munmap(r->sqes, r->sqes_len);
+	if (r->cq_ptr && r->cq_ptr != r->sq_ptr)
+		munmap(r->cq_ptr, r->cq_len);
+	if (r->sq_ptr)
+		munmap(r->sq_ptr, r->sq_len);
+	close(r->fd);
+
+	memset(r, 0, sizeof(*r));
+	r->fd = -1;
 }
 
-static struct rnbd_path *add_path(const char *sdir,
-				   const char *pname,
-				   struct rnbd_path **paths)
+static bool sysfs_uring_supported(int fd)
 {
-	struct rnbd_path *p;
-	char ppath[PATH_MAX];
+	static const int ops[] = {
+		IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE
+	};
+	struct io_uring_probe *probe;
+	bool ret = true;
+	size_t len;
 	int i;
 
-	strcpy(ppath, sdir);
-	strcat(ppath, pname);
-
-	for (i = 0; paths[i]; i++)
-		;
+	len = sizeof(*probe) + IORING_OP_LAST * sizeof(probe->ops[0]);
+	probe = calloc(1, len);
+	if (!probe)
+		return false;
 
-	p = calloc(1, sizeof(**paths));
-	if (!p)
-		return NULL;
-	paths[i] = p;
+	if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE,
+		    probe, IORING_OP_LAST) < 0) {
+		free(probe);
+		return false;
+	}
 
-	strcpy(p->pathname, pname);
-	scanf_sysfs(ppath, "src_addr", "%s", p->src_addr);
-	scanf_sysfs(ppath, "dst_addr", "%s", p->dst_addr);
-	scanf_sysfs(ppath, "hca_name", "%s", p->hca_name);
-	scanf_sysfs(ppath, "hca_port", "%d", &p->hca_port);
-	scanf_sysfs(ppath, "state", "%s", p->state);
+	for (i = 0; i < ARRSIZE(ops); i++)
+		if (ops[i] > probe->last_op ||
+		    !(probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED))
+			ret = false;
 
-	scanf_sysfs(ppath, "/stats/rdma", "%*u %lu %*u %lu %d %*d",
-		    &p->rx_bytes, &p->tx_bytes, &p->inflights);
-	scanf_sysfs(ppath, "/stats/reconnects", "%d %*d", &p->reconnects);
+	free(probe);
 
-	return p;
+	return ret;
 }
 
-static struct rnbd_sess *find_or_add_sess(const char *sessname,
-					   struct rnbd_sess **sess,
-					   struct rnbd_path **paths,
-					   enum rnbdmode side)
+static void sysfs_uring_init(struct sysfs_uring *r)
 {
-	struct rnbd_sess *s;
-	struct rnbd_path *p;
-	struct dirent *pent;
-	char path[PATH_MAX];
-	DIR *pdir;
-	int i;
+	struct io_uring_params p = {};
 
-	if (side == RNBD_CLIENT)
-		sprintf(path, "%s%s", use_sysfs_info->path_sess_clt, sessname);
-	else
-		sprintf(path, "%s%s", use_sysfs_info->path_sess_srv, sessname);
+	memset(r, 0, sizeof(*r));
+	r->fd = syscall(__NR_io_uring_setup, SYSFS_BATCH_MAX, &p);
+	if (r->fd < 0)
+		return;
 
-	for (i = 0; sess[i]; i++)
-		if (!strcmp(sessname, sess[i]->sessname))
-			return sess[i];
+	if (!sysfs_uring_supported(r->fd))
+		goto err;
 
-	s = calloc(1, sizeof(**sess));
-	if (!s)
-		return NULL;
+	r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (r->cq_len > r->sq_len)
+			r->sq_len = r->cq_len;
+		r->cq_len = r->sq_len;
+	}
 
-	sess[i] = s;
+	r->sq_ptr = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_ptr == MAP_FAILED) {
+		r->sq_ptr = NULL;
+		goto err;
+	}
 
-	strcpy(s->sessname, sessname);
-	s->side = side;
-	scanf_sysfs(path, "mpath_policy", "%s (%2s: %*d)", s->mp, s->mp_short);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		r->cq_ptr = r->sq_ptr;
+	} else {
+		r->cq_ptr = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE,
+				 MAP_SHARED | MAP_POPULATE, r->fd,
+				 IORING_OFF_CQ_RING);
+		if (r->cq_ptr == MAP_FAILED) {
+			r->cq_ptr = NULL;
+			goto err;
+		}
+	}
 
-	if (side == RNBD_CLIENT)
-		scanf_sysfs(path, "srv_hostname", "%s", s->hostname);
-	else
-		scanf_sysfs(path, "clt_hostname", "%s", s->hostname);
+	r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED) {
+		r->sqes = NULL;
+		goto err;
+	}
 
-	strcat(path, "/paths/");
-	s->path_cnt = dir_cnt(path);
-	if (!s->path_cnt)
-		return s;
+	r->sq_tail = r->sq_ptr + p.sq_off.tail;
+	r->sq_mask = r->sq_ptr + p.sq_off.ring_mask;
+	r->sq_array = r->sq_ptr + p.sq_off.array;
+	r->cq_head = r->cq_ptr + p.cq_off.head;
+	r->cq_tail = r->cq_ptr + p.cq_off.tail;
+	r->cq_mask = r->cq_ptr + p.cq_off.ring_mask;
+	r->cqes = r->cq_ptr + p.cq_off.cqes;
 
-	s->paths = calloc(s->path_cnt + 1, sizeof(*paths));
-	if (!s->paths) {
-		free(s);
-		return NULL;
-	}
+	return;
 
-	pdir = opendir(path);
-	if (!pdir)
-		goto out;
+err:
+	sysfs_uring_exit(r);
+}
 
-	for (pent = readdir(pdir), i = 0; pent && i < s->path_cnt;
-	     pent = readdir(pdir), i++) {
-		if (pent->d_name[0] == '.') {
-			i--;
-			continue;
-		}
+enum sysfs_uring_step {
+	SYSFS_OPEN,
+	SYSFS_READ,
+	SYSFS_CLOSE,
+};
 
-		p = add_path(path, pent->d_name, paths);
-		if (!p)
-			goto out;
+/*
+ * Queue one request of @step for every attribute of the batch which
+ * needs it, submit them with one system call and reap the completions.
+ */
+static int sysfs_uring_step(struct sysfs_batch *b, enum sysfs_uring_step step)
+{
+	struct sysfs_uring *r = &b->ring;
+	unsigned int head, tail, idx;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	struct sysfs_attr *a;
+	int i, n = 0, submitted = 0, reaped = 0, ret;
+
+	tail = *r->sq_tail;
+	for (i = 0; i < b->cnt; i++) {
+		a = &b->attrs[i];
+		if (step != SYSFS_OPEN && a->fd < 0)
+			continue;
 
-		s->paths[i] = p;
-		p->sess = s;
-		if (!strcmp(p->state, "connected")) {
-			strcat(s->path_uu, "U");
-			s->act_path_cnt++;
-		} else {
-			strcat(s->path_uu, "_");
+		idx = tail & *r->sq_mask;
+		sqe = &r->sqes[idx];
+		memset(sqe, 0, sizeof(*sqe));
+		switch (step) {
+		case SYSFS_OPEN:
+			sqe->opcode = IORING_OP_OPENAT;
+			sqe->fd = a->dirfd;
+			sqe->addr = (unsigned long)a->entry;
+			sqe->open_flags = O_RDONLY | O_CLOEXEC;
+			break;
+		case SYSFS_READ:
+			sqe->opcode = IORING_OP_READ;
+			sqe->fd = a->fd;
+			sqe->addr = (unsigned long)a->buf;
+			sqe->len = a->size - 1;
+			break;
+		case SYSFS_CLOSE:
+			sqe->opcode = IORING_OP_CLOSE;
+			sqe->fd = a->fd;
+			break;
 		}
-
-		s->rx_bytes += p->rx_bytes;
-		s->tx_bytes += p->tx_bytes;
-		s->inflights += p->inflights;
-		s->reconnects += p->reconnects;
+		sqe->user_data = i;
+		r->sq_array[idx] = idx;
+		tail++;
+		n++;
 	}
+	__atomic_store_n(r->sq_tail, tail, __ATOMIC_RELEASE);
 
-	s->paths[i] = NULL;
-	closedir(pdir);
-	return s;
-
-out:
-	for (i = 0; s->paths[i]; i++)
-		free(s->paths[i]);
+	while (reaped < n) {
+		ret = syscall(__NR_io_uring_enter, r->fd, n - submitted,
+			      n - reaped, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		submitted += ret;
+
+		head = *r->cq_head;
+		tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++, reaped++) {
+			cqe = &r->cqes[head & *r->cq_mask];
+			a = &b->attrs[cqe->user_data];
+			switch (step) {
+			case SYSFS_OPEN:
+				a->fd = cqe->res < 0 ? -1 : cqe->res;
+				break;
+			case SYSFS_READ:
+				a->len = cqe->res;
+				break;
+			case SYSFS_CLOSE:
+				a->fd = -1;
+				break;
+			}
+		}
+		__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+	}
 
-	free(s->paths);
-	free(s);
-	return NULL;
+	return 0;
 }
 
-static struct rnbd_sess_dev *add_sess_dev(const char *devname,
-					   struct rnbd_sess_dev **sds,
-					   struct rnbd_sess *s,
-					   struct rnbd_dev *d,
-					   enum rnbdmode side)
+static int sysfs_uring_read(struct sysfs_batch *b)
 {
-	char path[PATH_MAX];
-	int i;
+	int ret;
 
-	if (side == RNBD_CLIENT)
-		sprintf(path, "%s/devices/%s/%s/", use_sysfs_info->path_dev_clt,
-			devname, use_sysfs_info->path_dev_name);
-	else
-		sprintf(path, "%s/devices/%s/sessions/%s",
-			use_sysfs_info->path_dev_srv, devname, s->sessname);
+	if (b->ring.fd < 0)
+		return -EOPNOTSUPP;
 
-	for (i = 0; sds[i]; i++)
-		;
+	ret = sysfs_uring_step(b, SYSFS_OPEN);
+	if (!ret)
+		ret = sysfs_uring_step(b, SYSFS_READ);
+	if (!ret)
+		ret = sysfs_uring_step(b, SYSFS_CLOSE);
+	if (ret)
+		/* don't try again, the rest is done synchronously */
+		sysfs_uring_exit(&b->ring);
 
-	sds[i] = calloc(1, sizeof(**sds));
-	if (!sds[i])
-		return NULL;
+	return ret;
+}
 
-	scanf_sysfs(path, "mapping_path", "%s", sds[i]->mapping_path);
-	scanf_sysfs(path, "access_mode", "%s", sds[i]->access_mode);
+#else /* HAVE_IO_URING */
 
-	sds[i]->sess = s;
-	sds[i]->dev = d;
+static void sysfs_uring_init(struct sysfs_uring *r)
+{
+	r->fd = -1;
+}
 
-	return sds[i];
+static void sysfs_uring_exit(struct sysfs_uring *r)
+{
 }
 
-static int rnbd_sysfs_read_sess_path(
-		struct rnbd_sess **sess,
-		struct rnbd_path **paths,
-		enum rnbdmode side)
+static int sysfs_uring_read(struct sysfs_batch *b)
 {
-	struct dirent *sess_ent;
-	DIR *sp;
+	return -EOPNOTSUPP;
+}
 
-	if (side == RNBD_CLIENT)
-		sp = opendir(use_sysfs_info->path_sess_clt);
-	else
-		sp = opendir(use_sysfs_info->path_sess_srv);
-	if (!sp)
-		return 0;
+#endif /* HAVE_IO_URING */
 
-	for (sess_ent = readdir(sp); sess_ent; sess_ent = readdir(sp)) {
-		if (sess_ent->d_name[0] == '.')
+static void sysfs_sync_read(struct sysfs_batch *b)
+{
+	struct sysfs_attr *a;
+	int i;
+
+	for (i = 0; i < b->cnt; i++) {
+		a = &b->attrs[i];
+		if (a->len >= 0)
 			continue;
-		if (strcmp(sess_ent->d_name, "ctl") == 0)
+		if (a->fd < 0)
+			a->fd = openat(a->dirfd, a->entry, O_RDONLY | O_CLOEXEC);
+		if (a->fd < 0)
 			continue;
-
-		 find_or_add_sess(sess_ent->d_name, sess, paths, side);
+		a->len = read(a->fd, a->buf, a->size - 1);
+		close(a->fd);
+		a->fd = -1;
 	}
-	closedir(sp);
-
-	return 0;
 }
 
-static int rnbd_sysfs_read_clt(struct rnbd_sess_dev **sds,
-				struct rnbd_sess **sess,
-				struct rnbd_path **paths,
-				struct rnbd_dev **devs)
+static struct sysfs_batch *sysfs_batch_new(void)
+{
+	struct sysfs_batch *b;
+
+	b = malloc(sizeof(*b));
+	if (!b)
+		return NULL;
+
+	b->cnt = 0;
+	b->fds_cnt = 0;
+	sysfs_uring_init(&b->ring);
+
+	return b;
+}
+
+/* on failure the string keeps its previous value */
+static void store_str(void *arg, const char *s)
+{
+	const char *str = str_intern(s);
+
+	if (str)
+		*(const char **)arg = str;
+}
+
+static void *arena_alloc(size_t size);
+
+/*
+ * Per CPU counters into a new array of the arena, returns the number
+ * of CPUs.
+ */
+static int parse_cpu_cnts(char **s, unsigned long **cnts)
+{
+	unsigned long v;
+	char *p = *s;
+	int i, n = 0;
+
+	while (parse_ulong(&p, &v))
+		n++;
+	if (!n)
+		return 0;
+
+	*cnts = arena_alloc(n * sizeof(**cnts));
+	if (!*cnts)
+		return 0;
+
+	for (i = 0; i < n; i++)
+		parse_ulong(s, &(*cnts)[i]);
+
+	return n;
+}
+
+/*
+ * "    CPU0 CPU1 ...\nfrom: <n> <n> ...\nto  : <n> <n> ...\n"
+ */
+static void parse_cpu_migr_table(char *s, struct rnbd_cpu_migr *m)
+{
+	char *from, *to;
+
+	from = strstr(s, "\nfrom:");
+	to = strstr(s, "\nto");
+	if (!from || !to || !(to = strchr(to, ':')))
+		return;
+
+	from += strlen("\nfrom:");
+	to++;
+	m->from_cnt = parse_cpu_cnts(&from, &m->from);
+	m->to_cnt = parse_cpu_cnts(&to, &m->to);
+}
+
+static void cpu_migr_sum(struct rnbd_cpu_migr *m)
+{
+	int i;
+
+	m->total = 0;
+	for (i = 0; i < m->from_cnt; i++)
+		m->total += m->from[i];
+}
+
+/*
+ * The values are only stored up to the first one which can't be parsed,
+ * like sscanf() does.
+ */
+static void sysfs_attr_parse(struct sysfs_attr *a)
+{
+	struct rnbd_cpu_migr *m = a->args[0];
+	unsigned long *v = a->args[0];
+	char *s = a->buf, *tok;
+	int n;
+
+	a->buf[a->len] = '\0';
+
+	switch (a->parse) {
+	case SYSFS_TOKEN:
+		tok = parse_token(&s);
+		if (tok)
+			store_str(a->args[0], tok);
+		break;
+	case SYSFS_INT:
+		parse_int(&s, a->args[0]);
+		break;
+	case SYSFS_ULONG:
+		parse_ulong(&s, a->args[0]);
+		break;
+	case SYSFS_MPATH:
+		/* "min-inflight (MI: 1)" */
+		tok = parse_token(&s);
+		if (!tok)
+			break;
+		store_str(a->args[0], tok);
+
+		s = skip_space(s);
+		if (*s++ != '(')
+			break;
+		s = skip_space(s);
+		for (n = 0; n < 2 && s[n] && !isspace(s[n]); n++)
+			;
+		s[n] = '\0';
+		if (n)
+			store_str(a->args[1], s);
+		break;
+	case SYSFS_RDMA:
+		/* rx cnt, rx bytes, tx cnt, tx bytes, inflight, failover */
+		for (n = 0; n < 4; n++)
+			if (!parse_ulong(&s, &v[n]))
+				break;
+		if (n == 4)
+			parse_int(&s, a->args[1]);
+		break;
+	case SYSFS_CPU_FROM:
+		m->from_cnt = parse_cpu_cnts(&s, &m->from);
+		cpu_migr_sum(m);
+		break;
+	case SYSFS_CPU_TO:
+		m->to_cnt = parse_cpu_cnts(&s, &m->to);
+		break;
+	case SYSFS_CPU_MIGR:
+		parse_cpu_migr_table(s, m);
+		cpu_migr_sum(m);
+		break;
+	case SYSFS_BLK_STAT:
+		parse_blk_stat(&s, a->args[0]);
+		break;
+	}
+}
+
+/*
+ * Read and parse all the attributes queued so far,
+ * then close the directories handed over to the batch.
+ */
+static void sysfs_batch_flush(struct sysfs_batch *b)
+{
+	int i;
+
+	if (b->cnt && sysfs_uring_read(b))
+		sysfs_sync_read(b);
+
+	for (i = 0; i < b->cnt; i++) {
+		if (b->attrs[i].len > 0)
+			sysfs_attr_parse(&b->attrs[i]);
+		if (b->attrs[i].buf != b->attrs[i].small)
+			free(b->attrs[i].buf);
+	}
+	b->cnt = 0;
+
+	for (i = 0; i < b->fds_cnt; i++)
+		close(b->fds[i]);
+	b->fds_cnt = 0;
+}
+
+static void sysfs_batch_free(struct sysfs_batch *b)
+{
+	if (!b)
+		return;
+
+	sysfs_batch_flush(b);
+	sysfs_uring_exit(&b->ring);
+	free(b);
+}
+
+/*
+ * Queue reading of @entry relative to @dirfd, the content is parsed
+ * according to @parse into up to three pointers when the batch is
+ * flushed.
+ */
+#define sysfs_batch_add(b, dirfd, entry, parse, ...)			\
+	_sysfs_batch_add(b, dirfd, entry, parse, ##__VA_ARGS__,		\
+			 NULL, NULL, NULL)
+
+static void _sysfs_batch_add(struct sysfs_batch *b, int dirfd,
+			     const char *entry, enum sysfs_parse parse, ...)
+{
+	struct sysfs_attr *a;
+	va_list args;
+	int i;
+
+	if (dirfd < 0)
+		return;
+
+	if (b->cnt == SYSFS_BATCH_MAX)
+		sysfs_batch_flush(b);
+
+	a = &b->attrs[b->cnt++];
+	a->dirfd = dirfd;
+	a->fd = -1;
+	a->len = -1;
+	snprintf(a->entry, sizeof(a->entry), "%s", entry);
+	a->parse = parse;
+
+	/* per CPU values don't fit, fall back to a truncated read */
+	a->buf = NULL;
+	if (parse == SYSFS_CPU_FROM || parse == SYSFS_CPU_TO ||
+	    parse == SYSFS_CPU_MIGR)
+		a->buf = malloc(SYSFS_PAGE_LEN);
+	a->size = a->buf ? SYSFS_PAGE_LEN : sizeof(a->small);
+	if (!a->buf)
+		a->buf = a->small;
+
+	va_start(args, parse);
+	for (i = 0; i < ARRSIZE(a->args); i++)
+		a->args[i] = va_arg(args, void *);
+	va_end(args);
+}
+
+/*
+ * Hand the directory @fd over to the batch, it is closed
+ * after the attributes queued relative to it are read.
+ */
+static void sysfs_batch_own(struct sysfs_batch *b, int fd)
+{
+	if (fd < 0)
+		return;
+
+	if (b->fds_cnt == SYSFS_BATCH_MAX)
+		sysfs_batch_flush(b);
+
+	b->fds[b->fds_cnt++] = fd;
+}
+
+/*
+ * Append @el to the NULL terminated array @arr holding @cnt elements.
+ * The array is grown geometrically, @cap is its current capacity.
+ */
+#define vec_add(arr, cnt, cap, el)					\
+({									\
+	typeof(arr) __v = (arr);					\
+	int __ret = 0;							\
+									\
+	if ((cnt) + 2 > (cap)) {					\
+		__v = realloc((arr), ((cap) ? 2 * (cap) : 16) *	\
+			      sizeof(*(arr)));				\
+		if (__v)						\
+			(cap) = (cap) ? 2 * (cap) : 16;			\
+	}								\
+	if (__v) {							\
+		(arr) = __v;						\
+		(arr)[(cnt)++] = (el);					\
+		(arr)[(cnt)] = NULL;					\
+	} else {							\
+		__ret = -ENOMEM;					\
+	}								\
+	__ret;								\
+})
+
+/*
+ * Open addressing hash index over the objects of a snapshot. A slot
+ * holds an object and the hash of the key it was added under. Objects
+ * can be added under several keys and several objects can share a key,
+ * so a lookup walks the whole probe sequence of the key and compares
+ * the objects found.
+ */
+struct sysfs_index_slot {
+	unsigned int	hash;
+	void		*obj;
+};
+
+struct sysfs_index {
+	struct sysfs_index_slot	*slots;
+	unsigned int		size;	/* power of 2 */
+	unsigned int		cnt;
+};
+
+#define index_for_each(idx, h, i)					\
+	for ((i) = (h) & ((idx)->size - 1);				\
+	     (idx)->size && (idx)->slots[(i)].obj;			\
+	     (i) = ((i) + 1) & ((idx)->size - 1))
+
+/* FNV-1a, @h is the hash of the preceding part of a composite key */
+static unsigned int str_hash(unsigned int h, const char *s)
+{
+	while (*s) {
+		h ^= (unsigned char)*s++;
+		h *= 16777619;
+	}
+
+	return h;
+}
+
+#define STR_HASH_INIT 2166136261u
+
+static int index_add(struct sysfs_index *idx, unsigned int h, void *obj)
+{
+	struct sysfs_index_slot *slots;
+	unsigned int i, j, size;
+
+	/* keep the load factor below 1/2 */
+	if (2 * (idx->cnt + 1) > idx->size) {
+		size = idx->size ? 2 * idx->size : 64;
+		slots = calloc(size, sizeof(*slots));
+		if (!slots)
+			return -ENOMEM;
+
+		for (i = 0; i < idx->size; i++) {
+			if (!idx->slots[i].obj)
+				continue;
+			for (j = idx->slots[i].hash & (size - 1); slots[j].obj;
+			     j = (j + 1) & (size - 1))
+				;
+			slots[j] = idx->slots[i];
+		}
+		free(idx->slots);
+		idx->slots = slots;
+		idx->size = size;
+	}
+
+	index_for_each(idx, h, i)
+		;
+	idx->slots[i].hash = h;
+	idx->slots[i].obj = obj;
+	idx->cnt++;
+
+	return 0;
+}
+
+static void index_free(struct sysfs_index *idx)
+{
+	free(idx->slots);
+	memset(idx, 0, sizeof(*idx));
+}
+
+/*
+ * Indexes of the objects of one side
+ */
+struct sysfs_indexes {
+	struct sysfs_index	sess;	/* by session name */
+	struct sysfs_index	paths;	/* by session name and path name */
+	struct sysfs_index	sds;	/* by mapping path and device name */
+};
+
+static struct sysfs_indexes idx_clt, idx_srv;
+static struct sysfs_index idx_devs;	/* by device name */
+
+static void sysfs_indexes_free(struct sysfs_indexes *idx)
+{
+	index_free(&idx->sess);
+	index_free(&idx->paths);
+	index_free(&idx->sds);
+}
+
+static unsigned int path_hash(const char *sessname, const char *pathname)
+{
+	return str_hash(str_hash(str_hash(STR_HASH_INIT, sessname), "/"),
+			pathname);
+}
+
+/*
+ * Arena holding the objects and the strings of a snapshot. It grows in
+ * chunks and is only released as a whole. The workers of the pool
+ * allocate concurrently, hence the lock.
+ */
+#define ARENA_CHUNK	(64 * 1024)
+
+struct arena_chunk {
+	struct arena_chunk	*next;
+	size_t			size;
+	size_t			used;
+	char			data[];
+};
+
+static struct arena_chunk *arena;
+static struct sysfs_index strs;		/* interned strings */
+static size_t strs_bytes;
+static pthread_mutex_t arena_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *arena_alloc_locked(size_t size)
+{
+	struct arena_chunk *c = arena;
+	void *p;
+
+	size = (size + 7) & ~(size_t)7;
+	if (!c || c->used + size > c->size) {
+		c = malloc(sizeof(*c) + (size > ARENA_CHUNK ? size
+							      : ARENA_CHUNK));
+		if (!c)
+			return NULL;
+		c->size = size > ARENA_CHUNK ? size : ARENA_CHUNK;
+		c->used = 0;
+		c->next = arena;
+		arena = c;
+	}
+	p = c->data + c->used;
+	c->used += size;
+
+	return p;
+}
+
+/*
+ * Zeroed memory from the arena
+ */
+static void *arena_alloc(size_t size)
+{
+	void *p;
+
+	pthread_mutex_lock(&arena_lock);
+	p = arena_alloc_locked(size);
+	pthread_mutex_unlock(&arena_lock);
+
+	if (p)
+		memset(p, 0, size);
+
+	return p;
+}
+
+static void arena_free(void)
+{
+	struct arena_chunk *c;
+
+	while (arena) {
+		c = arena;
+		arena = c->next;
+		free(c);
+	}
+	index_free(&strs);
+	strs_bytes = 0;
+}
+
+/*
+ * Interned strings are preceded by their length
+ */
+static const struct {
+	uint16_t	len;
+	char		str[1];
+} str_empty;
+
+static size_t str_len(const char *s)
+{
+	return ((const uint16_t *)s)[-1];
+}
+
+/*
+ * Return the interned copy of @s, NULL if out of memory
+ */
+static const char *str_intern(const char *s)
+{
+	unsigned int i, h;
+	const char *o;
+	uint16_t *e;
+	size_t len;
+
+	len = strlen(s);
+	if (!len)
+		return str_empty.str;
+	if (len > UINT16_MAX)
+		return NULL;
+
+	h = str_hash(STR_HASH_INIT, s);
+
+	pthread_mutex_lock(&arena_lock);
+	index_for_each(&strs, h, i) {
+		o = strs.slots[i].obj;
+		if (strs.slots[i].hash == h && str_len(o) == len &&
+		    !memcmp(o, s, len))
+			goto out;
+	}
+
+	o = NULL;
+	e = arena_alloc_locked(sizeof(*e) + len + 1);
+	if (!e)
+		goto out;
+	*e = len;
+	memcpy(e + 1, s, len + 1);
+	if (!index_add(&strs, h, e + 1)) {
+		o = (const char *)(e + 1);
+		strs_bytes += sizeof(*e) + len + 1;
+	}
+out:
+	pthread_mutex_unlock(&arena_lock);
+
+	return o;
+}
+
+void rnbd_sysfs_mem_stats(struct rnbd_sysfs_mem *mem)
+{
+	const struct sysfs_index *idx[] = {
+		&idx_devs, &idx_clt.sess, &idx_clt.paths, &idx_clt.sds,
+		&idx_srv.sess, &idx_srv.paths, &idx_srv.sds, &strs
+	};
+	struct arena_chunk *c;
+	int i;
+
+	memset(mem, 0, sizeof(*mem));
+	for (c = arena; c; c = c->next) {
+		mem->arena += sizeof(*c) + c->size;
+		mem->used += c->used;
+	}
+	mem->strs = strs.cnt;
+	mem->strs_bytes = strs_bytes;
+	for (i = 0; i < ARRSIZE(idx); i++)
+		mem->index += idx[i]->size * sizeof(*idx[i]->slots);
+}
+
+/*
+ * Objects of one side (client or server) collected during the scan
+ */
+struct rnbd_sysfs_objs {
+	int			sess_fd;	/* rtrs sessions class dir */
+	struct sysfs_indexes	*idx;
+	struct rnbd_sess_dev	**sds;
+	int			sds_cnt, sds_cap;
+	struct rnbd_sess	**sess;
+	int			sess_cnt, sess_cap;
+	struct rnbd_path	**paths;
+	int			paths_cnt, paths_cap;
+};
+
+static struct rnbd_dev **devs;
+static int devs_cnt, devs_cap;
+
+/*
+ * The objects themselves are in the arena, only the arrays are freed
+ */
+static void rnbd_sysfs_free(struct rnbd_sess_dev **sds,
+			     struct rnbd_sess **sess,
+			     struct rnbd_path **paths)
+{
+	free(sds);
+	free(sess);
+	free(paths);
+}
+
+void rnbd_sysfs_free_all(struct rnbd_sess_dev **sds_clt,
+			  struct rnbd_sess_dev **sds_srv,
+			  struct rnbd_sess **sess_clt,
+			  struct rnbd_sess **sess_srv,
+			  struct rnbd_path **paths_clt,
+			  struct rnbd_path **paths_srv)
+{
+	rnbd_sysfs_free(sds_clt, sess_clt, paths_clt);
+	rnbd_sysfs_free(sds_srv, sess_srv, paths_srv);
+
+	free(devs);
+
+	devs = NULL;
+	devs_cnt = 0;
+	devs_cap = 0;
+
+	index_free(&idx_devs);
+	sysfs_indexes_free(&idx_clt);
+	sysfs_indexes_free(&idx_srv);
+	arena_free();
+
+	close_dir(sysfs_root_fd);
+	sysfs_root_fd = -1;
+}
+
+/*
+ * Simple worker pool: fn(arg, i, batch) is called for every i in
+ * [0, nr). Each worker queues the attributes into its own batch, which
+ * is flushed when the worker is done. The calling thread takes part in
+ * the work, so with jobs <= 1 no threads are created at all.
+ */
+struct sysfs_pool {
+	int	(*fn)(void *arg, int i, struct sysfs_batch *b);
+	void	*arg;
+	int	nr;
+	int	next;
+	int	err;
+};
+
+static int sysfs_jobs = 1;
+static unsigned int sysfs_attrs = RNBD_ATTR_ALL;
+
+static void *sysfs_pool_worker(void *data)
+{
+	struct sysfs_pool *pool = data;
+	struct sysfs_batch *b;
+	int i, err;
+
+	b = sysfs_batch_new();
+	if (!b) {
+		__atomic_store_n(&pool->err, -ENOMEM, __ATOMIC_RELAXED);
+		return NULL;
+	}
+
+	for (;;) {
+		i = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+		if (i >= pool->nr)
+			break;
+
+		err = pool->fn(pool->arg, i, b);
+		if (err)
+			__atomic_store_n(&pool->err, err, __ATOMIC_RELAXED);
+	}
+
+	sysfs_batch_free(b);
+
+	return NULL;
+}
+
+static int sysfs_pool_run(int nr,
+			  int (*fn)(void *arg, int i, struct sysfs_batch *b),
+			  void *arg)
+{
+	struct sysfs_pool pool = { .fn = fn, .arg = arg, .nr = nr };
+	pthread_t threads[RNBD_SYSFS_MAX_JOBS];
+	int i, jobs, started = 0;
+
+	jobs = sysfs_jobs < nr ? sysfs_jobs : nr;
+
+	for (i = 1; i < jobs; i++) {
+		/* if we can't start more threads, go on with what we have */
+		if (pthread_create(&threads[started], NULL,
+				   sysfs_pool_worker, &pool))
+			break;
+		started++;
+	}
+
+	sysfs_pool_worker(&pool);
+
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	return pool.err;
+}
+
+/*
+ * @link is the symlink to the block device directory relative to @dirfd
+ */
+static struct rnbd_dev *read_dev(int dirfd, const char *link,
+				  enum rnbdmode side, struct sysfs_batch *b)
+{
+	char entry[NAME_MAX + 8], lpath[PATH_MAX], devpath[PATH_MAX];
+	struct rnbd_dev *d;
+	ssize_t len;
+	int fd;
+
+	len = readlinkat(dirfd, link, lpath, sizeof(lpath) - 1);
+	if (len < 0)
+		return NULL;
+	lpath[len] = '\0';
+
+	d = arena_alloc(sizeof(*d));
+	if (!d)
+		return NULL;
+
+	snprintf(devpath, sizeof(devpath), "/dev/%s", basename(lpath));
+	d->devpath = str_intern(devpath);
+	d->devname = str_intern(basename(lpath));
+	d->state = str_empty.str;
+	if (!d->devname || !d->devpath)
+		return NULL;
+
+	if (!(sysfs_attrs & (RNBD_ATTR_DEV_STAT | RNBD_ATTR_DEV_STATE)))
+		return d;
+
+	fd = openat_dir(dirfd, link);
+	if (sysfs_attrs & RNBD_ATTR_DEV_STAT)
+		sysfs_batch_add(b, fd, "stat", SYSFS_BLK_STAT, &d->stat);
+
+	if (side == RNBD_CLIENT && sysfs_attrs & RNBD_ATTR_DEV_STATE) {
+		snprintf(entry, sizeof(entry), "%s/state",
+			 use_sysfs_info->path_dev_name);
+		sysfs_batch_add(b, fd, entry, SYSFS_TOKEN, &d->state);
+	}
+	sysfs_batch_own(b, fd);
+
+	return d;
+}
+
+/*
+ * Add @d to the list of devices unless a device with the same name
+ * is already there, in which case the existing one is returned.
+ */
+static struct rnbd_dev *find_or_add_dev(struct rnbd_dev *d)
+{
+	unsigned int i, h = str_hash(STR_HASH_INIT, d->devname);
+	struct rnbd_dev *o;
+
+	index_for_each(&idx_devs, h, i) {
+		o = idx_devs.slots[i].obj;
+		if (idx_devs.slots[i].hash == h && d->devname == o->devname)
+			return o;
+	}
+
+	if (vec_add(devs, devs_cnt, devs_cap, d))
+		return NULL;
+	if (index_add(&idx_devs, h, d)) {
+		/* still owned by devs */
+		return NULL;
+	}
+
+	return d;
+}
+
+static struct rnbd_path *read_path(int pdirfd, const char *pname,
+				    enum rnbdmode side, struct sysfs_batch *b)
+{
+	struct rnbd_path *p;
+	int fd;
+
+	p = arena_alloc(sizeof(*p));
+	if (!p)
+		return NULL;
+
+	p->pathname = str_intern(pname);
+	if (!p->pathname)
+		return NULL;
+	p->src_addr = p->dst_addr = p->hca_name = str_empty.str;
+	p->state = str_empty.str;
+
+	if (!(sysfs_attrs & RNBD_ATTR_PATH_ALL))
+		return p;
+
+	fd = openat_dir(pdirfd, pname);
+
+	if (sysfs_attrs & RNBD_ATTR_PATH_SRC_ADDR)
+		sysfs_batch_add(b, fd, "src_addr", SYSFS_TOKEN, &p->src_addr);
+	if (sysfs_attrs & RNBD_ATTR_PATH_DST_ADDR)
+		sysfs_batch_add(b, fd, "dst_addr", SYSFS_TOKEN, &p->dst_addr);
+	if (sysfs_attrs & RNBD_ATTR_PATH_HCA_NAME)
+		sysfs_batch_add(b, fd, "hca_name", SYSFS_TOKEN, &p->hca_name);
+	if (sysfs_attrs & RNBD_ATTR_PATH_HCA_PORT)
+		sysfs_batch_add(b, fd, "hca_port", SYSFS_INT, &p->hca_port);
+	if (sysfs_attrs & RNBD_ATTR_PATH_STATE)
+		sysfs_batch_add(b, fd, "state", SYSFS_TOKEN, &p->state);
+	if (sysfs_attrs & RNBD_ATTR_PATH_STATS_RDMA)
+		sysfs_batch_add(b, fd, "stats/rdma", SYSFS_RDMA,
+				&p->rx_cnt, &p->inflights);
+	if (sysfs_attrs & RNBD_ATTR_PATH_RECONNECTS)
+		sysfs_batch_add(b, fd, "stats/reconnects", SYSFS_INT,
+				&p->reconnects);
+	/* only one of the two formats exists, the other one is not found */
+	if (side == RNBD_CLIENT && sysfs_attrs & RNBD_ATTR_PATH_CPU_MIGR) {
+		sysfs_batch_add(b, fd, "stats/cpu_migration_from",
+				SYSFS_CPU_FROM, &p->migr);
+		sysfs_batch_add(b, fd, "stats/cpu_migration_to",
+				SYSFS_CPU_TO, &p->migr);
+		sysfs_batch_add(b, fd, "stats/cpu_migration",
+				SYSFS_CPU_MIGR, &p->migr);
+	}
+	if (side == RNBD_CLIENT && sysfs_attrs & RNBD_ATTR_PATH_LATENCY)
+		sysfs_batch_add(b, fd, "cur_latency", SYSFS_ULONG,
+				&p->cur_latency);
+
+	sysfs_batch_own(b, fd);
+
+	return p;
+}
+
+/*
+ * Queue the attributes and the paths of session @s. Only @s is modified,
+ * so that sessions can be read in parallel. The values derived from the
+ * paths are filled in by merge_sess_paths() after the batch is flushed.
+ */
+static int read_sess(int sess_fd, struct rnbd_sess *s, struct sysfs_batch *b)
+{
+	struct rnbd_path *p;
+	struct dirent *pent;
+	int fd, paths_cap = 0, ret = 0;
+	DIR *pdir;
+
+	fd = openat_dir(sess_fd, s->sessname);
+	if (fd < 0)
+		return 0;
+
+	if (sysfs_attrs & RNBD_ATTR_SESS_MPATH_POLICY)
+		sysfs_batch_add(b, fd, "mpath_policy", SYSFS_MPATH,
+				&s->mp, &s->mp_short);
+
+	if (sysfs_attrs & RNBD_ATTR_SESS_HOSTNAME)
+		sysfs_batch_add(b, fd, s->side == RNBD_CLIENT ?
+				"srv_hostname" : "clt_hostname",
+				SYSFS_TOKEN, &s->hostname);
+
+	pdir = opendir_at(fd, "paths");
+	sysfs_batch_own(b, fd);
+	if (!pdir)
+		return 0;
+
+	for (pent = readdir(pdir); pent; pent = readdir(pdir)) {
+		if (pent->d_name[0] == '.')
+			continue;
+
+		p = read_path(dirfd(pdir), pent->d_name, s->side, b);
+		if (!p || vec_add(s->paths, s->path_cnt, paths_cap, p)) {
+			ret = -ENOMEM;
+			break;
+		}
+		p->sess = s;
+	}
+
+	closedir(pdir);
+
+	return ret;
+}
+
+/*
+ * Fill in the session values calculated from its paths, move the array
+ * of paths into the arena and add the paths to the list and the index
+ * of all the paths.
+ */
+static int merge_sess_paths(struct rnbd_sysfs_objs *objs,
+			    struct rnbd_sess *s)
+{
+	struct rnbd_path *p, **paths;
+	char uu[NAME_MAX];
+	int i;
+
+	paths = arena_alloc((s->path_cnt + 1) * sizeof(*paths));
+	if (paths && s->path_cnt)
+		memcpy(paths, s->paths, s->path_cnt * sizeof(*paths));
+	free(s->paths);
+	s->paths = paths;
+	if (!paths) {
+		s->path_cnt = 0;
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < s->path_cnt; i++) {
+		p = s->paths[i];
+
+		if (!strcmp(p->state, "connected"))
+			s->act_path_cnt++;
+		if (i < sizeof(uu) - 1)
+			uu[i] = strcmp(p->state, "connected") ? '_' : 'U';
+
+		s->rx_bytes += p->rx_bytes;
+		s->tx_bytes += p->tx_bytes;
+		s->inflights += p->inflights;
+		s->reconnects += p->reconnects;
+
+		if (!vec_add(objs->paths, objs->paths_cnt, objs->paths_cap, p))
+			continue;
+
+		s->paths[i] = NULL;
+		s->path_cnt = i;
+
+		return -ENOMEM;
+	}
+	uu[i < sizeof(uu) - 1 ? i : sizeof(uu) - 1] = '\0';
+
+	s->path_uu = str_intern(uu);
+	if (!s->path_uu)
+		return -ENOMEM;
+
+	for (i = 0; i < s->path_cnt; i++)
+		if (index_add(&objs->idx->paths,
+			      path_hash(s->sessname, s->paths[i]->pathname),
+			      s->paths[i]))
+			return -ENOMEM;
+
+	return 0;
+}
+
+static struct rnbd_sess *alloc_sess(const char *sessname,
+				     struct rnbd_sysfs_objs *objs,
+				     enum rnbdmode side)
+{
+	struct rnbd_sess *s;
+
+	s = arena_alloc(sizeof(*s));
+	if (!s)
+		return NULL;
+
+	s->sessname = str_intern(sessname);
+	if (!s->sessname)
+		return NULL;
+	s->mp = s->mp_short = s->hostname = s->path_uu = str_empty.str;
+	s->side = side;
+
+	if (vec_add(objs->sess, objs->sess_cnt, objs->sess_cap, s))
+		return NULL;
+
+	if (index_add(&objs->idx->sess, str_hash(STR_HASH_INIT, sessname), s))
+		return NULL;
+
+	return s;
+}
+
+static struct rnbd_sess *find_or_add_sess(const char *sessname,
+					   struct rnbd_sysfs_objs *objs,
+					   enum rnbdmode side)
+{
+	unsigned int i, h = str_hash(STR_HASH_INIT, sessname);
+	struct sysfs_batch *b;
+	struct rnbd_sess *s;
+	int ret;
+
+	index_for_each(&objs->idx->sess, h, i) {
+		s = objs->idx->sess.slots[i].obj;
+		if (objs->idx->sess.slots[i].hash == h &&
+		    !strcmp(sessname, s->sessname))
+			return s;
+	}
+
+	s = alloc_sess(sessname, objs, side);
+	if (!s)
+		return NULL;
+
+	b = sysfs_batch_new();
+	if (!b)
+		return NULL;
+
+	ret = read_sess(objs->sess_fd, s, b);
+	sysfs_batch_free(b);
+	if (!ret)
+		ret = merge_sess_paths(objs, s);
+	else
+		merge_sess_paths(objs, s);
+
+	return ret ? NULL : s;
+}
+
+/*
+ * @fd is the directory of the mapping: <dev>/rnbd/ on the client side
+ * and devices/<dev>/sessions/<sess>/ on the server side.
+ */
+static struct rnbd_sess_dev *read_sess_dev(int fd, struct sysfs_batch *b)
 {
-	char path[PATH_MAX], sessname[NAME_MAX];
-	int res;
-	struct dirent *dent;
 	struct rnbd_sess_dev *sd;
+
+	sd = arena_alloc(sizeof(*sd));
+	if (!sd)
+		return NULL;
+	sd->mapping_path = sd->access_mode = str_empty.str;
+
+	sysfs_batch_add(b, fd, "mapping_path", SYSFS_TOKEN, &sd->mapping_path);
+	if (sysfs_attrs & RNBD_ATTR_SD_ACCESS_MODE)
+		sysfs_batch_add(b, fd, "access_mode", SYSFS_TOKEN, &sd->access_mode);
+
+	return sd;
+}
+
+static int read_sess_job(void *arg, int i, struct sysfs_batch *b)
+{
+	struct rnbd_sysfs_objs *objs = arg;
+
+	return read_sess(objs->sess_fd, objs->sess[i], b);
+}
+
+static int rnbd_sysfs_read_sess_path(struct rnbd_sysfs_objs *objs,
+				      enum rnbdmode side)
+{
+	struct dirent *sess_ent;
+	int i, err, ret = 0;
+	DIR *sp;
+
+	if (side == RNBD_CLIENT)
+		objs->sess_fd = openat_dir(sysfs_root(),
+				sysfs_rel(use_sysfs_info->path_sess_clt));
+	else
+		objs->sess_fd = openat_dir(sysfs_root(),
+				sysfs_rel(use_sysfs_info->path_sess_srv));
+
+	sp = opendir_at(objs->sess_fd, ".");
+	if (!sp)
+		return 0;
+
+	for (sess_ent = readdir(sp); sess_ent; sess_ent = readdir(sp)) {
+		if (sess_ent->d_name[0] == '.')
+			continue;
+		if (strcmp(sess_ent->d_name, "ctl") == 0)
+			continue;
+
+		if (!alloc_sess(sess_ent->d_name, objs, side)) {
+			closedir(sp);
+			return -ENOMEM;
+		}
+	}
+	closedir(sp);
+
+	ret = sysfs_pool_run(objs->sess_cnt, read_sess_job, objs);
+
+	for (i = 0; i < objs->sess_cnt; i++) {
+		err = merge_sess_paths(objs, objs->sess[i]);
+		if (err)
+			ret = err;
+	}
+
+	return ret;
+}
+
+/*
+ * Mapping found by a device scan job. The session is looked up by
+ * name when the results of the jobs are merged.
+ */
+struct sysfs_map {
+	const char		*sessname;
+	struct rnbd_sess_dev	*sd;
+};
+
+struct sysfs_dev_job {
+	char			name[NAME_MAX];	/* entry in ctl/devices/ */
+	struct rnbd_dev		*dev;
+	struct sysfs_map	**maps;
+	int			maps_cnt, maps_cap;
+};
+
+struct sysfs_dev_scan {
+	int			dirfd;		/* ctl/devices/ */
+	enum rnbdmode		side;
+	struct sysfs_dev_job	*jobs;
+	int			jobs_cnt;
+};
+
+/*
+ * @fd is handed over to the batch
+ */
+static int add_map(struct sysfs_dev_job *job, int fd, const char *sessname,
+		   struct sysfs_batch *b)
+{
+	struct sysfs_map *map;
+	int ret = -ENOMEM;
+
+	map = calloc(1, sizeof(*map));
+	if (!map)
+		goto out;
+
+	if (vec_add(job->maps, job->maps_cnt, job->maps_cap, map)) {
+		free(map);
+		goto out;
+	}
+
+	map->sessname = sessname ? str_intern(sessname) : str_empty.str;
+	if (!sessname)
+		sysfs_batch_add(b, fd, "session", SYSFS_TOKEN, &map->sessname);
+
+	map->sd = read_sess_dev(fd, b);
+	if (map->sd && map->sessname)
+		ret = 0;
+out:
+	if (fd >= 0)
+		sysfs_batch_own(b, fd);
+
+	return ret;
+}
+
+static int read_dev_job_clt(struct sysfs_dev_scan *scan,
+			    struct sysfs_dev_job *job,
+			    struct sysfs_batch *b)
+{
+	char entry[2 * NAME_MAX + 2];
+
+	job->dev = read_dev(scan->dirfd, job->name, RNBD_CLIENT, b);
+	if (!job->dev)
+		return -ENOMEM;
+
+	snprintf(entry, sizeof(entry), "%s/%s", job->name,
+		 use_sysfs_info->path_dev_name);
+
+	return add_map(job, openat_dir(scan->dirfd, entry), NULL, b);
+}
+
+static int read_dev_job_srv(struct sysfs_dev_scan *scan,
+			    struct sysfs_dev_job *job,
+			    struct sysfs_batch *b)
+{
+	struct dirent *sent;
+	int dev_fd, ret = 0;
+	DIR *sdir;
+
+	dev_fd = openat_dir(scan->dirfd, job->name);
+
+	job->dev = read_dev(dev_fd, "block_dev", RNBD_SERVER, b);
+	if (!job->dev) {
+		close_dir(dev_fd);
+		return -ENOMEM;
+	}
+
+	sdir = opendir_at(dev_fd, "sessions");
+	close_dir(dev_fd);
+	if (!sdir)
+		return 0;
+
+	for (sent = readdir(sdir); sent && !ret; sent = readdir(sdir)) {
+		if (sent->d_name[0] == '.')
+			continue;
+
+		ret = add_map(job, openat_dir(dirfd(sdir), sent->d_name),
+			      sent->d_name, b);
+	}
+	closedir(sdir);
+
+	return ret;
+}
+
+static int read_dev_job(void *arg, int i, struct sysfs_batch *b)
+{
+	struct sysfs_dev_scan *scan = arg;
+
+	if (scan->side == RNBD_CLIENT)
+		return read_dev_job_clt(scan, &scan->jobs[i], b);
+	else
+		return read_dev_job_srv(scan, &scan->jobs[i], b);
+}
+
+static int sds_index_add(struct sysfs_index *idx, struct rnbd_sess_dev *sd)
+{
+	int ret;
+
+	ret = index_add(idx, str_hash(STR_HASH_INIT, sd->mapping_path), sd);
+	if (!ret)
+		ret = index_add(idx, str_hash(STR_HASH_INIT, sd->dev->devname),
+				sd);
+
+	return ret;
+}
+
+/*
+ * Move the device and the mappings found by @job into @objs
+ * and release whatever is left of @job.
+ */
+static int merge_dev_job(struct rnbd_sysfs_objs *objs,
+			 struct sysfs_dev_job *job, enum rnbdmode side)
+{
+	struct rnbd_sess *s;
+	struct rnbd_dev *d;
+	int i, ret = 0;
+
+	d = job->dev ? find_or_add_dev(job->dev) : NULL;
+	if (!d)
+		ret = -ENOMEM;
+
+	for (i = 0; i < job->maps_cnt; i++) {
+		struct rnbd_sess_dev *sd = job->maps[i]->sd;
+
+		if (!ret && sd) {
+			s = find_or_add_sess(job->maps[i]->sessname,
+					     objs, side);
+			if (s && !vec_add(objs->sds, objs->sds_cnt,
+					  objs->sds_cap, sd)) {
+				sd->sess = s;
+				sd->dev = d;
+				ret = sds_index_add(&objs->idx->sds, sd);
+			} else {
+				ret = -ENOMEM;
+			}
+		}
+		free(job->maps[i]);
+	}
+	free(job->maps);
+
+	return ret;
+}
+
+static int rnbd_sysfs_read_devs(struct rnbd_sysfs_objs *objs,
+				 enum rnbdmode side)
+{
+	struct sysfs_dev_scan scan = { .side = side };
+	struct sysfs_dev_job *jobs;
+	struct dirent *dent;
+	int i, err, ctl_fd, cap = 0, ret;
+	DIR *ddir;
+
+	if (side == RNBD_CLIENT)
+		ctl_fd = openat_dir(sysfs_root(),
+				    sysfs_rel(use_sysfs_info->path_dev_clt));
+	else
+		ctl_fd = openat_dir(sysfs_root(),
+				    sysfs_rel(use_sysfs_info->path_dev_srv));
+	ddir = opendir_at(ctl_fd, "devices");
+	close_dir(ctl_fd);
+	if (!ddir)
+		return 0;
+
+	for (dent = readdir(ddir); dent; dent = readdir(ddir)) {
+		if (dent->d_name[0] == '.')
+			continue;
+
+		if (scan.jobs_cnt == cap) {
+			cap = cap ? 2 * cap : 16;
+			jobs = realloc(scan.jobs, cap * sizeof(*jobs));
+			if (!jobs) {
+				free(scan.jobs);
+				closedir(ddir);
+				return -ENOMEM;
+			}
+			scan.jobs = jobs;
+		}
+		jobs = &scan.jobs[scan.jobs_cnt++];
+		memset(jobs, 0, sizeof(*jobs));
+		strcpy(jobs->name, dent->d_name);
+	}
+
+	scan.dirfd = dirfd(ddir);
+	ret = sysfs_pool_run(scan.jobs_cnt, read_dev_job, &scan);
+
+	for (i = 0; i < scan.jobs_cnt; i++) {
+		err = merge_dev_job(objs, &scan.jobs[i], side);
+		if (err)
+			ret = err;
+	}
+
+	free(scan.jobs);
+	closedir(ddir);
+
+	return ret;
+}
+
+static int rnbd_sysfs_read_clt(struct rnbd_sysfs_objs *objs)
+{
+	int res;
+
+	res = rnbd_sysfs_read_sess_path(objs, RNBD_CLIENT);
+	if (res)
+		return res;
+
+	return rnbd_sysfs_read_devs(objs, RNBD_CLIENT);
+}
+
+static int rnbd_sysfs_read_srv(struct rnbd_sysfs_objs *objs)
+{
+	int res;
+
+	res = rnbd_sysfs_read_sess_path(objs, RNBD_SERVER);
+	if (res)
+		return res;
+
+	return rnbd_sysfs_read_devs(objs, RNBD_SERVER);
+}
+
+/*
+ * Make sure the arrays of @objs are allocated and NULL terminated
+ * even if nothing was found.
+ */
+static int rnbd_sysfs_objs_terminate(struct rnbd_sysfs_objs *objs)
+{
+	if (!objs->sds)
+		objs->sds = calloc(1, sizeof(*objs->sds));
+	if (!objs->sess)
+		objs->sess = calloc(1, sizeof(*objs->sess));
+	if (!objs->paths)
+		objs->paths = calloc(1, sizeof(*objs->paths));
+
+	if (!objs->sds || !objs->sess || !objs->paths)
+		return -ENOMEM;
+
+	return 0;
+}
+
+/*
+ * Read all the stuff from sysfs in a single pass over the sysfs tree.
+ * The arrays are allocated while the tree is traversed and are NULL
+ * terminated, the counters include the terminating NULL element.
+ * Sessions and devices are spread over up to @jobs threads, the result
+ * does not depend on the number of jobs. Only the optional attributes
+ * in @attrs are read.
+ * Release with rnbd_sysfs_free_all().
+ */
+int rnbd_sysfs_read_all(struct rnbd_sess_dev ***sds_clt,
+			 struct rnbd_sess_dev ***sds_srv,
+			 struct rnbd_sess ***sess_clt,
+			 struct rnbd_sess ***sess_srv,
+			 struct rnbd_path ***paths_clt,
+			 struct rnbd_path ***paths_srv,
+			 int *sds_clt_cnt, int *sds_srv_cnt,
+			 int *sess_clt_cnt, int *sess_srv_cnt,
+			 int *paths_clt_cnt, int *paths_srv_cnt,
+			 int jobs, unsigned int attrs)
+{
+	struct rnbd_sysfs_objs clt = { .sess_fd = -1, .idx = &idx_clt },
+			       srv = { .sess_fd = -1, .idx = &idx_srv };
+	int ret;
+
+	sysfs_jobs = jobs;
+	sysfs_attrs = attrs;
+
+	ret = rnbd_sysfs_read_clt(&clt);
+	if (!ret)
+		ret = rnbd_sysfs_read_srv(&srv);
+	close_dir(clt.sess_fd);
+	close_dir(srv.sess_fd);
+	if (!ret)
+		ret = rnbd_sysfs_objs_terminate(&clt);
+	if (!ret)
+		ret = rnbd_sysfs_objs_terminate(&srv);
+	if (ret) {
+		rnbd_sysfs_free_all(clt.sds, srv.sds, clt.sess, srv.sess,
+				     clt.paths, srv.paths);
+		return ret;
+	}
+
+	*sds_clt = clt.sds;
+	*sds_srv = srv.sds;
+	*sess_clt = clt.sess;
+	*sess_srv = srv.sess;
+	*paths_clt = clt.paths;
+	*paths_srv = srv.paths;
+
+	*sds_clt_cnt = clt.sds_cnt + 1;
+	*sds_srv_cnt = srv.sds_cnt + 1;
+	*sess_clt_cnt = clt.sess_cnt + 1;
+	*sess_srv_cnt = srv.sess_cnt + 1;
+	*paths_clt_cnt = clt.paths_cnt + 1;
+	*paths_srv_cnt = srv.paths_cnt + 1;
+
+	return 0;
+}
+
+/*
+ * Lookups in the index of the last snapshot read by rnbd_sysfs_read_all()
+ */
+struct rnbd_sess *rnbd_sysfs_lookup_sess(enum rnbdmode side,
+					  const char *sessname)
+{
+	struct sysfs_index *idx = side == RNBD_CLIENT ? &idx_clt.sess
+						      : &idx_srv.sess;
+	unsigned int i, h = str_hash(STR_HASH_INIT, sessname);
 	struct rnbd_sess *s;
-	struct rnbd_dev *d;
-	DIR *ddir;
 
-	res = rnbd_sysfs_read_sess_path(sess, paths, RNBD_CLIENT);
-	if (res)
-		return res;
+	index_for_each(idx, h, i) {
+		s = idx->slots[i].obj;
+		if (idx->slots[i].hash == h && !strcmp(s->sessname, sessname))
+			return s;
+	}
 
-	sprintf(path, "%s/devices/", use_sysfs_info->path_dev_clt);
-	ddir = opendir(path);
-	if (!ddir)
-		return 0;
+	return NULL;
+}
 
-	for (dent = readdir(ddir); dent; dent = readdir(ddir)) {
-		if (dent->d_name[0] == '.')
+struct rnbd_path *rnbd_sysfs_lookup_path(enum rnbdmode side,
+					  const char *sessname,
+					  const char *pathname)
+{
+	struct sysfs_index *idx = side == RNBD_CLIENT ? &idx_clt.paths
+						      : &idx_srv.paths;
+	unsigned int i, h = path_hash(sessname, pathname);
+	struct rnbd_path *p;
+
+	index_for_each(idx, h, i) {
+		p = idx->slots[i].obj;
+		if (idx->slots[i].hash == h &&
+		    !strcmp(p->pathname, pathname) &&
+		    !strcmp(p->sess->sessname, sessname))
+			return p;
+	}
+
+	return NULL;
+}
+
+static int sds_lookup(const struct sysfs_index *idx, const char *key,
+		      const char *name, struct rnbd_sess_dev **res, int cnt)
+{
+	unsigned int i, h = str_hash(STR_HASH_INIT, key);
+	struct rnbd_sess_dev *sd;
+	int j;
+
+	index_for_each(idx, h, i) {
+		sd = idx->slots[i].obj;
+		if (idx->slots[i].hash != h ||
+		    (strcmp(sd->mapping_path, name) &&
+		     strcmp(sd->dev->devname, name) &&
+		     strcmp(sd->dev->devpath, name)))
 			continue;
 
-		sprintf(path, "%s/devices/%s/%s", use_sysfs_info->path_dev_clt, dent->d_name, use_sysfs_info->path_dev_name);
-		scanf_sysfs(path, "session", "%s", sessname);
+		/* a mapping is in the index under two keys */
+		for (j = 0; j < cnt && res[j] != sd; j++)
+			;
+		if (j == cnt)
+			res[cnt++] = sd;
+	}
 
-		s = find_or_add_sess(sessname, sess, paths, RNBD_CLIENT);
-		if (!s)
-			return -ENOMEM;
+	return cnt;
+}
 
-		sprintf(path, "%s/devices/%s", use_sysfs_info->path_dev_clt, dent->d_name);
-		d = find_or_add_dev(path, devs, RNBD_CLIENT);
-		if (!d)
-			return -ENOMEM;
+/*
+ * Find the mappings on @side with the mapping path, device name or
+ * device path @name. @res must have room for all the mappings of the
+ * side, the result is NULL terminated and in no particular order.
+ */
+int rnbd_sysfs_lookup_sds(enum rnbdmode side, const char *name,
+			  struct rnbd_sess_dev **res)
+{
+	struct sysfs_index *idx = side == RNBD_CLIENT ? &idx_clt.sds
+						      : &idx_srv.sds;
+	int cnt;
 
-		sd = add_sess_dev(dent->d_name, sds, s, d, RNBD_CLIENT);
-		if (!sd)
-			return -ENOMEM;
+	cnt = sds_lookup(idx, name, name, res, 0);
+	if (!strncmp(name, "/dev/", 5))
+		cnt = sds_lookup(idx, name + 5, name, res, cnt);
+	res[cnt] = NULL;
+
+	return cnt;
+}
+
+/*
+ * Check whether there is any session on @side without reading sysfs
+ */
+bool rnbd_sysfs_has_sessions(enum rnbdmode side)
+{
+	struct dirent *ent;
+	bool ret = false;
+	DIR *sp;
+
+	if (side == RNBD_CLIENT)
+		sp = opendir_at(sysfs_root(),
+				sysfs_rel(use_sysfs_info->path_sess_clt));
+	else
+		sp = opendir_at(sysfs_root(),
+				sysfs_rel(use_sysfs_info->path_sess_srv));
+	if (!sp)
+		return false;
+
+	for (ent = readdir(sp); ent && !ret; ent = readdir(sp))
+		if (ent->d_name[0] != '.' && strcmp(ent->d_name, "ctl"))
+			ret = true;
+	closedir(sp);
+
+	return ret;
+}
+
+/*
+ * The HCA ports found so far, in the order they were found
+ */
+struct hca_ports {
+	struct rnbd_hca_port	**ports;
+	int			cnt;
+	int			cap;
+};
+
+static struct rnbd_hca_port *hca_port_get(struct hca_ports *h,
+					  const char *hca_name, int port)
+{
+	struct rnbd_hca_port *hp, **ports;
+	int i;
+
+	for (i = 0; i < h->cnt; i++)
+		if (h->ports[i]->port == port &&
+		    !strcmp(h->ports[i]->hca_name, hca_name))
+			return h->ports[i];
+
+	if (h->cnt == h->cap) {
+		ports = realloc(h->ports, (h->cap * 2 + 8) * sizeof(*ports));
+		if (!ports)
+			return NULL;
+		h->ports = ports;
+		h->cap = h->cap * 2 + 8;
 	}
 
-	closedir(ddir);
+	hp = arena_alloc(sizeof(*hp));
+	if (!hp)
+		return NULL;
+	hp->hca_name = hca_name;
+	hp->port = port;
+	hp->gid = hp->link_state = hp->rate = str_empty.str;
+	h->ports[h->cnt++] = hp;
 
-	return 0;
+	return hp;
 }
 
-static int rnbd_sysfs_read_srv(struct rnbd_sess_dev **sds,
-				struct rnbd_sess **sess,
-				struct rnbd_path **paths,
-				struct rnbd_dev **devs)
+static int compar_hca_ports(const void *p1, const void *p2)
 {
-	char path[PATH_MAX];
-	int res;
-	struct dirent *dent, *sent;
-	struct rnbd_sess_dev *sd;
-	struct rnbd_sess *s;
-	struct rnbd_dev *d;
-	DIR *ddir, *sdir;
+	const struct rnbd_hca_port *const *hp1 = p1, *const *hp2 = p2;
 
-	res = rnbd_sysfs_read_sess_path(sess, paths, RNBD_SERVER);
-	if (res)
-		return res;
-	
-	sprintf(path, "%s/devices/", use_sysfs_info->path_dev_srv);
-	ddir = opendir(path);
+	return strcmp((*hp1)->hca_name, (*hp2)->hca_name) ?
+		: (*hp1)->port - (*hp2)->port;
+}
+
+int rnbd_sysfs_hca_ports(struct rnbd_path **paths_clt,
+			 struct rnbd_path **paths_srv,
+			 const struct port_desc *descs, int desc_cnt,
+			 struct rnbd_hca_port ***ports)
+{
+	struct rnbd_path **sides[] = { paths_clt, paths_srv }, **pp, *p;
+	struct hca_ports h = { 0 };
+	struct rnbd_hca_port *hp;
+	const char *name;
+	int i;
+
+	for (i = 0; i < desc_cnt; i++) {
+		name = str_intern(descs[i].hca);
+		hp = name ? hca_port_get(&h, name, atoi(descs[i].port)) : NULL;
+		if (!hp)
+			goto out;
+		hp->gid = str_intern(descs[i].gid);
+		hp->link_state = str_intern(descs[i].state);
+		hp->rate = str_intern(descs[i].rate);
+		if (!hp->gid || !hp->link_state || !hp->rate)
+			goto out;
+	}
+
+	for (i = 0; i < ARRSIZE(sides); i++) {
+		for (pp = sides[i]; pp && *pp; pp++) {
+			p = *pp;
+			hp = hca_port_get(&h, p->hca_name, p->hca_port);
+			if (!hp)
+				goto out;
+
+			/* server paths have no state, they are connected */
+			hp->path_cnt++;
+			if (!p->state[0] || !strcmp(p->state, "connected"))
+				hp->act_path_cnt++;
+			hp->rx_bytes += p->rx_bytes;
+			hp->tx_bytes += p->tx_bytes;
+			hp->inflights += p->inflights;
+			hp->reconnects += p->reconnects;
+		}
+	}
+
+	*ports = realloc(h.ports, (h.cnt + 1) * sizeof(**ports));
+	if (!*ports)
+		goto out;
+	(*ports)[h.cnt] = NULL;
+	qsort(*ports, h.cnt, sizeof(**ports), compar_hca_ports);
+
+	return h.cnt;
+out:
+	free(h.ports);
+
+	return -ENOMEM;
+}
+
+const char *rnbd_sess_host(const struct rnbd_sess *s)
+{
+	return s->hostname[0] ? s->hostname : s->sessname;
+}
+
+/*
+ * The hosts found so far, in the order they were found
+ */
+struct hosts {
+	struct rnbd_host	**hosts;
+	int			cnt;
+	int			cap;
+};
+
+/* the names are interned, equal names are the same pointer */
+static struct rnbd_host *host_get(struct hosts *h, enum rnbdmode side,
+				  const char *hostname)
+{
+	struct rnbd_host *hp, **hosts;
+	int i;
+
+	for (i = h->cnt - 1; i >= 0; i--)
+		if (h->hosts[i]->hostname == hostname &&
+		    h->hosts[i]->side == side)
+			return h->hosts[i];
+
+	if (h->cnt == h->cap) {
+		hosts = realloc(h->hosts, (h->cap * 2 + 8) * sizeof(*hosts));
+		if (!hosts)
+			return NULL;
+		h->hosts = hosts;
+		h->cap = h->cap * 2 + 8;
+	}
+
+	hp = arena_alloc(sizeof(*hp));
+	if (!hp)
+		return NULL;
+	hp->hostname = hostname;
+	hp->side = side;
+	h->hosts[h->cnt++] = hp;
+
+	return hp;
+}
+
+static int compar_hosts(const void *p1, const void *p2)
+{
+	const struct rnbd_host *const *h1 = p1, *const *h2 = p2;
+
+	return (*h1)->side - (*h2)->side ?
+		: strcmp((*h1)->hostname, (*h2)->hostname);
+}
+
+int rnbd_sysfs_hosts(struct rnbd_sess **sess_clt,
+		     struct rnbd_sess **sess_srv,
+		     struct rnbd_sess_dev **sds_clt,
+		     struct rnbd_sess_dev **sds_srv,
+		     struct rnbd_host ***hosts)
+{
+	struct rnbd_sess **sides[] = { sess_clt, sess_srv }, **ss, *s;
+	struct rnbd_sess_dev **sds[] = { sds_clt, sds_srv }, **sd;
+	struct hosts h = { 0 };
+	struct rnbd_host *hp;
+	int i, j, ret = -ENOMEM;
+
+	for (i = 0; i < ARRSIZE(sides); i++) {
+		for (ss = sides[i]; ss && *ss; ss++) {
+			s = *ss;
+			hp = host_get(&h, s->side, rnbd_sess_host(s));
+			if (!hp)
+				goto out;
+
+			hp->sess_cnt++;
+			hp->path_cnt += s->path_cnt;
+			/* server paths have no state, they are connected */
+			for (j = 0; j < s->path_cnt; j++)
+				if (!s->paths[j]->state[0] ||
+				    !strcmp(s->paths[j]->state, "connected"))
+					hp->act_path_cnt++;
+			hp->rx_bytes += s->rx_bytes;
+			hp->tx_bytes += s->tx_bytes;
+			hp->inflights += s->inflights;
+			hp->reconnects += s->reconnects;
+		}
+		/* only the devices of the sessions grouped above */
+		for (sd = sides[i] ? sds[i] : NULL; sd && *sd; sd++) {
+			hp = host_get(&h, (*sd)->sess->side,
+				      rnbd_sess_host((*sd)->sess));
+			if (!hp)
+				goto out;
+			hp->dev_cnt++;
+		}
+	}
+
+	*hosts = arena_alloc((h.cnt + 1) * sizeof(**hosts));
+	if (!*hosts)
+		goto out;
+	for (i = 0; i < h.cnt; i++)
+		(*hosts)[i] = h.hosts[i];
+	qsort(*hosts, h.cnt, sizeof(**hosts), compar_hosts);
+	ret = h.cnt;
+out:
+	free(h.hosts);
+
+	return ret;
+}
+
+static const char *sysfs_sess_dir(enum rnbdmode side)
+{
+	return sysfs_rel(side == RNBD_CLIENT ? use_sysfs_info->path_sess_clt
+					     : use_sysfs_info->path_sess_srv);
+}
+
+/*
+ * Check whether @devname is an rnbd client block device by looking
+ * only at /sys/block/<devname>/rnbd.
+ */
+bool rnbd_sysfs_clt_dev_exists(const char *devname)
+{
+	char entry[PATH_MAX];
+
+	if (!*devname || strchr(devname, '/'))
+		return false;
+
+	snprintf(entry, sizeof(entry), "sys/block/%s/%s", devname,
+		 use_sysfs_info->path_dev_name);
+
+	return faccessat(sysfs_root(), entry, F_OK, AT_EACCESS) == 0;
+}
+
+/*
+ * Count the client devices other than @devname with the mapping path
+ * @name, reading only the mapping_path of each device.
+ */
+int rnbd_sysfs_clt_mapping_cnt(const char *name, const char *devname)
+{
+	char entry[PATH_MAX], val[SYSFS_ATTR_LEN], *s, *tok;
+	struct dirent *ent;
+	int ctl_fd, cnt = 0;
+	DIR *ddir;
+
+	ctl_fd = openat_dir(sysfs_root(),
+			    sysfs_rel(use_sysfs_info->path_dev_clt));
+	ddir = opendir_at(ctl_fd, "devices");
+	close_dir(ctl_fd);
 	if (!ddir)
 		return 0;
 
-	for (dent = readdir(ddir); dent; dent = readdir(ddir)) {
-		if (dent->d_name[0] == '.')
+	for (ent = readdir(ddir); ent; ent = readdir(ddir)) {
+		if (ent->d_name[0] == '.' || !strcmp(ent->d_name, devname))
 			continue;
 
-		sprintf(path, "%s/devices/%s/block_dev",
-			use_sysfs_info->path_dev_srv, dent->d_name);
+		snprintf(entry, sizeof(entry), "%s/%s/mapping_path",
+			 ent->d_name, use_sysfs_info->path_dev_name);
+		if (read_attr(dirfd(ddir), entry, val, sizeof(val)) < 0)
+			continue;
 
-		d = find_or_add_dev(path, devs, RNBD_SERVER);
-		if (!d)
-			return -ENOMEM;
+		s = val;
+		tok = parse_token(&s);
+		if (tok && !strcmp(tok, name))
+			cnt++;
+	}
+	closedir(ddir);
+
+	return cnt;
+}
+
+/*
+ * Check whether there is a session named @sessname on @side
+ */
+bool rnbd_sysfs_sess_exists(enum rnbdmode side, const char *sessname)
+{
+	char entry[PATH_MAX];
+
+	if (!*sessname || strchr(sessname, '/'))
+		return false;
+
+	snprintf(entry, sizeof(entry), "%s%s", sysfs_sess_dir(side), sessname);
+
+	return faccessat(sysfs_root(), entry, F_OK, AT_EACCESS) == 0;
+}
+
+/*
+ * Find the sessions on @side with a path named exactly @pathname
+ * without reading any attributes. If @sessname is NULL all sessions are
+ * checked. The name of the last session found is stored in @found
+ * (NAME_MAX + 1 bytes), the number of sessions found is returned.
+ */
+int rnbd_sysfs_find_path(enum rnbdmode side, const char *sessname,
+			 const char *pathname, char *found)
+{
+	char entry[PATH_MAX];
+	struct dirent *ent;
+	int cnt = 0;
+	DIR *sp;
+
+	if (!*pathname || strchr(pathname, '/'))
+		return 0;
 
-		sprintf(path, "%s/devices/%s/sessions/",
-			use_sysfs_info->path_dev_srv, dent->d_name);
-		sdir = opendir(path);
-		if (!sdir)
+	if (sessname) {
+		if (strchr(sessname, '/') || strlen(sessname) > NAME_MAX)
 			return 0;
-		for (sent = readdir(sdir); sent; sent = readdir(sdir)) {
-			if (sent->d_name[0] == '.')
-				continue;
-			s = find_or_add_sess(sent->d_name, sess, paths,
-					     RNBD_SERVER);
-			if (!s)
-				return -ENOMEM;
 
-			sd = add_sess_dev(dent->d_name, sds,
-					  s, d, RNBD_SERVER);
-			if (!sd)
-				return -ENOMEM;
-		}
-		closedir(sdir);
+		snprintf(entry, sizeof(entry), "%s%s/paths/%s",
+			 sysfs_sess_dir(side), sessname, pathname);
+		if (faccessat(sysfs_root(), entry, F_OK, AT_EACCESS))
+			return 0;
+
+		strcpy(found, sessname);
+		return 1;
 	}
 
-	closedir(ddir);
+	sp = opendir_at(sysfs_root(), sysfs_sess_dir(side));
+	if (!sp)
+		return 0;
 
-	return 0;
+	for (ent = readdir(sp); ent; ent = readdir(sp)) {
+		if (ent->d_name[0] == '.' || !strcmp(ent->d_name, "ctl"))
+			continue;
+
+		snprintf(entry, sizeof(entry), "%s/paths/%s",
+			 ent->d_name, pathname);
+		if (faccessat(dirfd(sp), entry, F_OK, AT_EACCESS))
+			continue;
+
+		strcpy(found, ent->d_name);
+		cnt++;
+	}
+	closedir(sp);
+
+	return cnt;
 }
 
 /*
- * Read all the stuff from sysfs.
- * Use rnbd_sysfs_alloc_all() before and rnbd_sysfs_free_all() after.
+ * Counter attributes are kept open by callers sampling them periodically,
+ * every sample is a single pread() from the start of the file.
  */
-int rnbd_sysfs_read_all(struct rnbd_sess_dev **sds_clt,
-			 struct rnbd_sess_dev **sds_srv,
-			 struct rnbd_sess **sess_clt,
-			 struct rnbd_sess **sess_srv,
-			 struct rnbd_path **paths_clt,
-			 struct rnbd_path **paths_srv)
+static int open_attr(const char *entry)
 {
-	int ret = 0;
+	int fd;
 
-	ret = rnbd_sysfs_read_clt(sds_clt, sess_clt, paths_clt, devs);
-	if (ret)
+	fd = openat(sysfs_root(), entry, O_RDONLY | O_CLOEXEC);
+
+	return fd < 0 ? -errno : fd;
+}
+
+static int pread_attr(int fd, char *buf, size_t size)
+{
+	ssize_t len;
+
+	len = pread(fd, buf, size - 1, 0);
+	if (len < 0)
+		return -errno;
+	buf[len] = '\0';
+
+	return len;
+}
+
+int rnbd_sysfs_open_dev_stat(const char *devname)
+{
+	char entry[PATH_MAX];
+
+	if (!*devname || strchr(devname, '/'))
+		return -EINVAL;
+
+	snprintf(entry, sizeof(entry), "sys/class/block/%s/stat", devname);
+
+	return open_attr(entry);
+}
+
+static int open_path_attr(enum rnbdmode side, const char *sessname,
+			  const char *pathname, const char *attr)
+{
+	char entry[PATH_MAX];
+
+	if (strchr(sessname, '/') || strchr(pathname, '/'))
+		return -EINVAL;
+
+	snprintf(entry, sizeof(entry), "%s%s/paths/%s/%s",
+		 sysfs_sess_dir(side), sessname, pathname, attr);
+
+	return open_attr(entry);
+}
+
+int rnbd_sysfs_open_path_stat(enum rnbdmode side, const char *sessname,
+			      const char *pathname)
+{
+	return open_path_attr(side, sessname, pathname, "stats/rdma");
+}
+
+int rnbd_sysfs_open_path_cpu_migr(const char *sessname, const char *pathname)
+{
+	int fd;
+
+	fd = open_path_attr(RNBD_CLIENT, sessname, pathname,
+			    "stats/cpu_migration_from");
+	if (fd == -ENOENT)
+		fd = open_path_attr(RNBD_CLIENT, sessname, pathname,
+				    "stats/cpu_migration");
+
+	return fd;
+}
+
+int rnbd_sysfs_open_path_latency(const char *sessname, const char *pathname)
+{
+	return open_path_attr(RNBD_CLIENT, sessname, pathname, "cur_latency");
+}
+
+int rnbd_sysfs_read_blk_stat(int fd, struct rnbd_blk_stat *st)
+{
+	char buf[SYSFS_ATTR_LEN], *s = buf;
+	int ret;
+
+	ret = pread_attr(fd, buf, sizeof(buf));
+	if (ret < 0)
 		return ret;
 
-	ret = rnbd_sysfs_read_srv(sds_srv, sess_srv, paths_srv, devs);
+	/* all the kernels have the fields up to time_in_queue */
+	memset(st, 0, sizeof(*st));
+	if (parse_blk_stat(&s, st) <= offsetof(struct rnbd_blk_stat,
+					       time_in_queue) / sizeof(long))
+		return -EINVAL;
 
-	return ret;
+	return 0;
+}
+
+int rnbd_sysfs_read_rdma_stat(int fd, struct rnbd_rdma_stat *st)
+{
+	char buf[SYSFS_ATTR_LEN], *s = buf;
+	int ret;
+
+	ret = pread_attr(fd, buf, sizeof(buf));
+	if (ret < 0)
+		return ret;
+
+	/* rx cnt, rx bytes, tx cnt, tx bytes, inflight, failover */
+	if (!parse_ulong(&s, &st->rx_cnt) || !parse_ulong(&s, &st->rx_bytes) ||
+	    !parse_ulong(&s, &st->tx_cnt) || !parse_ulong(&s, &st->tx_bytes) ||
+	    !parse_int(&s, &st->inflights))
+		return -EINVAL;
+
+	return 0;
+}
+
+int rnbd_sysfs_read_cpu_migr(int fd, unsigned long *total)
+{
+	char buf[SYSFS_PAGE_LEN];
+	int ret;
+
+	ret = pread_attr(fd, buf, sizeof(buf));
+	if (ret < 0)
+		return ret;
+
+	return parse_cpu_migr_total(buf, total) ? 0 : -EINVAL;
+}
+
+int rnbd_sysfs_read_latency(int fd, unsigned long *ns)
+{
+	char buf[SYSFS_ATTR_LEN], *s = buf;
+	int ret;
+
+	ret = pread_attr(fd, buf, sizeof(buf));
+	if (ret < 0)
+		return ret;
+
+	/* "<n> ns" */
+	return parse_ulong(&s, ns) ? 0 : -EINVAL;
 }
 
 enum rnbdmode mode_for_host(void)
 {
 	enum rnbdmode mode = RNBD_NONE;
 
-	if (faccessat(AT_FDCWD, use_sysfs_info->path_dev_clt, F_OK, AT_EACCESS) == 0)
+	if (faccessat(sysfs_root(), sysfs_rel(use_sysfs_info->path_dev_clt), F_OK, AT_EACCESS) == 0)
 		mode |= RNBD_CLIENT;
 
 	/* else we are not interested in any error diagnossis here  */
 	/* if we can not deduce the mode, than we just know nothing */
 
-	if (faccessat(AT_FDCWD, use_sysfs_info->path_dev_srv, F_OK, AT_EACCESS) == 0)
+	if (faccessat(sysfs_root(), sysfs_rel(use_sysfs_info->path_dev_srv), F_OK, AT_EACCESS) == 0)
 		mode |= RNBD_SERVER;
 
 	if (mode == RNBD_NONE)
@@ -690,15 +2602,15 @@ enum rnbdmode mode_for_host(void)
  */
 void check_compat_sysfs(struct rnbd_ctx *ctx)
 {
-	if ((faccessat(AT_FDCWD, PATH_DEV_CLT, F_OK, AT_EACCESS) == 0
-	    || faccessat(AT_FDCWD, PATH_DEV_SRV, F_OK, AT_EACCESS) == 0)
+	if ((faccessat(sysfs_root(), sysfs_rel(PATH_DEV_CLT), F_OK, AT_EACCESS) == 0
+	    || faccessat(sysfs_root(), sysfs_rel(PATH_DEV_SRV), F_OK, AT_EACCESS) == 0)
 	    && (strcmp(ctx->pname, COMPAT_PATH_DEV_NAME) != 0)) {
 		ctx->sysfs_avail = 1;
 		/* default is already set */
 		return;
 	}
-	if ((faccessat(AT_FDCWD, COMPAT_PATH_DEV_CLT, F_OK, AT_EACCESS) == 0)
-	    || (faccessat(AT_FDCWD, COMPAT_PATH_DEV_SRV, F_OK, AT_EACCESS) == 0)
+	if ((faccessat(sysfs_root(), sysfs_rel(COMPAT_PATH_DEV_CLT), F_OK, AT_EACCESS) == 0)
+	    || (faccessat(sysfs_root(), sysfs_rel(COMPAT_PATH_DEV_SRV), F_OK, AT_EACCESS) == 0)
 	    || (strcmp(ctx->pname, COMPAT_PATH_DEV_NAME) == 0)) {
 
 		ctx->sysfs_avail = 1;
@@ -1,5 +1,8 @@
 /* SPDX-License-Identifier: GPL-2.0-or-later */
 #include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <dirent.h>
 
 struct rnbd_sysfs_info {
 	const char *path_dev_clt;
@@ -9,6 +12,41 @@ struct rnbd_sysfs_info {
 	const char *path_dev_name;
 };
 
+#define RNBD_SYSFS_MAX_JOBS 64
+
+/*
+ * Optional sysfs attributes read by the scanner. The names of the objects
+ * and the links between them are always read. Columns declare which of
+ * the attributes they need in rnbd-clms.h.
+ */
+enum rnbd_attr {
+	RNBD_ATTR_DEV_STAT		= 1 << 0,	/* <blockdev>/stat */
+	RNBD_ATTR_DEV_STATE		= 1 << 1,	/* <blockdev>/rnbd/state */
+	RNBD_ATTR_SD_ACCESS_MODE	= 1 << 2,
+	RNBD_ATTR_SESS_MPATH_POLICY	= 1 << 3,
+	RNBD_ATTR_SESS_HOSTNAME		= 1 << 4,	/* {srv,clt}_hostname */
+	RNBD_ATTR_PATH_SRC_ADDR		= 1 << 5,
+	RNBD_ATTR_PATH_DST_ADDR		= 1 << 6,
+	RNBD_ATTR_PATH_HCA_NAME		= 1 << 7,
+	RNBD_ATTR_PATH_HCA_PORT		= 1 << 8,
+	RNBD_ATTR_PATH_STATE		= 1 << 9,
+	RNBD_ATTR_PATH_STATS_RDMA	= 1 << 10,
+	RNBD_ATTR_PATH_RECONNECTS	= 1 << 11,
+	RNBD_ATTR_PATH_CPU_MIGR		= 1 << 12,	/* stats/cpu_migration* */
+	RNBD_ATTR_PATH_LATENCY		= 1 << 13,	/* cur_latency */
+
+	RNBD_ATTR_PATH_ALL		= RNBD_ATTR_PATH_SRC_ADDR
+					| RNBD_ATTR_PATH_DST_ADDR
+					| RNBD_ATTR_PATH_HCA_NAME
+					| RNBD_ATTR_PATH_HCA_PORT
+					| RNBD_ATTR_PATH_STATE
+					| RNBD_ATTR_PATH_STATS_RDMA
+					| RNBD_ATTR_PATH_RECONNECTS
+					| RNBD_ATTR_PATH_CPU_MIGR
+					| RNBD_ATTR_PATH_LATENCY,
+	RNBD_ATTR_ALL			= (1 << 14) - 1,
+};
+
 enum rnbdmode {
 	RNBD_NONE = 0,
 	RNBD_CLIENT = 1,
@@ -16,42 +54,88 @@ enum rnbdmode {
 	RNBD_BOTH = RNBD_CLIENT | RNBD_SERVER,
 };
 
+/*
+ * The objects of a snapshot and their strings live in an arena, which
+ * is released at once by rnbd_sysfs_free_all(). The strings are
+ * interned, equal strings share the same storage. Strings which are
+ * not read from sysfs are empty, never NULL.
+ */
+
+/*
+ * <blockdev>/stat, the fields are in the order of the file. Older
+ * kernels don't have the discard and flush fields, they stay 0.
+ */
+struct rnbd_blk_stat {
+	unsigned long	rd_ios;
+	unsigned long	rd_merges;
+	unsigned long	rd_sect;
+	unsigned long	rd_ticks;	/* ms */
+	unsigned long	wr_ios;
+	unsigned long	wr_merges;
+	unsigned long	wr_sect;
+	unsigned long	wr_ticks;
+	unsigned long	in_flight;
+	unsigned long	io_ticks;
+	unsigned long	time_in_queue;
+	unsigned long	dc_ios;
+	unsigned long	dc_merges;
+	unsigned long	dc_sect;
+	unsigned long	dc_ticks;
+	unsigned long	fl_ios;
+	unsigned long	fl_ticks;
+};
+
 /*
  * A block device exported or imported
  */
 struct rnbd_dev {
-	char		devname[NAME_MAX]; /* file under /dev/ */
-	char		devpath[PATH_MAX]; /* /dev/rnbd<x>, /dev/ram<x> */
-	unsigned long	rx_sect;	   /* from /sys/block/../stats */
-	unsigned long	tx_sect;	   /* from /sys/block/../stats */
-	char		state[NAME_MAX];   /* ../rnbd/state sysfs entry */
+	const char	*devname;	/* file under /dev/ */
+	const char	*devpath;	/* /dev/rnbd<x>, /dev/ram<x> */
+	struct rnbd_blk_stat stat;	/* from /sys/block/../stat */
+	const char	*state;		/* ../rnbd/state sysfs entry */
+};
+
+/*
+ * Requests completed on another CPU than the one they were submitted on,
+ * counted per CPU. Only client paths have them.
+ */
+struct rnbd_cpu_migr {
+	unsigned long	*from;		/* per CPU, in the arena */
+	int		from_cnt;
+	unsigned long	*to;
+	int		to_cnt;
+	unsigned long	total;		/* sum of from */
 };
 
 struct rnbd_path {
-	struct rnbd_sess *sess;	      /* parent session */
-	char		  pathname[NAME_MAX]; /* path appears in sysfs */
-	char		  src_addr[NAME_MAX]; /* client address */
-	char		  dst_addr[NAME_MAX]; /* server address */
-	char		  hca_name[NAME_MAX]; /* hca name */
-	int		  hca_port;	      /* hca port */
-	char		  state[NAME_MAX];    /* state sysfs entry */
-	/* stats/rdma */
+	struct rnbd_sess *sess;		/* parent session */
+	const char	  *pathname;	/* path appears in sysfs */
+	const char	  *src_addr;	/* client address */
+	const char	  *dst_addr;	/* server address */
+	const char	  *hca_name;	/* hca name */
+	int		  hca_port;	/* hca port */
+	const char	  *state;	/* state sysfs entry */
+	/* stats/rdma, in the order of the file */
+	unsigned long	  rx_cnt;	/* read requests */
 	unsigned long	  rx_bytes;
+	unsigned long	  tx_cnt;	/* write requests */
 	unsigned long	  tx_bytes;
 	int		  inflights;
 	int		  reconnects;
+	struct rnbd_cpu_migr migr;
+	unsigned long	  cur_latency;	/* ns, client only */
 };
 
 struct rnbd_sess {
 	enum rnbdmode	  side;			/* client or server side */
-	char		  sessname[NAME_MAX];	/* session name */
-	char		  mp[NAME_MAX];		/* multipath policy */
-	char		  mp_short[NAME_MAX];	/* multipath policy short */
-	char		  hostname[NAME_MAX];	/* hostname of counterpart */
+	const char	  *sessname;		/* session name */
+	const char	  *mp;			/* multipath policy */
+	const char	  *mp_short;		/* multipath policy short */
+	const char	  *hostname;		/* hostname of counterpart */
 
 	/* fields calculated from the list of paths */
 	int		  act_path_cnt;		/* active path count */
-	char		  path_uu[NAME_MAX];	/* paths states str */
+	const char	  *path_uu;		/* paths states str */
 	unsigned long	  rx_bytes;
 	unsigned long	  tx_bytes;
 	int		  inflights;
@@ -62,13 +146,63 @@ struct rnbd_sess {
 	struct rnbd_path **paths;	/* paths */
 };
 
+/*
+ * A port of a local HCA with the paths of both sides using it
+ */
+struct rnbd_hca_port {
+	const char	  *hca_name;
+	int		  port;
+	const char	  *gid;		/* gids/0 of the port */
+	const char	  *link_state;	/* i.e. ACTIVE */
+	const char	  *rate;	/* i.e. 100 Gb/sec (4X EDR) */
+
+	/* fields calculated from the paths */
+	int		  path_cnt;
+	int		  act_path_cnt;	/* connected paths */
+	unsigned long	  rx_bytes;
+	unsigned long	  tx_bytes;
+	int		  inflights;
+	int		  reconnects;
+};
+
+/*
+ * A counterpart host with the sessions of one side to it
+ */
+struct rnbd_host {
+	const char	  *hostname;	/* or the session name if unknown */
+	enum rnbdmode	  side;		/* of the sessions */
+
+	/* fields calculated from the sessions */
+	int		  sess_cnt;
+	int		  dev_cnt;	/* imported or exported devices */
+	int		  path_cnt;
+	int		  act_path_cnt;
+	unsigned long	  rx_bytes;
+	unsigned long	  tx_bytes;
+	int		  inflights;
+	int		  reconnects;
+};
+
 struct rnbd_sess_dev {
-	struct rnbd_sess	*sess;			/* session */
-	char			mapping_path[NAME_MAX]; /* name for mapping */
-	char			access_mode[64];	/* ro/rw/migration */
-	struct rnbd_dev	*dev;			/* rnbd block device */
+	struct rnbd_sess	*sess;		/* session */
+	const char		*mapping_path;	/* name for mapping */
+	const char		*access_mode;	/* ro/rw/migration */
+	struct rnbd_dev		*dev;		/* rnbd block device */
+};
+
+/*
+ * Memory used by the last snapshot
+ */
+struct rnbd_sysfs_mem {
+	size_t	arena;		/* bytes allocated for the arena */
+	size_t	used;		/* bytes used in the arena */
+	size_t	strs;		/* number of interned strings */
+	size_t	strs_bytes;	/* bytes used by the interned strings */
+	size_t	index;		/* bytes used by the hash indexes */
 };
 
+void rnbd_sysfs_mem_stats(struct rnbd_sysfs_mem *mem);
+
 void rnbd_sysfs_free_all(struct rnbd_sess_dev **sds_clt,
 			  struct rnbd_sess_dev **sds_srv,
 			  struct rnbd_sess **sess_clt,
@@ -76,33 +210,117 @@ void rnbd_sysfs_free_all(struct rnbd_sess_dev **sds_clt,
 			  struct rnbd_path **paths_clt,
 			  struct rnbd_path **paths_srv);
 
-int rnbd_sysfs_alloc_all(struct rnbd_sess_dev ***sds_clt,
-			  struct rnbd_sess_dev ***sds_srv,
-			  struct rnbd_sess ***sess_clt,
-			  struct rnbd_sess ***sess_srv,
-			  struct rnbd_path ***paths_clt,
-			  struct rnbd_path ***paths_srv,
-			  int *sds_clt_cnt, int *sds_srv_cnt,
-			  int *sess_clt_cnt, int *sess_srv_cnt,
-			  int *paths_clt_cnt, int *paths_srv_cnt);
-/*
- * Read all the stuff from sysfs.
- * Use rnbd_sysfs_alloc_all() before and rnbd_sysfs_free_all() after.
- */
-int rnbd_sysfs_read_all(struct rnbd_sess_dev **sds_clt,
-			struct rnbd_sess_dev **sds_srv,
-			struct rnbd_sess **sess_clt,
-			struct rnbd_sess **sess_srv,
-			struct rnbd_path **paths_clt,
-			struct rnbd_path **paths_srv);
+/*
+ * Read all the stuff from sysfs in a single pass.
+ * The arrays are allocated on the fly and NULL terminated, the counters
+ * include the terminating element. Use rnbd_sysfs_free_all() after.
+ * Sessions and devices are read by up to @jobs threads in parallel.
+ * Only the optional attributes in @attrs (enum rnbd_attr) are read.
+ */
+int rnbd_sysfs_read_all(struct rnbd_sess_dev ***sds_clt,
+			struct rnbd_sess_dev ***sds_srv,
+			struct rnbd_sess ***sess_clt,
+			struct rnbd_sess ***sess_srv,
+			struct rnbd_path ***paths_clt,
+			struct rnbd_path ***paths_srv,
+			int *sds_clt_cnt, int *sds_srv_cnt,
+			int *sess_clt_cnt, int *sess_srv_cnt,
+			int *paths_clt_cnt, int *paths_srv_cnt,
+			int jobs, unsigned int attrs);
+
+/*
+ * Hash lookups in the objects read by the last rnbd_sysfs_read_all()
+ */
+struct rnbd_sess *rnbd_sysfs_lookup_sess(enum rnbdmode side,
+					  const char *sessname);
+struct rnbd_path *rnbd_sysfs_lookup_path(enum rnbdmode side,
+					  const char *sessname,
+					  const char *pathname);
+int rnbd_sysfs_lookup_sds(enum rnbdmode side, const char *name,
+			  struct rnbd_sess_dev **res);
+
+bool rnbd_sysfs_has_sessions(enum rnbdmode side);
+
+struct port_desc;
+
+/*
+ * Group the paths of the last snapshot (either array may be NULL) by the
+ * HCA port they use, joined with the ports in @descs. Ports without any
+ * paths are listed too. The NULL terminated array is sorted by HCA and
+ * port and must be freed, the ports in it are released with the
+ * snapshot. Returns the number of ports or -errno.
+ */
+int rnbd_sysfs_hca_ports(struct rnbd_path **paths_clt,
+			 struct rnbd_path **paths_srv,
+			 const struct port_desc *descs, int desc_cnt,
+			 struct rnbd_hca_port ***ports);
+
+/*
+ * The counterpart host of a session: its hostname, or the session name
+ * if the hostname is not known. The string is interned.
+ */
+const char *rnbd_sess_host(const struct rnbd_sess *s);
+
+/*
+ * Group the sessions of the last snapshot (any array may be NULL) by
+ * the side and the counterpart host. The devices are counted per host.
+ * The NULL terminated array is sorted by side, client first, and
+ * hostname and is released with the snapshot. Returns the number of
+ * hosts or -errno.
+ */
+int rnbd_sysfs_hosts(struct rnbd_sess **sess_clt,
+		     struct rnbd_sess **sess_srv,
+		     struct rnbd_sess_dev **sds_clt,
+		     struct rnbd_sess_dev **sds_srv,
+		     struct rnbd_host ***hosts);
+
+/*
+ * Direct lookups of single objects, without a scan
+ */
+bool rnbd_sysfs_clt_dev_exists(const char *devname);
+int rnbd_sysfs_clt_mapping_cnt(const char *name, const char *devname);
+bool rnbd_sysfs_sess_exists(enum rnbdmode side, const char *sessname);
+int rnbd_sysfs_find_path(enum rnbdmode side, const char *sessname,
+			 const char *pathname, char *found);
+
+/*
+ * Counters sampled periodically. The attribute files are opened once,
+ * the read functions pread() them from the start. Returns -errno.
+ */
+struct rnbd_rdma_stat {				/* <path>/stats/rdma */
+	unsigned long	rx_cnt;
+	unsigned long	rx_bytes;
+	unsigned long	tx_cnt;
+	unsigned long	tx_bytes;
+	int		inflights;
+};
+
+int rnbd_sysfs_open_dev_stat(const char *devname);
+int rnbd_sysfs_open_path_stat(enum rnbdmode side, const char *sessname,
+			      const char *pathname);
+int rnbd_sysfs_read_blk_stat(int fd, struct rnbd_blk_stat *st);
+int rnbd_sysfs_read_rdma_stat(int fd, struct rnbd_rdma_stat *st);
+
+/*
+ * Attributes of client paths only: the number of requests which
+ * migrated from one CPU to another, summed over all CPUs, and the
+ * current latency in ns.
+ */
+int rnbd_sysfs_open_path_cpu_migr(const char *sessname, const char *pathname);
+int rnbd_sysfs_open_path_latency(const char *sessname, const char *pathname);
+int rnbd_sysfs_read_cpu_migr(int fd, unsigned long *total);
+int rnbd_sysfs_read_latency(int fd, unsigned long *ns);
 
 struct rnbd_ctx;
 
 int printf_sysfs(const char *dir, const char *entry,
 		 const struct rnbd_ctx *ctx, const char *format, ...)
 	__attribute__ ((format (printf, 4, 5)));
-int scanf_sysfs(const char *dir, const char *entry, const char *format, ...)
-	__attribute__ ((format (scanf, 3, 4)));
+int read_sysfs_token(const char *dir, const char *entry,
+		     char *buf, size_t size);
+int read_sysfs_line(const char *dir, const char *entry,
+		    char *buf, size_t size);
+DIR *opendir_sysfs(const char *path);
 
 enum rnbdmode mode_for_host(void);
 const char *mode_to_string(enum rnbdmode mode);
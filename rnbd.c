@@ -18,6 +18,9 @@
 #include "table.h"
 #include "misc.h"
 #include "list.h"
+#include "top.h"
+#include "serve.h"
+#include "analyze.h"
 
 #include "rnbd-sysfs.h"
 #include "rnbd-clms.h"
@@ -65,6 +68,8 @@ static int parse_fmt(int argc, const char *argv[],
 		ctx->fmt = FMT_JSON;
 	else if (!strcasecmp(*argv, "xml"))
 		ctx->fmt = FMT_XML;
+	else if (!strcasecmp(*argv, "prom"))
+		ctx->fmt = FMT_PROM;
 	else if (!strcasecmp(*argv, "term"))
 		ctx->fmt = FMT_TERM;
 	else
@@ -121,6 +126,8 @@ enum lstmode {
 	LST_DEVICES,
 	LST_SESSIONS,
 	LST_PATHS,
+	LST_HCAS,
+	LST_HOSTS,
 	LST_ALL
 };
 
@@ -139,6 +146,14 @@ static int parse_lst(int argc, const char *argv[],
 	else if (!strcasecmp(*argv, "paths") ||
 		 !strcasecmp(*argv, "path"))
 		ctx->lstmode = LST_PATHS;
+	else if (!strcasecmp(*argv, "hcas") ||
+		 !strcasecmp(*argv, "hca") ||
+		 !strcasecmp(*argv, "ports") ||
+		 !strcasecmp(*argv, "port"))
+		ctx->lstmode = LST_HCAS;
+	else if (!strcasecmp(*argv, "hosts") ||
+		 !strcasecmp(*argv, "host"))
+		ctx->lstmode = LST_HOSTS;
 	else
 		return 0;
 
@@ -266,10 +281,15 @@ static int parse_unit(int argc, const char *argv[],
 
 	clm_set_hdr_unit(&clm_rnbd_dev_rx_sect, param->descr);
 	clm_set_hdr_unit(&clm_rnbd_dev_tx_sect, param->descr);
+	clm_set_hdr_unit(&clm_rnbd_dev_dc_sect, param->descr);
 	clm_set_hdr_unit(&clm_rnbd_sess_rx_bytes, param->descr);
 	clm_set_hdr_unit(&clm_rnbd_sess_tx_bytes, param->descr);
 	clm_set_hdr_unit(&clm_rnbd_path_rx_bytes, param->descr);
 	clm_set_hdr_unit(&clm_rnbd_path_tx_bytes, param->descr);
+	clm_set_hdr_unit(&clm_rnbd_hca_port_rx_bytes, param->descr);
+	clm_set_hdr_unit(&clm_rnbd_hca_port_tx_bytes, param->descr);
+	clm_set_hdr_unit(&clm_rnbd_host_rx_bytes, param->descr);
+	clm_set_hdr_unit(&clm_rnbd_host_tx_bytes, param->descr);
 
 	ctx->unit_set = true;
 	return 1;
@@ -290,6 +310,10 @@ static int parse_all(int argc, const char *argv[],
 	       ARRSIZE(all_clms_paths_clt) * sizeof(all_clms_paths[0]));
 	memcpy(&ctx->clms_paths_srv, &all_clms_paths_srv,
 	       ARRSIZE(all_clms_paths_srv) * sizeof(all_clms_paths[0]));
+	memcpy(&ctx->clms_hcas, &all_clms_hcas,
+	       ARRSIZE(all_clms_hcas) * sizeof(all_clms_hcas[0]));
+	memcpy(&ctx->clms_hosts, &all_clms_hosts,
+	       ARRSIZE(all_clms_hosts) * sizeof(all_clms_hosts[0]));
 
 	return 1;
 }
@@ -325,9 +349,303 @@ static int parse_debug(int argc, const char *argv[],
 	return 1;
 }
 
+static int parse_jobs(int argc, const char *argv[],
+		      const struct param *param, struct rnbd_ctx *ctx)
+{
+	char *end;
+	long jobs;
+
+	if (argc < 2) {
+		ERR(trm, "Please specify the number of jobs\n");
+		return -EINVAL;
+	}
+
+	jobs = strtol(argv[1], &end, 10);
+	if (*end || jobs < 1 || jobs > RNBD_SYSFS_MAX_JOBS) {
+		ERR(trm, "Invalid number of jobs '%s', expected 1-%d\n",
+		    argv[1], RNBD_SYSFS_MAX_JOBS);
+		return -EINVAL;
+	}
+
+	ctx->jobs = jobs;
+
+	return 2;
+}
+
+static int parse_interval(int argc, const char *argv[],
+			  const struct param *param, struct rnbd_ctx *ctx)
+{
+	char *end;
+	double sec;
+
+	if (argc < 2) {
+		ERR(trm, "Please specify the refresh interval in seconds\n");
+		return -EINVAL;
+	}
+
+	sec = strtod(argv[1], &end);
+	if (*end || end == argv[1] || sec < 0.1 || sec > 3600) {
+		ERR(trm, "Invalid interval '%s', expected 0.1-3600 seconds\n",
+		    argv[1]);
+		return -EINVAL;
+	}
+
+	ctx->interval_ms = sec * 1000;
+	ctx->interval_set = true;
+
+	return 2;
+}
+
+static int parse_listen(int argc, const char *argv[],
+			const struct param *param, struct rnbd_ctx *ctx)
+{
+	if (argc < 2) {
+		ERR(trm,
+		    "Please specify <host>:<port> or the path of a unix socket\n");
+		return -EINVAL;
+	}
+
+	ctx->listen = argv[1];
+	ctx->listen_set = true;
+
+	return 2;
+}
+
+static int parse_ttl(int argc, const char *argv[],
+		     const struct param *param, struct rnbd_ctx *ctx)
+{
+	char *end;
+	double sec;
+
+	if (argc < 2) {
+		ERR(trm, "Please specify the ttl in seconds\n");
+		return -EINVAL;
+	}
+
+	sec = strtod(argv[1], &end);
+	if (*end || end == argv[1] || sec < 0 || sec > 3600) {
+		ERR(trm, "Invalid ttl '%s', expected 0-3600 seconds\n",
+		    argv[1]);
+		return -EINVAL;
+	}
+
+	ctx->ttl_ms = sec * 1000;
+	ctx->ttl_set = true;
+
+	return 2;
+}
+
+static int parse_count(int argc, const char *argv[],
+		       const struct param *param, struct rnbd_ctx *ctx)
+{
+	char *end;
+	long count;
+
+	if (argc < 2) {
+		ERR(trm, "Please specify the number of refreshes\n");
+		return -EINVAL;
+	}
+
+	count = strtol(argv[1], &end, 10);
+	if (*end || end == argv[1] || count < 1 || count > INT_MAX) {
+		ERR(trm, "Invalid count '%s'\n", argv[1]);
+		return -EINVAL;
+	}
+
+	ctx->count = count;
+	ctx->count_set = true;
+
+	return 2;
+}
+
+static int parse_limit(int argc, const char *argv[],
+		       const struct param *param, struct rnbd_ctx *ctx)
+{
+	char *end;
+	long limit;
+
+	if (argc < 2) {
+		ERR(trm, "Please specify the number of rows\n");
+		return -EINVAL;
+	}
+
+	limit = strtol(argv[1], &end, 10);
+	if (*end || end == argv[1] || limit < 1 || limit > INT_MAX) {
+		ERR(trm, "Invalid limit '%s'\n", argv[1]);
+		return -EINVAL;
+	}
+
+	ctx->limit = limit;
+	ctx->limit_set = true;
+
+	return 2;
+}
+
+static int parse_sort(int argc, const char *argv[],
+		      const struct param *param, struct rnbd_ctx *ctx)
+{
+	if (argc < 2) {
+		ERR(trm, "Please specify the field to sort by\n");
+		return -EINVAL;
+	}
+
+	if (!table_find_column(argv[1], all_clms_top)) {
+		ERR(trm, "Unknown field to sort by '%s'\n", argv[1]);
+		return -EINVAL;
+	}
+
+	ctx->sort = argv[1];
+	ctx->sort_set = true;
+
+	return 2;
+}
+
+/*
+ * sort <field>[,-<field>]... or sort=<field>[,-<field>]...
+ * The fields are looked up once the objects to list are known.
+ */
+static int parse_list_sort(int argc, const char *argv[],
+			   const struct param *param, struct rnbd_ctx *ctx)
+{
+	const char *sort = strchr(argv[0], '=');
+	int ret = 1;
+
+	if (!sort) {
+		if (argc < 2) {
+			ERR(trm, "Please specify the fields to sort by\n");
+			return -EINVAL;
+		}
+		sort = argv[1];
+		ret = 2;
+	} else {
+		sort++;
+	}
+
+	if (!*sort) {
+		ERR(trm, "Please specify the fields to sort by\n");
+		return -EINVAL;
+	}
+
+	ctx->sort = sort;
+	ctx->sort_set = true;
+
+	return ret;
+}
+
+/*
+ * group <field> or group=<field>
+ */
+static int parse_group(int argc, const char *argv[],
+		       const struct param *param, struct rnbd_ctx *ctx)
+{
+	const char *group = strchr(argv[0], '=');
+	int ret = 1;
+
+	if (!group) {
+		if (argc < 2) {
+			ERR(trm, "Please specify the field to group by\n");
+			return -EINVAL;
+		}
+		group = argv[1];
+		ret = 2;
+	} else {
+		group++;
+	}
+
+	if (!*group) {
+		ERR(trm, "Please specify the field to group by\n");
+		return -EINVAL;
+	}
+
+	ctx->group = group;
+	ctx->group_set = true;
+
+	return ret;
+}
+
+static bool is_and_or(const char *str)
+{
+	return !strcasecmp(str, "and") || !strcasecmp(str, "or");
+}
+
+/*
+ * where <field><op><value> [and|or <field><op><value>]...
+ */
+static int parse_where(int argc, const char *argv[],
+		       const struct param *param, struct rnbd_ctx *ctx)
+{
+	char name[NAME_MAX];
+	const char *val;
+	enum table_op op;
+	int i;
+
+	if (argc < 2) {
+		ERR(trm, "Please specify the condition\n");
+		return -EINVAL;
+	}
+
+	for (i = 1; ; i += 2) {
+		if (table_cond_split(argv[i], name, sizeof(name), &op, &val)) {
+			ERR(trm, "Invalid condition '%s', expected %s\n",
+			    argv[i], "<field><op><value>");
+			return -EINVAL;
+		}
+		if (i + 1 >= argc || !is_and_or(argv[i + 1]))
+			break;
+		if (i + 2 >= argc) {
+			ERR(trm, "Please specify the condition after '%s'\n",
+			    argv[i + 1]);
+			return -EINVAL;
+		}
+	}
+
+	ctx->where = argv + 1;
+	ctx->where_cnt = i;
+
+	return i + 1;
+}
+
 static struct param _params_from =
 	{TOK_FROM, "from", "", "", "Destination to map a device from",
 	 NULL, parse_from, 0};
+static struct param _params_interval =
+	{TOK_INTERVAL, "interval", "", "",
+	 "Refresh every <seconds> (default: 1)",
+	 NULL, parse_interval, 0};
+static struct param _params_count =
+	{TOK_COUNT, "count", "", "", "Exit after <n> refreshes",
+	 NULL, parse_count, 0};
+static struct param _params_sort =
+	{TOK_SORT, "sort", "", "",
+	 "Sort by <field> (default: rx + tx)",
+	 NULL, parse_sort, 0};
+static struct param _params_list_sort =
+	{TOK_SORT, "sort", "", "",
+	 "Sort by comma separated <fields>, '-' for descending",
+	 NULL, parse_list_sort, 0};
+static struct param _params_where =
+	{TOK_WHERE, "where", "", "",
+	 "Only <field><op><value> [and|or ...], op: = != < <= > >=",
+	 NULL, parse_where, 0};
+static struct param _params_limit =
+	{TOK_LIMIT, "limit", "", "", "Only the first <n> rows in sort order",
+	 NULL, parse_limit, 0};
+static struct param _params_group =
+	{TOK_GROUP, "group", "", "",
+	 "Sum up the numbers of the rows by the text <field>",
+	 NULL, parse_group, 0};
+static struct param _params_listen =
+	{TOK_LISTEN, "listen", "", "",
+	 "Listen on <host>:<port> or on a unix socket <path>",
+	 NULL, parse_listen, 0};
+static struct param _params_minus_minus_listen =
+	{TOK_LISTEN, "--listen", "", "",
+	 "Listen on <host>:<port> or on a unix socket <path>",
+	 NULL, parse_listen, 0};
+static struct param _params_ttl =
+	{TOK_TTL, "ttl", "", "",
+	 "Read sysfs at most every <seconds> (default: 5)",
+	 NULL, parse_ttl, 0};
 static struct param _params_client =
 	{TOK_CLIENT, "client", "", "", "Operations of client",
 	 NULL, parse_mode, 0};
@@ -371,6 +689,19 @@ static struct param _params_paths =
 	{TOK_PATHS, "paths", "", "", "Operate on paths", NULL, parse_lst, 0};
 static struct param _params_path =
 	{TOK_PATHS, "path", "", "", "", NULL, parse_lst, 0};
+static struct param _params_hcas =
+	{TOK_HCAS, "hcas", "", "", "Operate on HCA ports", NULL, parse_lst, 0};
+static struct param _params_hca =
+	{TOK_HCAS, "hca", "", "", "", NULL, parse_lst, 0};
+static struct param _params_ports =
+	{TOK_HCAS, "ports", "", "", "", NULL, parse_lst, 0};
+static struct param _params_port =
+	{TOK_HCAS, "port", "", "", "", NULL, parse_lst, 0};
+static struct param _params_hosts =
+	{TOK_HOSTS, "hosts", "", "", "Operate on counterpart hosts", NULL,
+	 parse_lst, 0};
+static struct param _params_host =
+	{TOK_HOSTS, "host", "", "", "", NULL, parse_lst, 0};
 static struct param _params_path_param =
 	{TOK_PATHS, "<path>", "", "",
 	 "Path to use (i.e. gid:fe80::1@gid:fe80::2)",
@@ -392,6 +723,9 @@ static struct param _params_cvs =
 	{TOK_CSV, "csv", "", "", "Print in CSV format", NULL, parse_fmt, 0};
 static struct param _params_json =
 	{TOK_JSON, "json", "", "", "Print in JSON format", NULL, parse_fmt, 0};
+static struct param _params_prom =
+	{TOK_PROM, "prom", "", "", "Print in Prometheus text format", NULL,
+	 parse_fmt, 0};
 static struct param _params_term =
 	{TOK_TERM, "term", "", "", "Print for terminal", NULL, parse_fmt, 0};
 static struct param _params_ro =
@@ -439,6 +773,13 @@ static struct param _params_minus_minus_simulate =
 	{TOK_VERBOSE, "--simulate", "", "",
 	 "Only print modifying operations, do not execute",
 	 NULL, parse_flag, NULL, offsetof(struct rnbd_ctx, simulate_set)};
+static struct param _params_minus_j =
+	{TOK_VERBOSE, "-j", "", "", "Jobs",
+	 NULL, parse_jobs, 0};
+static struct param _params_minus_minus_jobs =
+	{TOK_VERBOSE, "--jobs", "", "",
+	 "Read sysfs with <n> parallel threads",
+	 NULL, parse_jobs, 0};
 static struct param _params_minus_c =
 	{TOK_VERBOSE, "-c", "", "", "Complete",
 	 NULL, parse_flag, NULL, offsetof(struct rnbd_ctx, complete_set)};
@@ -484,6 +825,12 @@ static struct param _params_all_recover =
 static struct param _params_recover_add_missing =
 	{TOK_ALL, "add-missing", "", "", "Add missing paths",
 	 NULL, parse_flag, NULL, offsetof(struct rnbd_ctx, add_missing_set)};
+static struct param _params_apply =
+	{TOK_APPLY, "apply", "", "", "Set the recommended multipath policy",
+	 NULL, parse_flag, NULL, offsetof(struct rnbd_ctx, apply_set)};
+static struct param _params_minus_minus_apply =
+	{TOK_APPLY, "--apply", "", "", "Set the recommended multipath policy",
+	 NULL, parse_flag, NULL, offsetof(struct rnbd_ctx, apply_set)};
 
 static struct param _params_null =
 	{TOK_NONE, 0};
@@ -674,6 +1021,17 @@ static void help_fields(void)
 		  "fields from the default selection.\n");
 }
 
+static void help_query(void)
+{
+	print_opt("sort", "Sort by comma separated <fields>, '-' descending");
+	print_opt("where",
+		  "Only <field><op><value>, op: = != < <= > >=, the");
+	print_opt("", "conditions joined by and|or, strings as patterns");
+	print_opt("limit", "Only the first <n> rows in sort order");
+	print_opt("group", "Sum up the numbers of the rows by the text");
+	print_opt("", "<field>, i.e. hostname, hca_name or state");
+}
+
 static void print_fields(const struct rnbd_ctx *ctx,
 			 struct table_column **def_clt,
 			 struct table_column **def_srv,
@@ -740,14 +1098,86 @@ static void help_dump_all(const char *program_name,
 		     all_clms_paths_srv,
 		     all_clms_paths, RNBD_BOTH);
 
-	print_opt("{format}", "Output format: csv|json|xml");
+	printf("%s%s%s%s\n", HPRE,
+	       CLR(trm, CDIM, "Host Fields"));
+	/* the hosts have the same fields on both sides */
+	print_fields(ctx, def_clms_hosts, def_clms_hosts,
+		     all_clms_hosts, all_clms_hosts,
+		     all_clms_hosts, RNBD_CLIENT);
+
+	print_opt("{format}", "Output format: csv|json|xml|prom");
 	print_opt("{unit}", "Units to use for size (in binary): B|K|M|G|T|P|E");
+	help_query();
 	print_param_descr("notree");
 	print_param_descr("noheaders");
 	print_param_descr("nototals");
 	print_param_descr("help");
 }
 
+static void help_top(const char *program_name,
+		     const struct param *cmd,
+		     const struct rnbd_ctx *ctx)
+{
+	cmd_print_usage_descr(cmd, program_name, ctx);
+
+	printf("\nArguments:\n");
+	print_opt("{object}",
+		  "Show only devices, sessions, paths, hcas or hosts.");
+	print_opt("", "Default: all but hcas and hosts");
+
+	printf("\nOptions:\n");
+	print_opt("interval", "Refresh every <seconds> (default: 1)");
+	print_opt("count", "Exit after <n> refreshes");
+	print_opt("sort", "Sort by <field>, numbers descending");
+	print_opt("", "(default: rx + tx)");
+	print_opt("limit", "Only the first <n> rows of every table");
+	print_param_descr("noheaders");
+	print_param_descr("help");
+
+	printf("\n%s%s%s%s\n", HPRE, CLR(trm, CDIM, "Fields"));
+	table_tbl_print_term(HPRE, all_clms_top, trm, ctx);
+}
+
+static void help_watch(const char *program_name,
+		       const struct param *cmd,
+		       const struct rnbd_ctx *ctx)
+{
+	cmd_print_usage_descr(cmd, program_name, ctx);
+
+	printf("\nArguments:\n");
+	print_opt("{object}",
+		  "Show only devices, sessions, paths, hcas or hosts.");
+	print_opt("", "Default: all but hcas and hosts");
+	print_opt("{fields}",
+		  "Comma separated list of fields to be printed.");
+	print_opt("", "The names are always printed. Default: all");
+
+	printf("\nOptions:\n");
+	print_opt("interval", "Sample every <seconds> (default: 1)");
+	print_opt("count", "Exit after <n> samples");
+	print_param_descr("help");
+
+	printf("\n%s%s%s%s\n", HPRE, CLR(trm, CDIM, "Fields"));
+	table_tbl_print_term(HPRE, all_clms_watch, trm, ctx);
+}
+
+static void help_serve(const char *program_name,
+		       const struct param *cmd,
+		       const struct rnbd_ctx *ctx)
+{
+	cmd_print_usage_descr(cmd, program_name, ctx);
+
+	printf("\nOptions:\n");
+	print_opt("listen", "Listen on <host>:<port>, i.e. :9100 or [::1]:9100,");
+	print_opt("", "or on a unix socket <path> containing a '/'");
+	print_opt("ttl", "Read sysfs at most every <seconds> (default: 5)");
+	print_param_descr("help");
+
+	printf("\n%s%s%s%s\n", HPRE, CLR(trm, CDIM, "Pages"));
+	print_opt("/, /json", "All the objects in JSON, as \"dump json all\"");
+	print_opt("/metrics", "All the objects in Prometheus text format");
+}
+
 static void help_list_devices(const char *program_name,
 			      const struct param *cmd,
 			      const struct rnbd_ctx *ctx)
@@ -767,8 +1197,9 @@ static void help_list_devices(const char *program_name,
 		     all_clms_devices_srv,
 		     all_clms_devices, ctx->rnbdmode);
 
-	print_opt("{format}", "Output format: csv|json|xml");
+	print_opt("{format}", "Output format: csv|json|xml|prom");
 	print_opt("{unit}", "Units to use for size (in binary): B|K|M|G|T|P|E");
+	help_query();
 	print_param_descr("notree");
 	print_param_descr("noheaders");
 	print_param_descr("nototals");
@@ -794,8 +1225,9 @@ static void help_list_sessions(const char *program_name,
 		     all_clms_sessions_srv,
 		     all_clms_sessions, ctx->rnbdmode);
 
-	print_opt("{format}", "Output format: csv|json|xml");
+	print_opt("{format}", "Output format: csv|json|xml|prom");
 	print_opt("{unit}", "Units to use for size (in binary): B|K|M|G|T|P|E");
+	help_query();
 	print_param_descr("notree");
 	print_param_descr("noheaders");
 	print_param_descr("nototals");
@@ -821,23 +1253,326 @@ static void help_list_paths(const char *program_name,
 		     all_clms_paths_srv,
 		     all_clms_paths, ctx->rnbdmode);
 
-	print_opt("{format}", "Output format: csv|json|xml");
+	print_opt("{format}", "Output format: csv|json|xml|prom");
 	print_opt("{unit}", "Units to use for size (in binary): B|K|M|G|T|P|E");
+	help_query();
 	print_param_descr("notree");
 	print_param_descr("noheaders");
 	print_param_descr("nototals");
 	print_opt("help", "Display help and exit. [fields|all]");
 }
 
+static void help_list_hcas(const char *program_name,
+			   const struct param *cmd,
+			   const struct rnbd_ctx *ctx)
+{
+	if (!program_name)
+		program_name = "hcas";
+
+	cmd_print_usage_descr(cmd, program_name, ctx);
+
+	printf("\nOptions:\n");
+
+	help_fields();
+
+	table_tbl_print_term(HPRE, all_clms_hcas, trm, ctx);
+	printf("\n%sDefault: ", HPRE);
+	print_clms_list(def_clms_hcas);
+	printf("\n");
+
+	print_opt("{format}", "Output format: csv|json|xml|prom");
+	print_opt("{unit}", "Units to use for size (in binary): B|K|M|G|T|P|E");
+	help_query();
+	print_param_descr("noheaders");
+	print_param_descr("nototals");
+	print_opt("help", "Display help and exit. [fields|all]");
+}
+
+static void help_list_hosts(const char *program_name,
+			   const struct param *cmd,
+			   const struct rnbd_ctx *ctx)
+{
+	if (!program_name)
+		program_name = "hosts";
+
+	cmd_print_usage_descr(cmd, program_name, ctx);
+
+	printf("\nOptions:\n");
+
+	help_fields();
+
+	table_tbl_print_term(HPRE, all_clms_hosts, trm, ctx);
+	printf("\n%sDefault: ", HPRE);
+	print_clms_list(def_clms_hosts);
+	printf("\n");
+
+	print_opt("{format}", "Output format: csv|json|xml|prom");
+	print_opt("{unit}", "Units to use for size (in binary): B|K|M|G|T|P|E");
+	help_query();
+	print_param_descr("noheaders");
+	print_param_descr("nototals");
+	print_opt("help", "Display help and exit. [fields|all]");
+}
+
+/*
+ * Copy the @cnt @rows matching ctx->where to the NULL terminated @res,
+ * sorted by ctx->sort or else by @def (NULL: in their order), only the
+ * first ctx->limit of them if it is set. The fields are looked up in
+ * @all. A dump lists objects with different fields: it is not sorted
+ * by those an object does not have and conditions on them are false.
+ * Returns the number of rows in @res.
+ */
+static int query_rows(void **rows, int cnt, void ***res,
+		      struct table_column **all, const char *def,
+		      bool is_dump, const struct rnbd_ctx *ctx)
+{
+	struct table_query q;
+	const char *bad;
+	int err;
+
+	*res = NULL;
+
+	err = table_query_init(&q, ctx->sort_set ? ctx->sort : def,
+			       ctx->where, ctx->where_cnt, all, is_dump,
+			       &bad);
+	if (err) {
+		ERR(trm, "Unknown field or invalid value in '%s'\n", bad);
+		return err;
+	}
+
+	*res = calloc(cnt + 1, sizeof(**res));
+	if (!*res) {
+		ERR(trm, "not enough memory\n");
+		return -ENOMEM;
+	}
+	if (cnt)
+		memcpy(*res, rows, cnt * sizeof(**res));
+
+	cnt = table_rows_filter(*res, cnt, &q, ctx);
+
+	if (ctx->limit_set)
+		err = cnt = table_rows_top(*res, cnt, &q, ctx->limit, ctx);
+	else
+		err = table_rows_sort(*res, cnt, &q, ctx);
+	if (err < 0) {
+		ERR(trm, "not enough memory\n");
+		free(*res);
+		*res = NULL;
+		return err;
+	}
+
+	return cnt;
+}
+
+/* the paths in the tree of a session are ordered by HCA and address */
+static void paths_tree_query(struct table_query *q)
+{
+	table_query_init(q, "hca_name,src_addr", NULL, 0, all_clms_paths,
+			 false, NULL);
+}
+
+/* how a list calls its outgoing and incoming side in the formats */
+struct list_sides {
+	const char		*csv[2];
+	const char		*json[2];
+	const char		*xml[2];
+	const char		*term[2];
+	const char		*dir[2];	/* a label of prom */
+	const char		*prom;		/* prefix of the metrics */
+	struct table_column	**all[2];
+	bool			dump_first;	/* opens the JSON of a dump */
+	bool			dump_last;	/* closes it */
+};
+
+static const struct list_sides devices_sides = {
+	.csv	= { "Imports", "Exports" },
+	.json	= { "imports", "exports" },
+	.xml	= { "imports", "exports" },
+	.term	= { "Imported devices", "Exported devices" },
+	.dir	= { "import", "export" },
+	.prom	= "rnbd_device_group",
+	.all	= { all_clms_devices_clt, all_clms_devices_srv },
+	.dump_first = true,
+};
+
+static const struct list_sides sessions_sides = {
+	.csv	= { "Outgoing sessions", "Incoming sessions" },
+	.json	= { "outgoing sessions", "incoming sessions" },
+	.xml	= { "outgoing-sessions", "incoming-sessions" },
+	.term	= { "Outgoing sessions", "Incoming sessions" },
+	.dir	= { "outgoing", "incoming" },
+	.prom	= "rnbd_session_group",
+	.all	= { all_clms_sessions_clt, all_clms_sessions_srv },
+};
+
+static const struct list_sides paths_sides = {
+	.csv	= { "Outgoing paths", "Incoming paths" },
+	.json	= { "outgoing paths", "incoming paths" },
+	.xml	= { "outgoing-paths", "incoming-paths" },
+	.term	= { "Outgoing paths", "Incoming paths" },
+	.dir	= { "outgoing", "incoming" },
+	.prom	= "rnbd_path_group",
+	.all	= { all_clms_paths_clt, all_clms_paths_srv },
+};
+
+static const struct list_sides hcas_sides = {
+	.json	= { "hca ports" },
+	.xml	= { "hca-ports" },
+	.prom	= "rnbd_hca_port_group",
+	.all	= { all_clms_hcas },
+};
+
+static const struct list_sides hosts_sides = {
+	.csv	= { "Outgoing hosts", "Incoming hosts" },
+	.json	= { "outgoing hosts", "incoming hosts" },
+	.xml	= { "outgoing-hosts", "incoming-hosts" },
+	.term	= { "Outgoing hosts", "Incoming hosts" },
+	.dir	= { "outgoing", "incoming" },
+	.prom	= "rnbd_host_group",
+	.all	= { all_clms_hosts, all_clms_hosts },
+	.dump_last = true,
+};
+
+/*
+ * List the @cnt @rows of both sides aggregated by ctx->group, with the
+ * sums of their numeric columns @cs. Returns 1 without listing anything
+ * if a dump lists objects which do not have the field, -errno if the
+ * field can not be grouped by.
+ */
+static int list_groups(void **rows[2], int cnt[2],
+		       struct table_column **cs[2],
+		       const struct list_sides *sides, bool is_dump,
+		       const struct rnbd_ctx *ctx)
+{
+	bool prom = ctx->fmt == FMT_PROM;
+	struct table_groups g[2] = {};
+	struct table_column *key;
+	int i, err = 0;
+
+	for (i = 0; i < 2; i++) {
+		if (!cnt[i])
+			continue;
+		key = table_find_column(ctx->group, sides->all[i]);
+		if (!key && is_dump) {
+			err = 1;
+			goto out;
+		}
+		if (!key || key->m_type != FLD_STR) {
+			ERR(trm, "Can not group by '%s', %s\n", ctx->group,
+			    key ? "it is no text field" : "unknown field");
+			err = -EINVAL;
+			goto out;
+		}
+		/* prom shows the groups of both sides in one list */
+		err = table_groups_add(&g[prom ? 0 : i], rows[i], cnt[i], key,
+				       cs[i], prom ? sides->dir[i] : NULL, ctx);
+		if (err) {
+			ERR(trm, "not enough memory\n");
+			goto out;
+		}
+	}
+
+	switch (ctx->fmt) {
+	case FMT_CSV:
+		for (i = 0; i < 2; i++) {
+			if (cnt[0] && cnt[1])
+				printf("%s:\n", sides->csv[i]);
+			if (cnt[i])
+				list_groups_csv(&g[i], ctx);
+		}
+		break;
+	case FMT_JSON:
+		if (!is_dump || sides->dump_first)
+			printf("{\n");
+
+		for (i = 0; i < 2 && sides->json[i]; i++) {
+			printf("%s\t\"%s\": ", i ? ",\n" : "", sides->json[i]);
+			if (cnt[i])
+				list_groups_json(&g[i], ctx);
+			else
+				printf("null");
+		}
+
+		if (!is_dump || sides->dump_last)
+			printf("\n}\n");
+		else
+			printf(",\n");
+		break;
+	case FMT_XML:
+		for (i = 0; i < 2; i++) {
+			if (!cnt[i])
+				continue;
+			printf("<%s>\n", sides->xml[i]);
+			list_groups_xml(&g[i], ctx);
+			printf("</%s>\n", sides->xml[i]);
+		}
+		break;
+	case FMT_PROM:
+		list_groups_prom(sides->prom, &g[0], ctx);
+		break;
+	case FMT_TERM:
+	default:
+		for (i = 0; i < 2; i++) {
+			if (i && cnt[0] && cnt[1] && is_dump)
+				printf("\n");
+			if (sides->term[i]
+			    && ((cnt[0] && cnt[1] && !ctx->noheaders_set)
+				|| (cnt[i] && is_dump)))
+				printf("%s%s%s\n",
+				       CLR(trm, CDIM, sides->term[i]));
+			if (cnt[i])
+				list_groups_term(&g[i], ctx);
+		}
+		break;
+	}
+out:
+	table_groups_free(&g[0]);
+	table_groups_free(&g[1]);
+
+	return err;
+}
+
 static int list_devices(struct rnbd_sess_dev **d_clt, int d_clt_cnt,
 			struct rnbd_sess_dev **d_srv, int d_srv_cnt,
 			bool is_dump, struct rnbd_ctx *ctx)
 {
+	struct rnbd_sess_dev **clt = NULL, **srv = NULL;
+	int err = 0;
+
 	if (!(ctx->rnbdmode & RNBD_CLIENT))
 		d_clt_cnt = 0;
 	if (!(ctx->rnbdmode & RNBD_SERVER))
 		d_srv_cnt = 0;
 
+	/* the devices are sorted already when the snapshot is taken */
+	if (d_clt_cnt)
+		d_clt_cnt = query_rows((void **)d_clt, d_clt_cnt,
+				       (void ***)&clt, all_clms_devices_clt,
+				       NULL, is_dump, ctx);
+	if (d_srv_cnt && d_clt_cnt >= 0)
+		d_srv_cnt = query_rows((void **)d_srv, d_srv_cnt,
+				       (void ***)&srv, all_clms_devices_srv,
+				       NULL, is_dump, ctx);
+	if (d_clt_cnt < 0 || d_srv_cnt < 0) {
+		free(clt);
+		return d_clt_cnt < 0 ? d_clt_cnt : d_srv_cnt;
+	}
+	d_clt = clt;
+	d_srv = srv;
+
+	if (ctx->group_set) {
+		void **rows[] = { (void **)d_clt, (void **)d_srv };
+		int cnts[] = { d_clt_cnt, d_srv_cnt };
+		struct table_column **cs[] = { ctx->clms_devices_clt,
+					       ctx->clms_devices_srv };
+
+		err = list_groups(rows, cnts, cs, &devices_sides, is_dump,
+				  ctx);
+		if (err <= 0)
+			goto out;
+		err = 0;
+	}
+
 	switch (ctx->fmt) {
 	case FMT_CSV:
 		if ((d_clt_cnt && d_srv_cnt) || ctx->rnbdmode == RNBD_BOTH)
@@ -889,6 +1624,12 @@ static int list_devices(struct rnbd_sess_dev **d_clt, int d_clt_cnt,
 		}
 
 		break;
+	case FMT_PROM:
+		list_devices_prom(d_clt_cnt ? d_clt : NULL,
+				  ctx->clms_devices_clt,
+				  d_srv_cnt ? d_srv : NULL,
+				  ctx->clms_devices_srv, ctx);
+		break;
 	case FMT_TERM:
 	default:
 		if ((d_clt_cnt && d_srv_cnt && !ctx->noheaders_set)
@@ -912,18 +1653,57 @@ static int list_devices(struct rnbd_sess_dev **d_clt, int d_clt_cnt,
 
 		break;
 	}
-	return 0;
+
+out:
+	free(clt);
+	free(srv);
+
+	return err;
 }
 
 static int list_sessions(struct rnbd_sess **s_clt, int clt_s_num,
 			 struct rnbd_sess **s_srv, int srv_s_num,
 			 bool is_dump, struct rnbd_ctx *ctx)
 {
+	const char *def = ctx->fmt == FMT_TERM ? "sessname" : NULL;
+	struct rnbd_sess **clt = NULL, **srv = NULL;
+	struct table_query paths_q;
+	int err = 0;
+
 	if (!(ctx->rnbdmode & RNBD_CLIENT))
 		clt_s_num = 0;
 	if (!(ctx->rnbdmode & RNBD_SERVER))
 		srv_s_num = 0;
 
+	if (clt_s_num)
+		clt_s_num = query_rows((void **)s_clt, clt_s_num,
+				       (void ***)&clt, all_clms_sessions_clt,
+				       def, is_dump, ctx);
+	if (srv_s_num && clt_s_num >= 0)
+		srv_s_num = query_rows((void **)s_srv, srv_s_num,
+				       (void ***)&srv, all_clms_sessions_srv,
+				       def, is_dump, ctx);
+	if (clt_s_num < 0 || srv_s_num < 0) {
+		free(clt);
+		return clt_s_num < 0 ? clt_s_num : srv_s_num;
+	}
+	s_clt = clt;
+	s_srv = srv;
+	paths_tree_query(&paths_q);
+
+	if (ctx->group_set) {
+		void **rows[] = { (void **)s_clt, (void **)s_srv };
+		int cnts[] = { clt_s_num, srv_s_num };
+		struct table_column **cs[] = { ctx->clms_sessions_clt,
+					       ctx->clms_sessions_srv };
+
+		err = list_groups(rows, cnts, cs, &sessions_sides, is_dump,
+				  ctx);
+		if (err <= 0)
+			goto out;
+		err = 0;
+	}
+
 	switch (ctx->fmt) {
 	case FMT_CSV:
 		if (clt_s_num && srv_s_num)
@@ -946,9 +1726,9 @@ static int list_sessions(struct rnbd_sess **s_clt, int clt_s_num,
 		if (clt_s_num)
 			list_sessions_json(s_clt, ctx->clms_sessions_clt, ctx);
 		else
-			printf("null,\n");
+			printf("null");
 
-		printf("\t\"incoming sessions\": ");
+		printf(",\n\t\"incoming sessions\": ");
 		if (srv_s_num)
 			list_sessions_json(s_srv, ctx->clms_sessions_srv, ctx);
 		else
@@ -972,138 +1752,536 @@ static int list_sessions(struct rnbd_sess **s_clt, int clt_s_num,
 			printf("</incoming-sessions>\n");
 		}
 
-		break;
-	case FMT_TERM:
-	default:
-		if ((clt_s_num && srv_s_num && !ctx->noheaders_set)
-		    || (clt_s_num && is_dump))
-			printf("%s%s%s\n",
-			       CLR(trm, CDIM, "Outgoing sessions"));
+		break;
+	case FMT_PROM:
+		list_sessions_prom(clt_s_num ? s_clt : NULL,
+				   ctx->clms_sessions_clt,
+				   srv_s_num ? s_srv : NULL,
+				   ctx->clms_sessions_srv, ctx);
+		break;
+	case FMT_TERM:
+	default:
+		if ((clt_s_num && srv_s_num && !ctx->noheaders_set)
+		    || (clt_s_num && is_dump))
+			printf("%s%s%s\n",
+			       CLR(trm, CDIM, "Outgoing sessions"));
+
+		if (clt_s_num)
+			err = list_sessions_term(s_clt, ctx->clms_sessions_clt,
+						 &paths_q, ctx);
+
+		if (clt_s_num && srv_s_num && is_dump)
+			printf("\n");
+
+		if ((clt_s_num && srv_s_num && !ctx->noheaders_set)
+		    || (srv_s_num && is_dump))
+			printf("%s%s%s\n",
+			       CLR(trm, CDIM, "Incoming sessions"));
+
+		if (srv_s_num && !err)
+			err = list_sessions_term(s_srv, ctx->clms_sessions_srv,
+						 &paths_q, ctx);
+		break;
+	}
+
+out:
+	free(clt);
+	free(srv);
+
+	return err;
+}
+
+static int list_paths(struct rnbd_path **p_clt, int clt_p_num,
+		      struct rnbd_path **p_srv, int srv_p_num,
+		      bool is_dump, struct rnbd_ctx *ctx)
+{
+	const char *def = ctx->fmt == FMT_TERM ? "sessname" : NULL;
+	struct rnbd_path **clt = NULL, **srv = NULL;
+	int err = 0;
+
+	if (!(ctx->rnbdmode & RNBD_CLIENT))
+		clt_p_num = 0;
+	if (!(ctx->rnbdmode & RNBD_SERVER))
+		srv_p_num = 0;
+
+	if (clt_p_num)
+		clt_p_num = query_rows((void **)p_clt, clt_p_num,
+				       (void ***)&clt, all_clms_paths_clt,
+				       def, is_dump, ctx);
+	if (srv_p_num && clt_p_num >= 0)
+		srv_p_num = query_rows((void **)p_srv, srv_p_num,
+				       (void ***)&srv, all_clms_paths_srv,
+				       def, is_dump, ctx);
+	if (clt_p_num < 0 || srv_p_num < 0) {
+		free(clt);
+		return clt_p_num < 0 ? clt_p_num : srv_p_num;
+	}
+	p_clt = clt;
+	p_srv = srv;
+
+	if (ctx->group_set) {
+		void **rows[] = { (void **)p_clt, (void **)p_srv };
+		int cnts[] = { clt_p_num, srv_p_num };
+		struct table_column **cs[] = { ctx->clms_paths_clt,
+					       ctx->clms_paths_srv };
+
+		err = list_groups(rows, cnts, cs, &paths_sides, is_dump,
+				  ctx);
+		if (err <= 0)
+			goto out;
+		err = 0;
+	}
+
+	switch (ctx->fmt) {
+	case FMT_CSV:
+		if (clt_p_num && srv_p_num)
+			printf("Outgoing paths:\n");
+
+		if (clt_p_num)
+			list_paths_csv(p_clt, ctx->clms_paths_clt, ctx);
+
+		if (clt_p_num && srv_p_num)
+			printf("Incoming paths:\n");
+
+		if (srv_p_num)
+			list_paths_csv(p_srv, ctx->clms_paths_srv, ctx);
+		break;
+	case FMT_JSON:
+		if (!is_dump)
+			printf("{\n");
+
+		printf("\t\"outgoing paths\": ");
+		if (clt_p_num)
+			list_paths_json(p_clt, ctx->clms_paths_clt, ctx);
+		else
+			printf("null");
+
+		printf(",\n\t\"incoming paths\": ");
+		if (srv_p_num)
+			list_paths_json(p_srv, ctx->clms_paths_srv, ctx);
+		else
+			printf("null");
+
+		/* the hosts follow in a dump */
+		if (!is_dump)
+			printf("\n}\n");
+		else
+			printf(",\n");
+
+		break;
+	case FMT_XML:
+		if (clt_p_num) {
+			printf("<outgoing-paths>\n");
+			list_paths_xml(p_clt, ctx->clms_paths_clt, ctx);
+			printf("</outgoing-paths>\n");
+		}
+		if (srv_p_num) {
+			printf("<incoming-paths>\n");
+			list_paths_xml(p_srv, ctx->clms_paths_srv, ctx);
+			printf("</incoming-paths>\n");
+		}
+
+		break;
+	case FMT_PROM:
+		list_paths_prom(clt_p_num ? p_clt : NULL,
+				ctx->clms_paths_clt,
+				srv_p_num ? p_srv : NULL,
+				ctx->clms_paths_srv, ctx);
+		break;
+	case FMT_TERM:
+	default:
+		if ((clt_p_num && srv_p_num && !ctx->noheaders_set)
+		    || (clt_p_num && is_dump))
+			printf("%s%s%s\n",
+			       CLR(trm, CDIM, "Outgoing paths"));
+
+		if (clt_p_num)
+			err = list_paths_term(p_clt, clt_p_num,
+					      ctx->clms_paths_clt, 0, NULL,
+					      ctx);
+
+		if (clt_p_num && srv_p_num && is_dump)
+			printf("\n");
+
+		if ((clt_p_num && srv_p_num && !ctx->noheaders_set)
+		    || (srv_p_num && is_dump))
+			printf("%s%s%s\n",
+			       CLR(trm, CDIM, "Incoming paths"));
+
+		if (srv_p_num && !err)
+			err = list_paths_term(p_srv, srv_p_num,
+					      ctx->clms_paths_srv, 0, NULL,
+					      ctx);
+		break;
+	}
+
+out:
+	free(clt);
+	free(srv);
+
+	return err;
+}
+
+/*
+ * The local HCA ports with the paths of the sides in ctx->rnbdmode
+ */
+static int hca_ports(struct rnbd_hca_port ***ports,
+		     const struct rnbd_ctx *ctx)
+{
+	struct rnbd_path **clt = NULL, **srv = NULL;
+	int cnt;
+
+	if (ctx->rnbdmode & RNBD_CLIENT)
+		clt = paths_clt;
+	if (ctx->rnbdmode & RNBD_SERVER)
+		srv = paths_srv;
+
+	cnt = rnbd_sysfs_hca_ports(clt, srv, ctx->port_descs, ctx->port_cnt,
+				   ports);
+	if (cnt < 0)
+		ERR(trm, "not enough memory\n");
+
+	return cnt;
+}
+
+static int list_hcas(struct rnbd_ctx *ctx)
+{
+	struct rnbd_hca_port **all, **ports;
+	int cnt, err = 0;
+
+	cnt = hca_ports(&all, ctx);
+	if (cnt < 0)
+		return cnt;
+
+	cnt = query_rows((void **)all, cnt, (void ***)&ports, all_clms_hcas,
+			 NULL, false, ctx);
+	free(all);
+	if (cnt < 0)
+		return cnt;
+
+	if (ctx->group_set) {
+		void **rows[] = { (void **)ports, NULL };
+		int cnts[] = { cnt, 0 };
+		struct table_column **cs[] = { ctx->clms_hcas, NULL };
+
+		err = list_groups(rows, cnts, cs, &hcas_sides, false, ctx);
+		goto out;
+	}
+
+	switch (ctx->fmt) {
+	case FMT_CSV:
+		if (cnt)
+			list_hcas_csv(ports, ctx->clms_hcas, ctx);
+		break;
+	case FMT_JSON:
+		printf("{\n\t\"hca ports\": ");
+		if (cnt)
+			list_hcas_json(ports, ctx->clms_hcas, ctx);
+		else
+			printf("null");
+		printf("\n}\n");
+		break;
+	case FMT_XML:
+		printf("<hca-ports>\n");
+		list_hcas_xml(ports, ctx->clms_hcas, ctx);
+		printf("</hca-ports>\n");
+		break;
+	case FMT_PROM:
+		list_hcas_prom(ports, ctx->clms_hcas, ctx);
+		break;
+	case FMT_TERM:
+	default:
+		if (cnt)
+			err = list_hcas_term(ports, ctx->clms_hcas, ctx);
+		break;
+	}
+
+out:
+	free(ports);
+
+	return err;
+}
+
+/* the hosts of the snapshot, built once for the sides in the mode */
+static struct rnbd_host **snap_hosts;
+static int snap_host_cnt;
+static unsigned int snap_hosts_mode;
+
+/*
+ * The counterpart hosts of the sessions of the sides in ctx->rnbdmode.
+ * They live in the snapshot and are only built once for it.
+ */
+static int hosts(struct rnbd_host ***hosts, const struct rnbd_ctx *ctx)
+{
+	struct rnbd_sess_dev **ds_clt = NULL, **ds_srv = NULL;
+	struct rnbd_sess **ss_clt = NULL, **ss_srv = NULL;
+	int cnt;
 
-		if (clt_s_num)
-			list_sessions_term(s_clt, ctx->clms_sessions_clt, ctx);
+	if (snap_hosts && snap_hosts_mode == ctx->rnbdmode) {
+		*hosts = snap_hosts;
+		return snap_host_cnt;
+	}
 
-		if (clt_s_num && srv_s_num && is_dump)
-			printf("\n");
+	if (ctx->rnbdmode & RNBD_CLIENT) {
+		ss_clt = sess_clt;
+		ds_clt = sds_clt;
+	}
+	if (ctx->rnbdmode & RNBD_SERVER) {
+		ss_srv = sess_srv;
+		ds_srv = sds_srv;
+	}
 
-		if ((clt_s_num && srv_s_num && !ctx->noheaders_set)
-		    || (srv_s_num && is_dump))
-			printf("%s%s%s\n",
-			       CLR(trm, CDIM, "Incoming sessions"));
+	cnt = rnbd_sysfs_hosts(ss_clt, ss_srv, ds_clt, ds_srv, hosts);
+	if (cnt < 0) {
+		ERR(trm, "not enough memory\n");
+		return cnt;
+	}
+	snap_hosts = *hosts;
+	snap_host_cnt = cnt;
+	snap_hosts_mode = ctx->rnbdmode;
 
-		if (srv_s_num)
-			list_sessions_term(s_srv, ctx->clms_sessions_srv, ctx);
-		break;
+	return cnt;
+}
+
+/*
+ * The hosts are sorted by side, the outgoing ones first. Terminate the
+ * outgoing ones in @clt and the incoming ones in @srv.
+ */
+static int hosts_split(struct rnbd_host **hh, int cnt,
+		       struct rnbd_host ***clt, int *clt_cnt,
+		       struct rnbd_host ***srv, int *srv_cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt && hh[i]->side == RNBD_CLIENT; i++)
+		;
+
+	*clt = calloc(i + 1, sizeof(**clt));
+	*srv = calloc(cnt - i + 1, sizeof(**srv));
+	if (!*clt || !*srv) {
+		ERR(trm, "Failed to alloc memory\n");
+		free(*clt);
+		free(*srv);
+		return -ENOMEM;
 	}
+	memcpy(*clt, hh, i * sizeof(**clt));
+	memcpy(*srv, hh + i, (cnt - i) * sizeof(**srv));
+	*clt_cnt = i;
+	*srv_cnt = cnt - i;
 
 	return 0;
 }
 
-static int list_paths(struct rnbd_path **p_clt, int clt_p_num,
-		      struct rnbd_path **p_srv, int srv_p_num,
-		      bool is_dump, struct rnbd_ctx *ctx)
+static int list_hosts(struct rnbd_host **hh, int cnt, bool is_dump,
+		      struct rnbd_ctx *ctx)
 {
-	if (!(ctx->rnbdmode & RNBD_CLIENT))
-		clt_p_num = 0;
-	if (!(ctx->rnbdmode & RNBD_SERVER))
-		srv_p_num = 0;
+	struct rnbd_host **h_clt, **h_srv, **q_clt = NULL, **q_srv = NULL;
+	int clt_cnt, srv_cnt, err;
+
+	err = hosts_split(hh, cnt, &h_clt, &clt_cnt, &h_srv, &srv_cnt);
+	if (err)
+		return err;
+
+	clt_cnt = query_rows((void **)h_clt, clt_cnt, (void ***)&q_clt,
+			     all_clms_hosts, NULL, is_dump, ctx);
+	if (clt_cnt >= 0)
+		srv_cnt = query_rows((void **)h_srv, srv_cnt,
+				     (void ***)&q_srv, all_clms_hosts, NULL,
+				     is_dump, ctx);
+	free(h_clt);
+	free(h_srv);
+	if (clt_cnt < 0 || srv_cnt < 0) {
+		free(q_clt);
+		return clt_cnt < 0 ? clt_cnt : srv_cnt;
+	}
+	h_clt = q_clt;
+	h_srv = q_srv;
+
+	if (ctx->group_set) {
+		void **rows[] = { (void **)h_clt, (void **)h_srv };
+		int cnts[] = { clt_cnt, srv_cnt };
+		struct table_column **cs[] = { ctx->clms_hosts,
+					       ctx->clms_hosts };
+
+		err = list_groups(rows, cnts, cs, &hosts_sides, is_dump,
+				  ctx);
+		if (err <= 0)
+			goto out;
+		err = 0;
+	}
 
 	switch (ctx->fmt) {
 	case FMT_CSV:
-		if (clt_p_num && srv_p_num)
-			printf("Outgoing paths:\n");
+		if (clt_cnt && srv_cnt)
+			printf("Outgoing hosts:\n");
 
-		if (clt_p_num)
-			list_paths_csv(p_clt, ctx->clms_paths_clt, ctx);
+		if (clt_cnt)
+			list_hosts_csv(h_clt, ctx->clms_hosts, ctx);
 
-		if (clt_p_num && srv_p_num)
-			printf("Incoming paths:\n");
+		if (clt_cnt && srv_cnt)
+			printf("Incoming hosts:\n");
 
-		if (srv_p_num)
-			list_paths_csv(p_srv, ctx->clms_paths_srv, ctx);
+		if (srv_cnt)
+			list_hosts_csv(h_srv, ctx->clms_hosts, ctx);
 		break;
 	case FMT_JSON:
 		if (!is_dump)
 			printf("{\n");
 
-		printf("\t\"outgoing paths\": ");
-		if (clt_p_num)
-			list_paths_json(p_clt, ctx->clms_paths_clt, ctx);
+		printf("\t\"outgoing hosts\": ");
+		if (clt_cnt)
+			list_hosts_json(h_clt, ctx->clms_hosts, ctx);
 		else
-			printf("null,\n");
+			printf("null");
+		printf(",\n");
 
-		printf("\t\"incoming paths\": ");
-		if (srv_p_num)
-			list_paths_json(p_srv, ctx->clms_paths_srv, ctx);
+		printf("\t\"incoming hosts\": ");
+		if (srv_cnt)
+			list_hosts_json(h_srv, ctx->clms_hosts, ctx);
 		else
 			printf("null");
 
 		printf("\n}\n");
-
 		break;
 	case FMT_XML:
-		if (clt_p_num) {
-			printf("<outgoing-paths>\n");
-			list_paths_xml(p_clt, ctx->clms_paths_clt, ctx);
-			printf("</outgoing-paths>\n");
+		if (clt_cnt) {
+			printf("<outgoing-hosts>\n");
+			list_hosts_xml(h_clt, ctx->clms_hosts, ctx);
+			printf("</outgoing-hosts>\n");
 		}
-		if (srv_p_num) {
-			printf("<incoming-paths>\n");
-			list_paths_xml(p_srv, ctx->clms_paths_srv, ctx);
-			printf("</incoming-paths>\n");
+		if (srv_cnt) {
+			printf("<incoming-hosts>\n");
+			list_hosts_xml(h_srv, ctx->clms_hosts, ctx);
+			printf("</incoming-hosts>\n");
 		}
-
+		break;
+	case FMT_PROM:
+		list_hosts_prom(h_clt, h_srv, ctx->clms_hosts, ctx);
 		break;
 	case FMT_TERM:
 	default:
-		if ((clt_p_num && srv_p_num && !ctx->noheaders_set)
-		    || (clt_p_num && is_dump))
+		if ((clt_cnt && srv_cnt && !ctx->noheaders_set)
+		    || (clt_cnt && is_dump))
 			printf("%s%s%s\n",
-			       CLR(trm, CDIM, "Outgoing paths"));
+			       CLR(trm, CDIM, "Outgoing hosts"));
 
-		if (clt_p_num)
-			list_paths_term(p_clt, clt_p_num,
-					ctx->clms_paths_clt, 0, ctx,
-					compar_paths_sessname);
+		if (clt_cnt)
+			err = list_hosts_term(h_clt, ctx->clms_hosts, ctx);
 
-		if (clt_p_num && srv_p_num && is_dump)
+		if (clt_cnt && srv_cnt && is_dump)
 			printf("\n");
 
-		if ((clt_p_num && srv_p_num && !ctx->noheaders_set)
-		    || (srv_p_num && is_dump))
+		if ((clt_cnt && srv_cnt && !ctx->noheaders_set)
+		    || (srv_cnt && is_dump))
 			printf("%s%s%s\n",
-			       CLR(trm, CDIM, "Incoming paths"));
+			       CLR(trm, CDIM, "Incoming hosts"));
 
-		if (srv_p_num)
-			list_paths_term(p_srv, srv_p_num,
-					ctx->clms_paths_srv, 0, ctx,
-					compar_paths_sessname);
+		if (srv_cnt && !err)
+			err = list_hosts_term(h_srv, ctx->clms_hosts, ctx);
 		break;
 	}
 
-	return 0;
+out:
+	free(h_clt);
+	free(h_srv);
+
+	return err;
 }
 
-static bool match_device(struct rnbd_sess_dev *d, const char *name)
+/* the devices are ordered by session and mapping path */
+static int sort_sds(struct rnbd_sess_dev **sds, int cnt,
+		    const struct rnbd_ctx *ctx)
 {
-	if (!strcmp(d->mapping_path, name) ||
-	    !strcmp(d->dev->devname, name) ||
-	    !strcmp(d->dev->devpath, name))
-		return true;
+	struct table_query q;
 
-	return false;
+	table_query_init(&q, "sessname,mapping_path", NULL, 0,
+			 all_clms_devices, false, NULL);
+
+	return table_rows_sort((void **)sds, cnt, &q, ctx);
+}
+
+static bool sysfs_read_done;
+static unsigned int sysfs_read_attrs;
+
+static void sysfs_snapshot_free(void)
+{
+	rnbd_sysfs_free_all(sds_clt, sds_srv, sess_clt, sess_srv,
+			     paths_clt, paths_srv);
+	sds_clt = sds_srv = NULL;
+	sess_clt = sess_srv = NULL;
+	paths_clt = paths_srv = NULL;
+	sds_clt_cnt = sds_srv_cnt = 0;
+	sess_clt_cnt = sess_srv_cnt = 0;
+	paths_clt_cnt = paths_srv_cnt = 0;
+	snap_hosts = NULL;
+	snap_host_cnt = 0;
+	sysfs_read_done = false;
+}
+
+/*
+ * Read the devices, sessions and paths from sysfs, but only the
+ * attributes in attrs. The objects themselves are always discovered.
+ * If a snapshot without some of the requested attributes was taken
+ * already it is thrown away and sysfs is read again.
+ */
+static int sysfs_snapshot(const struct rnbd_ctx *ctx, unsigned int attrs)
+{
+	int ret;
+
+	if (sysfs_read_done && (sysfs_read_attrs & attrs) == attrs)
+		return 0;
+
+	attrs |= sysfs_read_attrs;
+	sysfs_snapshot_free();
+
+	ret = rnbd_sysfs_read_all(&sds_clt, &sds_srv,
+				   &sess_clt, &sess_srv,
+				   &paths_clt, &paths_srv,
+				   &sds_clt_cnt, &sds_srv_cnt,
+				   &sess_clt_cnt, &sess_srv_cnt,
+				   &paths_clt_cnt, &paths_srv_cnt,
+				   ctx->jobs, attrs);
+	if (ret) {
+		ERR(trm, "Failed to read sysfs entries: %d\n", ret);
+		return ret;
+	}
+	ret = sort_sds(sds_clt, sds_clt_cnt - 1, ctx) ? :
+	      sort_sds(sds_srv, sds_srv_cnt - 1, ctx);
+	if (ret) {
+		ERR(trm, "not enough memory\n");
+		return ret;
+	}
+
+	if (ctx->debug_set) {
+		struct rnbd_sysfs_mem mem;
+
+		rnbd_sysfs_mem_stats(&mem);
+		INF(ctx->debug_set,
+		    "snapshot: %zu bytes arena (%zu used), %zu strings (%zu bytes), %zu bytes index\n",
+		    mem.arena, mem.used, mem.strs, mem.strs_bytes, mem.index);
+	}
+
+	sysfs_read_done = true;
+	sysfs_read_attrs = attrs;
+
+	return 0;
 }
 
 static int find_devices(const char *name, struct rnbd_sess_dev **devs,
-			struct rnbd_sess_dev **res)
+			struct rnbd_sess_dev **res,
+			const struct rnbd_ctx *ctx)
 {
-	int i, cnt = 0;
+	int cnt;
 
-	for (i = 0; devs[i]; i++)
-		if (match_device(devs[i], name))
-			res[cnt++] = devs[i];
+	if (!devs[0]) {
+		res[0] = NULL;
+		return 0;
+	}
 
-	res[cnt] = NULL;
+	/* all the devices in devs are on the same side */
+	cnt = rnbd_sysfs_lookup_sds(devs[0]->sess->side, name, res);
+	/* they are left unsorted if there is not enough memory */
+	sort_sds(res, cnt, ctx);
 
 	return cnt;
 }
@@ -1111,17 +2289,17 @@ static int find_devices(const char *name, struct rnbd_sess_dev **devs,
 /*
  * Find all rnbd devices by device name, device path or mapping path
  */
-static int find_devs_all(const char *name, enum rnbdmode rnbdmode,
+static int find_devs_all(const char *name, const struct rnbd_ctx *ctx,
 			 struct rnbd_sess_dev **ds_imp,
 			 int *ds_imp_cnt, struct rnbd_sess_dev **ds_exp,
 			 int *ds_exp_cnt)
 {
 	int cnt_imp = 0, cnt_exp = 0;
 
-	if (rnbdmode & RNBD_CLIENT)
-		cnt_imp = find_devices(name, sds_clt, ds_imp);
-	if (rnbdmode & RNBD_SERVER)
-		cnt_exp = find_devices(name, sds_srv, ds_exp);
+	if (ctx->rnbdmode & RNBD_CLIENT)
+		cnt_imp = find_devices(name, sds_clt, ds_imp, ctx);
+	if (ctx->rnbdmode & RNBD_SERVER)
+		cnt_exp = find_devices(name, sds_srv, ds_exp, ctx);
 
 	*ds_imp_cnt = cnt_imp;
 	*ds_exp_cnt = cnt_exp;
@@ -1155,6 +2333,9 @@ static int show_device(struct rnbd_sess_dev **clt, struct rnbd_sess_dev **srv,
 	case FMT_XML:
 		list_devices_xml(ds, cs, ctx);
 		break;
+	case FMT_PROM:
+		list_devices_prom(ds, cs, NULL, NULL, ctx);
+		break;
 	case FMT_TERM:
 	default:
 		table_row_stringify(ds[0], flds, cs, ctx, true, 0);
@@ -1169,13 +2350,11 @@ static int show_device(struct rnbd_sess_dev **clt, struct rnbd_sess_dev **srv,
 static struct rnbd_sess *find_sess(const char *name,
 				   struct rnbd_sess **ss)
 {
-	int i;
-
-	for (i = 0; ss[i]; i++)
-		if (!strcmp(name, ss[i]->sessname))
-			return ss[i];
+	if (!ss[0])
+		return NULL;
 
-	return NULL;
+	/* all the sessions in ss are on the same side */
+	return rnbd_sysfs_lookup_sess(ss[0]->side, name);
 }
 
 static int find_sess_match(const char *name, enum rnbdmode rnbdmode,
@@ -1301,6 +2480,29 @@ static int find_paths(const char *session_name, const char *path_name,
 		      struct rnbd_path **pp, struct rnbd_path **res)
 {
 	int i, port, cnt = 0;
+	struct rnbd_sess *sess;
+	struct rnbd_path *path;
+
+	if (pp[0] && session_name) {
+		/* the exact name of a path is unique within its session */
+		if (path_name && !ctx->port_desc_set) {
+			path = rnbd_sysfs_lookup_path(pp[0]->sess->side,
+						      session_name, path_name);
+			if (path) {
+				res[0] = path;
+				res[1] = NULL;
+				return 1;
+			}
+		}
+		/* only the paths of the session can match */
+		sess = rnbd_sysfs_lookup_sess(pp[0]->sess->side,
+					      session_name);
+		if (!sess || !sess->paths) {
+			res[0] = NULL;
+			return 0;
+		}
+		pp = sess->paths;
+	}
 
 	for (i = 0; pp[i]; i++) {
 		if (session_name && path_name && ctx->port_desc_set) {
@@ -1410,6 +2612,74 @@ static void list_default(struct rnbd_ctx *ctx)
 	       ARRSIZE(def_clms_paths_clt) * sizeof(all_clms_paths[0]));
 	memcpy(&(ctx->clms_paths_srv), &def_clms_paths_srv,
 	       ARRSIZE(def_clms_paths_srv) * sizeof(all_clms_paths[0]));
+
+	memcpy(&(ctx->clms_hcas), &def_clms_hcas,
+	       ARRSIZE(def_clms_hcas) * sizeof(all_clms_hcas[0]));
+	memcpy(&(ctx->clms_hosts), &def_clms_hosts,
+	       ARRSIZE(def_clms_hosts) * sizeof(all_clms_hosts[0]));
+}
+
+#define CPU_MIGR_PER_LINE	16
+
+static unsigned long cpu_migr_cnt(const unsigned long *cnts, int cnt, int cpu)
+{
+	return cpu < cnt ? cnts[cpu] : 0;
+}
+
+static void show_cpu_migr_line(const char *hdr, int hdr_width,
+			       const int *cpus, const int *width, int n,
+			       const unsigned long *cnts, int cnt)
+{
+	int i;
+
+	printf("%-*s" CLM_DLM, hdr_width, hdr);
+	for (i = 0; i < n; i++)
+		printf("%s%*lu", i ? " " : "", width[i],
+		       cpu_migr_cnt(cnts, cnt, cpus[i]));
+	printf("\n");
+}
+
+/*
+ * Table of the requests migrated from and to every CPU below the
+ * fields of a path. CPUs without migrations are left out.
+ */
+static void show_cpu_migr(const struct rnbd_cpu_migr *m, int hdr_width)
+{
+	int cpus[CPU_MIGR_PER_LINE], width[CPU_MIGR_PER_LINE];
+	int cpu, cpu_cnt, i, n = 0;
+	unsigned long from, to;
+	char str[32];
+
+	cpu_cnt = m->from_cnt > m->to_cnt ? m->from_cnt : m->to_cnt;
+	for (cpu = 0; cpu < cpu_cnt; cpu++) {
+		from = cpu_migr_cnt(m->from, m->from_cnt, cpu);
+		to = cpu_migr_cnt(m->to, m->to_cnt, cpu);
+		if (from || to) {
+			cpus[n] = cpu;
+			width[n] = snprintf(str, sizeof(str), "CPU%d", cpu);
+			i = snprintf(str, sizeof(str), "%lu",
+				     from > to ? from : to);
+			if (i > width[n])
+				width[n] = i;
+			n++;
+		}
+		if (n < CPU_MIGR_PER_LINE && cpu < cpu_cnt - 1)
+			continue;
+		if (!n)
+			break;
+
+		printf("%-*s" CLM_DLM, hdr_width, "");
+		for (i = 0; i < n; i++) {
+			snprintf(str, sizeof(str), "CPU%d", cpus[i]);
+			printf("%s%*s", i ? " " : "", width[i], str);
+		}
+		printf("\n");
+		show_cpu_migr_line("Migr from", hdr_width, cpus, width, n,
+				   m->from, m->from_cnt);
+		show_cpu_migr_line("Migr to", hdr_width, cpus, width, n,
+				   m->to, m->to_cnt);
+		n = 0;
+	}
 }
 
 static int show_path(struct rnbd_path **pp_clt, struct rnbd_path **pp_srv,
@@ -1438,11 +2708,17 @@ static int show_path(struct rnbd_path **pp_clt, struct rnbd_path **pp_srv,
 	case FMT_XML:
 		list_paths_xml(pp, cs, ctx);
 		break;
+	case FMT_PROM:
+		list_paths_prom(pp, cs, NULL, NULL, ctx);
+		break;
 	case FMT_TERM:
 	default:
 		table_row_stringify(pp[0], flds, cs, ctx, true, 0);
 		table_entry_print_term("", flds, cs,
 				       table_get_max_h_width(cs), trm);
+		if (table_find_column("cpu_migr", cs))
+			show_cpu_migr(&pp[0]->migr,
+				      table_get_max_h_width(cs));
 		break;
 	}
 
@@ -1454,6 +2730,7 @@ static int show_session(struct rnbd_sess **ss_clt, struct rnbd_sess **ss_srv,
 {
 	struct table_fld flds[CLM_MAX_CNT];
 	struct table_column **cs, **ps;
+	struct table_query paths_q;
 	struct rnbd_sess **ss;
 
 	if (ss_clt && ss_clt[0]) {
@@ -1477,6 +2754,9 @@ static int show_session(struct rnbd_sess **ss_clt, struct rnbd_sess **ss_srv,
 	case FMT_XML:
 		list_sessions_xml(ss, cs, ctx);
 		break;
+	case FMT_PROM:
+		list_sessions_prom(ss, cs, NULL, NULL, ctx);
+		break;
 	case FMT_TERM:
 	default:
 		table_row_stringify(ss[0], flds, cs, ctx, true, 0);
@@ -1494,8 +2774,9 @@ static int show_session(struct rnbd_sess **ss_clt, struct rnbd_sess **ss_srv,
 			printf(" %s(%s)%s",
 			       CLR(trm, CBLD, ss[0]->mp_short));
 		printf("\n");
-		list_paths_term(ss[0]->paths, ss[0]->path_cnt, ps, 1, ctx,
-				compar_paths_hca_src);
+		paths_tree_query(&paths_q);
+		return list_paths_term(ss[0]->paths, ss[0]->path_cnt, ps, 1,
+				       &paths_q, ctx);
 
 		break;
 	}
@@ -1546,7 +2827,7 @@ static int show_all(const char *name, struct rnbd_ctx *ctx)
 		c_ss = find_sess_match_all(name, ctx->rnbdmode, ss_clt,
 					   &c_ss_clt, ss_srv, &c_ss_srv);
 	if (!(c_pp && ctx->path_cnt == 1))
-		c_ds = find_devs_all(name, ctx->rnbdmode, ds_clt,
+		c_ds = find_devs_all(name, ctx, ds_clt,
 				     &c_ds_clt, ds_srv, &c_ds_srv);
 	if ((ctx->path_cnt == 1 && c_pp > 1)
 	    || (ctx->path_cnt != 1 && c_pp + c_ss + c_ds > 1)) {
@@ -1596,6 +2877,106 @@ out:
 	return ret;
 }
 
+/*
+ * Print a host with its sessions
+ */
+static int show_host(struct rnbd_host *h, struct rnbd_ctx *ctx)
+{
+	struct table_column **hc = ctx->clms_hosts, **cs;
+	struct table_query sess_q, paths_q;
+	struct table_fld flds[CLM_MAX_CNT];
+	struct rnbd_sess **ss, **all;
+	int i, cnt = 0, err;
+
+	table_row_stringify(h, flds, hc, ctx, true, 0);
+	table_entry_print_term("", flds, hc, table_get_max_h_width(hc), trm);
+
+	if (ctx->notree_set || table_clm_cnt(hc) == 1)
+		return 0;
+
+	if (h->side == RNBD_CLIENT) {
+		all = sess_clt;
+		cs = ctx->clms_sessions_clt;
+		ss = calloc(sess_clt_cnt, sizeof(*ss));
+	} else {
+		all = sess_srv;
+		cs = ctx->clms_sessions_srv;
+		ss = calloc(sess_srv_cnt, sizeof(*ss));
+	}
+	if (!ss) {
+		ERR(trm, "Failed to alloc memory\n");
+		return -ENOMEM;
+	}
+	for (i = 0; all[i]; i++)
+		if (rnbd_sess_host(all[i]) == h->hostname)
+			ss[cnt++] = all[i];
+
+	table_query_init(&sess_q, "sessname", NULL, 0, all_clms_sessions,
+			 false, NULL);
+	err = table_rows_sort((void **)ss, cnt, &sess_q, ctx);
+	if (!err) {
+		printf("%s%s%s\n", CLR(trm, CBLD, h->hostname));
+		paths_tree_query(&paths_q);
+		err = list_sessions_term(ss, cs, &paths_q, ctx);
+	}
+	free(ss);
+
+	return err;
+}
+
+static int show_hosts(const char *name, struct rnbd_ctx *ctx)
+{
+	struct rnbd_host **hh, **found;
+	int i, cnt, found_cnt = 0, ret = 0;
+
+	cnt = hosts(&hh, ctx);
+	if (cnt < 0)
+		return cnt;
+
+	found = calloc(cnt + 1, sizeof(*found));
+	if (!found) {
+		ERR(trm, "Failed to alloc memory\n");
+		return -ENOMEM;
+	}
+	for (i = 0; i < cnt; i++)
+		if (!strcmp(hh[i]->hostname, name))
+			found[found_cnt++] = hh[i];
+
+	if (!found_cnt) {
+		ERR(trm, "There is no host matching '%s'\n", name);
+		ret = -ENOENT;
+		goto out;
+	}
+
+	/* a host may be both client and server of sessions */
+	switch (ctx->fmt) {
+	case FMT_CSV:
+		list_hosts_csv(found, ctx->clms_hosts, ctx);
+		break;
+	case FMT_JSON:
+		list_hosts_json(found, ctx->clms_hosts, ctx);
+		printf("\n");
+		break;
+	case FMT_XML:
+		list_hosts_xml(found, ctx->clms_hosts, ctx);
+		break;
+	case FMT_PROM:
+		list_hosts_prom(found, NULL, ctx->clms_hosts, ctx);
+		break;
+	case FMT_TERM:
+	default:
+		for (i = 0; i < found_cnt && !ret; i++) {
+			if (i)
+				printf("\n");
+			ret = show_host(found[i], ctx);
+		}
+		break;
+	}
+out:
+	free(found);
+	return ret;
+}
+
 static int show_devices(const char *name, struct rnbd_ctx *ctx)
 {
 	struct rnbd_sess_dev **ds_clt, **ds_srv;
@@ -1610,7 +2991,7 @@ static int show_devices(const char *name, struct rnbd_ctx *ctx)
 		ret = -ENOMEM;
 		goto out;
 	}
-	c_ds = find_devs_all(name, ctx->rnbdmode, ds_clt,
+	c_ds = find_devs_all(name, ctx, ds_clt,
 			     &c_ds_clt, ds_srv, &c_ds_srv);
 	if (c_ds > 1) {
 		ERR(trm, "Multiple devices match '%s'\n", name);
@@ -1904,7 +3285,7 @@ static void help_show(const char *program_name,
 		printf("%sProvide 'all' to print all available fields\n\n",
 		       HPRE);
 
-	print_opt("{format}", "Output format: csv|json|xml");
+	print_opt("{format}", "Output format: csv|json|xml|prom");
 	print_opt("{unit}", "Units to use for size (in binary): B|K|M|G|T|P|E");
 
 	print_opt("help", "Display help and exit. [fields|all]");
@@ -1935,7 +3316,7 @@ static void help_show_devices(const char *program_name,
 		     all_clms_devices_srv,
 		     all_clms_devices, ctx->rnbdmode);
 
-	print_opt("{format}", "Output format: csv|json|xml");
+	print_opt("{format}", "Output format: csv|json|xml|prom");
 	print_opt("{unit}", "Units to use for size (in binary): B|K|M|G|T|P|E");
 
 	print_opt("help", "Display help and exit. [fields|all]");
@@ -1970,8 +3351,41 @@ static void help_show_sessions(const char *program_name,
 		printf("%sProvide 'all' to print all available fields\n\n",
 		       HPRE);
 
-	print_opt("{format}", "Output format: csv|json|xml");
+	print_opt("{format}", "Output format: csv|json|xml|prom");
+	print_opt("{unit}", "Units to use for size (in binary): B|K|M|G|T|P|E");
+
+	print_opt("help", "Display help and exit. [fields|all]");
+}
+
+static void help_show_hosts(const char *program_name,
+			    const struct param *cmd,
+			    const struct rnbd_ctx *ctx)
+{
+	if (!program_name)
+		program_name = "hosts";
+
+	cmd_print_usage_descr(cmd, program_name, ctx);
+
+	printf("\nArguments:\n");
+	print_opt("<host>",
+		  "Hostname of the counterpart of the sessions.");
+
+	printf("\nOptions:\n");
+
+	help_fields();
+
+	table_tbl_print_term(HPRE, all_clms_hosts, trm, ctx);
+	printf("\n%sDefault: ", HPRE);
+	print_clms_list(def_clms_hosts);
+	printf("\n");
+
+	if (!ctx->help_set)
+		printf("%sProvide 'all' to print all available fields\n\n",
+		       HPRE);
+
+	print_opt("{format}", "Output format: csv|json|xml|prom");
 	print_opt("{unit}", "Units to use for size (in binary): B|K|M|G|T|P|E");
+	print_param_descr("notree");
 
 	print_opt("help", "Display help and exit. [fields|all]");
 }
@@ -2020,7 +3434,7 @@ static void help_show_paths(const char *program_name,
 		printf("%sProvide 'all' to print all available fields\n\n",
 		       HPRE);
 
-	print_opt("{format}", "Output format: csv|json|xml");
+	print_opt("{format}", "Output format: csv|json|xml|prom");
 	print_opt("{unit}", "Units to use for size (in binary): B|K|M|G|T|P|E");
 
 	print_opt("help", "Display help and exit. [fields|all]");
@@ -2340,7 +3754,7 @@ static struct rnbd_sess_dev *find_single_device(const char *name,
 		return NULL;
 	}
 
-	match_count = find_devices(name, devs, matching_devs);
+	match_count = find_devices(name, devs, matching_devs, ctx);
 	if (match_count == 1) {
 
 		res = matching_devs[0];
@@ -2352,31 +3766,68 @@ static struct rnbd_sess_dev *find_single_device(const char *name,
 		    name);
 	}
 
-	free(matching_devs);
-	return res;
+	free(matching_devs);
+	return res;
+}
+
+/*
+ * Find the client device @name refers to. The kernel name or the path
+ * under /dev/ of a device is checked directly in sysfs, as long as no
+ * other device has @name as its mapping path. A mapping path or an
+ * ambiguous name requires to scan all the devices. For a device found
+ * directly only the name is filled in into @dev, it points into @name.
+ */
+static const struct rnbd_dev *find_single_client_dev(const char *name,
+						     struct rnbd_ctx *ctx,
+						     struct rnbd_dev *dev)
+{
+	const struct rnbd_sess_dev *ds;
+	const char *devname = name;
+
+	if (!sysfs_read_done) {
+		if (!strncmp(devname, "/dev/", 5))
+			devname += 5;
+
+		if (rnbd_sysfs_clt_dev_exists(devname) &&
+		    !rnbd_sysfs_clt_mapping_cnt(name, devname)) {
+			memset(dev, 0, sizeof(*dev));
+			dev->devname = devname;
+			dev->devpath = dev->state = "";
+			return dev;
+		}
+		INF(ctx->debug_set,
+		    "'%s' is not a unique device, scanning all devices.\n",
+		    name);
+		if (sysfs_snapshot(ctx, 0))
+			return NULL;
+	}
+	ds = find_single_device(name, ctx, sds_clt, sds_clt_cnt, true/*print_err*/);
+
+	return ds ? ds->dev : NULL;
 }
 
 static int client_devices_resize(const char *device_name, uint64_t size_sect,
 				 struct rnbd_ctx *ctx)
 {
-	const struct rnbd_sess_dev *ds;
+	const struct rnbd_dev *dev;
+	struct rnbd_dev tmp_dev;
 	char tmp[PATH_MAX];
 	int ret;
 
-	ds = find_single_device(device_name, ctx, sds_clt, sds_clt_cnt, true/*print_err*/);
-	if (!ds)
+	dev = find_single_client_dev(device_name, ctx, &tmp_dev);
+	if (!dev)
 		return -EINVAL;
 
-	sprintf(tmp, "/sys/block/%s/%s", ds->dev->devname,
+	sprintf(tmp, "/sys/block/%s/%s", dev->devname,
 		get_sysfs_info(ctx)->path_dev_name);
 	ret = printf_sysfs(tmp, "resize", ctx, "%" PRIu64, size_sect);
 	if (ret)
 		ERR(trm, "Failed to resize %s to %" PRIu64 ": %s (%d)\n",
-		    ds->dev->devname, size_sect, strerror(-ret), ret);
+		    dev->devname, size_sect, strerror(-ret), ret);
 	else
 		INF(ctx->verbose_set,
 		    "Device '%s' resized sucessfully to %" PRIu64 " sectors.\n",
-		    ds->dev->devname, size_sect);
+		    dev->devname, size_sect);
 
 	return ret;
 }
@@ -2418,13 +3869,13 @@ static void help_unmap(const char *program_name,
 	print_param_descr("help");
 }
 
-static int _client_devices_unmap(const struct rnbd_sess_dev *ds, bool force,
+static int _client_devices_unmap(const struct rnbd_dev *dev, bool force,
 				struct rnbd_ctx *ctx)
 {
 	char tmp[PATH_MAX];
 	int ret;
 
-	sprintf(tmp, "/sys/block/%s/%s", ds->dev->devname,
+	sprintf(tmp, "/sys/block/%s/%s", dev->devname,
 		get_sysfs_info(ctx)->path_dev_name);
 
 	ret = printf_sysfs(tmp, "unmap_device", ctx, "%s",
@@ -2432,10 +3883,10 @@ static int _client_devices_unmap(const struct rnbd_sess_dev *ds, bool force,
 	if (ret)
 		ERR(trm, "Failed to %sunmap '%s': %s (%d)\n",
 		    force ? "force-" : "",
-		    ds->dev->devname, strerror(-ret), ret);
+		    dev->devname, strerror(-ret), ret);
 	else
 		INF(ctx->verbose_set, "Device '%s' sucessfully unmapped.\n",
-		    ds->dev->devname);
+		    dev->devname);
 
 	return ret;
 }
@@ -2443,13 +3894,14 @@ static int _client_devices_unmap(const struct rnbd_sess_dev *ds, bool force,
 static int client_devices_unmap(const char *device_name, bool force,
 				struct rnbd_ctx *ctx)
 {
-	const struct rnbd_sess_dev *ds;
+	const struct rnbd_dev *dev;
+	struct rnbd_dev tmp_dev;
 
-	ds = find_single_device(device_name, ctx, sds_clt, sds_clt_cnt, true/*print_err*/);
-	if (!ds)
+	dev = find_single_client_dev(device_name, ctx, &tmp_dev);
+	if (!dev)
 		return -EINVAL;
 
-	return _client_devices_unmap(ds, force, ctx);
+	return _client_devices_unmap(dev, force, ctx);
 }
 
 static int client_device_remap(const struct rnbd_dev *dev,
@@ -2480,13 +3932,14 @@ static int client_device_remap(const struct rnbd_dev *dev,
 
 static int client_devices_remap(const char *device_name, struct rnbd_ctx *ctx)
 {
-	const struct rnbd_sess_dev *ds;
+	const struct rnbd_dev *dev;
+	struct rnbd_dev tmp_dev;
 
-	ds = find_single_device(device_name, ctx, sds_clt, sds_clt_cnt, true/*print_err*/);
-	if (!ds)
+	dev = find_single_client_dev(device_name, ctx, &tmp_dev);
+	if (!dev)
 		return -EINVAL;
 
-	return client_device_remap(ds->dev, ctx);
+	return client_device_remap(dev, ctx);
 }
 
 static int client_session_remap(const char *session_name,
@@ -2501,6 +3954,10 @@ static int client_session_remap(const char *session_name,
 	if (!ctx->sysfs_avail)
 		ERR(trm, "Not possible to remap devices: modules not loaded.\n");
 
+	err = sysfs_snapshot(ctx, RNBD_ATTR_ALL);
+	if (err)
+		return err;
+
 	if (!sds_clt_cnt) {
 		ERR(trm,
 		    "No devices mapped. Nothing to be done!\n");
@@ -2526,7 +3983,7 @@ static int client_session_remap(const char *session_name,
 	for (sds_iter = sds_clt; *sds_iter; sds_iter++) {
 
 		if ((*sds_iter)->sess == sess) {
-			tmp_err = _client_devices_unmap((*sds_iter), 0, ctx);
+			tmp_err = _client_devices_unmap((*sds_iter)->dev, 0, ctx);
 			/*  intentional continue on error */
 			if (tmp_err)
 				ERR(trm, "Failed to unmap device: %s, %s (%d)\n",
@@ -2578,6 +4035,10 @@ static int session_do_all_paths(enum rnbdmode mode,
 	struct rnbd_path *const *paths_iter;
 	const struct rnbd_sess *sess;
 
+	err = sysfs_snapshot(ctx, RNBD_ATTR_ALL);
+	if (err)
+		return err;
+
 	if (!(mode == RNBD_CLIENT ?
 	      sess_clt_cnt
 	      : sess_srv_cnt)) {
@@ -2758,6 +4219,35 @@ static void help_recover_session(const char *program_name,
 	print_opt("", "rnbd recover ps402a-905@st401a-8");
 }
 
+static void help_analyze_session(const char *program_name,
+				 const struct param *cmd,
+				 const struct rnbd_ctx *ctx)
+{
+	if (!program_name)
+		program_name = "<session>|all ";
+
+	cmd_print_usage_descr(cmd, program_name, ctx);
+
+	printf("\nArguments:\n");
+	print_opt("<session>|all", "Name or identifier of a session.");
+	print_opt("", "All analyzes all sessions.");
+
+	printf("\nOptions:\n");
+	print_opt("interval", "Sample over <seconds> (default: 1)");
+	print_opt("apply", "Set the recommended multipath policy");
+	print_opt("{format}", "Output format: json");
+	print_param_descr("verbose");
+	print_param_descr("help");
+
+	printf("\nFlags:\n");
+	print_opt("down", "Path is not connected");
+	print_opt("low-share", "Path carries less than half of its fair share");
+	print_opt("same-port", "Path shares its HCA port with another path");
+
+	printf("\nExample:\n");
+	print_opt("", "rnbd session analyze all interval 5 apply");
+}
+
 static void help_recover_path(const char *program_name,
 			      const struct param *cmd,
 			      const struct rnbd_ctx *ctx)
@@ -2934,27 +4424,46 @@ static int client_path_do(const char *session_name,
 			  const char *message_success,
 			  const char *message_fail, struct rnbd_ctx *ctx)
 {
-	char sysfs_path[4096];
+	char sysfs_path[4096], found_sess[NAME_MAX + 1];
+	const char *sessname, *pathname;
 	struct rnbd_path *path;
 	int ret;
 
-	path = find_single_path(session_name, path_name,
-				ctx, paths_clt, paths_clt_cnt, true);
+	/*
+	 * A path given by its exact name in a single session is written to
+	 * directly, everything else is matched against all the paths.
+	 */
+	if (!sysfs_read_done && path_name && !ctx->port_desc_set &&
+	    rnbd_sysfs_find_path(RNBD_CLIENT, session_name, path_name,
+				 found_sess) == 1) {
+		sessname = found_sess;
+		pathname = path_name;
+	} else {
+		ret = sysfs_snapshot(ctx, RNBD_ATTR_ALL);
+		if (ret)
+			return ret;
+
+		path = find_single_path(session_name, path_name,
+					ctx, paths_clt, paths_clt_cnt, true);
 
-	if (!path)
-		return -EINVAL;
+		if (!path)
+			return -EINVAL;
+
+		sessname = path->sess->sessname;
+		pathname = path->pathname;
+	}
 
 	snprintf(sysfs_path, sizeof(sysfs_path), "%s%s/paths/%s",
 		 get_sysfs_info(ctx)->path_sess_clt,
-		 path->sess->sessname, path->pathname);
+		 sessname, pathname);
 
 	ret = printf_sysfs(sysfs_path, sysfs_entry, ctx, "1");
 	if (ret)
-		ERR(trm, message_fail, path->pathname,
-		    path->sess->sessname, strerror(-ret), ret);
+		ERR(trm, message_fail, pathname,
+		    sessname, strerror(-ret), ret);
 	else
 		INF(ctx->verbose_set, message_success,
-		    path->pathname, path->sess->sessname);
+		    pathname, sessname);
 	return ret;
 }
 
@@ -3089,6 +4598,10 @@ static int server_path_disconnect(const char *session_name,
 	struct rnbd_path *path;
 	int ret;
 
+	ret = sysfs_snapshot(ctx, RNBD_ATTR_ALL);
+	if (ret)
+		return ret;
+
 	path = find_single_path(session_name, path_name, ctx, paths_srv,
 				paths_srv_cnt, true);
 
@@ -3143,6 +4656,27 @@ static struct param _cmd_dump_all =
 		"",
 		"Dump information about all rnbd objects.",
 		NULL, NULL, help_dump_all};
+static struct param _cmd_top =
+	{TOK_TOP, "top",
+		"Show live rates of all",
+		"",
+		"Show throughput, IOPS and inflights of devices, sessions and paths, refreshed periodically.",
+		"[devices|sessions|paths|hcas|hosts]",
+		NULL, help_top};
+static struct param _cmd_watch =
+	{TOK_WATCH, "watch",
+		"Stream samples of all",
+		"",
+		"Print counters, deltas and rates of devices, sessions and paths as one line of JSON per interval.",
+		"[devices|sessions|paths|hcas|hosts] [fields]",
+		NULL, help_watch};
+static struct param _cmd_serve =
+	{TOK_SERVE, "serve",
+		"Serve metrics of all",
+		"",
+		"Serve the information about all rnbd objects over HTTP in JSON and Prometheus formats.",
+		"listen <addr>",
+		NULL, help_serve};
 static struct param _cmd_list_devices =
 	{TOK_LIST, "list",
 		"List information on all",
@@ -3161,6 +4695,18 @@ static struct param _cmd_list_paths =
 		"s",
 		"List information on paths.",
 		NULL, NULL, help_list_paths};
+static struct param _cmd_list_hcas =
+	{TOK_LIST, "list",
+		"List information on all",
+		"s",
+		"List the paths and the traffic per HCA port.",
+		NULL, NULL, help_list_hcas};
+static struct param _cmd_list_hosts =
+	{TOK_LIST, "list",
+		"List information on all",
+		"s",
+		"List the sessions, devices and traffic per counterpart host.",
+		NULL, NULL, help_list_hosts};
 static struct param _cmd_show =
 	{TOK_SHOW, "show",
 		"Show information about the object that is designated by <name>",
@@ -3189,6 +4735,13 @@ static struct param _cmd_show_paths =
 		"Show information about an rnbd transport path.",
 		"[session] <path>",
 		NULL, help_show_paths};
+static struct param _cmd_show_hosts =
+	{TOK_SHOW, "show",
+		"Show information about a",
+		"",
+		"Show information about a counterpart host and its sessions.",
+		"<host>",
+		NULL, help_show_hosts};
 static struct param _cmd_map =
 	{TOK_MAP, "map",
 		"Map a",
@@ -3294,6 +4847,13 @@ static struct param _cmd_recover_session =
 		"Recover a session: reconnect disconnected paths.",
 		"<session>|all [add-missing]",
 		 NULL, help_recover_session};
+static struct param _cmd_analyze_session =
+	{TOK_ANALYZE, "analyze",
+		"Analyze the paths of a",
+		"",
+		"Sample the paths of a session, report imbalance and recommend a multipath policy.",
+		"<session>|all [interval <seconds>] [apply]",
+		 NULL, help_analyze_session};
 static struct param _cmd_reconnect_path =
 	{TOK_RECONNECT, "reconnect",
 		"Reconnect a",
@@ -3354,6 +4914,8 @@ static struct param *params_flags[] = {
 	&_params_minus_d,
 	&_params_minus_minus_simulate,
 	&_params_minus_s,
+	&_params_minus_minus_jobs,
+	&_params_minus_j,
 	&_params_minus_c,
 	&_params_minus_minus_complete,
 	&_params_minus_minus_version,
@@ -3365,6 +4927,7 @@ static struct param *params_flags_help[] = {
 	&_params_minus_minus_verbose,
 	&_params_minus_minus_debug,
 	&_params_minus_minus_simulate,
+	&_params_minus_minus_jobs,
 	&_params_null
 };
 
@@ -3407,8 +4970,17 @@ static struct param *params_both[] = {
 	&_params_sess,
 	&_params_paths,
 	&_params_path,
+	&_params_hcas,
+	&_params_hca,
+	&_params_ports,
+	&_params_port,
+	&_params_hosts,
+	&_params_host,
 	&_cmd_list_devices,
 	&_cmd_dump_all,
+	&_cmd_top,
+	&_cmd_watch,
+	&_cmd_serve,
 	&_cmd_show,
 	&_cmd_map,
 	&_cmd_resize,
@@ -3423,6 +4995,8 @@ static struct param *params_both_help[] = {
 	&_params_devices,
 	&_params_sessions,
 	&_params_paths,
+	&_params_hcas,
+	&_params_hosts,
 	&_params_help,
 	&_params_null
 };
@@ -3437,7 +5011,15 @@ static struct param *params_object_type_client[] = {
 	&_params_sess,
 	&_params_paths,
 	&_params_path,
+	&_params_hcas,
+	&_params_hca,
+	&_params_ports,
+	&_params_port,
+	&_params_hosts,
+	&_params_host,
 	&_cmd_dump_all,
+	&_cmd_top,
+	&_cmd_watch,
 	&_cmd_list_devices,
 	&_cmd_show,
 	&_cmd_map,
@@ -3459,8 +5041,16 @@ static struct param *params_object_type_server[] = {
 	&_params_sess,
 	&_params_paths,
 	&_params_path,
+	&_params_hcas,
+	&_params_hca,
+	&_params_ports,
+	&_params_port,
+	&_params_hosts,
+	&_params_host,
 	&_cmd_close_device,
 	&_cmd_dump_all,
+	&_cmd_top,
+	&_cmd_watch,
 	&_cmd_list_devices,
 	&_cmd_show,
 	&_params_help,
@@ -3471,6 +5061,8 @@ static struct param *params_object_type_help_client[] = {
 	&_params_devices_client,
 	&_params_sessions,
 	&_params_paths,
+	&_params_hcas,
+	&_params_hosts,
 	&_params_help,
 	&_params_null
 };
@@ -3479,6 +5071,8 @@ static struct param *params_object_type_help_server[] = {
 	&_params_devices,
 	&_params_sessions,
 	&_params_paths,
+	&_params_hcas,
+	&_params_hosts,
 	&_params_help,
 	&_params_null
 };
@@ -3487,6 +5081,7 @@ static struct param *params_list_parameters[] = {
 	&_params_xml,
 	&_params_cvs,
 	&_params_json,
+	&_params_prom,
 	&_params_term,
 	&_params_byte,
 	&_params_kib,
@@ -3501,6 +5096,10 @@ static struct param *params_list_parameters[] = {
 	&_params_noterm,
 	&_params_all,
 	&_params_verbose,
+	&_params_list_sort,
+	&_params_where,
+	&_params_limit,
+	&_params_group,
 	&_params_help,
 	&_params_null
 };
@@ -3509,10 +5108,66 @@ static struct param *params_fmt_parameters[] = {
 	&_params_xml,
 	&_params_cvs,
 	&_params_json,
+	&_params_prom,
 	&_params_term,
 	&_params_null
 };
 
+static struct param *params_serve_parameters[] = {
+	&_params_listen,
+	&_params_minus_minus_listen,
+	&_params_ttl,
+	&_params_help,
+	&_params_null
+};
+
+static struct param *params_top_parameters[] = {
+	&_params_devices,
+	&_params_device,
+	&_params_devs,
+	&_params_dev,
+	&_params_sessions,
+	&_params_session,
+	&_params_sess,
+	&_params_paths,
+	&_params_path,
+	&_params_hcas,
+	&_params_hca,
+	&_params_ports,
+	&_params_port,
+	&_params_hosts,
+	&_params_host,
+	&_params_interval,
+	&_params_count,
+	&_params_sort,
+	&_params_limit,
+	&_params_noheaders,
+	&_params_help,
+	&_params_null
+};
+
+static struct param *params_watch_parameters[] = {
+	&_params_devices,
+	&_params_device,
+	&_params_devs,
+	&_params_dev,
+	&_params_sessions,
+	&_params_session,
+	&_params_sess,
+	&_params_paths,
+	&_params_path,
+	&_params_hcas,
+	&_params_hca,
+	&_params_ports,
+	&_params_port,
+	&_params_hosts,
+	&_params_host,
+	&_params_interval,
+	&_params_count,
+	&_params_help,
+	&_params_null
+};
+
 static struct param *params_map_parameters[] = {
 	&_params_from,
 	&_params_ro,
@@ -3569,6 +5224,18 @@ static struct param *params_recover_session_parameters_help[] = {
 	&_params_null
 };
 
+static struct param *params_analyze_session_parameters[] = {
+	&_params_interval,
+	&_params_apply,
+	&_params_minus_minus_apply,
+	&_params_json,
+	&_params_term,
+	&_params_help,
+	&_params_verbose,
+	&_params_minus_v,
+	&_params_null
+};
+
 static struct param *params_add_path_help[] = {
 	&_params_help,
 	&_params_path_param,
@@ -3581,6 +5248,7 @@ static struct param *cmds_client_sessions[] = {
 	&_cmd_show_sessions,
 	&_cmd_reconnect_session,
 	&_cmd_recover_session,
+	&_cmd_analyze_session,
 	&_cmd_remap_session,
 	&_cmd_help,
 	&_cmd_null
@@ -3591,6 +5259,7 @@ static struct param *cmds_client_sessions_help[] = {
 	&_cmd_show_sessions,
 	&_cmd_reconnect_session,
 	&_cmd_recover_session,
+	&_cmd_analyze_session,
 	&_cmd_remap_session,
 	&_cmd_help,
 	&_cmd_null
@@ -3686,6 +5355,7 @@ static struct param *cmds_both_sessions[] = {
 	&_cmd_dis_session,
 	&_cmd_reconnect_session,
 	&_cmd_recover_session,
+	&_cmd_analyze_session,
 	&_cmd_help,
 	&_cmd_null
 };
@@ -3695,6 +5365,7 @@ static struct param *cmds_both_sessions_help[] = {
 	&_cmd_show_sessions,
 	&_cmd_remap_session,
 	&_cmd_recover_session,
+	&_cmd_analyze_session,
 	&_cmd_help,
 	&_cmd_null
 };
@@ -3723,6 +5394,19 @@ static struct param *cmds_both_paths_help[] = {
 	&_cmd_null
 };
 
+static struct param *cmds_hcas[] = {
+	&_cmd_list_hcas,
+	&_cmd_help,
+	&_cmd_null
+};
+
+static struct param *cmds_hosts[] = {
+	&_cmd_list_hosts,
+	&_cmd_show_hosts,
+	&_cmd_help,
+	&_cmd_null
+};
+
 static int levenstein_compare(int d1, int d2, const char *s1, const char *s2)
 {
 	return d1 != d2 ? d1 - d2 : strcmp(s1, s2);
@@ -3862,6 +5546,18 @@ static int parse_both_paths_clms(const char *arg, struct rnbd_ctx *ctx)
 	return err;
 }
 
+static int parse_hcas_clms(const char *arg, struct rnbd_ctx *ctx)
+{
+	return table_extend_columns(arg, comma, all_clms_hcas,
+				    ctx->clms_hcas, CLM_MAX_CNT);
+}
+
+static int parse_hosts_clms(const char *arg, struct rnbd_ctx *ctx)
+{
+	return table_extend_columns(arg, comma, all_clms_hosts,
+				    ctx->clms_hosts, CLM_MAX_CNT);
+}
+
 static int parse_clt_clms(const char *arg, struct rnbd_ctx *ctx)
 {
 	int tmp_err, err;
@@ -3988,9 +5684,9 @@ static void rnbd_ctx_default(struct rnbd_ctx *ctx)
 		ctx->prec = 3;
 
 	if (!ctx->rnbdmode_set) {
-		if (sess_clt[0])
+		if (rnbd_sysfs_has_sessions(RNBD_CLIENT))
 			ctx->rnbdmode |= RNBD_CLIENT;
-		if (sess_srv[0])
+		if (rnbd_sysfs_has_sessions(RNBD_SERVER))
 			ctx->rnbdmode |= RNBD_SERVER;
 	}
 }
@@ -4043,6 +5739,160 @@ static int init_show(enum rnbdmode rnbdmode,
 	return 0;
 }
 
+static unsigned int clms_deps(struct table_column *const *cs)
+{
+	unsigned int deps = 0;
+
+	for (; *cs; cs++)
+		deps |= (*cs)->m_deps;
+
+	return deps;
+}
+
+/* the attributes the field @name needs in any of the objects */
+static unsigned int clm_name_deps(const char *name)
+{
+	struct table_column **all[] = {
+		all_clms_devices, all_clms_sessions, all_clms_paths,
+		all_clms_hcas, all_clms_hosts
+	};
+	struct table_column *c;
+	unsigned int attrs = 0;
+	int i;
+
+	for (i = 0; i < ARRSIZE(all); i++) {
+		c = table_find_column(name, all[i]);
+		if (c)
+			attrs |= c->m_deps;
+	}
+
+	return attrs;
+}
+
+/* the attributes of the fields to sort, filter and group by */
+static unsigned int query_deps(const struct rnbd_ctx *ctx)
+{
+	const char *sort = ctx->sort_set ? ctx->sort : "";
+	unsigned int attrs = 0;
+	char name[NAME_MAX];
+	const char *val;
+	enum table_op op;
+	size_t n;
+	int i;
+
+	while (*sort) {
+		if (*sort == '-' || *sort == '+')
+			sort++;
+		n = strcspn(sort, ",");
+		snprintf(name, sizeof(name), "%.*s", (int)n, sort);
+		attrs |= clm_name_deps(name);
+		sort += n;
+		if (*sort)
+			sort++;
+	}
+
+	for (i = 0; i < ctx->where_cnt; i += 2)
+		if (!table_cond_split(ctx->where[i], name, sizeof(name),
+				      &op, &val))
+			attrs |= clm_name_deps(name);
+
+	if (ctx->group_set)
+		attrs |= clm_name_deps(ctx->group);
+
+	return attrs;
+}
+
+/*
+ * Only the attributes shown by a list command are read from sysfs.
+ * Which column sets are in use follows from the column parser of the
+ * command. The session tree additionaly needs the short path
+ * description and the fields the paths are sorted by, the fields to
+ * sort, filter and group by are read too.
+ */
+static int sysfs_snapshot_for_list(const struct param *cmd,
+		int (*parse_clms)(const char *arg, struct rnbd_ctx *ctx),
+		const struct rnbd_ctx *ctx)
+{
+	bool clt = parse_clms == parse_clt_clms || parse_clms == parse_both_clms;
+	bool srv = parse_clms == parse_srv_clms || parse_clms == parse_both_clms;
+	unsigned int attrs = 0;
+
+	if (cmd->tok == TOK_SHOW)
+		return sysfs_snapshot(ctx, RNBD_ATTR_ALL);
+
+	attrs |= query_deps(ctx);
+
+	if (clt || parse_clms == parse_clt_devices_clms ||
+	    parse_clms == parse_both_devices_clms)
+		attrs |= clms_deps(ctx->clms_devices_clt);
+	if (srv || parse_clms == parse_srv_devices_clms ||
+	    parse_clms == parse_both_devices_clms)
+		attrs |= clms_deps(ctx->clms_devices_srv);
+	if (clt || parse_clms == parse_clt_sessions_clms ||
+	    parse_clms == parse_both_sessions_clms)
+		attrs |= clms_deps(ctx->clms_sessions_clt);
+	if (srv || parse_clms == parse_srv_sessions_clms ||
+	    parse_clms == parse_both_sessions_clms)
+		attrs |= clms_deps(ctx->clms_sessions_srv);
+	if (clt || parse_clms == parse_clt_paths_clms ||
+	    parse_clms == parse_both_paths_clms)
+		attrs |= clms_deps(ctx->clms_paths_clt);
+	if (srv || parse_clms == parse_srv_paths_clms ||
+	    parse_clms == parse_both_paths_clms)
+		attrs |= clms_deps(ctx->clms_paths_srv);
+	/* the paths are grouped by their HCA port */
+	if (parse_clms == parse_hcas_clms)
+		attrs |= clms_deps(ctx->clms_hcas) |
+			 RNBD_ATTR_PATH_HCA_NAME | RNBD_ATTR_PATH_HCA_PORT;
+	/* the sessions are grouped by their host, dump lists the hosts too */
+	if (parse_clms == parse_hosts_clms || cmd->tok == TOK_DUMP)
+		attrs |= clms_deps(ctx->clms_hosts) | RNBD_ATTR_SESS_HOSTNAME;
+
+	if (!ctx->notree_set && (clt || srv ||
+				 parse_clms == parse_clt_sessions_clms ||
+				 parse_clms == parse_srv_sessions_clms ||
+				 parse_clms == parse_both_sessions_clms))
+		attrs |= clms_deps(clms_paths_shortdesc) |
+			 RNBD_ATTR_PATH_HCA_NAME | RNBD_ATTR_PATH_SRC_ADDR;
+
+	return sysfs_snapshot(ctx, attrs);
+}
+
+/*
+ * Commands which do not list anything work on the complete snapshot.
+ * Listing commands read sysfs in parse_list_parameters(), once the
+ * columns are known. Commands on a single device or path look their
+ * target up directly and only take a snapshot if that is not possible.
+ */
+static int sysfs_snapshot_for_cmd(enum rnbd_token tok,
+				  const struct rnbd_ctx *ctx)
+{
+	switch (tok) {
+	case TOK_LIST:
+	case TOK_SHOW:
+	case TOK_DUMP:
+	case TOK_TOP:
+	case TOK_WATCH:
+	case TOK_SERVE:
+	case TOK_HELP:
+	case TOK_DEVICES:
+	case TOK_SESSIONS:
+	case TOK_PATHS:
+	case TOK_HCAS:
+	case TOK_HOSTS:
+	case TOK_VERSION:
+	case TOK_RESIZE:
+	case TOK_UNMAP:
+	case TOK_REMAP:
+	case TOK_RECONNECT:
+	case TOK_DISCONNECT:
+	case TOK_DELETE:
+		return 0;
+	default:
+		return sysfs_snapshot(ctx, RNBD_ATTR_ALL);
+	}
+}
+
 /**
  * Parse all the possible parameters to list or show commands.
  * The results are collected in the rnbd_ctx struct
@@ -4067,12 +5917,19 @@ int parse_list_parameters(int argc, const char *argv[], struct rnbd_ctx *ctx,
 	while (argc && err >= 0) {
 		/* parse the list flags */
 		param = find_param(*argv, params_list_parameters);
+		if (!param && !strncasecmp(*argv, "sort=", 5))
+			param = &_params_list_sort;
+		if (!param && !strncasecmp(*argv, "group=", 6))
+			param = &_params_group;
 		if (param) {
 			err = param->parse(argc, argv, param, ctx);
 			if (err > 0) {
 				argc -= err; argv += err;
 				continue;
 			}
+			/* the parser said what is wrong */
+			if (err < 0)
+				return err;
 		}
 		/* parse collumn parameters */
 		err = (*parse_clms)(*argv, ctx);
@@ -4109,6 +5966,9 @@ int parse_list_parameters(int argc, const char *argv[], struct rnbd_ctx *ctx,
 	} else if (err == -EINVAL) {
 		handle_unknown_param(*argv, params_list_parameters);
 	}
+	if (err >= 0)
+		err = sysfs_snapshot_for_list(cmd, parse_clms, ctx);
+
 	return err < 0 ? err : start_argc - argc;
 }
 
@@ -4201,11 +6061,61 @@ int parse_map_parameters(int argc, const char *argv[], int *accepted,
 	return err;
 }
 
+static int dump_all(struct rnbd_ctx *ctx)
+{
+	struct rnbd_host **hh;
+	int err, tmp_err, host_cnt;
+
+	err = list_devices(sds_clt, sds_clt_cnt - 1, sds_srv,
+			   sds_srv_cnt - 1, true, ctx);
+
+	if (ctx->fmt != FMT_PROM
+	    && (sds_clt_cnt - 1 + sds_srv_cnt - 1)
+	    && (sess_clt_cnt - 1 + sess_srv_cnt - 1))
+		printf("\n");
+
+	tmp_err = list_sessions(sess_clt, sess_clt_cnt - 1, sess_srv,
+				sess_srv_cnt - 1, true, ctx);
+
+	if (!err && tmp_err)
+		err = tmp_err;
+
+	if (ctx->fmt != FMT_PROM
+	    && (sds_clt_cnt - 1 + sds_srv_cnt - 1
+	     + sess_clt_cnt - 1 + sess_srv_cnt - 1)
+	    && (paths_clt_cnt - 1 + paths_srv_cnt - 1))
+		printf("\n");
+
+	tmp_err = list_paths(paths_clt, paths_clt_cnt - 1, paths_srv,
+			     paths_srv_cnt - 1, true, ctx);
+
+	if (!err && tmp_err)
+		err = tmp_err;
+
+	host_cnt = hosts(&hh, ctx);
+	if (host_cnt < 0)
+		return err ? err : host_cnt;
+
+	if (ctx->fmt != FMT_PROM
+	    && (sds_clt_cnt - 1 + sds_srv_cnt - 1
+	     + sess_clt_cnt - 1 + sess_srv_cnt - 1
+	     + paths_clt_cnt - 1 + paths_srv_cnt - 1)
+	    && host_cnt)
+		printf("\n");
+
+	tmp_err = list_hosts(hh, host_cnt, true, ctx);
+
+	if (!err && tmp_err)
+		err = tmp_err;
+
+	return err;
+}
+
 int cmd_dump_all(int argc, const char *argv[], const struct param *cmd,
 		 const char *help_context, struct rnbd_ctx *ctx)
 
 {
-	int err, tmp_err;
+	int err;
 
 	err = parse_all_parameters(argc, argv, params_fmt_parameters,
 				   ctx, cmd, "");
@@ -4226,33 +6136,187 @@ int cmd_dump_all(int argc, const char *argv[], const struct param *cmd,
 	if (err < 0)
 		return err;
 
-	ctx->rnbdmode = RNBD_BOTH;
+	ctx->rnbdmode = RNBD_BOTH;
+
+	return dump_all(ctx);
+}
+
+static int serve_dump(struct rnbd_ctx *ctx, bool rescan)
+{
+	int err;
+
+	if (rescan) {
+		sysfs_snapshot_free();
+		err = sysfs_snapshot(ctx, RNBD_ATTR_ALL);
+		if (err)
+			return err;
+	}
+
+	return dump_all(ctx);
+}
+
+int cmd_serve(int argc, const char *argv[], const struct param *cmd,
+	      const char *help_context, struct rnbd_ctx *ctx)
+{
+	int err;
+
+	err = parse_cmd_parameters(argc, argv, params_serve_parameters,
+				   ctx, cmd, help_context, 0);
+	if (err < 0)
+		return err;
+
+	argc -= err; argv += err;
+
+	if (argc > 0) {
+		handle_unknown_param(*argv, params_serve_parameters);
+		return -EINVAL;
+	}
+
+	if (!ctx->listen_set) {
+		ERR(trm,
+		    "Please specify where to listen: listen <host>:<port>|<path>\n");
+		return -EINVAL;
+	}
+	if (!ctx->ttl_set)
+		ctx->ttl_ms = 5000;
+
+	/* the pages have all the fields of both sides, as dump */
+	(void) parse_all(0, NULL, NULL, ctx);
+	ctx->rnbdmode = RNBD_BOTH;
+
+	return serve_run(ctx->listen, serve_dump, ctx);
+}
+
+/*
+ * The objects shown by top and watch, all but the HCA ports and the
+ * hosts by default
+ */
+static unsigned int top_objs(const struct rnbd_ctx *ctx)
+{
+	if (!ctx->lstmode_set)
+		return TOP_ALL;
+
+	switch (ctx->lstmode) {
+	case LST_DEVICES:
+		return TOP_DEVICES;
+	case LST_SESSIONS:
+		return TOP_SESSIONS;
+	case LST_HCAS:
+		return TOP_HCAS;
+	case LST_HOSTS:
+		return TOP_HOSTS;
+	default:
+		return TOP_PATHS;
+	}
+}
+
+/*
+ * Only the names are needed, the counters are sampled by top. The paths
+ * are summed up per HCA port by their hca_name and hca_port, the
+ * sessions per host by their hostname. Top takes the objects again
+ * while it runs, so sysfs is always read anew and the ports taken
+ * before are freed.
+ */
+static int top_snapshot(struct top_src *src, unsigned int objs,
+			const struct rnbd_ctx *ctx)
+{
+	static struct rnbd_hca_port **ports;
+	unsigned int attrs = 0;
+	int err;
+
+	free(ports);
+	ports = NULL;
+	memset(src, 0, sizeof(*src));
+	if (objs & TOP_HCAS)
+		attrs |= RNBD_ATTR_PATH_HCA_NAME | RNBD_ATTR_PATH_HCA_PORT;
+	if (objs & TOP_HOSTS)
+		attrs |= RNBD_ATTR_SESS_HOSTNAME;
+	sysfs_snapshot_free();
+	err = sysfs_snapshot(ctx, attrs);
+	if (err)
+		return err;
+
+	if (objs & TOP_HCAS) {
+		err = hca_ports(&ports, ctx);
+		if (err < 0)
+			return err;
+		src->ports = ports;
+	}
+	if (objs & TOP_HOSTS) {
+		err = hosts(&src->hosts, ctx);
+		if (err < 0)
+			return err;
+	}
+	if (ctx->rnbdmode & RNBD_CLIENT) {
+		src->sds_clt = sds_clt;
+		src->sess_clt = sess_clt;
+	}
+	if (ctx->rnbdmode & RNBD_SERVER) {
+		src->sds_srv = sds_srv;
+		src->sess_srv = sess_srv;
+	}
+
+	return 0;
+}
+
+int cmd_top(int argc, const char *argv[], const struct param *cmd,
+	    const char *help_context, struct rnbd_ctx *ctx)
+{
+	unsigned int objs;
+	int err;
+
+	ctx->lstmode_set = false;
+	err = parse_cmd_parameters(argc, argv, params_top_parameters,
+				   ctx, cmd, help_context, 0);
+	if (err < 0)
+		return err;
+
+	argc -= err; argv += err;
 
-	err = list_devices(sds_clt, sds_clt_cnt - 1, sds_srv,
-			   sds_srv_cnt - 1, true, ctx);
+	if (argc > 0) {
+		handle_unknown_param(*argv, params_top_parameters);
+		return -EINVAL;
+	}
 
-	if ((sds_clt_cnt - 1 + sds_srv_cnt - 1)
-	    && (sess_clt_cnt - 1 + sess_srv_cnt - 1))
-		printf("\n");
+	objs = top_objs(ctx);
+	if (!ctx->interval_set)
+		ctx->interval_ms = 1000;
 
-	tmp_err = list_sessions(sess_clt, sess_clt_cnt - 1, sess_srv,
-				sess_srv_cnt - 1, true, ctx);
+	return top_run(top_snapshot, objs, ctx);
+}
 
-	if (!err && tmp_err)
-		err = tmp_err;
+int cmd_watch(int argc, const char *argv[], const struct param *cmd,
+	      const char *help_context, struct rnbd_ctx *ctx)
+{
+	const char *clms = NULL;
+	unsigned int objs;
+	int err;
 
-	if ((sds_clt_cnt - 1 + sds_srv_cnt - 1
-	     + sess_clt_cnt - 1 + sess_srv_cnt - 1)
-	    && (paths_clt_cnt - 1 + paths_srv_cnt - 1))
-		printf("\n");
+	ctx->lstmode_set = false;
+	while (argc) {
+		err = parse_cmd_parameters(argc, argv, params_watch_parameters,
+					   ctx, cmd, help_context, 0);
+		if (err < 0)
+			return err;
 
-	tmp_err = list_paths(paths_clt, paths_clt_cnt - 1, paths_srv,
-			     paths_srv_cnt - 1, true, ctx);
+		argc -= err; argv += err;
+		if (!argc)
+			break;
 
-	if (!err && tmp_err)
-		err = tmp_err;
+		/* anything else is the list of fields */
+		if (clms) {
+			handle_unknown_param(*argv, params_watch_parameters);
+			return -EINVAL;
+		}
+		clms = *argv;
+		argc--; argv++;
+	}
 
-	return err;
+	objs = top_objs(ctx);
+	if (!ctx->interval_set)
+		ctx->interval_ms = 1000;
+
+	return watch_run(top_snapshot, objs, clms, ctx);
 }
 
 int check_root(const struct rnbd_ctx *ctx)
@@ -4428,9 +6492,25 @@ int cmd_remap(int argc, const char *argv[], const struct param *cmd,
 	if (err < 0)
 		return err;
 
-	if (allowSession
-	    && find_single_session(ctx->name, ctx, sess_clt,
-				   sds_clt_cnt, false))
+	if (!allowSession)
+		return client_devices_remap(ctx->name, ctx);
+
+	/*
+	 * Sessions are matched by name or hostname, which requires a scan
+	 * unless the name is one of a session or of a device.
+	 */
+	if (!sysfs_read_done) {
+		if (rnbd_sysfs_sess_exists(RNBD_CLIENT, ctx->name))
+			return client_session_remap(ctx->name, ctx);
+		if (rnbd_sysfs_clt_dev_exists(ctx->name))
+			return client_devices_remap(ctx->name, ctx);
+
+		err = sysfs_snapshot(ctx, RNBD_ATTR_SESS_HOSTNAME);
+		if (err)
+			return err;
+	}
+	if (find_single_session(ctx->name, ctx, sess_clt,
+				sds_clt_cnt, false))
 		return client_session_remap(ctx->name, ctx);
 
 	return client_devices_remap(ctx->name, ctx);
@@ -4828,6 +6908,95 @@ int cmd_client_session_recover(int argc, const char *argv[],
 	return err;
 }
 
+static int client_session_set_mpath_policy(const struct rnbd_sess *sess,
+					   const char *policy,
+					   struct rnbd_ctx *ctx)
+{
+	char sysfs_path[4096];
+	int ret;
+
+	snprintf(sysfs_path, sizeof(sysfs_path), "%s%s",
+		 get_sysfs_info(ctx)->path_sess_clt, sess->sessname);
+
+	ret = printf_sysfs(sysfs_path, "mpath_policy", ctx, "%s", policy);
+	if (ret)
+		ERR(trm,
+		    "Failed to set multipath policy '%s' of session '%s': %s (%d)\n",
+		    policy, sess->sessname, strerror(-ret), ret);
+	else
+		INF(ctx->verbose_set,
+		    "Successfully set multipath policy '%s' of session '%s'.\n",
+		    policy, sess->sessname);
+	return ret;
+}
+
+int cmd_client_session_analyze(int argc, const char *argv[],
+			       const struct param *cmd,
+			       const char *help_context, struct rnbd_ctx *ctx)
+{
+	struct rnbd_sess *one[2] = { NULL }, **sess = one;
+	const char **advice;
+	int i, err, tmp_err;
+
+	err = parse_name_help(argc--, argv++,
+			      help_context, cmd, ctx);
+	if (err < 0)
+		return err;
+
+	err = parse_cmd_parameters(argc, argv,
+				   params_analyze_session_parameters,
+				   ctx, cmd, help_context, 0);
+	if (err < 0)
+		return err;
+
+	argc -= err; argv += err;
+
+	if (argc > 0) {
+
+		handle_unknown_param(*argv,
+				     params_analyze_session_parameters);
+		return -EINVAL;
+	}
+
+	if (ctx->apply_set) {
+		err = check_root(ctx);
+		if (err < 0)
+			return err;
+	}
+
+	/*
+	 * If session with the name "all" doesn't exist
+	 * analyze all sessions
+	 */
+	one[0] = find_single_session(ctx->name, ctx, sess_clt, sess_clt_cnt,
+				     strcmp(ctx->name, "all"));
+	if (!one[0] && strcmp(ctx->name, "all"))
+		return -EINVAL;
+	if (!one[0])
+		sess = sess_clt;
+
+	advice = calloc(sess == one ? 2 : sess_clt_cnt, sizeof(*advice));
+	if (!advice) {
+		ERR(trm, "Failed to allocate memory\n");
+		return -ENOMEM;
+	}
+
+	err = analyze_run(sess, advice, ctx);
+
+	for (i = 0; !err && ctx->apply_set && sess[i]; i++) {
+		if (!advice[i])
+			continue;
+
+		tmp_err = client_session_set_mpath_policy(sess[i], advice[i],
+							  ctx);
+		if (tmp_err < 0 && err >= 0)
+			err = tmp_err;
+	}
+	free(advice);
+
+	return err;
+}
+
 int cmd_recover_device_session_or_path(int argc, const char *argv[],
 				       const struct param *cmd,
 				       const char *help_context, struct rnbd_ctx *ctx)
@@ -5035,7 +7204,7 @@ int cmd_server_devices_force_close(int argc, const char *argv[], const struct pa
 		return -ENOMEM;
 	}
 
-	devs_cnt = find_devices(device_name, sds_srv, ds_exp);
+	devs_cnt = find_devices(device_name, sds_srv, ds_exp, ctx);
 
 	if (ctx->name) {
 		int sess_cnt = 0;
@@ -5217,6 +7386,10 @@ int cmd_both_sessions(int argc, const char *argv[], struct rnbd_ctx *ctx)
 
 		argc--; argv++;
 
+		err = sysfs_snapshot_for_cmd(cmd->tok, ctx);
+		if (err < 0)
+			return err;
+
 		switch (cmd->tok) {
 		case TOK_LIST:
 
@@ -5256,6 +7429,10 @@ int cmd_both_sessions(int argc, const char *argv[], struct rnbd_ctx *ctx)
 		case TOK_RECOVER:
 			err = cmd_client_session_recover(argc, argv, cmd, _help_context, ctx);
 			break;
+		case TOK_ANALYZE:
+			err = cmd_client_session_analyze(argc, argv, cmd,
+							 _help_context, ctx);
+			break;
 
 		case TOK_HELP:
 			parse_help(argc, argv, NULL, ctx);
@@ -5300,6 +7477,10 @@ int cmd_both_paths(int argc, const char *argv[], struct rnbd_ctx *ctx)
 
 		argc--; argv++;
 
+		err = sysfs_snapshot_for_cmd(cmd->tok, ctx);
+		if (err < 0)
+			return err;
+
 		switch (cmd->tok) {
 		case TOK_LIST:
 
@@ -5387,6 +7568,10 @@ int cmd_client_sessions(int argc, const char *argv[], struct rnbd_ctx *ctx)
 
 		argc--; argv++;
 
+		err = sysfs_snapshot_for_cmd(cmd->tok, ctx);
+		if (err < 0)
+			return err;
+
 		switch (cmd->tok) {
 		case TOK_LIST:
 
@@ -5421,6 +7606,10 @@ int cmd_client_sessions(int argc, const char *argv[], struct rnbd_ctx *ctx)
 		case TOK_RECOVER:
 			err = cmd_client_session_recover(argc, argv, cmd, _help_context, ctx);
 			break;
+		case TOK_ANALYZE:
+			err = cmd_client_session_analyze(argc, argv, cmd,
+							 _help_context, ctx);
+			break;
 		case TOK_REMAP:
 			err = cmd_session_remap(argc, argv, cmd,
 						_help_context, ctx);
@@ -5469,6 +7658,10 @@ int cmd_client_devices(int argc, const char *argv[], struct rnbd_ctx *ctx)
 
 		argc--; argv++;
 
+		err = sysfs_snapshot_for_cmd(cmd->tok, ctx);
+		if (err < 0)
+			return err;
+
 		switch (cmd->tok) {
 		case TOK_LIST:
 
@@ -5561,6 +7754,10 @@ int cmd_client_paths(int argc, const char *argv[], struct rnbd_ctx *ctx)
 
 		argc--; argv++;
 
+		err = sysfs_snapshot_for_cmd(cmd->tok, ctx);
+		if (err < 0)
+			return err;
+
 		switch (cmd->tok) {
 		case TOK_LIST:
 
@@ -5655,6 +7852,10 @@ int cmd_server_sessions(int argc, const char *argv[], struct rnbd_ctx *ctx)
 
 		argc--; argv++;
 
+		err = sysfs_snapshot_for_cmd(cmd->tok, ctx);
+		if (err < 0)
+			return err;
+
 		switch (cmd->tok) {
 		case TOK_LIST:
 
@@ -5728,6 +7929,10 @@ int cmd_server_devices(int argc, const char *argv[], struct rnbd_ctx *ctx)
 
 		argc--; argv++;
 
+		err = sysfs_snapshot_for_cmd(cmd->tok, ctx);
+		if (err < 0)
+			return err;
+
 		switch (cmd->tok) {
 		case TOK_LIST:
 
@@ -5801,6 +8006,10 @@ int cmd_server_paths(int argc, const char *argv[], struct rnbd_ctx *ctx)
 
 		argc--; argv++;
 
+		err = sysfs_snapshot_for_cmd(cmd->tok, ctx);
+		if (err < 0)
+			return err;
+
 		switch (cmd->tok) {
 		case TOK_LIST:
 			err = parse_list_parameters(argc, argv, ctx,
@@ -5848,6 +8057,131 @@ int cmd_server_paths(int argc, const char *argv[], struct rnbd_ctx *ctx)
 	return err;
 }
 
+/*
+ * The HCA ports are the same for all modes, only the paths counted
+ * differ.
+ */
+int cmd_hcas(int argc, const char *argv[], const char *help_context,
+	     struct rnbd_ctx *ctx)
+{
+	const char *_help_context = ctx->pname_with_mode
+		? "hca" : help_context;
+
+	int err = 0;
+	const struct param *cmd;
+
+	cmd = find_param(*argv, cmds_hcas);
+	if (!cmd) {
+		print_usage(_help_context, cmds_hcas, ctx);
+		if (ctx->complete_set)
+			err = -EAGAIN;
+		else
+			err = -EINVAL;
+
+		if (argc)
+			handle_unknown_param(*argv, cmds_hcas);
+		else if (!ctx->complete_set)
+			ERR(trm, "Please specify a command\n");
+	}
+	if (err >= 0) {
+
+		argc--; argv++;
+
+		switch (cmd->tok) {
+		case TOK_LIST:
+			err = parse_list_parameters(argc, argv, ctx,
+						    parse_hcas_clms,
+						    cmd, _help_context, 0);
+			if (err < 0)
+				break;
+
+			err = list_hcas(ctx);
+			break;
+		case TOK_HELP:
+			parse_help(argc, argv, NULL, ctx);
+			print_help(_help_context, cmd, cmds_hcas, ctx);
+			break;
+		default:
+			print_usage(_help_context, cmds_hcas, ctx);
+			handle_unknown_param(cmd->param_str, cmds_hcas);
+			err = -EINVAL;
+			break;
+		}
+	}
+	return err;
+}
+
+int cmd_hosts(int argc, const char *argv[], const char *help_context,
+	      struct rnbd_ctx *ctx)
+{
+	const char *_help_context = ctx->pname_with_mode
+		? "host" : help_context;
+
+	struct rnbd_host **hh;
+	int err = 0;
+	const struct param *cmd;
+
+	cmd = find_param(*argv, cmds_hosts);
+	if (!cmd) {
+		print_usage(_help_context, cmds_hosts, ctx);
+		if (ctx->complete_set)
+			err = -EAGAIN;
+		else
+			err = -EINVAL;
+
+		if (argc)
+			handle_unknown_param(*argv, cmds_hosts);
+		else if (!ctx->complete_set)
+			ERR(trm, "Please specify a command\n");
+	}
+	if (err >= 0) {
+
+		argc--; argv++;
+
+		switch (cmd->tok) {
+		case TOK_LIST:
+			err = parse_list_parameters(argc, argv, ctx,
+						    parse_hosts_clms,
+						    cmd, _help_context, 0);
+			if (err < 0)
+				break;
+
+			err = hosts(&hh, ctx);
+			if (err < 0)
+				break;
+
+			err = list_hosts(hh, err, false, ctx);
+			break;
+		case TOK_SHOW:
+			err = parse_name_help(argc--, argv++,
+					      _help_context, cmd, ctx);
+			if (err < 0)
+				break;
+
+			init_show(ctx->rnbdmode, LST_HOSTS, ctx);
+
+			err = parse_list_parameters(argc, argv, ctx,
+						    parse_hosts_clms,
+						    cmd, _help_context, 0);
+			if (err < 0)
+				break;
+
+			err = show_hosts(ctx->name, ctx);
+			break;
+		case TOK_HELP:
+			parse_help(argc, argv, NULL, ctx);
+			print_help(_help_context, cmd, cmds_hosts, ctx);
+			break;
+		default:
+			print_usage(_help_context, cmds_hosts, ctx);
+			handle_unknown_param(cmd->param_str, cmds_hosts);
+			err = -EINVAL;
+			break;
+		}
+	}
+	return err;
+}
+
 int cmd_client(int argc, const char *argv[], struct rnbd_ctx *ctx)
 {
 	const char *_help_context = "client";
@@ -5879,6 +8213,10 @@ int cmd_client(int argc, const char *argv[], struct rnbd_ctx *ctx)
 	argc--; argv++;
 
 	if (err >= 0) {
+		err = sysfs_snapshot_for_cmd(param->tok, ctx);
+		if (err < 0)
+			return err;
+
 		switch (param->tok) {
 		case TOK_DEVICES:
 			err = cmd_client_devices(argc, argv, ctx);
@@ -5889,9 +8227,21 @@ int cmd_client(int argc, const char *argv[], struct rnbd_ctx *ctx)
 		case TOK_PATHS:
 			err = cmd_client_paths(argc, argv, ctx);
 			break;
+		case TOK_HCAS:
+			err = cmd_hcas(argc, argv, "client hca", ctx);
+			break;
+		case TOK_HOSTS:
+			err = cmd_hosts(argc, argv, "client host", ctx);
+			break;
 		case TOK_DUMP:
 			err = cmd_dump_all(argc, argv, param, "", ctx);
 			break;
+		case TOK_TOP:
+			err = cmd_top(argc, argv, param, _help_context, ctx);
+			break;
+		case TOK_WATCH:
+			err = cmd_watch(argc, argv, param, _help_context, ctx);
+			break;
 		case TOK_LIST:
 
 			err = parse_list_parameters(argc, argv, ctx,
@@ -5986,6 +8336,10 @@ int cmd_server(int argc, const char *argv[], struct rnbd_ctx *ctx)
 	argc--; argv++;
 
 	if (err >= 0) {
+		err = sysfs_snapshot_for_cmd(param->tok, ctx);
+		if (err < 0)
+			return err;
+
 		switch (param->tok) {
 		case TOK_DEVICES:
 			err = cmd_server_devices(argc, argv, ctx);
@@ -5996,9 +8350,21 @@ int cmd_server(int argc, const char *argv[], struct rnbd_ctx *ctx)
 		case TOK_PATHS:
 			err = cmd_server_paths(argc, argv, ctx);
 			break;
+		case TOK_HCAS:
+			err = cmd_hcas(argc, argv, "server hca", ctx);
+			break;
+		case TOK_HOSTS:
+			err = cmd_hosts(argc, argv, "server host", ctx);
+			break;
 		case TOK_DUMP:
 			err = cmd_dump_all(argc, argv, param, "", ctx);
 			break;
+		case TOK_TOP:
+			err = cmd_top(argc, argv, param, _help_context, ctx);
+			break;
+		case TOK_WATCH:
+			err = cmd_watch(argc, argv, param, _help_context, ctx);
+			break;
 		case TOK_CLOSE:
 			err = cmd_server_devices_force_close(argc, argv, param, _help_context, ctx);
 			break;
@@ -6077,6 +8443,10 @@ int cmd_both(int argc, const char *argv[], struct rnbd_ctx *ctx)
 	argc--; argv++;
 
 	if (err >= 0) {
+		err = sysfs_snapshot_for_cmd(param->tok, ctx);
+		if (err < 0)
+			return err;
+
 		switch (param->tok) {
 		case TOK_DEVICES:
 			/* call client function here. Note that list and show */
@@ -6089,9 +8459,24 @@ int cmd_both(int argc, const char *argv[], struct rnbd_ctx *ctx)
 		case TOK_PATHS:
 			err = cmd_both_paths(argc, argv, ctx);
 			break;
+		case TOK_HCAS:
+			err = cmd_hcas(argc, argv, "hca", ctx);
+			break;
+		case TOK_HOSTS:
+			err = cmd_hosts(argc, argv, "host", ctx);
+			break;
 		case TOK_DUMP:
 			err = cmd_dump_all(argc, argv, param, "", ctx);
 			break;
+		case TOK_TOP:
+			err = cmd_top(argc, argv, param, "", ctx);
+			break;
+		case TOK_WATCH:
+			err = cmd_watch(argc, argv, param, "", ctx);
+			break;
+		case TOK_SERVE:
+			err = cmd_serve(argc, argv, param, "", ctx);
+			break;
 		case TOK_LIST:
 			err = parse_list_parameters(argc, argv, ctx,
 						    parse_both_devices_clms,
@@ -6225,20 +8610,6 @@ int cmd_start(int argc, const char *argv[], struct rnbd_ctx *ctx)
 	return err;
 }
 
-static int compar_sds_sess(const void *p1, const void *p2)
-{
-	const struct rnbd_sess_dev *const *sd1 = p1, *const *sd2 = p2;
-
-	return strcmp((*sd1)->sess->sessname, (*sd2)->sess->sessname);
-}
-
-static int compar_sds_dev(const void *p1, const void *p2)
-{
-	const struct rnbd_sess_dev *const *sd1 = p1, *const *sd2 = p2;
-
-	return strcmp((*sd1)->mapping_path, (*sd2)->mapping_path);
-}
-
 int main(int argc, const char *argv[])
 {
 	int ret = 0;
@@ -6249,27 +8620,12 @@ int main(int argc, const char *argv[])
 	parse_argv0(argv[0], &ctx);
 	check_compat_sysfs(&ctx);
 
-	ret = rnbd_sysfs_alloc_all(&sds_clt, &sds_srv,
-				    &sess_clt, &sess_srv,
-				    &paths_clt, &paths_srv,
-				    &sds_clt_cnt, &sds_srv_cnt,
-				    &sess_clt_cnt, &sess_srv_cnt,
-				    &paths_clt_cnt, &paths_srv_cnt);
-	if (ret) {
-		ERR(trm, "Failed to alloc memory for sysfs entries: %d\n", ret);
+	ret = parse_cmd_parameters(--argc, ++argv, params_flags,
+				   &ctx, NULL, NULL, 0);
+	if (ret < 0)
 		goto out;
-	}
 
-	ret = rnbd_sysfs_read_all(sds_clt, sds_srv, sess_clt, sess_srv,
-				   paths_clt, paths_srv);
-	if (ret) {
-		ERR(trm, "Failed to read sysfs entries: %d\n", ret);
-		goto free;
-	}
-	qsort(sds_clt, sds_clt_cnt - 1, sizeof(*sds_clt), compar_sds_dev);
-	qsort(sds_srv, sds_srv_cnt - 1, sizeof(*sds_srv), compar_sds_dev);
-	qsort(sds_clt, sds_clt_cnt - 1, sizeof(*sds_clt), compar_sds_sess);
-	qsort(sds_srv, sds_srv_cnt - 1, sizeof(*sds_srv), compar_sds_sess);
+	argc -= ret; argv += ret;
 
 	ret = read_port_descs(ctx.port_descs, MAX_PATHS_PER_SESSION);
 	if (ret < 0) {
@@ -6281,13 +8637,6 @@ int main(int argc, const char *argv[])
 
 	rnbd_ctx_default(&ctx);
 
-	ret = parse_cmd_parameters(--argc, ++argv, params_flags,
-				   &ctx, NULL, NULL, 0);
-	if (ret < 0)
-		goto free;
-
-	argc -= ret; argv += ret;
-
 	INF(ctx.debug_set, "%s using '%s' sysfs.\n",
 	    ctx.pname, get_sysfs_info(&ctx)->path_dev_name);
 
@@ -6304,8 +8653,7 @@ int main(int argc, const char *argv[])
 	ret = cmd_start(argc, argv, &ctx);
 
 free:
-	rnbd_sysfs_free_all(sds_clt, sds_srv, sess_clt, sess_srv,
-			     paths_clt, paths_srv);
+	sysfs_snapshot_free();
 out:
 	deinit_rnbd_ctx(&ctx);
 
@@ -92,6 +92,10 @@ List devices imported on client, show only mapping_path and devpath, output in j
 
     rnbd client devices list mapping_path,devpath json
 
+# ENVIRONMENT
+**RNBD_SYSFS_ROOT**
+: Directory to access the sysfs entries under, instead of /. Used to run against a synthetic sysfs tree, which can be created with rnbd-sysfs-gen.sh or make sysfs-tree.
+
 # COPYRIGHT
 Copyright © 2019 - 2021 IONOS Cloud GmbH. All Rights Reserved
 
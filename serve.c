@@ -0,0 +1,544 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Configuration tool for RNBD driver and RTRS library.
+ *
+ * Copyright (c) 2019 1&1 IONOS SE. All rights reserved.
+ * Authors: Danil Kipnis <danil.kipnis@cloud.ionos.com>
+ *          Lutz Pogrell <lutz.pogrell@cloud.ionos.com>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "serve.h"
+
+#include "table.h"
+#include "misc.h"
+
+#define SERVE_MAX_CONNS	64
+#define SERVE_REQ_MAX	4096		/* request line and headers */
+#define SERVE_CONN_MS	10000		/* max lifetime of a connection */
+
+extern bool trm;
+
+/*
+ * A rendered page, shared by the connections sending it
+ */
+struct serve_buf {
+	int		ref;
+	char		hdr[192];
+	int		hdr_len;
+	char		*data;
+	size_t		len;
+};
+
+struct serve_page {
+	const char	*type;		/* Content-Type */
+	enum fmt_type	fmt;
+	struct serve_buf *buf;
+	unsigned long	gen;		/* snapshot the page was rendered of */
+};
+
+enum {
+	PAGE_JSON,
+	PAGE_PROM,
+};
+
+static struct serve_page pages[] = {
+	[PAGE_JSON] = { "application/json; charset=utf-8", FMT_JSON },
+	[PAGE_PROM] = { "text/plain; version=0.0.4; charset=utf-8", FMT_PROM },
+};
+
+struct serve_conn {
+	int		fd;		/* -1 if the slot is free */
+	uint64_t	since;		/* accepted at, ms */
+	bool		out;		/* waiting for EPOLLOUT */
+	char		req[SERVE_REQ_MAX + 1];
+	size_t		req_len;
+
+	/* response: a header and the body of a page, if any */
+	const char	*hdr;		/* NULL while reading the request */
+	size_t		hdr_len;
+	char		err[160];	/* header of an error response */
+	struct serve_buf *buf;
+	size_t		body_len;	/* 0 for HEAD */
+	size_t		sent;
+};
+
+struct serve {
+	int		epfd;
+	int		lfd;
+	serve_dump_fn	dump;
+	struct rnbd_ctx	*ctx;
+	uint64_t	scanned;	/* time of the last scan, ms */
+	unsigned long	gen;		/* number of scans */
+	struct serve_conn conns[SERVE_MAX_CONNS];
+};
+
+static volatile sig_atomic_t serve_stop;
+
+static void serve_sig(int sig)
+{
+	serve_stop = 1;
+}
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000ull + ts.tv_nsec / 1000000;
+}
+
+static void buf_put(struct serve_buf *buf)
+{
+	if (!buf || --buf->ref)
+		return;
+
+	free(buf->data);
+	free(buf);
+}
+
+/*
+ * Run @dump with stdout redirected into a new buffer
+ */
+static struct serve_buf *page_render(struct serve *s, struct serve_page *p,
+				     bool rescan)
+{
+	struct serve_buf *buf;
+	FILE *out = stdout;
+	int err;
+
+	buf = calloc(1, sizeof(*buf));
+	if (!buf)
+		return NULL;
+
+	fflush(stdout);
+	stdout = open_memstream(&buf->data, &buf->len);
+	if (!stdout) {
+		stdout = out;
+		free(buf);
+		return NULL;
+	}
+
+	s->ctx->fmt = p->fmt;
+	err = s->dump(s->ctx, rescan);
+
+	fclose(stdout);
+	stdout = out;
+
+	if (err) {
+		free(buf->data);
+		free(buf);
+		return NULL;
+	}
+
+	buf->ref = 1;
+	buf->hdr_len = snprintf(buf->hdr, sizeof(buf->hdr),
+				"HTTP/1.1 200 OK\r\n"
+				"Content-Type: %s\r\n"
+				"Content-Length: %zu\r\n"
+				"Connection: close\r\n\r\n",
+				p->type, buf->len);
+
+	return buf;
+}
+
+/*
+ * Get a reference to the page, sysfs is read again if the snapshot
+ * is older than the ttl.
+ */
+static struct serve_buf *page_get(struct serve *s, struct serve_page *p)
+{
+	uint64_t now = now_ms();
+	struct serve_buf *buf;
+	bool rescan;
+
+	rescan = !s->gen || now - s->scanned >= s->ctx->ttl_ms;
+	if (rescan || p->gen != s->gen) {
+		buf = page_render(s, p, rescan);
+		if (!buf)
+			return NULL;
+
+		if (rescan) {
+			s->gen++;
+			s->scanned = now;
+		}
+		buf_put(p->buf);
+		p->buf = buf;
+		p->gen = s->gen;
+	}
+	p->buf->ref++;
+
+	return p->buf;
+}
+
+static struct serve_page *page_find(const char *path)
+{
+	if (!strcmp(path, "/") || !strcmp(path, "/json"))
+		return &pages[PAGE_JSON];
+	if (!strcmp(path, "/metrics"))
+		return &pages[PAGE_PROM];
+
+	return NULL;
+}
+
+static void conn_close(struct serve_conn *c)
+{
+	close(c->fd);
+	buf_put(c->buf);
+	memset(c, 0, sizeof(*c));
+	c->fd = -1;
+}
+
+static void conn_error(struct serve_conn *c, const char *status)
+{
+	c->hdr_len = snprintf(c->err, sizeof(c->err),
+			      "HTTP/1.1 %s\r\n"
+			      "Content-Type: text/plain\r\n"
+			      "Content-Length: %zu\r\n"
+			      "Connection: close\r\n\r\n%s\n",
+			      status, strlen(status) + 1, status);
+	c->hdr = c->err;
+}
+
+/*
+ * Parse the request line, the headers are ignored
+ */
+static void conn_request(struct serve *s, struct serve_conn *c)
+{
+	struct serve_page *p;
+	char *method, *path;
+	bool head;
+
+	method = c->req;
+	path = strchr(method, ' ');
+	if (!path) {
+		conn_error(c, "400 Bad Request");
+		return;
+	}
+	*path++ = '\0';
+	path[strcspn(path, " ?\r\n")] = '\0';
+
+	head = !strcmp(method, "HEAD");
+	if (!head && strcmp(method, "GET")) {
+		conn_error(c, "405 Method Not Allowed");
+		return;
+	}
+
+	p = page_find(path);
+	if (!p) {
+		conn_error(c, "404 Not Found");
+		return;
+	}
+
+	c->buf = page_get(s, p);
+	if (!c->buf) {
+		conn_error(c, "503 Service Unavailable");
+		return;
+	}
+	c->hdr = c->buf->hdr;
+	c->hdr_len = c->buf->hdr_len;
+	c->body_len = head ? 0 : c->buf->len;
+}
+
+/*
+ * Returns 1 if the response was sent, 0 if the socket is full
+ */
+static int conn_send(struct serve_conn *c)
+{
+	struct msghdr msg = {};
+	struct iovec iov[2];
+	size_t off;
+	ssize_t ret;
+
+	while (c->sent < c->hdr_len + c->body_len) {
+		msg.msg_iov = iov;
+		msg.msg_iovlen = 0;
+
+		if (c->sent < c->hdr_len) {
+			iov[0].iov_base = (char *)c->hdr + c->sent;
+			iov[0].iov_len = c->hdr_len - c->sent;
+			msg.msg_iovlen++;
+		}
+		if (c->body_len) {
+			off = c->sent > c->hdr_len ? c->sent - c->hdr_len : 0;
+			iov[msg.msg_iovlen].iov_base = c->buf->data + off;
+			iov[msg.msg_iovlen].iov_len = c->body_len - off;
+			msg.msg_iovlen++;
+		}
+
+		ret = sendmsg(c->fd, &msg, MSG_NOSIGNAL);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN)
+				return 0;
+			return -errno;
+		}
+		c->sent += ret;
+	}
+
+	return 1;
+}
+
+static void conn_event(struct serve *s, struct serve_conn *c)
+{
+	struct epoll_event ev = {
+		.events = EPOLLOUT,
+		.data.ptr = c,
+	};
+	ssize_t ret;
+
+	if (!c->hdr) {
+		ret = read(c->fd, c->req + c->req_len,
+			   SERVE_REQ_MAX - c->req_len);
+		if (ret < 0 && (errno == EAGAIN || errno == EINTR))
+			return;
+		if (ret <= 0) {
+			conn_close(c);
+			return;
+		}
+		c->req_len += ret;
+		c->req[c->req_len] = '\0';
+
+		if (strstr(c->req, "\r\n\r\n") || strstr(c->req, "\n\n"))
+			conn_request(s, c);
+		else if (c->req_len == SERVE_REQ_MAX)
+			conn_error(c, "431 Request Header Fields Too Large");
+		else
+			return;
+	}
+
+	ret = conn_send(c);
+	if (!ret) {
+		if (!c->out && !epoll_ctl(s->epfd, EPOLL_CTL_MOD, c->fd, &ev))
+			c->out = true;
+		return;
+	}
+
+	if (ret > 0)
+		shutdown(c->fd, SHUT_WR);
+	conn_close(c);
+}
+
+static void serve_accept(struct serve *s)
+{
+	struct epoll_event ev = { .events = EPOLLIN };
+	struct serve_conn *c;
+	int fd, i;
+
+	for (;;) {
+		fd = accept4(s->lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0)
+			return;
+
+		for (i = 0; i < SERVE_MAX_CONNS; i++)
+			if (s->conns[i].fd < 0)
+				break;
+		if (i == SERVE_MAX_CONNS) {
+			close(fd);
+			continue;
+		}
+
+		c = &s->conns[i];
+		c->fd = fd;
+		c->since = now_ms();
+		ev.data.ptr = c;
+		if (epoll_ctl(s->epfd, EPOLL_CTL_ADD, fd, &ev))
+			conn_close(c);
+	}
+}
+
+/*
+ * Close the connections of clients which are too slow
+ */
+static void serve_expire(struct serve *s)
+{
+	uint64_t now = now_ms();
+	int i;
+
+	for (i = 0; i < SERVE_MAX_CONNS; i++)
+		if (s->conns[i].fd >= 0 &&
+		    now - s->conns[i].since > SERVE_CONN_MS)
+			conn_close(&s->conns[i]);
+}
+
+static int serve_listen_unix(const char *path)
+{
+	struct sockaddr_un sun = { .sun_family = AF_UNIX };
+	struct stat st;
+	int fd;
+
+	if (strlen(path) >= sizeof(sun.sun_path))
+		return -ENAMETOOLONG;
+	strcpy(sun.sun_path, path);
+
+	/* a stale socket of an earlier run */
+	if (!lstat(path, &st) && S_ISSOCK(st.st_mode))
+		unlink(path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return -errno;
+
+	if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)) ||
+	    listen(fd, SOMAXCONN)) {
+		close(fd);
+		return -errno;
+	}
+
+	return fd;
+}
+
+static int serve_listen_inet(const char *addr)
+{
+	struct addrinfo hints = {
+		.ai_family = AF_UNSPEC,
+		.ai_socktype = SOCK_STREAM,
+		.ai_flags = AI_PASSIVE,
+	}, *res, *ai;
+	char host[NI_MAXHOST], *port;
+	int fd = -EINVAL, one = 1, ret;
+	const char *h = host;
+
+	if (strlen(addr) >= sizeof(host))
+		return -EINVAL;
+	strcpy(host, addr);
+
+	port = strrchr(host, ':');
+	if (!port || !port[1])
+		return -EINVAL;
+	*port++ = '\0';
+
+	/* [<ipv6 address>]:<port> */
+	if (host[0] == '[' && port[-2] == ']') {
+		port[-2] = '\0';
+		h++;
+	}
+
+	if (getaddrinfo(*h ? h : NULL, port, &hints, &res))
+		return -EADDRNOTAVAIL;
+
+	for (ai = res; ai; ai = ai->ai_next) {
+		fd = socket(ai->ai_family,
+			    ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+			    ai->ai_protocol);
+		if (fd < 0) {
+			fd = -errno;
+			continue;
+		}
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+		if (!bind(fd, ai->ai_addr, ai->ai_addrlen) &&
+		    !listen(fd, SOMAXCONN))
+			break;
+
+		ret = -errno;
+		close(fd);
+		fd = ret;
+	}
+	freeaddrinfo(res);
+
+	return fd;
+}
+
+static bool is_unix_path(const char *addr)
+{
+	return strchr(addr, '/');
+}
+
+int serve_run(const char *addr, serve_dump_fn dump, struct rnbd_ctx *ctx)
+{
+	struct sigaction sa = { .sa_handler = serve_sig };
+	struct epoll_event evs[16], ev = { .events = EPOLLIN };
+	struct serve s = {
+		.dump = dump,
+		.ctx = ctx,
+	};
+	int err = 0, i, n;
+
+	for (i = 0; i < SERVE_MAX_CONNS; i++)
+		s.conns[i].fd = -1;
+
+	/* fail early if sysfs can't be read, this also warms up the pages */
+	for (i = 0; i < ARRSIZE(pages); i++) {
+		struct serve_buf *buf = page_get(&s, &pages[i]);
+
+		if (!buf)
+			return -EIO;
+		buf_put(buf);
+	}
+
+	s.lfd = is_unix_path(addr) ? serve_listen_unix(addr) :
+				     serve_listen_inet(addr);
+	if (s.lfd < 0) {
+		ERR(trm, "Failed to listen on '%s': %s\n", addr,
+		    strerror(-s.lfd));
+		err = s.lfd;
+		goto out_pages;
+	}
+
+	s.epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (s.epfd < 0 || epoll_ctl(s.epfd, EPOLL_CTL_ADD, s.lfd, &ev)) {
+		err = -errno;
+		ERR(trm, "Failed to set up epoll: %s\n", strerror(-err));
+		goto out_close;
+	}
+
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	if (ctx->verbose_set)
+		printf("Listening on %s\n", addr);
+	fflush(stdout);
+
+	while (!serve_stop) {
+		n = epoll_wait(s.epfd, evs, ARRSIZE(evs), 1000);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			err = -errno;
+			break;
+		}
+
+		for (i = 0; i < n; i++)
+			if (evs[i].data.ptr)
+				conn_event(&s, evs[i].data.ptr);
+			else
+				serve_accept(&s);
+
+		serve_expire(&s);
+	}
+
+	for (i = 0; i < SERVE_MAX_CONNS; i++)
+		if (s.conns[i].fd >= 0)
+			conn_close(&s.conns[i]);
+
+out_close:
+	if (s.epfd >= 0)
+		close(s.epfd);
+	close(s.lfd);
+	if (is_unix_path(addr))
+		unlink(addr);
+out_pages:
+	for (i = 0; i < ARRSIZE(pages); i++) {
+		buf_put(pages[i].buf);
+		pages[i].buf = NULL;
+	}
+
+	return err;
+}
@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Configuration tool for RNBD driver and RTRS library.
+ *
+ * Copyright (c) 2019 1&1 IONOS SE. All rights reserved.
+ * Authors: Danil Kipnis <danil.kipnis@cloud.ionos.com>
+ *          Lutz Pogrell <lutz.pogrell@cloud.ionos.com>
+ */
+
+#ifndef __H_SERVE
+#define __H_SERVE
+
+#include <stdbool.h>
+
+struct rnbd_ctx;
+
+/*
+ * Print all the objects to stdout in the format ctx->fmt, after
+ * reading a new snapshot from sysfs if @rescan is set. Returns -errno.
+ */
+typedef int (*serve_dump_fn)(struct rnbd_ctx *ctx, bool rescan);
+
+/*
+ * Serve the output of @dump over HTTP on @addr, either <host>:<port>
+ * or the path of a unix socket, until SIGINT or SIGTERM:
+ *
+ *   /, /json	JSON
+ *   /metrics	Prometheus text format
+ *
+ * The pages are rendered once per snapshot and sysfs is read at most
+ * once every ctx->ttl_ms. Returns -errno.
+ */
+int serve_run(const char *addr, serve_dump_fn dump, struct rnbd_ctx *ctx);
+
+#endif /* __H_SERVE */
@@ -15,6 +15,8 @@
 #include <string.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <fnmatch.h>
+#include <limits.h>
 
 int clr_print(bool trm, enum color clr, const char *format, ...)
 {
@@ -40,6 +42,33 @@ static const char * const fld_fmt_str[] = {
 	[FLD_LLU] = "%" PRIu64,
 };
 
+static size_t table_fld_stringify(void *s, struct table_column *c,
+				  struct table_fld *fld,
+				  const struct rnbd_ctx *ctx, bool humanize)
+{
+	void *v = (void *)s + c->s_off + c->m_offset;
+
+	/* some m_tostr leave the field alone when there is nothing to show */
+	if (c->m_tostr) {
+		fld->str[0] = '\0';
+		fld->clr = CNRM;
+		return c->m_tostr(fld->str, CLM_MAX_WIDTH, ctx, &fld->clr, v,
+				  humanize);
+	}
+
+	fld->clr = c->clm_color;
+
+	if (c->m_type == FLD_INT || c->m_type == FLD_VAL)
+		return snprintf(fld->str, CLM_MAX_WIDTH,
+				fld_fmt_str[c->m_type], *(int *)v);
+	else if (c->m_type == FLD_LLU)
+		return snprintf(fld->str, CLM_MAX_WIDTH,
+				fld_fmt_str[c->m_type], *(uint64_t *)v);
+	else
+		return snprintf(fld->str, CLM_MAX_WIDTH,
+				fld_fmt_str[c->m_type], *(const char **)v);
+}
+
 int table_row_stringify(void *s, struct table_fld *flds,
 			struct table_column **cs, const struct rnbd_ctx *ctx,
 			bool humanize, int pre_len)
@@ -47,30 +76,30 @@ int table_row_stringify(void *s, struct table_fld *flds,
 	struct table_column *c;
 	size_t len;
 	int clm;
-	void *v;
 
 	for (c = *cs, clm = 0; c; c = *++cs, clm++) {
-		v = (void *)s + c->s_off + c->m_offset;
-
-		if (c->m_tostr) {
-			len = c->m_tostr(flds[clm].str, CLM_MAX_WIDTH, ctx,
-					 &flds[clm].clr, v, humanize);
-		} else {
-			if (c->m_type == FLD_INT || c->m_type == FLD_VAL)
-				len = snprintf(flds[clm].str, CLM_MAX_WIDTH,
-					       fld_fmt_str[c->m_type],
-					       *(int *)v);
-			else if (c->m_type == FLD_LLU)
-				len = snprintf(flds[clm].str, CLM_MAX_WIDTH,
-					       fld_fmt_str[c->m_type],
-					       *(uint64_t *)v);
-			else
-				len = snprintf(flds[clm].str, CLM_MAX_WIDTH,
-					       fld_fmt_str[c->m_type],
-					       (char *)v);
+		len = table_fld_stringify(s, c, &flds[clm], ctx, humanize);
 
-			flds[clm].clr = c->clm_color;
-		}
+		if (!clm)
+			len += pre_len;
+
+		if (c->m_width < len)
+			c->m_width = len;
+	}
+
+	return 0;
+}
+
+int table_row_widths(void *s, struct table_column **cs,
+		     const struct rnbd_ctx *ctx, bool humanize, int pre_len)
+{
+	struct table_column *c;
+	struct table_fld fld;
+	size_t len;
+	int clm;
+
+	for (c = *cs, clm = 0; c; c = *++cs, clm++) {
+		len = table_fld_stringify(s, c, &fld, ctx, humanize);
 
 		if (!clm)
 			len += pre_len;
@@ -141,94 +170,276 @@ int table_flds_print_term(const char *pre, struct table_fld *flds,
 	return 0;
 }
 
-/* FIXME: escape ',' in strings */
-int table_flds_print_csv(struct table_fld *flds,
-			 struct table_column **cs, bool trm)
+/*
+ * A row as a single line of JSON, without colors
+ */
+int table_flds_print_json_line(struct table_fld *flds,
+			       struct table_column **cs)
 {
-	struct table_column *c = *cs;
+	struct table_column *c;
 	int clm;
 
-	if (c)
-		table_fld_print_as_str(&flds[0], c, trm);
+	printf("{");
 
-	for (c = *++cs, clm = 1; c; c = *++cs, clm++) {
-		printf(",");
-		table_fld_print_as_str(&flds[clm], c, trm);
+	for (c = *cs, clm = 0; c; c = *++cs, clm++) {
+		printf(clm ? ", \"%s\": " : "\"%s\": ", c->m_name);
+		if (!table_fld_print_as_str(&flds[clm], c, false))
+			printf("null");
 	}
 
-	printf("\n");
+	printf("}");
 
 	return 0;
 }
 
-/*FIXME: escape '"' in strings */
-int table_flds_print_json(const char *prefix, struct table_fld *flds,
-			  struct table_column **cs, bool trm)
+int table_row_print(void *v, enum fmt_type fmt, const char *pre,
+		    struct table_column **cs, bool trm,
+		    const struct rnbd_ctx *ctx, bool humanize,
+		    size_t pre_len)
 {
-	struct table_column *c = *cs;
-	int clm;
+	struct table_fld flds[CLM_MAX_CNT];
 
-	printf("%s{", prefix);
+	if (fmt != FMT_TERM) {
+		table_row_out(v, fmt, pre, cs, ctx);
+		table_out_flush();
+		return 0;
+	}
+
+	table_row_stringify(v, flds, cs, ctx, humanize, pre_len);
+
+	return table_flds_print_term(pre, flds, cs, trm, pre_len);
+}
 
-	if (c) {
-		printf("\n%s\t\"%s\": ", prefix, c->m_name);
-		if (!table_fld_print_as_str(&flds[0], c, trm))
-			clr_print(trm, flds[0].clr, "null");
+#define TABLE_OUT_SIZE	(64 * 1024)
+
+/*
+ * Output buffer of the machine readable formats: the fields are written
+ * straight from the structs into it and it is handed to stdout in
+ * chunks, memory use does not depend on the number of rows.
+ */
+static struct {
+	char	data[TABLE_OUT_SIZE];
+	size_t	len;
+} out;
+
+void table_out_flush(void)
+{
+	if (out.len)
+		fwrite(out.data, 1, out.len, stdout);
+	out.len = 0;
+}
+
+static void out_putc(char c)
+{
+	if (out.len == TABLE_OUT_SIZE)
+		table_out_flush();
+	out.data[out.len++] = c;
+}
+
+static void out_write(const char *s, size_t len)
+{
+	size_t n;
+
+	while (len) {
+		if (out.len == TABLE_OUT_SIZE)
+			table_out_flush();
+		n = TABLE_OUT_SIZE - out.len;
+		if (n > len)
+			n = len;
+		memcpy(out.data + out.len, s, n);
+		out.len += n;
+		s += n;
+		len -= n;
 	}
+}
+
+static void out_puts(const char *s)
+{
+	out_write(s, strlen(s));
+}
 
-	for (c = *++cs, clm = 1; c; c = *++cs, clm++) {
-		printf(",\n%s\t\"%s\": ", prefix, c->m_name);
-		if (!table_fld_print_as_str(&flds[clm], c, trm))
-			clr_print(trm, flds[clm].clr, "null");
+int table_out_printf(const char *format, ...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, format);
+	len = vsnprintf(out.data + out.len, TABLE_OUT_SIZE - out.len, format,
+			args);
+	va_end(args);
+	if (len < 0 || len < TABLE_OUT_SIZE - out.len) {
+		out.len += len > 0 ? len : 0;
+		return len;
 	}
 
-	printf("\n%s}", prefix);
+	/* didn't fit, start over in an empty buffer or bypass it */
+	table_out_flush();
+	va_start(args, format);
+	if (len < TABLE_OUT_SIZE)
+		out.len = vsnprintf(out.data, TABLE_OUT_SIZE, format, args);
+	else
+		vprintf(format, args);
+	va_end(args);
+
+	return len;
+}
+
+static void out_int(int64_t d)
+{
+	char buf[24], *p = buf + sizeof(buf);
+	uint64_t u = d < 0 ? -(uint64_t)d : d;
 
-	return 0;
+	do {
+		*--p = '0' + u % 10;
+		u /= 10;
+	} while (u);
+	if (d < 0)
+		*--p = '-';
+
+	out_write(p, buf + sizeof(buf) - p);
 }
 
-int table_flds_print_xml(const char *prefix, struct table_fld *flds,
-			 struct table_column **cs, bool trm)
+static void out_llu(uint64_t u)
 {
-	struct table_column *c = *cs;
-	int clm;
+	char buf[24], *p = buf + sizeof(buf);
 
-	for (c = *cs, clm = 0; c; c = *++cs, clm++) {
-		printf("%s<%s>", prefix, c->m_name);
-		table_fld_print_as_str(&flds[clm], c, trm);
-		printf("</%s>\n", c->m_name);
+	do {
+		*--p = '0' + u % 10;
+		u /= 10;
+	} while (u);
+
+	out_write(p, buf + sizeof(buf) - p);
+}
+
+/*
+ * A string in double quotes, escaped for @fmt: JSON escapes quotes,
+ * backslashes and control characters, CSV doubles the quotes and XML
+ * replaces the markup characters by entities.
+ */
+static void out_str(const char *s, enum fmt_type fmt)
+{
+	const char *p;
+
+	out_putc('"');
+	for (p = s; p && *p; p++) {
+		switch (fmt) {
+		case FMT_JSON:
+			if (*p == '"' || *p == '\\') {
+				out_putc('\\');
+				out_putc(*p);
+			} else if (*p == '\n') {
+				out_write("\\n", 2);
+			} else if (*p == '\t') {
+				out_write("\\t", 2);
+			} else if ((unsigned char)*p < 0x20) {
+				table_out_printf("\\u%04x", *p);
+			} else {
+				out_putc(*p);
+			}
+			break;
+		case FMT_CSV:
+			if (*p == '"')
+				out_putc('"');
+			out_putc(*p);
+			break;
+		case FMT_XML:
+			if (*p == '&')
+				out_write("&amp;", 5);
+			else if (*p == '<')
+				out_write("&lt;", 4);
+			else if (*p == '>')
+				out_write("&gt;", 4);
+			else
+				out_putc(*p);
+			break;
+		default:
+			out_putc(*p);
+			break;
+		}
 	}
+	out_putc('"');
+}
 
-	return 0;
+/*
+ * A field of the row @s, strings quoted. Only columns with m_tostr are
+ * formatted on the stack, the others are written from the struct. A
+ * number formatted to nothing is null in JSON.
+ */
+static void out_fld(void *s, struct table_column *c, enum fmt_type fmt,
+		    const struct rnbd_ctx *ctx)
+{
+	void *v = (void *)s + c->s_off + c->m_offset;
+	char str[CLM_MAX_WIDTH];
+	enum color clr;
+	int len;
+
+	if (!c->m_tostr) {
+		if (c->m_type == FLD_STR)
+			out_str(*(const char **)v, fmt);
+		else if (c->m_type == FLD_LLU)
+			out_llu(*(uint64_t *)v);
+		else
+			out_int(*(int *)v);
+		return;
+	}
+
+	len = c->m_tostr(str, sizeof(str), ctx, &clr, v, false);
+	if (len >= (int)sizeof(str))
+		len = sizeof(str) - 1;
+
+	if (c->m_type == FLD_STR)
+		out_str(len > 0 ? str : "", fmt);
+	else if (len > 0)
+		out_write(str, len);
+	else if (fmt == FMT_JSON)
+		out_write("null", 4);
 }
 
-int table_flds_print(enum fmt_type fmt, const char *prefix,
-		     struct table_fld *flds, struct table_column **cs,
-		     bool trm, int pwidth)
+int table_row_out(void *s, enum fmt_type fmt, const char *pre,
+		  struct table_column **cs, const struct rnbd_ctx *ctx)
 {
+	struct table_column *c;
+	int clm;
+
 	switch (fmt) {
-	case FMT_TERM:
-		return table_flds_print_term(prefix, flds, cs, trm, pwidth);
-	case FMT_XML:
-		return table_flds_print_xml(prefix, flds, cs, trm);
 	case FMT_CSV:
-		return table_flds_print_csv(flds, cs, trm);
+		for (c = *cs, clm = 0; c; c = *++cs, clm++) {
+			if (clm)
+				out_putc(',');
+			out_fld(s, c, fmt, ctx);
+		}
+		out_putc('\n');
+		break;
 	case FMT_JSON:
-		return table_flds_print_json(prefix, flds, cs, trm);
+		out_puts(pre);
+		out_putc('{');
+		for (c = *cs, clm = 0; c; c = *++cs, clm++) {
+			out_puts(clm ? ",\n" : "\n");
+			out_puts(pre);
+			out_puts("\t\"");
+			out_puts(c->m_name);
+			out_puts("\": ");
+			out_fld(s, c, fmt, ctx);
+		}
+		out_putc('\n');
+		out_puts(pre);
+		out_putc('}');
+		break;
+	case FMT_XML:
+		for (c = *cs; c; c = *++cs) {
+			out_puts(pre);
+			out_putc('<');
+			out_puts(c->m_name);
+			out_putc('>');
+			out_fld(s, c, fmt, ctx);
+			out_puts("</");
+			out_puts(c->m_name);
+			out_puts(">\n");
+		}
+		break;
 	default:
 		return -EINVAL;
 	}
-}
-
-int table_row_print(void *v, enum fmt_type fmt, const char *pre,
-		    struct table_column **cs, bool trm,
-		    const struct rnbd_ctx *ctx, bool humanize,
-		    size_t pre_len)
-{
-	struct table_fld flds[CLM_MAX_CNT];
-
-	table_row_stringify(v, flds, cs, ctx, humanize, pre_len);
-	table_flds_print(fmt, pre, flds, cs, trm, pre_len);
 
 	return 0;
 }
@@ -258,7 +469,7 @@ int table_row_print_line(const char *pre, struct table_column **clms,
 			flds[clm].str[0] = '\0';
 	}
 
-	table_flds_print(FMT_TERM, pre, flds, clms, trm, pre_len);
+	table_flds_print_term(pre, flds, clms, trm, pre_len);
 
 	return 0;
 }
@@ -315,12 +526,14 @@ void table_header_print_csv(struct table_column **cs)
 	struct table_column *c = *cs;
 
 	if (c)
-		printf("%s", c->m_name);
+		out_puts(c->m_name);
 
-	for (c = *++cs; c; c = *++cs)
-		printf(",%s", c->m_name);
+	for (c = *++cs; c; c = *++cs) {
+		out_putc(',');
+		out_puts(c->m_name);
+	}
 
-	printf("\n");
+	out_putc('\n');
 }
 
 /*
@@ -458,10 +671,99 @@ int table_extend_columns(const char *arg, const char *delim,
 	return 0;
 }
 
+static bool table_clm_is_num(struct table_column *c)
+{
+	return c->m_type == FLD_INT || c->m_type == FLD_LLU;
+}
+
+static void prom_print_labels(void *s, struct table_column **cs,
+			      const struct rnbd_ctx *ctx)
+{
+	struct table_column *c;
+	struct table_fld fld;
+	const char *p;
+	bool first = true;
+
+	for (c = *cs; c; c = *++cs) {
+		if (table_clm_is_num(c))
+			continue;
+		if (!table_fld_stringify(s, c, &fld, ctx, false))
+			continue;
+
+		printf("%s%s=\"", first ? "{" : ",", c->m_name);
+		for (p = fld.str; *p; p++)
+			if (*p == '\\' || *p == '"')
+				printf("\\%c", *p);
+			else if (*p == '\n')
+				printf("\\n");
+			else
+				putchar(*p);
+		putchar('"');
+		first = false;
+	}
+	if (!first)
+		putchar('}');
+}
+
+/*
+ * Print @cnt NULL terminated arrays of rows (NULL arrays are skipped)
+ * in the Prometheus text format. Every numeric column of @cs[i] is the
+ * metric <prefix>_<name>, the other columns of @cs[i] are its labels.
+ * A column present in several arrays is printed as a single metric.
+ * Fields are formatted one at a time, rows are not stringified.
+ */
+int table_rows_print_prom(const char *prefix, void **rows[],
+			  struct table_column **cs[], int cnt,
+			  const struct rnbd_ctx *ctx)
+{
+	struct table_column *c, **clms;
+	struct table_fld fld;
+	int i, j, k;
+
+	for (i = 0; i < cnt; i++) {
+		if (!rows[i])
+			continue;
+
+		for (clms = cs[i]; (c = *clms); clms++) {
+			if (!table_clm_is_num(c))
+				continue;
+			for (j = 0; j < i; j++)
+				if (rows[j] && contains(c, cs[j]))
+					break;
+			if (j < i)
+				continue;
+
+			printf("# HELP %s_%s %s\n", prefix, c->m_name,
+			       c->m_descr);
+			printf("# TYPE %s_%s %s\n", prefix, c->m_name,
+			       c->m_kind == CLM_COUNTER ? "counter" : "gauge");
+
+			for (j = i; j < cnt; j++) {
+				if (!rows[j] || !contains(c, cs[j]))
+					continue;
+
+				for (k = 0; rows[j][k]; k++) {
+					if (!table_fld_stringify(rows[j][k], c,
+								 &fld, ctx,
+								 false))
+						continue;
+
+					printf("%s_%s", prefix, c->m_name);
+					prom_print_labels(rows[j][k], cs[j],
+							  ctx);
+					printf(" %s\n", fld.str);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
 #define CLM_LST(m_name, m_header, m_width, m_type, tostr, align, h_clr, c_clr,\
 		m_descr) \
 	CLM(table_column, m_name, m_header, m_type, tostr, \
-	    align, h_clr, c_clr, m_descr, m_width, 0)
+	    align, h_clr, c_clr, m_descr, m_width, 0, 0)
 
 static int pstr_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 		       enum color *clr, void *v, bool humanize)
@@ -470,8 +772,15 @@ static int pstr_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
 	return snprintf(str, len, "%s", *(char **)v);
 }
 
+static int astr_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+		       enum color *clr, void *v, bool humanize)
+{
+	*clr = 0;
+	return snprintf(str, len, "%s", (char *)v);
+}
+
 CLM_LST(m_name, "Field", 14, FLD_STR, pstr_to_str, 'l', CBLD, CNRM, "");
-CLM_LST(m_header, "Header", 13, FLD_STR, NULL, 'l', CBLD, CNRM, "");
+CLM_LST(m_header, "Header", 13, FLD_STR, astr_to_str, 'l', CBLD, CNRM, "");
 CLM_LST(m_descr, "Description", 50, FLD_STR, pstr_to_str, 'l', CBLD, CNRM, "");
 
 static struct table_column *l_clmns[] = {
@@ -494,3 +803,712 @@ int table_tbl_print_term(const char *prefix, struct table_column **clm,
 
 	return 0;
 }
+
+/* the longer operators first */
+static const struct {
+	const char	*str;
+	enum table_op	op;
+} table_ops[] = {
+	{ "!=", TBL_NE }, { "<=", TBL_LE }, { ">=", TBL_GE },
+	{ "==", TBL_EQ }, { "=", TBL_EQ }, { "<", TBL_LT }, { ">", TBL_GT },
+};
+
+int table_cond_split(const char *str, char *name, size_t len,
+		     enum table_op *op, const char **val)
+{
+	size_t n = strcspn(str, "=!<>");
+	int i;
+
+	if (!n || !str[n] || n >= len)
+		return -EINVAL;
+
+	for (i = 0; i < ARRSIZE(table_ops); i++)
+		if (!strncmp(str + n, table_ops[i].str,
+			     strlen(table_ops[i].str)))
+			break;
+	if (i == ARRSIZE(table_ops))
+		return -EINVAL;
+
+	memcpy(name, str, n);
+	name[n] = '\0';
+	*op = table_ops[i].op;
+	*val = str + n + strlen(table_ops[i].str);
+
+	return 0;
+}
+
+/*
+ * A number with an optional unit, i.e. 1G. Without a unit it is taken
+ * as is, as the fields of the columns with m_tostr are compared in the
+ * unit they are shown unhumanized in.
+ */
+static int table_str_to_num(const char *str, uint64_t *num)
+{
+	char *end;
+	int shift = 0;
+
+	errno = 0;
+	*num = strtoull(str, &end, 10);
+	if (errno || end == str)
+		return -EINVAL;
+	if (*end && get_unit_shift(end, &shift))
+		return -EINVAL;
+
+	*num <<= shift;
+
+	return 0;
+}
+
+int table_query_init(struct table_query *q, const char *sort,
+		     const char *const *where, int where_cnt,
+		     struct table_column **all, bool skip_unknown,
+		     const char **bad)
+{
+	char name[NAME_MAX];
+	struct table_key *k;
+	struct table_cond *c;
+	const char *val;
+	size_t n;
+	int i;
+
+	memset(q, 0, sizeof(*q));
+
+	while (sort && *sort) {
+		n = strcspn(sort, ",");
+		if (q->key_cnt == TBL_KEYS_MAX || n >= sizeof(name))
+			goto err;
+
+		k = &q->keys[q->key_cnt++];
+		k->desc = *sort == '-';
+		if (*sort == '-' || *sort == '+')
+			sort++, n--;
+
+		memcpy(name, sort, n);
+		name[n] = '\0';
+		k->clm = table_find_column(name, all);
+		if (!k->clm && !skip_unknown)
+			goto err;
+		if (!k->clm)
+			q->key_cnt--;
+
+		sort += n;
+		if (*sort)
+			sort++;
+	}
+
+	for (i = 0; i < where_cnt; i++) {
+		if (i % 2) {
+			if (q->cond_cnt == TBL_CONDS_MAX)
+				goto err_where;
+			if (!strcasecmp(where[i], "or"))
+				q->conds[q->cond_cnt].or = true;
+			else if (strcasecmp(where[i], "and"))
+				goto err_where;
+			continue;
+		}
+
+		if (q->cond_cnt == TBL_CONDS_MAX)
+			goto err_where;
+
+		c = &q->conds[q->cond_cnt];
+		if (table_cond_split(where[i], name, sizeof(name), &c->op,
+				     &val))
+			goto err_where;
+
+		/* an unknown field is kept as a condition never met */
+		c->clm = table_find_column(name, all);
+		if (!c->clm && !skip_unknown)
+			goto err_where;
+		if (c->clm && c->clm->m_type == FLD_STR)
+			c->val.str = val;
+		else if (c->clm && table_str_to_num(val, &c->val.num))
+			goto err_where;
+
+		q->cond_cnt++;
+	}
+	/* a dangling "and" or "or" */
+	if (where_cnt && !(where_cnt % 2))
+		goto err_where;
+
+	return 0;
+
+err_where:
+	sort = where[i < where_cnt ? i : where_cnt - 1];
+err:
+	if (bad)
+		*bad = sort;
+
+	return -EINVAL;
+}
+
+/*
+ * The value of the column @c of the row @s: the field itself, or the
+ * unhumanized string of the column if it has m_tostr, kept in @fld.
+ */
+static void table_fld_value(void *s, struct table_column *c,
+			    struct table_fld *fld,
+			    const struct rnbd_ctx *ctx,
+			    struct table_val *val)
+{
+	void *v = (void *)s + c->s_off + c->m_offset;
+
+	if (c->m_tostr) {
+		table_fld_stringify(s, c, fld, ctx, false);
+		if (c->m_type == FLD_STR)
+			val->str = fld->str;
+		else
+			val->num = strtoull(fld->str, NULL, 10);
+		return;
+	}
+
+	if (c->m_type == FLD_STR)
+		val->str = *(const char **)v ? : "";
+	else if (c->m_type == FLD_LLU)
+		val->num = *(uint64_t *)v;
+	else
+		val->num = (int64_t)*(int *)v;
+}
+
+static int table_val_cmp(enum fld_type type, const struct table_val *v1,
+			 const struct table_val *v2)
+{
+	if (type == FLD_STR)
+		return strcmp(v1->str, v2->str);
+	if (type == FLD_LLU)
+		return (v1->num > v2->num) - (v1->num < v2->num);
+
+	return ((int64_t)v1->num > (int64_t)v2->num) -
+	       ((int64_t)v1->num < (int64_t)v2->num);
+}
+
+static bool table_cond_match(void *s, const struct table_cond *c,
+			     const struct rnbd_ctx *ctx)
+{
+	struct table_fld fld;
+	struct table_val val = { NULL };
+	int ret;
+
+	if (!c->clm)
+		return false;
+
+	table_fld_value(s, c->clm, &fld, ctx, &val);
+
+	/* strings are matched against the value as a pattern */
+	if (c->clm->m_type == FLD_STR && (c->op == TBL_EQ || c->op == TBL_NE))
+		return !fnmatch(c->val.str, val.str, 0) == (c->op == TBL_EQ);
+
+	ret = table_val_cmp(c->clm->m_type, &val, &c->val);
+
+	switch (c->op) {
+	case TBL_EQ:
+		return !ret;
+	case TBL_NE:
+		return ret;
+	case TBL_LT:
+		return ret < 0;
+	case TBL_LE:
+		return ret <= 0;
+	case TBL_GT:
+		return ret > 0;
+	case TBL_GE:
+	default:
+		return ret >= 0;
+	}
+}
+
+bool table_row_match(void *s, const struct table_query *q,
+		     const struct rnbd_ctx *ctx)
+{
+	bool match = true;
+	int i;
+
+	for (i = 0; i < q->cond_cnt; i++) {
+		if (q->conds[i].or) {
+			if (match)
+				return true;
+			match = true;
+		}
+		if (match && !table_cond_match(s, &q->conds[i], ctx))
+			match = false;
+	}
+
+	return match;
+}
+
+int table_rows_filter(void **rows, int cnt, const struct table_query *q,
+		      const struct rnbd_ctx *ctx)
+{
+	int i, kept = 0;
+
+	if (!q->cond_cnt)
+		return cnt;
+
+	for (i = 0; i < cnt; i++)
+		if (table_row_match(rows[i], q, ctx))
+			rows[kept++] = rows[i];
+
+	if (kept < cnt)
+		rows[kept] = NULL;
+
+	return kept;
+}
+
+struct table_sort_ent {
+	void			*row;
+	int			idx;
+	struct table_val	keys[TBL_KEYS_MAX];
+};
+
+static const struct table_query *sort_query;
+
+static int compar_sort_ents(const void *p1, const void *p2)
+{
+	const struct table_sort_ent *e1 = p1, *e2 = p2;
+	const struct table_key *k;
+	int i, ret;
+
+	for (i = 0; i < sort_query->key_cnt; i++) {
+		k = &sort_query->keys[i];
+		ret = table_val_cmp(k->clm->m_type, &e1->keys[i],
+				    &e2->keys[i]);
+		if (ret)
+			return k->desc ? -ret : ret;
+	}
+
+	return e1->idx - e2->idx;
+}
+
+/* the strings of the columns with m_tostr are copies */
+static bool table_key_is_copy(const struct table_key *k)
+{
+	return k->clm->m_tostr && k->clm->m_type == FLD_STR;
+}
+
+/*
+ * Take the sort keys of @row, the strings of the columns with m_tostr
+ * are in @flds until they are copied.
+ */
+static void table_sort_ent_init(struct table_sort_ent *e, void *row, int idx,
+				struct table_fld *flds,
+				const struct table_query *q,
+				const struct rnbd_ctx *ctx)
+{
+	int k;
+
+	e->row = row;
+	e->idx = idx;
+	for (k = 0; k < q->key_cnt; k++)
+		table_fld_value(row, q->keys[k].clm, &flds[k], ctx,
+				&e->keys[k]);
+}
+
+static int table_sort_ent_copy(struct table_sort_ent *e,
+			       const struct table_query *q)
+{
+	int k;
+
+	for (k = 0; k < q->key_cnt; k++) {
+		if (!table_key_is_copy(&q->keys[k]))
+			continue;
+		e->keys[k].str = strdup(e->keys[k].str);
+		if (!e->keys[k].str) {
+			while (k--)
+				if (table_key_is_copy(&q->keys[k]))
+					free((char *)e->keys[k].str);
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static void table_sort_ent_free(struct table_sort_ent *e,
+				const struct table_query *q)
+{
+	int k;
+
+	for (k = 0; k < q->key_cnt; k++)
+		if (table_key_is_copy(&q->keys[k]))
+			free((char *)e->keys[k].str);
+}
+
+int table_rows_sort(void **rows, int cnt, const struct table_query *q,
+		    const struct rnbd_ctx *ctx)
+{
+	struct table_fld flds[TBL_KEYS_MAX];
+	struct table_sort_ent *ents;
+	int i, err = 0;
+
+	if (!q->key_cnt || cnt < 2)
+		return 0;
+
+	ents = calloc(cnt, sizeof(*ents));
+	if (!ents)
+		return -ENOMEM;
+
+	for (i = 0; i < cnt; i++) {
+		table_sort_ent_init(&ents[i], rows[i], i, flds, q, ctx);
+		err = table_sort_ent_copy(&ents[i], q);
+		if (err)
+			goto out;
+	}
+
+	sort_query = q;
+	qsort(ents, cnt, sizeof(*ents), compar_sort_ents);
+
+	for (i = 0; i < cnt; i++)
+		rows[i] = ents[i].row;
+out:
+	while (i--)
+		table_sort_ent_free(&ents[i], q);
+	free(ents);
+
+	return err;
+}
+
+/* the root of the @cnt entries of @heap is the one sorted last */
+static void table_heap_down(struct table_sort_ent *heap, int cnt, int i)
+{
+	struct table_sort_ent tmp;
+	int c;
+
+	while ((c = 2 * i + 1) < cnt) {
+		if (c + 1 < cnt && compar_sort_ents(&heap[c + 1], &heap[c]) > 0)
+			c++;
+		if (compar_sort_ents(&heap[c], &heap[i]) <= 0)
+			break;
+		tmp = heap[i];
+		heap[i] = heap[c];
+		heap[c] = tmp;
+		i = c;
+	}
+}
+
+int table_rows_top(void **rows, int cnt, const struct table_query *q, int n,
+		   const struct rnbd_ctx *ctx)
+{
+	struct table_fld flds[TBL_KEYS_MAX];
+	struct table_sort_ent *heap, e;
+	int i, j, len = 0, err = 0;
+
+	if (n >= cnt) {
+		err = table_rows_sort(rows, cnt, q, ctx);
+		return err ? : cnt;
+	}
+	if (!q->key_cnt)
+		goto out;
+
+	heap = calloc(n, sizeof(*heap));
+	if (!heap)
+		return -ENOMEM;
+
+	sort_query = q;
+	for (i = 0; i < cnt; i++) {
+		table_sort_ent_init(&e, rows[i], i, flds, q, ctx);
+		if (len == n && compar_sort_ents(&e, &heap[0]) >= 0)
+			continue;
+		err = table_sort_ent_copy(&e, q);
+		if (err)
+			goto free;
+		if (len < n) {
+			heap[len++] = e;
+			if (len == n)
+				for (j = n / 2 - 1; j >= 0; j--)
+					table_heap_down(heap, n, j);
+			continue;
+		}
+		/* replace the one sorted last so far */
+		table_sort_ent_free(&heap[0], q);
+		heap[0] = e;
+		table_heap_down(heap, n, 0);
+	}
+
+	qsort(heap, n, sizeof(*heap), compar_sort_ents);
+	for (i = 0; i < n; i++)
+		rows[i] = heap[i].row;
+free:
+	for (i = 0; i < len; i++)
+		table_sort_ent_free(&heap[i], q);
+	free(heap);
+	if (err)
+		return err;
+out:
+	rows[n] = NULL;
+
+	return n;
+}
+
+static struct table_column clm_table_group_dir =
+	_CLM(table_group, "direction", dir, "Direction", FLD_STR, NULL, 'l',
+	     CNRM, CNRM, "Direction of the rows", sizeof("Direction") - 1,
+	     0, 0);
+
+static struct table_column clm_table_group_cnt =
+	_CLM(table_group, "rows", cnt, "Rows", FLD_INT, NULL, 'r', CNRM,
+	     CNRM, "Number of rows in the group", sizeof("Rows") - 1, 0, 0);
+
+static void table_groups_init(struct table_groups *g,
+			      const struct table_column *key, const char *dir)
+{
+	struct table_column *c = g->clms;
+	int i;
+
+	/* the value is copied to the group, whatever the column shows */
+	*c = *key;
+	c->m_tostr = NULL;
+	c->m_offset = offsetof(struct table_group, key);
+	c->s_off = 0;
+	c->m_width = c->hdr_width;
+	c++;
+	if (dir)
+		*c++ = clm_table_group_dir;
+	*c++ = clm_table_group_cnt;
+
+	g->clm_cnt = g->sum_clm = c - g->clms;
+	for (i = 0; i < g->clm_cnt; i++)
+		g->cs[i] = &g->clms[i];
+}
+
+/* the mean of no rows at all is left blank */
+static int table_mean_ns_to_str(char *str, size_t len,
+				const struct rnbd_ctx *ctx, enum color *clr,
+				void *v, bool humanize)
+{
+	const struct table_sum *sum = v;
+
+	*clr = CNRM;
+	if (!sum->den)
+		return 0;
+
+	return ns_to_str(str, len, ctx, clr, v, humanize);
+}
+
+/*
+ * The index in the sums of the column @c, added to @g if it is new.
+ * The sums are shown like the rows show the column, unless that needs
+ * the rows. Returns -ENOSPC if there are too many columns.
+ */
+static int table_groups_clm(struct table_groups *g,
+			    const struct table_column *c)
+{
+	struct table_column *gc;
+	int i;
+
+	for (i = g->sum_clm; i < g->clm_cnt; i++)
+		if (!strcmp(g->clms[i].m_name, c->m_name))
+			return i - g->sum_clm;
+
+	if (g->clm_cnt == CLM_MAX_CNT)
+		return -ENOSPC;
+
+	gc = &g->clms[g->clm_cnt];
+	*gc = *c;
+	gc->m_offset = offsetof(struct table_group, sums) +
+		       (g->clm_cnt - g->sum_clm) * sizeof(struct table_sum);
+	gc->s_off = 0;
+	gc->m_width = gc->hdr_width;
+	if (c->m_tostr == sd_rx_to_str || c->m_tostr == sd_tx_to_str ||
+	    c->m_tostr == sd_dc_to_str)
+		gc->m_tostr = sect_to_str;
+	else if (c->m_tostr == path_rx_avg_to_str ||
+		 c->m_tostr == path_tx_avg_to_str)
+		gc->m_tostr = byte_to_str;
+	else if (c->m_tostr == path_latency_to_str)
+		gc->m_tostr = table_mean_ns_to_str;
+	else if (c->m_tostr != byte_to_str)
+		gc->m_tostr = NULL;
+	/* averages are shown as their value, not as the row counts */
+	if (c->m_kind == CLM_MEAN || c->m_kind == CLM_RATIO)
+		gc->m_type = FLD_LLU;
+	g->cs[g->clm_cnt] = gc;
+
+	return g->clm_cnt++ - g->sum_clm;
+}
+
+/* add the value @val of the column @c of the row @s to @sum */
+static void table_sum_add(struct table_sum *sum, void *s,
+			  const struct table_column *c, uint64_t val)
+{
+	void *v = (void *)s + c->s_off;
+
+	switch (c->m_kind) {
+	case CLM_MEAN:
+		sum->num += val;
+		sum->den++;
+		break;
+	case CLM_RATIO:
+		sum->num += *(uint64_t *)(v + c->m_dividend);
+		sum->den += *(uint64_t *)(v + c->m_offset);
+		break;
+	default:
+		if (c->m_type == FLD_INT)
+			sum->i += val;
+		else
+			sum->llu += val;
+		return;
+	}
+	sum->llu = sum->den ? sum->num / sum->den : 0;
+}
+
+static unsigned int fnv1a(unsigned int h, const char *s)
+{
+	while (*s)
+		h = (h ^ (unsigned char)*s++) * 16777619;
+
+	return h;
+}
+
+static unsigned int table_group_hash(const char *dir, const char *key)
+{
+	return fnv1a(fnv1a(2166136261u, dir ? : ""), key);
+}
+
+static struct table_group **table_groups_slot(struct table_groups *g,
+					      const char *dir,
+					      const char *key)
+{
+	unsigned int i, mask = g->hash_size - 1;
+	struct table_group *grp;
+
+	for (i = table_group_hash(dir, key) & mask; (grp = g->hash[i]);
+	     i = (i + 1) & mask)
+		if (!strcmp(grp->key, key) &&
+		    !strcmp(grp->dir ? : "", dir ? : ""))
+			break;
+
+	return &g->hash[i];
+}
+
+/* keep the hash at most half full, the groups fit into half of it */
+static int table_groups_grow(struct table_groups *g)
+{
+	struct table_group **hash, **groups;
+	unsigned int size;
+	int i;
+
+	if ((g->cnt + 1) * 2 <= g->hash_size)
+		return 0;
+
+	size = g->hash_size ? g->hash_size * 2 : 16;
+	groups = realloc(g->groups, (size / 2 + 1) * sizeof(*groups));
+	if (!groups)
+		return -ENOMEM;
+	g->groups = groups;
+
+	hash = calloc(size, sizeof(*hash));
+	if (!hash)
+		return -ENOMEM;
+	free(g->hash);
+	g->hash = hash;
+	g->hash_size = size;
+
+	for (i = 0; i < g->cnt; i++)
+		*table_groups_slot(g, groups[i]->dir, groups[i]->key) =
+			groups[i];
+
+	return 0;
+}
+
+int table_groups_add(struct table_groups *g, void **rows, int cnt,
+		     struct table_column *key, struct table_column **cs,
+		     const char *dir, const struct rnbd_ctx *ctx)
+{
+	struct table_column *sum_cs[CLM_MAX_CNT];
+	struct table_group **slot, *grp;
+	struct table_val val = { NULL };
+	int i, j, sums[CLM_MAX_CNT];
+	struct table_fld fld;
+	int sum_cnt = 0, err;
+
+	if (key->m_type != FLD_STR)
+		return -EINVAL;
+
+	if (!g->clm_cnt)
+		table_groups_init(g, key, dir);
+
+	for (; *cs; cs++) {
+		if (!table_clm_is_num(*cs))
+			continue;
+		j = table_groups_clm(g, *cs);
+		if (j < 0)
+			continue;
+		sum_cs[sum_cnt] = *cs;
+		sums[sum_cnt++] = j;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		err = table_groups_grow(g);
+		if (err)
+			return err;
+
+		table_fld_value(rows[i], key, &fld, ctx, &val);
+		slot = table_groups_slot(g, dir, val.str);
+		grp = *slot;
+		if (!grp) {
+			grp = calloc(1, sizeof(*grp));
+			if (!grp)
+				return -ENOMEM;
+			grp->key = strdup(val.str);
+			if (!grp->key) {
+				free(grp);
+				return -ENOMEM;
+			}
+			grp->dir = dir;
+			*slot = grp;
+			g->groups[g->cnt++] = grp;
+			g->groups[g->cnt] = NULL;
+		}
+
+		grp->cnt++;
+		for (j = 0; j < sum_cnt; j++) {
+			table_fld_value(rows[i], sum_cs[j], &fld, ctx, &val);
+			table_sum_add(&grp->sums[sums[j]], rows[i], sum_cs[j],
+				      val.num);
+		}
+	}
+
+	return 0;
+}
+
+void table_groups_total(const struct table_groups *g,
+			struct table_group *total)
+{
+	const struct table_column *c;
+	const struct table_group *grp;
+	struct table_sum *sum;
+	int i, j;
+
+	memset(total, 0, sizeof(*total));
+	total->key = "";
+	total->dir = "";
+
+	for (i = 0; i < g->cnt; i++) {
+		grp = g->groups[i];
+		total->cnt += grp->cnt;
+		for (j = 0; j < g->clm_cnt - g->sum_clm; j++) {
+			c = &g->clms[g->sum_clm + j];
+			sum = &total->sums[j];
+			if (c->m_kind == CLM_MEAN || c->m_kind == CLM_RATIO) {
+				sum->num += grp->sums[j].num;
+				sum->den += grp->sums[j].den;
+				sum->llu = sum->den ? sum->num / sum->den : 0;
+			} else if (c->m_type == FLD_INT) {
+				sum->i += grp->sums[j].i;
+			} else {
+				sum->llu += grp->sums[j].llu;
+			}
+		}
+	}
+}
+
+void table_groups_free(struct table_groups *g)
+{
+	int i;
+
+	for (i = 0; i < g->cnt; i++) {
+		free((char *)g->groups[i]->key);
+		free(g->groups[i]);
+	}
+	free(g->groups);
+	free(g->hash);
+}
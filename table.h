@@ -16,7 +16,7 @@
 #include <stddef.h>
 
 enum fld_type {
-	FLD_STR,
+	FLD_STR,	/* const char *, unless the column has m_tostr */
 	FLD_VAL,
 	FLD_INT,
 	FLD_LLU
@@ -26,7 +26,8 @@ enum fmt_type {
 	FMT_TERM,
 	FMT_CSV,
 	FMT_JSON,
-	FMT_XML
+	FMT_XML,
+	FMT_PROM
 };
 
 enum color {
@@ -47,6 +48,14 @@ enum color {
 
 struct rnbd_ctx;
 
+/* what a numeric column holds, how it is exported and grouped */
+enum clm_kind {
+	CLM_GAUGE,	/* a level, summed up by groups */
+	CLM_COUNTER,	/* only ever grows, summed up by groups */
+	CLM_MEAN,	/* not summable, groups show the mean of the rows */
+	CLM_RATIO,	/* the field at m_dividend per the one at m_offset */
+};
+
 struct table_column {
 	const char	*m_name;
 	char		m_header[16];
@@ -61,10 +70,13 @@ struct table_column {
 	enum color	hdr_color;
 	enum color	clm_color;
 	unsigned long	s_off;	/* TODO: ugly move to an embedding struct */
+	unsigned int	m_deps;	/* sysfs attributes needed, enum rnbd_attr */
+	enum clm_kind	m_kind;
+	unsigned long	m_dividend;	/* CLM_RATIO: offset of the dividend */
 };
 
-#define _CLM(str, s_name, name, header, type, tostr, align, h_clr, c_clr,\
-	     descr, width, off) \
+#define __CLM(str, s_name, name, header, type, tostr, align, h_clr, c_clr,\
+	      descr, width, off, deps, kind, dividend) \
 	{ \
 		.m_name		= s_name, \
 		.m_header	= header, \
@@ -77,14 +89,47 @@ struct table_column {
 		.clm_align	= align, \
 		.hdr_color	= h_clr, \
 		.clm_color	= c_clr, \
-		.s_off		= off \
+		.s_off		= off, \
+		.m_deps		= deps, \
+		.m_kind		= kind, \
+		.m_dividend	= dividend \
 	}
 
+#define _CLM(str, s_name, name, header, type, tostr, align, h_clr, c_clr,\
+	     descr, width, off, deps) \
+	__CLM(str, s_name, name, header, type, tostr, align, h_clr, c_clr,\
+	      descr, width, off, deps, CLM_GAUGE, 0)
+
+/* a column of a counter which only ever grows */
+#define _CLM_CNT(str, s_name, name, header, type, tostr, align, h_clr,\
+		 c_clr, descr, width, off, deps) \
+	__CLM(str, s_name, name, header, type, tostr, align, h_clr, c_clr,\
+	      descr, width, off, deps, CLM_COUNTER, 0)
+
+/* a column which can't be summed up, groups show the mean of the rows */
+#define _CLM_MEAN(str, s_name, name, header, type, tostr, align, h_clr,\
+		  c_clr, descr, width, off, deps) \
+	__CLM(str, s_name, name, header, type, tostr, align, h_clr, c_clr,\
+	      descr, width, off, deps, CLM_MEAN, 0)
+
+/* the average of the field @dividend per the field @name */
+#define _CLM_RATIO(str, s_name, name, dividend, header, type, tostr, align,\
+		   h_clr, c_clr, descr, width, off, deps) \
+	__CLM(str, s_name, name, header, type, tostr, align, h_clr, c_clr,\
+	      descr, width, off, deps, CLM_RATIO, \
+	      offsetof(struct str, dividend))
+
 #define CLM(str, name, header, type, tostr, align, h_clr, c_clr,\
-	    descr, width, off) \
+	    descr, width, off, deps) \
 struct table_column clm_ ## str ## _ ## name = \
 	_CLM(str, #name, name, header, type, tostr, align, h_clr, c_clr,\
-	     descr, width, off)
+	     descr, width, off, deps)
+
+#define CLM_CNT(str, name, header, type, tostr, align, h_clr, c_clr,\
+		descr, width, off, deps) \
+struct table_column clm_ ## str ## _ ## name = \
+	_CLM_CNT(str, #name, name, header, type, tostr, align, h_clr, c_clr,\
+		 descr, width, off, deps)
 
 #define CLM_MAX_WIDTH 128
 #define CLM_MAX_CNT 50
@@ -120,6 +165,15 @@ int table_row_stringify(void *s, struct table_fld *flds,
 			struct table_column **cs, const struct rnbd_ctx *ctx,
 			bool humanize, int pre_len);
 
+/*
+ * Widen the columns @cs to fit the row @s like table_row_stringify(),
+ * without keeping the strings. Tables of any size are printed with the
+ * memory of a single row: first the widths of all the rows, then every
+ * row with table_row_print().
+ */
+int table_row_widths(void *s, struct table_column **cs,
+		     const struct rnbd_ctx *ctx, bool humanize, int pre_len);
+
 int table_get_max_h_width(struct table_column **cs);
 
 
@@ -133,24 +187,31 @@ int table_fld_print_as_str(struct table_fld *fld, struct table_column *cs,
 int table_flds_print_term(const char *pre, struct table_fld *flds,
 			  struct table_column **cs, bool trm, int pwidth);
 
-int table_flds_print_csv(struct table_fld *flds,
-			 struct table_column **cs, bool trm);
-
-int table_flds_print_json(const char *prefix, struct table_fld *flds,
-			  struct table_column **cs, bool trm);
-
-int table_flds_print_xml(const char *prefix, struct table_fld *flds,
-			 struct table_column **cs, bool trm);
+int table_flds_print_json_line(struct table_fld *flds,
+			       struct table_column **cs);
 
-int table_flds_print(enum fmt_type fmt, const char *prefix,
-		     struct table_fld *flds, struct table_column **cs,
-		     bool trm, int pwidth);
+int table_rows_print_prom(const char *prefix, void **rows[],
+			  struct table_column **cs[], int cnt,
+			  const struct rnbd_ctx *ctx);
 
 int table_row_print(void *v, enum fmt_type fmt, const char *pre,
 		    struct table_column **cs, bool trm,
 		    const struct rnbd_ctx *ctx, bool humanize,
 		    size_t pre_len);
 
+/*
+ * Write the row @s in the machine readable format @fmt (CSV, JSON or
+ * XML) to the output buffer, which is handed to stdout when it is full
+ * or by table_out_flush(). Strings are escaped for @fmt.
+ */
+int table_row_out(void *s, enum fmt_type fmt, const char *pre,
+		  struct table_column **cs, const struct rnbd_ctx *ctx);
+
+int table_out_printf(const char *format, ...)
+	__attribute__ ((format (printf, 1, 2)));
+
+void table_out_flush(void);
+
 int table_row_print_line(const char *pre, struct table_column **clms,
 			 bool trm, size_t pre_len);
 
@@ -160,6 +221,7 @@ void table_flds_del_not_num(struct table_fld *flds,
 int table_header_print_term(const char *prefix, struct table_column **cs,
 			    bool trm);
 
+/* into the output buffer of table_row_out() */
 void table_header_print_csv(struct table_column **cs);
 /*
  * Find column with the name @name in the NULL terminated array
@@ -198,4 +260,151 @@ int table_clm_cnt(struct table_column **cs);
  */
 bool table_has_num(struct table_column **cs);
 
+/* operators of a where condition */
+enum table_op {
+	TBL_EQ,
+	TBL_NE,
+	TBL_LT,
+	TBL_LE,
+	TBL_GT,
+	TBL_GE
+};
+
+#define TBL_KEYS_MAX 4
+#define TBL_CONDS_MAX 16
+
+/* the typed value of a field, str for FLD_STR and num for the others */
+struct table_val {
+	const char	*str;
+	uint64_t	num;
+};
+
+struct table_key {
+	struct table_column	*clm;
+	bool			desc;
+};
+
+struct table_cond {
+	struct table_column	*clm;
+	enum table_op		op;
+	struct table_val	val;
+	bool			or;	/* starts a new alternative */
+};
+
+/* the sort order and the filter of a list */
+struct table_query {
+	struct table_key	keys[TBL_KEYS_MAX];
+	int			key_cnt;
+	struct table_cond	conds[TBL_CONDS_MAX];
+	int			cond_cnt;
+};
+
+/*
+ * Split the condition @str, i.e. "rx_bytes>=1G", into the column name
+ * (copied to @name of size @len), the operator @op and the value @val.
+ * Returns 0 or -EINVAL.
+ */
+int table_cond_split(const char *str, char *name, size_t len,
+		     enum table_op *op, const char **val);
+
+/*
+ * Look up the comma separated columns to sort by @sort (prefixed with
+ * '-' for descending) and the @where_cnt tokens of the conditions
+ * @where ("<col><op><value>" joined by "and" and "or", "and" binding
+ * stronger) in @all. Both may be empty. If @skip_unknown, sort keys
+ * not in @all are left out and conditions on them are never met.
+ * Returns 0 or -EINVAL with @bad set to the token which is wrong.
+ */
+int table_query_init(struct table_query *q, const char *sort,
+		     const char *const *where, int where_cnt,
+		     struct table_column **all, bool skip_unknown,
+		     const char **bad);
+
+/*
+ * Returns whether the row @s matches the conditions of @q. The fields
+ * are compared as they are in @s; only those of columns with m_tostr
+ * are stringified, unhumanized.
+ */
+bool table_row_match(void *s, const struct table_query *q,
+		     const struct rnbd_ctx *ctx);
+
+/*
+ * Keep the ones of the @cnt @rows matching @q in place, in order.
+ * Returns the number of rows kept, the array is NULL terminated after
+ * them if it was after the @cnt.
+ */
+int table_rows_filter(void **rows, int cnt, const struct table_query *q,
+		      const struct rnbd_ctx *ctx);
+
+/*
+ * Sort the @cnt @rows by the keys of @q, rows with equal keys keep
+ * their order. The values are taken from the rows once, not for every
+ * comparison. Returns 0 or -ENOMEM.
+ */
+int table_rows_sort(void **rows, int cnt, const struct table_query *q,
+		    const struct rnbd_ctx *ctx);
+
+/*
+ * Keep the first @n of the @cnt @rows in the order of @q, sorted,
+ * without sorting all of them: the candidates are kept in a heap of @n
+ * entries. Without keys the first @n rows are kept. Returns the number
+ * of rows kept, NULL terminated if it is less than @cnt, or -ENOMEM.
+ */
+int table_rows_top(void **rows, int cnt, const struct table_query *q, int n,
+		   const struct rnbd_ctx *ctx);
+
+/* the sum of a column, of the type of the column */
+/* the sum of a column, or of the dividend and divisor of its average */
+struct table_sum {
+	union {
+		uint64_t	llu;
+		int		i;
+	};
+	uint64_t	num;
+	uint64_t	den;
+};
+
+/* the rows with one value of the column grouped by */
+struct table_group {
+	const char	*key;
+	const char	*dir;	/* the side of the rows, NULL: not shown */
+	int		cnt;
+	struct table_sum sums[CLM_MAX_CNT];
+};
+
+/*
+ * Rows aggregated by the value of a string column: a row for every
+ * value with the number of rows and the sums of their numeric columns,
+ * or the averages of the columns which can't be summed up.
+ */
+struct table_groups {
+	struct table_group	**groups;	/* NULL terminated */
+	int			cnt;
+	struct table_column	clms[CLM_MAX_CNT];
+	struct table_column	*cs[CLM_MAX_CNT + 1];	/* of the groups */
+	int			clm_cnt;
+	int			sum_clm;	/* column of sums[0] */
+	struct table_group	**hash;
+	unsigned int		hash_size;
+};
+
+/*
+ * Add the @cnt @rows to the groups @g (zeroed before the first call) by
+ * the value of the string column @key in a single pass, summing the
+ * numeric columns of @cs; those of rows added by an earlier call are
+ * matched by name. The groups keep the order of their first rows.
+ * Rows of different @dir (NULL for none) are grouped apart, @dir is
+ * shown as a column then. Returns 0, -EINVAL if @key is no string or
+ * -ENOMEM.
+ */
+int table_groups_add(struct table_groups *g, void **rows, int cnt,
+		     struct table_column *key, struct table_column **cs,
+		     const char *dir, const struct rnbd_ctx *ctx);
+
+/* Sum up all the groups of @g in @total */
+void table_groups_total(const struct table_groups *g,
+			struct table_group *total);
+
+void table_groups_free(struct table_groups *g);
+
 #endif /* __H_TABLE */
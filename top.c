@@ -0,0 +1,1541 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Configuration tool for RNBD driver and RTRS library.
+ *
+ * Copyright (c) 2019 1&1 IONOS SE. All rights reserved.
+ * Authors: Danil Kipnis <danil.kipnis@cloud.ionos.com>
+ *          Lutz Pogrell <lutz.pogrell@cloud.ionos.com>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>	/* for TIOCGWINSZ */
+
+#include "top.h"
+
+#include "table.h"
+#include "misc.h"
+#include "rnbd-sysfs.h"
+
+#define NSEC_PER_SEC	1000000000ull
+#define NSEC_PER_MSEC	1000000ull
+
+extern bool trm;
+
+/*
+ * A device, session, path, HCA port or host with the counters of the
+ * last sample and the rates between the last two samples. Sessions, HCA
+ * ports and hosts have no counters of their own, they sum up the
+ * counters of their paths or sessions.
+ */
+struct top_row {
+	char		*name;		/* device, session, path, HCA, host */
+	char		*sessname;	/* the rows own copies of the names */
+	int		port;		/* of HCA ports */
+	const char	*dir;		/* outgoing or incoming, not of HCAs */
+	int		fd;		/* counter attribute, kept open */
+	int		migr_fd;	/* of client paths, or -1 */
+	int		lat_fd;
+	struct top_row	*paths;		/* paths of a session */
+	int		path_cnt;
+	bool		kept;		/* sampled before taken again */
+	struct top_row	*group;		/* HCA port of a path or host of a
+					 * session, summing them up
+					 */
+
+	/* counters of the last sample */
+	uint64_t	rx;		/* bytes */
+	uint64_t	tx;
+	uint64_t	rx_ios;
+	uint64_t	tx_ios;
+	int		inflights;
+
+	/* between the last two samples */
+	uint64_t	rx_delta;
+	uint64_t	tx_delta;
+	uint64_t	rx_ios_delta;
+	uint64_t	tx_ios_delta;
+	int		infl_delta;
+
+	/* per second between the last two samples */
+	uint64_t	rx_rate;
+	uint64_t	tx_rate;
+	uint64_t	rx_iops;
+	uint64_t	tx_iops;
+	uint64_t	rx_avg;		/* bytes per request */
+	uint64_t	tx_avg;
+
+	/* client sessions and paths */
+	uint64_t	migr;		/* requests migrated to another CPU */
+	uint64_t	migr_delta;
+	uint64_t	migr_rate;
+	uint64_t	latency;	/* ns, paths only */
+
+	/* block layer times of devices, ms */
+	uint64_t	rd_ticks;
+	uint64_t	wr_ticks;
+	uint64_t	io_ticks;
+	uint64_t	time_in_queue;
+
+	/* derived from the times between the last two samples */
+	uint64_t	r_await;	/* us per read */
+	uint64_t	w_await;	/* us per write */
+	uint64_t	util;		/* 1/100 % of the time busy */
+	uint64_t	aqu;		/* 1/100 requests in the queue */
+};
+
+static int delta_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+			enum color *clr, void *v, bool humanize)
+{
+	int delta = *(int *)v;
+
+	*clr = CNRM;
+
+	return snprintf(str, len, humanize ? "%+d" : "%d", delta);
+}
+
+static int await_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+			enum color *clr, void *v, bool humanize)
+{
+	*clr = CNRM;
+
+	return snprintf(str, len, "%.2f", *(uint64_t *)v / 1000.0);
+}
+
+static int util_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+		       enum color *clr, void *v, bool humanize)
+{
+	*clr = CNRM;
+
+	return snprintf(str, len, humanize ? "%.1f%%" : "%.1f",
+			*(uint64_t *)v / 100.0);
+}
+
+static int aqu_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+		      enum color *clr, void *v, bool humanize)
+{
+	*clr = CNRM;
+
+	return snprintf(str, len, "%.2f", *(uint64_t *)v / 100.0);
+}
+
+/* server paths have no latency, leave it blank as list does */
+static int latency_to_str(char *str, size_t len, const struct rnbd_ctx *ctx,
+			  enum color *clr, void *v, bool humanize)
+{
+	struct top_row *r = container_of(v, struct top_row, latency);
+
+	*clr = CNRM;
+
+	if (r->lat_fd < 0)
+		return 0;
+
+	return ns_to_str(str, len, ctx, clr, v, humanize);
+}
+
+#define _CLM_T(s_name, m_name, m_header, m_type, tostr, align, c_clr, \
+	       m_descr) \
+	_CLM(top_row, s_name, m_name, m_header, m_type, tostr, align, \
+	     CNRM, c_clr, m_descr, sizeof(m_header) - 1, 0, 0)
+
+static struct table_column clm_top_devname =
+	_CLM_T("devname", name, "Device", FLD_STR, NULL, 'l', CBLD,
+	       "Name of the block device");
+
+static struct table_column clm_top_sess =
+	_CLM_T("sessname", name, "Session", FLD_STR, NULL, 'l', CBLD,
+	       "Name of the session");
+
+static struct table_column clm_top_pathname =
+	_CLM_T("pathname", name, "Path", FLD_STR, path_to_norm, 'l', CNRM,
+	       "Name of the path");
+
+static struct table_column clm_top_sessname =
+	_CLM_T("sessname", sessname, "Session", FLD_STR, NULL, 'l', CNRM,
+	       "Session of the device or path");
+
+static struct table_column clm_top_hca =
+	_CLM_T("hca_name", name, "HCA", FLD_STR, NULL, 'l', CBLD,
+	       "Name of the HCA");
+
+static struct table_column clm_top_port =
+	_CLM_T("port", port, "Port", FLD_VAL, NULL, 'r', CNRM,
+	       "Port of the HCA");
+
+static struct table_column clm_top_host =
+	_CLM_T("host", name, "Host", FLD_STR, NULL, 'l', CBLD,
+	       "Hostname of the counterpart");
+
+static struct table_column clm_top_dir =
+	_CLM_T("direction", dir, "Direction", FLD_STR, NULL, 'l', CNRM,
+	       "Direction of the sessions: incoming or outgoing");
+
+static struct table_column clm_top_rx =
+	_CLM_T("rx", rx_rate, "RX/s", FLD_LLU, byte_to_str, 'r', CNRM,
+	       "Bytes read or received per second");
+
+static struct table_column clm_top_tx =
+	_CLM_T("tx", tx_rate, "TX/s", FLD_LLU, byte_to_str, 'r', CNRM,
+	       "Bytes written or sent per second");
+
+static struct table_column clm_top_rx_iops =
+	_CLM_T("rx_iops", rx_iops, "RX IO/s", FLD_LLU, NULL, 'r', CNRM,
+	       "Reads or receive requests per second");
+
+static struct table_column clm_top_tx_iops =
+	_CLM_T("tx_iops", tx_iops, "TX IO/s", FLD_LLU, NULL, 'r', CNRM,
+	       "Writes or send requests per second");
+
+static struct table_column clm_top_inflights =
+	_CLM_T("inflights", inflights, "Inflights", FLD_INT, NULL, 'r', CNRM,
+	       "Requests in flight");
+
+static struct table_column clm_top_infl_delta =
+	_CLM_T("infl_delta", infl_delta, "+/-", FLD_INT, delta_to_str, 'r',
+	       CNRM, "Change of the requests in flight over the interval");
+
+static struct table_column clm_top_rx_avg =
+	_CLM_T("rx_avg", rx_avg, "RX avg", FLD_LLU, byte_to_str, 'r', CNRM,
+	       "Average size of the reads or receive requests");
+
+static struct table_column clm_top_tx_avg =
+	_CLM_T("tx_avg", tx_avg, "TX avg", FLD_LLU, byte_to_str, 'r', CNRM,
+	       "Average size of the writes or send requests");
+
+static struct table_column clm_top_migr =
+	_CLM_T("migr", migr_rate, "Migr/s", FLD_LLU, NULL, 'r', CNRM,
+	       "Requests per second completed on another CPU (client only)");
+
+static struct table_column clm_top_latency =
+	_CLM_T("latency", latency, "Latency", FLD_LLU, latency_to_str, 'r',
+	       CNRM, "Current latency of the path (client paths only)");
+
+static struct table_column clm_top_r_await =
+	_CLM_T("r_await", r_await, "R ms", FLD_LLU, await_to_str, 'r', CNRM,
+	       "Average time of a read in ms (devices only)");
+
+static struct table_column clm_top_w_await =
+	_CLM_T("w_await", w_await, "W ms", FLD_LLU, await_to_str, 'r', CNRM,
+	       "Average time of a write in ms (devices only)");
+
+static struct table_column clm_top_util =
+	_CLM_T("util", util, "Util", FLD_LLU, util_to_str, 'r', CNRM,
+	       "Share of the time the device was busy (devices only)");
+
+static struct table_column clm_top_aqu =
+	_CLM_T("aqu", aqu, "Queue", FLD_LLU, aqu_to_str, 'r', CNRM,
+	       "Average number of requests queued (devices only)");
+
+struct table_column *all_clms_top[] = {
+	&clm_top_devname,
+	&clm_top_pathname,
+	&clm_top_sessname,
+	&clm_top_hca,
+	&clm_top_port,
+	&clm_top_host,
+	&clm_top_dir,
+	&clm_top_rx,
+	&clm_top_tx,
+	&clm_top_rx_iops,
+	&clm_top_tx_iops,
+	&clm_top_inflights,
+	&clm_top_infl_delta,
+	&clm_top_rx_avg,
+	&clm_top_tx_avg,
+	&clm_top_migr,
+	&clm_top_latency,
+	&clm_top_r_await,
+	&clm_top_w_await,
+	&clm_top_util,
+	&clm_top_aqu,
+	NULL
+};
+
+static struct table_column *clms_top_devices[] = {
+	&clm_top_devname,
+	&clm_top_sessname,
+	&clm_top_rx,
+	&clm_top_tx,
+	&clm_top_rx_iops,
+	&clm_top_tx_iops,
+	&clm_top_inflights,
+	&clm_top_infl_delta,
+	&clm_top_r_await,
+	&clm_top_w_await,
+	&clm_top_util,
+	&clm_top_aqu,
+	NULL
+};
+
+static struct table_column *clms_top_sessions[] = {
+	&clm_top_sess,
+	&clm_top_rx,
+	&clm_top_tx,
+	&clm_top_rx_iops,
+	&clm_top_tx_iops,
+	&clm_top_inflights,
+	&clm_top_infl_delta,
+	&clm_top_rx_avg,
+	&clm_top_tx_avg,
+	&clm_top_migr,
+	NULL
+};
+
+static struct table_column *clms_top_paths[] = {
+	&clm_top_sessname,
+	&clm_top_pathname,
+	&clm_top_rx,
+	&clm_top_tx,
+	&clm_top_rx_iops,
+	&clm_top_tx_iops,
+	&clm_top_inflights,
+	&clm_top_infl_delta,
+	&clm_top_rx_avg,
+	&clm_top_tx_avg,
+	&clm_top_migr,
+	&clm_top_latency,
+	NULL
+};
+
+static struct table_column *clms_top_hcas[] = {
+	&clm_top_hca,
+	&clm_top_port,
+	&clm_top_rx,
+	&clm_top_tx,
+	&clm_top_rx_iops,
+	&clm_top_tx_iops,
+	&clm_top_inflights,
+	&clm_top_infl_delta,
+	&clm_top_rx_avg,
+	&clm_top_tx_avg,
+	NULL
+};
+
+static struct table_column *clms_top_hosts[] = {
+	&clm_top_host,
+	&clm_top_dir,
+	&clm_top_rx,
+	&clm_top_tx,
+	&clm_top_rx_iops,
+	&clm_top_tx_iops,
+	&clm_top_inflights,
+	&clm_top_infl_delta,
+	&clm_top_rx_avg,
+	&clm_top_tx_avg,
+	&clm_top_migr,
+	NULL
+};
+
+/*
+ * Columns of watch: counters, their change since the last sample and
+ * the rates, all as plain numbers.
+ */
+#define CLM_W(s_name, m_name, m_type, tostr, m_descr) \
+	_CLM_T(s_name, m_name, "", m_type, tostr, 'r', CNRM, m_descr)
+
+static struct table_column clm_watch_devname =
+	CLM_W("devname", name, FLD_STR, NULL, "Name of the block device");
+static struct table_column clm_watch_sess =
+	CLM_W("sessname", name, FLD_STR, NULL, "Name of the session");
+static struct table_column clm_watch_pathname =
+	CLM_W("pathname", name, FLD_STR, NULL, "Name of the path");
+static struct table_column clm_watch_sessname =
+	CLM_W("sessname", sessname, FLD_STR, NULL,
+	      "Session of the device or path");
+static struct table_column clm_watch_hca =
+	CLM_W("hca_name", name, FLD_STR, NULL, "Name of the HCA");
+static struct table_column clm_watch_port =
+	CLM_W("port", port, FLD_VAL, NULL, "Port of the HCA");
+static struct table_column clm_watch_host =
+	CLM_W("host", name, FLD_STR, NULL, "Hostname of the counterpart");
+static struct table_column clm_watch_dir =
+	CLM_W("direction", dir, FLD_STR, NULL,
+	      "Direction of the sessions: incoming or outgoing");
+static struct table_column clm_watch_rx_bytes =
+	CLM_W("rx_bytes", rx, FLD_LLU, NULL, "Bytes read or received");
+static struct table_column clm_watch_tx_bytes =
+	CLM_W("tx_bytes", tx, FLD_LLU, NULL, "Bytes written or sent");
+static struct table_column clm_watch_rx_ios =
+	CLM_W("rx_ios", rx_ios, FLD_LLU, NULL, "Reads or receive requests");
+static struct table_column clm_watch_tx_ios =
+	CLM_W("tx_ios", tx_ios, FLD_LLU, NULL, "Writes or send requests");
+static struct table_column clm_watch_inflights =
+	CLM_W("inflights", inflights, FLD_INT, NULL, "Requests in flight");
+static struct table_column clm_watch_rx_delta =
+	CLM_W("rx_delta", rx_delta, FLD_LLU, NULL,
+	      "Bytes read or received since the last sample");
+static struct table_column clm_watch_tx_delta =
+	CLM_W("tx_delta", tx_delta, FLD_LLU, NULL,
+	      "Bytes written or sent since the last sample");
+static struct table_column clm_watch_rx_ios_delta =
+	CLM_W("rx_ios_delta", rx_ios_delta, FLD_LLU, NULL,
+	      "Reads or receive requests since the last sample");
+static struct table_column clm_watch_tx_ios_delta =
+	CLM_W("tx_ios_delta", tx_ios_delta, FLD_LLU, NULL,
+	      "Writes or send requests since the last sample");
+static struct table_column clm_watch_infl_delta =
+	CLM_W("infl_delta", infl_delta, FLD_INT, delta_to_str,
+	      "Change of the requests in flight since the last sample");
+static struct table_column clm_watch_rx_rate =
+	CLM_W("rx_rate", rx_rate, FLD_LLU, NULL,
+	      "Bytes read or received per second");
+static struct table_column clm_watch_tx_rate =
+	CLM_W("tx_rate", tx_rate, FLD_LLU, NULL,
+	      "Bytes written or sent per second");
+static struct table_column clm_watch_rx_iops =
+	CLM_W("rx_iops", rx_iops, FLD_LLU, NULL,
+	      "Reads or receive requests per second");
+static struct table_column clm_watch_tx_iops =
+	CLM_W("tx_iops", tx_iops, FLD_LLU, NULL,
+	      "Writes or send requests per second");
+static struct table_column clm_watch_rx_avg =
+	CLM_W("rx_avg", rx_avg, FLD_LLU, NULL,
+	      "Bytes per read or receive request since the last sample");
+static struct table_column clm_watch_tx_avg =
+	CLM_W("tx_avg", tx_avg, FLD_LLU, NULL,
+	      "Bytes per write or send request since the last sample");
+static struct table_column clm_watch_migr =
+	CLM_W("cpu_migr", migr, FLD_LLU, NULL,
+	      "Requests completed on another CPU");
+static struct table_column clm_watch_migr_delta =
+	CLM_W("migr_delta", migr_delta, FLD_LLU, NULL,
+	      "Requests completed on another CPU since the last sample");
+static struct table_column clm_watch_migr_rate =
+	CLM_W("migr_rate", migr_rate, FLD_LLU, NULL,
+	      "Requests completed on another CPU per second");
+static struct table_column clm_watch_latency =
+	CLM_W("latency", latency, FLD_LLU, NULL,
+	      "Current latency of the path in ns");
+static struct table_column clm_watch_rd_ticks =
+	CLM_W("rd_ticks", rd_ticks, FLD_LLU, NULL, "Milliseconds spent reading");
+static struct table_column clm_watch_wr_ticks =
+	CLM_W("wr_ticks", wr_ticks, FLD_LLU, NULL, "Milliseconds spent writing");
+static struct table_column clm_watch_io_ticks =
+	CLM_W("io_ticks", io_ticks, FLD_LLU, NULL,
+	      "Milliseconds the device was busy");
+static struct table_column clm_watch_time_in_queue =
+	CLM_W("time_in_queue", time_in_queue, FLD_LLU, NULL,
+	      "Milliseconds requests waited in total");
+static struct table_column clm_watch_r_await =
+	CLM_W("r_await", r_await, FLD_LLU, await_to_str,
+	      "Average time of a read in ms since the last sample");
+static struct table_column clm_watch_w_await =
+	CLM_W("w_await", w_await, FLD_LLU, await_to_str,
+	      "Average time of a write in ms since the last sample");
+static struct table_column clm_watch_util =
+	CLM_W("util", util, FLD_LLU, util_to_str,
+	      "Percentage of the time busy since the last sample");
+static struct table_column clm_watch_aqu =
+	CLM_W("aqu", aqu, FLD_LLU, aqu_to_str,
+	      "Average number of requests queued since the last sample");
+
+#define CLMS_WATCH_VALUES \
+	&clm_watch_rx_bytes, \
+	&clm_watch_tx_bytes, \
+	&clm_watch_rx_ios, \
+	&clm_watch_tx_ios, \
+	&clm_watch_inflights, \
+	&clm_watch_rx_delta, \
+	&clm_watch_tx_delta, \
+	&clm_watch_rx_ios_delta, \
+	&clm_watch_tx_ios_delta, \
+	&clm_watch_infl_delta, \
+	&clm_watch_rx_rate, \
+	&clm_watch_tx_rate, \
+	&clm_watch_rx_iops, \
+	&clm_watch_tx_iops, \
+	&clm_watch_rx_avg, \
+	&clm_watch_tx_avg
+
+/* RTRS counters, sessions and paths only */
+#define CLMS_WATCH_RTRS \
+	&clm_watch_migr, \
+	&clm_watch_migr_delta, \
+	&clm_watch_migr_rate
+
+/* block layer times, devices only */
+#define CLMS_WATCH_BLK \
+	&clm_watch_rd_ticks, \
+	&clm_watch_wr_ticks, \
+	&clm_watch_io_ticks, \
+	&clm_watch_time_in_queue, \
+	&clm_watch_r_await, \
+	&clm_watch_w_await, \
+	&clm_watch_util, \
+	&clm_watch_aqu
+
+struct table_column *all_clms_watch[] = {
+	&clm_watch_devname,
+	&clm_watch_pathname,
+	&clm_watch_sessname,
+	&clm_watch_hca,
+	&clm_watch_port,
+	&clm_watch_host,
+	&clm_watch_dir,
+	CLMS_WATCH_VALUES,
+	CLMS_WATCH_RTRS,
+	&clm_watch_latency,
+	CLMS_WATCH_BLK,
+	NULL
+};
+
+/* the name columns come first, they are always shown */
+static struct table_column *clms_watch_devices[] = {
+	&clm_watch_devname,
+	&clm_watch_sessname,
+	CLMS_WATCH_VALUES,
+	CLMS_WATCH_BLK,
+	NULL
+};
+
+static struct table_column *clms_watch_sessions[] = {
+	&clm_watch_sess,
+	CLMS_WATCH_VALUES,
+	CLMS_WATCH_RTRS,
+	NULL
+};
+
+static struct table_column *clms_watch_paths[] = {
+	&clm_watch_sessname,
+	&clm_watch_pathname,
+	CLMS_WATCH_VALUES,
+	CLMS_WATCH_RTRS,
+	&clm_watch_latency,
+	NULL
+};
+
+static struct table_column *clms_watch_hcas[] = {
+	&clm_watch_hca,
+	&clm_watch_port,
+	CLMS_WATCH_VALUES,
+	NULL
+};
+
+static struct table_column *clms_watch_hosts[] = {
+	&clm_watch_host,
+	&clm_watch_dir,
+	CLMS_WATCH_VALUES,
+	CLMS_WATCH_RTRS,
+	NULL
+};
+
+/*
+ * One table of the screen, the rows are sorted on every refresh
+ */
+struct top_tbl {
+	const char		*name;
+	struct top_row		**rows;
+	int			cnt;
+	struct table_column	**cs;
+	struct table_column	*sort;	/* NULL: by rx + tx */
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/* the counters start over when they are reset */
+static uint64_t delta(uint64_t cur, uint64_t prev, uint64_t ns)
+{
+	return ns && cur >= prev ? cur - prev : 0;
+}
+
+static uint64_t rate(uint64_t delta, uint64_t ns)
+{
+	return ns ? (double)delta * NSEC_PER_SEC / ns : 0;
+}
+
+/*
+ * Store the counters of a new sample taken @ns after the previous one,
+ * @ns is 0 for the first sample.
+ */
+static void row_update(struct top_row *r, uint64_t rx, uint64_t tx,
+		       uint64_t rx_ios, uint64_t tx_ios, int inflights,
+		       uint64_t ns)
+{
+	r->rx_delta = delta(rx, r->rx, ns);
+	r->tx_delta = delta(tx, r->tx, ns);
+	r->rx_ios_delta = delta(rx_ios, r->rx_ios, ns);
+	r->tx_ios_delta = delta(tx_ios, r->tx_ios, ns);
+	r->infl_delta = ns ? inflights - r->inflights : 0;
+
+	r->rx_rate = rate(r->rx_delta, ns);
+	r->tx_rate = rate(r->tx_delta, ns);
+	r->rx_iops = rate(r->rx_ios_delta, ns);
+	r->tx_iops = rate(r->tx_ios_delta, ns);
+	r->rx_avg = r->rx_ios_delta ? r->rx_delta / r->rx_ios_delta : 0;
+	r->tx_avg = r->tx_ios_delta ? r->tx_delta / r->tx_ios_delta : 0;
+
+	r->rx = rx;
+	r->tx = tx;
+	r->rx_ios = rx_ios;
+	r->tx_ios = tx_ios;
+	r->inflights = inflights;
+}
+
+/*
+ * Average time per request, time busy and queue depth like iostat -x,
+ * the times of the block layer are in ms.
+ */
+static void row_update_blk(struct top_row *r, const struct rnbd_blk_stat *st,
+			   uint64_t ns)
+{
+	uint64_t rd = delta(st->rd_ticks, r->rd_ticks, ns);
+	uint64_t wr = delta(st->wr_ticks, r->wr_ticks, ns);
+	uint64_t io = delta(st->io_ticks, r->io_ticks, ns);
+	uint64_t queue = delta(st->time_in_queue, r->time_in_queue, ns);
+
+	r->r_await = r->rx_ios_delta ? rd * 1000 / r->rx_ios_delta : 0;
+	r->w_await = r->tx_ios_delta ? wr * 1000 / r->tx_ios_delta : 0;
+	r->util = ns ? (double)io * NSEC_PER_MSEC * 10000 / ns : 0;
+	if (r->util > 10000)
+		r->util = 10000;
+	r->aqu = ns ? (double)queue * NSEC_PER_MSEC * 100 / ns : 0;
+
+	r->rd_ticks = st->rd_ticks;
+	r->wr_ticks = st->wr_ticks;
+	r->io_ticks = st->io_ticks;
+	r->time_in_queue = st->time_in_queue;
+}
+
+/*
+ * A counter which can't be read anymore counts as 0. Returns false if
+ * the counter was open but couldn't be read, the object is gone then.
+ */
+static bool sample_dev(struct top_row *r, uint64_t ns)
+{
+	struct rnbd_blk_stat st;
+	bool ok = true;
+
+	if (r->fd < 0 || rnbd_sysfs_read_blk_stat(r->fd, &st)) {
+		ok = r->fd < 0;
+		memset(&st, 0, sizeof(st));
+	}
+
+	row_update(r, (uint64_t)st.rd_sect << 9, (uint64_t)st.wr_sect << 9,
+		   st.rd_ios, st.wr_ios, st.in_flight, ns);
+	row_update_blk(r, &st, ns);
+
+	return ok;
+}
+
+static void row_update_migr(struct top_row *r, uint64_t migr, uint64_t ns)
+{
+	r->migr_delta = delta(migr, r->migr, ns);
+	r->migr_rate = rate(r->migr_delta, ns);
+	r->migr = migr;
+}
+
+static bool sample_path(struct top_row *r, uint64_t ns)
+{
+	unsigned long migr = 0, latency = 0;
+	struct rnbd_rdma_stat st;
+	bool ok = true;
+
+	if (r->fd < 0 || rnbd_sysfs_read_rdma_stat(r->fd, &st)) {
+		ok = r->fd < 0;
+		memset(&st, 0, sizeof(st));
+	}
+	if (r->migr_fd >= 0)
+		rnbd_sysfs_read_cpu_migr(r->migr_fd, &migr);
+	if (r->lat_fd >= 0)
+		rnbd_sysfs_read_latency(r->lat_fd, &latency);
+
+	row_update(r, st.rx_bytes, st.tx_bytes, st.rx_cnt, st.tx_cnt,
+		   st.inflights, ns);
+	row_update_migr(r, migr, ns);
+	r->latency = latency;
+
+	return ok;
+}
+
+/* add the counters of the last sample of @from to @to */
+static void row_add(struct top_row *to, const struct top_row *from)
+{
+	to->rx += from->rx;
+	to->tx += from->tx;
+	to->rx_ios += from->rx_ios;
+	to->tx_ios += from->tx_ios;
+	to->inflights += from->inflights;
+	to->migr += from->migr;
+}
+
+static void row_update_sum(struct top_row *r, const struct top_row *sum,
+			   uint64_t ns)
+{
+	row_update(r, sum->rx, sum->tx, sum->rx_ios, sum->tx_ios,
+		   sum->inflights, ns);
+	row_update_migr(r, sum->migr, ns);
+}
+
+static bool sample_sess(struct top_row *r, uint64_t ns)
+{
+	struct top_row sum = {};
+	bool ok = true;
+	int i;
+
+	for (i = 0; i < r->path_cnt; i++) {
+		if (!sample_path(&r->paths[i], ns))
+			ok = false;
+		row_add(&sum, &r->paths[i]);
+	}
+	row_update_sum(r, &sum, ns);
+
+	return ok;
+}
+
+/*
+ * Sum up the @rows in the group @r, the paths and sessions are sampled
+ * before
+ */
+static void sample_group(struct top_row *r, struct top_row *rows, int cnt,
+			 uint64_t ns)
+{
+	struct top_row sum = {};
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		if (rows[i].group == r)
+			row_add(&sum, &rows[i]);
+	row_update_sum(r, &sum, ns);
+}
+
+static const struct table_column *sort_clm;
+
+static int compar_u64_desc(uint64_t v1, uint64_t v2)
+{
+	return (v1 < v2) - (v1 > v2);
+}
+
+static int compar_rows(const void *p1, const void *p2)
+{
+	const struct top_row *r1 = *(const struct top_row **)p1;
+	const struct top_row *r2 = *(const struct top_row **)p2;
+	const void *v1, *v2;
+	int ret;
+
+	if (!sort_clm) {
+		ret = compar_u64_desc(r1->rx_rate + r1->tx_rate,
+				      r2->rx_rate + r2->tx_rate);
+	} else {
+		v1 = (const char *)r1 + sort_clm->m_offset;
+		v2 = (const char *)r2 + sort_clm->m_offset;
+
+		switch (sort_clm->m_type) {
+		case FLD_STR:
+			ret = strcmp(*(const char **)v1, *(const char **)v2);
+			break;
+		case FLD_LLU:
+			ret = compar_u64_desc(*(const uint64_t *)v1,
+					      *(const uint64_t *)v2);
+			break;
+		default:
+			ret = (*(const int *)v1 < *(const int *)v2) -
+			      (*(const int *)v1 > *(const int *)v2);
+			break;
+		}
+	}
+	if (!ret)
+		ret = strcmp(r1->sessname, r2->sessname);
+	if (!ret)
+		ret = strcmp(r1->name, r2->name);
+	if (!ret)
+		ret = r1->port - r2->port;
+	if (!ret && r1->dir && r2->dir)
+		ret = strcmp(r1->dir, r2->dir);
+
+	return ret;
+}
+
+/* the root of the first @cnt @rows is the one sorted last */
+static void rows_heap_down(struct top_row **rows, int cnt, int i)
+{
+	struct top_row *tmp;
+	int c;
+
+	while ((c = 2 * i + 1) < cnt) {
+		if (c + 1 < cnt && compar_rows(&rows[c + 1], &rows[c]) > 0)
+			c++;
+		if (compar_rows(&rows[c], &rows[i]) <= 0)
+			break;
+		tmp = rows[i];
+		rows[i] = rows[c];
+		rows[c] = tmp;
+		i = c;
+	}
+}
+
+/*
+ * Sort the first @n rows of @tbl to its front. Only a heap of @n rows
+ * is kept ordered while going through the others.
+ */
+static void tbl_sort(struct top_tbl *tbl, int n)
+{
+	struct top_row **rows = tbl->rows, *tmp;
+	int i;
+
+	sort_clm = tbl->sort;
+	if (n < tbl->cnt) {
+		for (i = n / 2 - 1; i >= 0; i--)
+			rows_heap_down(rows, n, i);
+		for (i = n; i < tbl->cnt; i++) {
+			if (compar_rows(&rows[i], &rows[0]) >= 0)
+				continue;
+			tmp = rows[0];
+			rows[0] = rows[i];
+			rows[i] = tmp;
+			rows_heap_down(rows, n, 0);
+		}
+	}
+	qsort(rows, n, sizeof(*rows), compar_rows);
+}
+
+/*
+ * The rows and tables of a top or watch run
+ */
+struct top {
+	struct top_row		*devs;
+	int			dev_cnt;
+	struct top_row		*sess;
+	int			sess_cnt;
+	struct top_row		*paths;
+	int			path_cnt;
+	struct top_row		*hcas;
+	int			hca_cnt;
+	struct top_row		*hosts;
+	int			host_cnt;
+	struct top_row		**ptrs;		/* rows of the tables */
+	struct top_tbl		tbls[5];
+	int			tbl_cnt;
+	struct table_fld	*flds;		/* of the longest table */
+	uint64_t		ns;		/* since the last sample */
+	struct timespec		time;		/* of the last sample */
+	bool			stale;		/* a counter couldn't be read */
+};
+
+/* take the objects again at least every 10s */
+#define TOP_RESCAN_NS	(10 * NSEC_PER_SEC)
+
+/*
+ * Number of lines of the terminal, 0 if the output is no terminal
+ */
+static int term_lines(void)
+{
+	struct winsize ws;
+
+	if (!trm || ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws))
+		return 0;
+
+	return ws.ws_row;
+}
+
+static void top_print(struct top *t, int refresh, const struct rnbd_ctx *ctx)
+{
+	int i, j, n, cs_cnt, lines, max = 0;
+	struct table_fld *flds = t->flds;
+	struct top_tbl *tbl;
+	char tm[16];
+
+	/* title, then an empty line and a header for every table */
+	lines = term_lines();
+	if (lines) {
+		max = (lines - 2) / t->tbl_cnt - 2;
+		if (max < 1)
+			max = 1;
+	}
+
+	strftime(tm, sizeof(tm), "%H:%M:%S", localtime(&t->time.tv_sec));
+
+	if (trm)
+		printf("\x1B[H\x1B[2J");
+	else if (refresh)
+		printf("\n");
+	clr_print(trm, CBLD, "%s top - %s, every %u.%03us\n", ctx->pname, tm,
+		  ctx->interval_ms / 1000, ctx->interval_ms % 1000);
+
+	for (i = 0; i < t->tbl_cnt; i++) {
+		tbl = &t->tbls[i];
+
+		n = max && max < tbl->cnt ? max : tbl->cnt;
+		if (ctx->limit_set && ctx->limit < n)
+			n = ctx->limit;
+		tbl_sort(tbl, n);
+
+		cs_cnt = table_clm_cnt(tbl->cs);
+		for (j = 0; j < n; j++)
+			table_row_stringify(tbl->rows[j], flds + j * cs_cnt,
+					    tbl->cs, ctx, true, 0);
+
+		printf("\n");
+		if (!ctx->noheaders_set)
+			table_header_print_term("", tbl->cs, trm);
+		for (j = 0; j < n; j++)
+			table_flds_print_term("", flds + j * cs_cnt, tbl->cs,
+					      trm, 0);
+	}
+	fflush(stdout);
+}
+
+/*
+ * One line of JSON per sample: the time of the sample, the seconds since
+ * the previous one and the rows of all the tables.
+ */
+static void watch_print(struct top *t, int refresh,
+			const struct rnbd_ctx *ctx)
+{
+	struct table_fld *flds = t->flds;
+	struct top_tbl *tbl;
+	int i, j;
+
+	printf("{\"time\": %lld.%03ld, \"interval\": %.3f",
+	       (long long)t->time.tv_sec, t->time.tv_nsec / 1000000,
+	       (double)t->ns / NSEC_PER_SEC);
+
+	for (i = 0; i < t->tbl_cnt; i++) {
+		tbl = &t->tbls[i];
+
+		printf(", \"%s\": [", tbl->name);
+		for (j = 0; j < tbl->cnt; j++) {
+			table_row_stringify(tbl->rows[j], flds, tbl->cs, ctx,
+					    false, 0);
+			if (j)
+				printf(", ");
+			table_flds_print_json_line(flds, tbl->cs);
+		}
+		printf("]");
+	}
+	printf("}\n");
+	fflush(stdout);
+}
+
+static int count_sds(struct rnbd_sess_dev **sds)
+{
+	int cnt = 0;
+
+	while (sds && sds[cnt])
+		cnt++;
+
+	return cnt;
+}
+
+static int count_paths(struct rnbd_sess **sess, int *sess_cnt)
+{
+	int cnt = 0;
+
+	for (; sess && *sess; sess++) {
+		cnt += (*sess)->path_cnt;
+		(*sess_cnt)++;
+	}
+
+	return cnt;
+}
+
+static struct top_row *rows_alloc(int cnt)
+{
+	struct top_row *rows = calloc(cnt + 1, sizeof(*rows));
+	int i;
+
+	for (i = 0; rows && i < cnt; i++)
+		rows[i].fd = rows[i].migr_fd = rows[i].lat_fd = -1;
+
+	return rows;
+}
+
+/* the rows keep their names while the objects are taken again */
+static int row_names(struct top_row *r, const char *name,
+		     const char *sessname)
+{
+	r->name = strdup(name ? : "");
+	r->sessname = strdup(sessname ? : "");
+
+	return r->name && r->sessname ? 0 : -ENOMEM;
+}
+
+static const char *host_dir(enum rnbdmode side)
+{
+	return side == RNBD_CLIENT ? "outgoing" : "incoming";
+}
+
+static int init_devs(struct rnbd_sess_dev **sds, enum rnbdmode side,
+		     struct top_row **r)
+{
+	for (; sds && *sds; sds++, (*r)++) {
+		if (row_names(*r, (*sds)->dev->devname,
+			      (*sds)->sess ? (*sds)->sess->sessname : ""))
+			return -ENOMEM;
+		(*r)->dir = host_dir(side);
+		(*r)->fd = rnbd_sysfs_open_dev_stat((*r)->name);
+	}
+
+	return 0;
+}
+
+static int init_hcas(struct rnbd_hca_port **ports, struct top_row *r)
+{
+	for (; ports && *ports; ports++, r++) {
+		if (row_names(r, (*ports)->hca_name, ""))
+			return -ENOMEM;
+		r->port = (*ports)->port;
+	}
+
+	return 0;
+}
+
+static struct top_row *find_hca(struct top_row *hcas, int cnt,
+				const struct rnbd_path *p)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		if (hcas[i].port == p->hca_port &&
+		    !strcmp(hcas[i].name, p->hca_name))
+			return &hcas[i];
+
+	return NULL;
+}
+
+static int init_hosts(struct rnbd_host **hosts, struct top_row *r)
+{
+	for (; hosts && *hosts; hosts++, r++) {
+		if (row_names(r, (*hosts)->hostname, ""))
+			return -ENOMEM;
+		r->dir = host_dir((*hosts)->side);
+	}
+
+	return 0;
+}
+
+static struct top_row *find_host(struct top_row *hosts, int cnt,
+				 const struct rnbd_sess *s)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		if (hosts[i].dir == host_dir(s->side) &&
+		    !strcmp(hosts[i].name, rnbd_sess_host(s)))
+			return &hosts[i];
+
+	return NULL;
+}
+
+static int init_sess(struct rnbd_sess **sess, struct top_row **s,
+		     struct top_row **p, const struct top *t)
+{
+	struct rnbd_sess *rs;
+	int i;
+
+	for (; sess && *sess; sess++, (*s)++) {
+		rs = *sess;
+
+		if (row_names(*s, rs->sessname, rs->sessname))
+			return -ENOMEM;
+		(*s)->dir = host_dir(rs->side);
+		(*s)->paths = *p;
+		(*s)->path_cnt = rs->path_cnt;
+		(*s)->group = find_host(t->hosts, t->host_cnt, rs);
+
+		for (i = 0; i < rs->path_cnt; i++, (*p)++) {
+			if (row_names(*p, rs->paths[i]->pathname,
+				      rs->sessname))
+				return -ENOMEM;
+			(*p)->dir = (*s)->dir;
+			(*p)->group = find_hca(t->hcas, t->hca_cnt,
+					       rs->paths[i]);
+			(*p)->fd = rnbd_sysfs_open_path_stat(rs->side,
+							     rs->sessname,
+							     (*p)->name);
+			if (rs->side != RNBD_CLIENT)
+				continue;
+			(*p)->migr_fd =
+				rnbd_sysfs_open_path_cpu_migr(rs->sessname,
+							      (*p)->name);
+			(*p)->lat_fd =
+				rnbd_sysfs_open_path_latency(rs->sessname,
+							     (*p)->name);
+		}
+	}
+
+	return 0;
+}
+
+static void free_rows(struct top_row *rows, int cnt)
+{
+	int i;
+
+	for (i = 0; rows && i < cnt; i++) {
+		if (rows[i].fd >= 0)
+			close(rows[i].fd);
+		if (rows[i].migr_fd >= 0)
+			close(rows[i].migr_fd);
+		if (rows[i].lat_fd >= 0)
+			close(rows[i].lat_fd);
+		free(rows[i].name);
+		free(rows[i].sessname);
+	}
+	free(rows);
+}
+
+static void tbl_add(struct top *t, const char *name, struct top_row *rows,
+		    int cnt, struct table_column **cs, struct top_row ***ptrs,
+		    const struct rnbd_ctx *ctx)
+{
+	struct top_tbl *tbl = &t->tbls[t->tbl_cnt++];
+	int i;
+
+	tbl->name = name;
+	tbl->rows = *ptrs;
+	tbl->cnt = cnt;
+	tbl->cs = cs;
+	tbl->sort = ctx->sort_set ? table_find_column(ctx->sort, cs) : NULL;
+
+	for (i = 0; i < cnt; i++)
+		tbl->rows[i] = &rows[i];
+	*ptrs += cnt;
+}
+
+static void top_free(struct top *t)
+{
+	free(t->flds);
+	free(t->ptrs);
+	free_rows(t->hcas, t->hca_cnt);
+	free_rows(t->hosts, t->host_cnt);
+	free_rows(t->paths, t->path_cnt);
+	free_rows(t->sess, t->sess_cnt);
+	free_rows(t->devs, t->dev_cnt);
+}
+
+/*
+ * Set up the rows of the objects in @objs of @src and open their
+ * counters. The tables show the columns @cs of devices, sessions,
+ * paths, HCA ports and hosts.
+ */
+static int top_init(struct top *t, const struct top_src *src,
+		    unsigned int objs, struct table_column **cs[5],
+		    const struct rnbd_ctx *ctx)
+{
+	struct top_row *d, *s, *p, **ptr;
+	int i, max_cs = 0, max_cnt = 0;
+
+	memset(t, 0, sizeof(*t));
+
+	if (objs & TOP_DEVICES)
+		t->dev_cnt = count_sds(src->sds_clt) + count_sds(src->sds_srv);
+	if (objs & (TOP_SESSIONS | TOP_PATHS | TOP_HCAS | TOP_HOSTS))
+		t->path_cnt = count_paths(src->sess_clt, &t->sess_cnt) +
+			      count_paths(src->sess_srv, &t->sess_cnt);
+	if (objs & TOP_HCAS)
+		while (src->ports && src->ports[t->hca_cnt])
+			t->hca_cnt++;
+	if (objs & TOP_HOSTS)
+		while (src->hosts && src->hosts[t->host_cnt])
+			t->host_cnt++;
+
+	t->devs = rows_alloc(t->dev_cnt);
+	t->sess = rows_alloc(t->sess_cnt);
+	t->paths = rows_alloc(t->path_cnt);
+	t->hcas = rows_alloc(t->hca_cnt);
+	t->hosts = rows_alloc(t->host_cnt);
+	t->ptrs = calloc(t->dev_cnt + t->sess_cnt + t->path_cnt +
+			 t->hca_cnt + t->host_cnt + 1, sizeof(*t->ptrs));
+	if (!t->devs || !t->sess || !t->paths || !t->hcas || !t->hosts ||
+	    !t->ptrs)
+		goto err;
+
+	if (objs & TOP_DEVICES) {
+		d = t->devs;
+		if (init_devs(src->sds_clt, RNBD_CLIENT, &d) ||
+		    init_devs(src->sds_srv, RNBD_SERVER, &d))
+			goto err;
+	}
+	if ((objs & TOP_HCAS) && init_hcas(src->ports, t->hcas))
+		goto err;
+	if ((objs & TOP_HOSTS) && init_hosts(src->hosts, t->hosts))
+		goto err;
+	if (objs & (TOP_SESSIONS | TOP_PATHS | TOP_HCAS | TOP_HOSTS)) {
+		s = t->sess;
+		p = t->paths;
+		if (init_sess(src->sess_clt, &s, &p, t) ||
+		    init_sess(src->sess_srv, &s, &p, t))
+			goto err;
+	}
+
+	ptr = t->ptrs;
+	if (objs & TOP_DEVICES)
+		tbl_add(t, "devices", t->devs, t->dev_cnt, cs[0], &ptr, ctx);
+	if (objs & TOP_SESSIONS)
+		tbl_add(t, "sessions", t->sess, t->sess_cnt, cs[1], &ptr, ctx);
+	if (objs & TOP_PATHS)
+		tbl_add(t, "paths", t->paths, t->path_cnt, cs[2], &ptr, ctx);
+	if (objs & TOP_HCAS)
+		tbl_add(t, "hcas", t->hcas, t->hca_cnt, cs[3], &ptr, ctx);
+	if (objs & TOP_HOSTS)
+		tbl_add(t, "hosts", t->hosts, t->host_cnt, cs[4], &ptr, ctx);
+
+	for (i = 0; i < t->tbl_cnt; i++) {
+		if (max_cnt < t->tbls[i].cnt)
+			max_cnt = t->tbls[i].cnt;
+		if (max_cs < table_clm_cnt(t->tbls[i].cs))
+			max_cs = table_clm_cnt(t->tbls[i].cs);
+	}
+
+	t->flds = calloc(max_cnt * max_cs + 1, sizeof(*t->flds));
+	if (!t->flds)
+		goto err;
+
+	return 0;
+
+err:
+	ERR(trm, "not enough memory\n");
+	top_free(t);
+
+	return -ENOMEM;
+}
+
+static void sample_all(struct top *t, uint64_t ns)
+{
+	int i;
+
+	for (i = 0; i < t->dev_cnt; i++)
+		if (!sample_dev(&t->devs[i], ns))
+			t->stale = true;
+	for (i = 0; i < t->sess_cnt; i++)
+		if (!sample_sess(&t->sess[i], ns))
+			t->stale = true;
+	for (i = 0; i < t->hca_cnt; i++)
+		sample_group(&t->hcas[i], t->paths, t->path_cnt, ns);
+	for (i = 0; i < t->host_cnt; i++)
+		sample_group(&t->hosts[i], t->sess, t->sess_cnt, ns);
+
+	t->ns = ns;
+	clock_gettime(CLOCK_REALTIME, &t->time);
+}
+
+static unsigned int fnv1a(unsigned int h, const char *s)
+{
+	while (*s)
+		h = (h ^ (unsigned char)*s++) * 16777619;
+
+	return h;
+}
+
+static unsigned int row_hash(const struct top_row *r)
+{
+	return fnv1a(fnv1a(2166136261u, r->name), r->sessname) ^ r->port;
+}
+
+static bool row_same(const struct top_row *r1, const struct top_row *r2)
+{
+	return r1->port == r2->port && r1->dir == r2->dir &&
+	       !strcmp(r1->name, r2->name) &&
+	       !strcmp(r1->sessname, r2->sessname);
+}
+
+/*
+ * Take the samples of the @old rows over to the same objects in @rows,
+ * only the names, counter files and links between the rows are kept.
+ */
+static void rows_take_over(struct top_row *rows, int cnt,
+			  const struct top_row *old, int old_cnt)
+{
+	const struct top_row **hash;
+	unsigned int h, mask, size;
+	struct top_row keep;
+	int i;
+
+	for (size = 16; size < old_cnt * 2; size *= 2)
+		;
+	mask = size - 1;
+	hash = calloc(size, sizeof(*hash));
+	if (!hash)
+		return;
+
+	for (i = 0; i < old_cnt; i++) {
+		for (h = row_hash(&old[i]) & mask; hash[h]; h = (h + 1) & mask)
+			;
+		hash[h] = &old[i];
+	}
+
+	for (i = 0; i < cnt; i++) {
+		for (h = row_hash(&rows[i]) & mask; hash[h]; h = (h + 1) & mask)
+			if (row_same(hash[h], &rows[i]))
+				break;
+		if (!hash[h])
+			continue;
+		keep = rows[i];
+		rows[i] = *hash[h];
+		rows[i].name = keep.name;
+		rows[i].sessname = keep.sessname;
+		rows[i].dir = keep.dir;
+		rows[i].fd = keep.fd;
+		rows[i].migr_fd = keep.migr_fd;
+		rows[i].lat_fd = keep.lat_fd;
+		rows[i].paths = keep.paths;
+		rows[i].path_cnt = keep.path_cnt;
+		rows[i].group = keep.group;
+		rows[i].kept = true;
+	}
+	free(hash);
+}
+
+/*
+ * The counters of the last sample of a session, HCA port or host are
+ * the sums of its paths or sessions again, its rates are kept.
+ */
+static void row_resum(struct top_row *r, const struct top_row *rows,
+		      int cnt, bool group)
+{
+	int i;
+
+	r->rx = r->tx = r->rx_ios = r->tx_ios = r->migr = 0;
+	r->inflights = 0;
+	for (i = 0; i < cnt; i++)
+		if (!group || rows[i].group == r)
+			row_add(r, &rows[i]);
+}
+
+/*
+ * Take the objects again and replace the rows of @t by theirs. Objects
+ * sampled before keep their samples, the others are sampled now, so
+ * that the next sample gives their rates. @t is kept on errors.
+ */
+static int top_rescan(struct top *t, top_snapshot_fn snapshot,
+		      unsigned int objs, struct table_column **cs[5],
+		      const struct rnbd_ctx *ctx)
+{
+	struct top_src src;
+	struct top n;
+	int i, err;
+
+	err = snapshot(&src, objs, ctx);
+	if (err)
+		return err;
+	err = top_init(&n, &src, objs, cs, ctx);
+	if (err)
+		return err;
+
+	rows_take_over(n.devs, n.dev_cnt, t->devs, t->dev_cnt);
+	rows_take_over(n.paths, n.path_cnt, t->paths, t->path_cnt);
+	rows_take_over(n.sess, n.sess_cnt, t->sess, t->sess_cnt);
+	rows_take_over(n.hcas, n.hca_cnt, t->hcas, t->hca_cnt);
+	rows_take_over(n.hosts, n.host_cnt, t->hosts, t->host_cnt);
+
+	for (i = 0; i < n.dev_cnt; i++)
+		if (!n.devs[i].kept)
+			sample_dev(&n.devs[i], 0);
+	for (i = 0; i < n.path_cnt; i++)
+		if (!n.paths[i].kept)
+			sample_path(&n.paths[i], 0);
+	for (i = 0; i < n.sess_cnt; i++)
+		row_resum(&n.sess[i], n.sess[i].paths, n.sess[i].path_cnt,
+			  false);
+	for (i = 0; i < n.hca_cnt; i++)
+		row_resum(&n.hcas[i], n.paths, n.path_cnt, true);
+	for (i = 0; i < n.host_cnt; i++)
+		row_resum(&n.hosts[i], n.sess, n.sess_cnt, true);
+
+	n.ns = t->ns;
+	n.time = t->time;
+	top_free(t);
+	*t = n;
+
+	return 0;
+}
+
+/*
+ * Sample every ctx->interval_ms and call @print after each sample
+ * but the first one, which only provides the base for the rates. The
+ * objects are taken again with @snapshot when a counter of one can't
+ * be read anymore, and every TOP_RESCAN_NS for the new ones.
+ */
+static void top_loop(struct top *t, top_snapshot_fn snapshot,
+		     unsigned int objs, struct table_column **cs[5],
+		     void (*print)(struct top *t, int refresh,
+				   const struct rnbd_ctx *ctx),
+		     const struct rnbd_ctx *ctx)
+{
+	uint64_t last, now, next, interval, scanned;
+	struct timespec ts;
+	int i;
+
+	interval = ctx->interval_ms * NSEC_PER_MSEC;
+	last = scanned = now_ns();
+	sample_all(t, 0);
+
+	for (i = 0, next = last; !ctx->count || i < ctx->count; i++) {
+		/* don't try to catch up when a refresh took too long */
+		next += interval;
+		now = now_ns();
+		if (next < now)
+			next = now;
+
+		ts.tv_sec = next / NSEC_PER_SEC;
+		ts.tv_nsec = next % NSEC_PER_SEC;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+				       NULL) == EINTR)
+			;
+
+		now = now_ns();
+		sample_all(t, now - last);
+		last = now;
+
+		/* on errors the old rows are shown until the next try */
+		if (t->stale || now - scanned >= TOP_RESCAN_NS) {
+			top_rescan(t, snapshot, objs, cs, ctx);
+			t->stale = false;
+			scanned = now;
+		}
+
+		print(t, i, ctx);
+	}
+}
+
+static int top_start(top_snapshot_fn snapshot, unsigned int objs,
+		     struct table_column **cs[5],
+		     void (*print)(struct top *t, int refresh,
+				   const struct rnbd_ctx *ctx),
+		     const struct rnbd_ctx *ctx)
+{
+	struct top_src src;
+	struct top t;
+	int err;
+
+	err = snapshot(&src, objs, ctx);
+	if (err)
+		return err;
+	err = top_init(&t, &src, objs, cs, ctx);
+	if (err)
+		return err;
+
+	top_loop(&t, snapshot, objs, cs, print, ctx);
+	top_free(&t);
+
+	return 0;
+}
+
+int top_run(top_snapshot_fn snapshot, unsigned int objs,
+	    const struct rnbd_ctx *ctx)
+{
+	struct table_column **cs[5] = {
+		clms_top_devices, clms_top_sessions, clms_top_paths,
+		clms_top_hcas, clms_top_hosts
+	};
+
+	return top_start(snapshot, objs, cs, top_print, ctx);
+}
+
+#define WATCH_CLMS_LEN (CLM_MAX_CNT * 16)
+/* fields besides the up to two name columns and the NULL */
+#define WATCH_CLMS_MAX (CLM_MAX_CNT - 3)
+
+/* copy the comma separated @names to @buf, false if they do not fit */
+static bool watch_clms_copy(const char *names, char *buf)
+{
+	if (strlen(names) >= WATCH_CLMS_LEN)
+		return false;
+
+	strcpy(buf, names);
+
+	return true;
+}
+
+/*
+ * The name columns of @all followed by the columns named in the comma
+ * separated list @names which are in @all as well, at most
+ * CLM_MAX_CNT - 1 of them.
+ */
+static void watch_select_clms(const char *names, struct table_column **all,
+			      struct table_column **cs)
+{
+	char buf[WATCH_CLMS_LEN], *tok, *save;
+	struct table_column *c;
+	int cnt = 0;
+
+	for (; *all && ((*all)->m_type == FLD_STR ||
+			(*all)->m_type == FLD_VAL); all++)
+		cs[cnt++] = *all;
+
+	if (!names) {
+		while (*all && cnt < CLM_MAX_CNT - 1)
+			cs[cnt++] = *all++;
+		cs[cnt] = NULL;
+		return;
+	}
+
+	if (!watch_clms_copy(names, buf))
+		buf[0] = '\0';
+	for (tok = strtok_r(buf, ",", &save); tok && cnt < CLM_MAX_CNT - 1;
+	     tok = strtok_r(NULL, ",", &save)) {
+		c = table_find_column(tok, all);
+		if (c)
+			cs[cnt++] = c;
+	}
+	cs[cnt] = NULL;
+}
+
+/*
+ * The fields @names must be known, given once and leave room for the
+ * name columns.
+ */
+static bool watch_clms_valid(const char *names)
+{
+	char buf[WATCH_CLMS_LEN], *tok, *save;
+	struct table_column *seen[CLM_MAX_CNT], *c;
+	int i, cnt = 0;
+
+	if (!watch_clms_copy(names, buf)) {
+		ERR(trm, "Too many fields\n");
+		return false;
+	}
+
+	for (tok = strtok_r(buf, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		c = table_find_column(tok, all_clms_watch);
+		if (!c) {
+			ERR(trm, "Unknown field '%s'\n", tok);
+			return false;
+		}
+		for (i = 0; i < cnt; i++)
+			if (seen[i] == c)
+				break;
+		if (i < cnt) {
+			ERR(trm, "Field '%s' given twice\n", tok);
+			return false;
+		}
+		if (cnt == WATCH_CLMS_MAX) {
+			ERR(trm, "Too many fields\n");
+			return false;
+		}
+		seen[cnt++] = c;
+	}
+
+	return true;
+}
+
+int watch_run(top_snapshot_fn snapshot, unsigned int objs, const char *clms,
+	      const struct rnbd_ctx *ctx)
+{
+	struct table_column *devs[CLM_MAX_CNT], *sess[CLM_MAX_CNT],
+			    *paths[CLM_MAX_CNT], *hcas[CLM_MAX_CNT],
+			    *hosts_cs[CLM_MAX_CNT];
+	struct table_column **cs[5] = { devs, sess, paths, hcas, hosts_cs };
+
+	if (clms && !watch_clms_valid(clms))
+		return -EINVAL;
+
+	watch_select_clms(clms, clms_watch_devices, devs);
+	watch_select_clms(clms, clms_watch_sessions, sess);
+	watch_select_clms(clms, clms_watch_paths, paths);
+	watch_select_clms(clms, clms_watch_hcas, hcas);
+	watch_select_clms(clms, clms_watch_hosts, hosts_cs);
+
+	return top_start(snapshot, objs, cs, watch_print, ctx);
+}
@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Configuration tool for RNBD driver and RTRS library.
+ *
+ * Copyright (c) 2019 1&1 IONOS SE. All rights reserved.
+ * Authors: Danil Kipnis <danil.kipnis@cloud.ionos.com>
+ *          Lutz Pogrell <lutz.pogrell@cloud.ionos.com>
+ */
+
+#ifndef __H_TOP
+#define __H_TOP
+
+struct rnbd_sess_dev;
+struct rnbd_sess;
+struct rnbd_hca_port;
+struct rnbd_host;
+struct table_column;
+struct rnbd_ctx;
+
+/* objects shown by top */
+enum top_objs {
+	TOP_DEVICES	= 1 << 0,
+	TOP_SESSIONS	= 1 << 1,
+	TOP_PATHS	= 1 << 2,
+	TOP_ALL		= TOP_DEVICES | TOP_SESSIONS | TOP_PATHS,
+	TOP_HCAS	= 1 << 3,	/* only on request */
+	TOP_HOSTS	= 1 << 4,	/* only on request */
+};
+
+/* all the columns of top and watch, NULL terminated */
+extern struct table_column *all_clms_top[];
+extern struct table_column *all_clms_watch[];
+
+/*
+ * The objects shown by top, NULL terminated arrays of which any may be
+ * NULL. The rates of the HCA @ports are the sums of the paths of the
+ * sessions using them, the rates of the @hosts the sums of their
+ * sessions.
+ */
+struct top_src {
+	struct rnbd_sess_dev	**sds_clt;
+	struct rnbd_sess_dev	**sds_srv;
+	struct rnbd_sess	**sess_clt;
+	struct rnbd_sess	**sess_srv;
+	struct rnbd_hca_port	**ports;
+	struct rnbd_host	**hosts;
+};
+
+/*
+ * Take the objects in @objs from sysfs into @src, replacing the ones
+ * taken before. Returns -errno.
+ */
+typedef int (*top_snapshot_fn)(struct top_src *src, unsigned int objs,
+			       const struct rnbd_ctx *ctx);
+
+/*
+ * Refresh per second rates of the objects taken by @snapshot every
+ * ctx->interval_ms, until ctx->count refreshes were shown or forever if
+ * it is 0. The objects are taken again when one of them is gone and
+ * every few seconds, so that objects added or removed meanwhile come
+ * and go.
+ */
+int top_run(top_snapshot_fn snapshot, unsigned int objs,
+	    const struct rnbd_ctx *ctx);
+
+/*
+ * Like top_run(), but print every sample as a single line of JSON with
+ * the columns in the comma separated list @clms (NULL: all of them).
+ */
+int watch_run(top_snapshot_fn snapshot, unsigned int objs, const char *clms,
+	      const struct rnbd_ctx *ctx);
+
+#endif /* __H_TOP */